@@ -0,0 +1,200 @@
+#include "AssetCache.h"
+
+#include "Core/Hash.h"
+#include "Logging/Log.h"
+
+#include <algorithm>
+#include <fstream>
+#include <unordered_set>
+
+/***********************************************************************************/
+MeshPtr AssetCache::loadMesh(const std::string_view modelPath, const std::string_view texturePath) {
+	const auto texture = loadTexture(texturePath);
+	const auto key = normalizePath(modelPath) + '|' + texture->path;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (auto mesh = find(m_meshes.byPath, key)) {
+			return mesh;
+		}
+	}
+
+	// Same geometry + same texture object means the same mesh, whatever the paths were
+	const auto modelHash = hashFile(normalizePath(modelPath));
+	const auto textureAddress = reinterpret_cast<std::uintptr_t>(texture.get());
+	const auto hash = modelHash ? Hash::fnv1a(&textureAddress, sizeof(textureAddress), modelHash) : 0;
+
+	if (hash) {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (auto mesh = m_meshes.byHash[hash].lock()) {
+			m_meshes.byPath[key] = mesh;
+			return mesh;
+		}
+	}
+
+	auto mesh = Mesh::loadModel(modelPath, texture);
+	if (!mesh) {
+		LOG_CRITICAL("Failed to load model.");
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	// Another thread may have finished the same load first, keep the one already handed out
+	if (auto existing = find(m_meshes.byPath, key)) {
+		return existing;
+	}
+
+	m_meshes.byPath[key] = mesh;
+	if (hash) {
+		m_meshes.byHash[hash] = mesh;
+	}
+
+	return mesh;
+}
+
+/***********************************************************************************/
+TexturePtr AssetCache::loadTexture(const std::string_view path) {
+	const auto key = normalizePath(path);
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (auto texture = find(m_textures.byPath, key)) {
+			return texture;
+		}
+	}
+
+	const auto hash = hashFile(key);
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (auto existing = find(m_textures.byPath, key)) {
+		return existing;
+	}
+
+	if (hash) {
+		if (auto texture = m_textures.byHash[hash].lock()) {
+			m_textures.byPath[key] = texture;
+			return texture;
+		}
+	}
+	else {
+		spdlog::get("console")->error("Failed to read texture {}.", key);
+	}
+
+	// Pixels are read when the render system uploads it
+	auto texture = std::make_shared<Texture>(key);
+	m_textures.byPath[key] = texture;
+	if (hash) {
+		m_textures.byHash[hash] = texture;
+	}
+
+	return texture;
+}
+
+/***********************************************************************************/
+std::vector<MeshPtr> AssetCache::findMeshes(const std::string_view modelPath) const {
+	// Keys are "model|texture"
+	const auto prefix = normalizePath(modelPath) + '|';
+
+	std::vector<MeshPtr> meshes;
+	std::lock_guard<std::mutex> lock(m_mutex);
+	for (const auto& entry : m_meshes.byPath) {
+		if (entry.first.compare(0, prefix.size(), prefix) != 0) {
+			continue;
+		}
+
+		auto mesh = entry.second.lock();
+		if (mesh && std::find(meshes.begin(), meshes.end(), mesh) == meshes.end()) {
+			meshes.push_back(std::move(mesh));
+		}
+	}
+
+	return meshes;
+}
+
+/***********************************************************************************/
+TexturePtr AssetCache::findTexture(const std::string_view path) const {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return find(m_textures.byPath, normalizePath(path));
+}
+
+/***********************************************************************************/
+void AssetCache::forgetContents(const std::string_view path) {
+	const auto meshes = findMeshes(path);
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	for (const auto& mesh : meshes) {
+		forgetHash(m_meshes, mesh.get());
+	}
+	if (const auto texture = find(m_textures.byPath, normalizePath(path))) {
+		forgetHash(m_textures, texture.get());
+	}
+}
+
+/***********************************************************************************/
+std::size_t AssetCache::meshCount() const {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return countAlive(m_meshes);
+}
+
+/***********************************************************************************/
+std::size_t AssetCache::textureCount() const {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return countAlive(m_textures);
+}
+
+/***********************************************************************************/
+std::string AssetCache::normalizePath(const std::string_view path) {
+	std::string result(path);
+	std::replace(result.begin(), result.end(), '\\', '/');
+	return result;
+}
+
+/***********************************************************************************/
+std::uint64_t AssetCache::hashFile(const std::string& path) {
+	std::ifstream file(path, std::ios::binary);
+	if (!file) {
+		return 0;
+	}
+
+	auto hash = Hash::FnvOffsetBasis;
+	char buffer[64 * 1024];
+	while (file.read(buffer, sizeof(buffer)) || file.gcount() > 0) {
+		hash = Hash::fnv1a(buffer, static_cast<std::size_t>(file.gcount()), hash);
+	}
+
+	return hash;
+}
+
+/***********************************************************************************/
+template<typename T>
+std::shared_ptr<T> AssetCache::find(const std::unordered_map<std::string, std::weak_ptr<T>>& entries, const std::string& key) {
+	const auto it = entries.find(key);
+	return it != entries.end() ? it->second.lock() : nullptr;
+}
+
+/***********************************************************************************/
+template<typename T>
+std::size_t AssetCache::countAlive(const Entries<T>& entries) {
+	// Several paths can lead to one asset
+	std::unordered_set<const T*> alive;
+	for (const auto& entry : entries.byPath) {
+		if (const auto asset = entry.second.lock()) {
+			alive.insert(asset.get());
+		}
+	}
+
+	return alive.size();
+}
+
+/***********************************************************************************/
+template<typename T>
+void AssetCache::forgetHash(Entries<T>& entries, const T* asset) {
+	for (auto it = entries.byHash.begin(); it != entries.byHash.end();) {
+		const auto existing = it->second.lock();
+		if (!existing || existing.get() == asset) {
+			it = entries.byHash.erase(it);
+		}
+		else {
+			++it;
+		}
+	}
+}
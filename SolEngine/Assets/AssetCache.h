@@ -0,0 +1,65 @@
+#pragma once
+
+#include "Graphics/Mesh.h"
+#include "Graphics/Texture.h"
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Loads meshes and textures once and hands out shared references to them.
+// Assets are found by path first, then by a hash of the file contents, so the same file under
+// two paths (or a copy of it) is still loaded once. The cache only keeps weak references: an
+// asset goes away with its last handle (the render system keeps its own while the GPU copy lives).
+class AssetCache {
+
+public:
+	AssetCache() = default;
+
+	AssetCache(const AssetCache&) = delete;
+	AssetCache& operator=(const AssetCache&) = delete;
+
+	// Meshes are keyed by the model and its texture, the same OBJ with another texture is a different mesh.
+	// A model that fails to load is fatal.
+	MeshPtr loadMesh(const std::string_view modelPath, const std::string_view texturePath);
+	TexturePtr loadTexture(const std::string_view path);
+
+	// Alive assets loaded from a file, for reloading them in place
+	std::vector<MeshPtr> findMeshes(const std::string_view modelPath) const;
+	TexturePtr findTexture(const std::string_view path) const;
+	// The file's contents changed: assets loaded from it no longer match their content hash
+	void forgetContents(const std::string_view path);
+
+	// Assets that are still alive
+	std::size_t meshCount() const;
+	std::size_t textureCount() const;
+
+private:
+	/***********************************************************************************/
+	template<typename T>
+	struct Entries {
+		std::unordered_map<std::string, std::weak_ptr<T>> byPath;
+		std::unordered_map<std::uint64_t, std::weak_ptr<T>> byHash;
+	};
+	/***********************************************************************************/
+
+	// Slashes unified, so "Data\\a.jpg" and "Data/a.jpg" are one asset
+	static std::string normalizePath(const std::string_view path);
+	// FNV-1a over the file contents, 0 if the file can't be read
+	static std::uint64_t hashFile(const std::string& path);
+
+	template<typename T>
+	static std::shared_ptr<T> find(const std::unordered_map<std::string, std::weak_ptr<T>>& entries, const std::string& key);
+	template<typename T>
+	static std::size_t countAlive(const Entries<T>& entries);
+	template<typename T>
+	static void forgetHash(Entries<T>& entries, const T* asset);
+
+	// Guards the maps only: loading happens unlocked so background loads don't serialize
+	mutable std::mutex m_mutex;
+	Entries<Mesh> m_meshes;
+	Entries<Texture> m_textures;
+};
@@ -0,0 +1,185 @@
+#include "FileWatcher.h"
+
+#include "Logging/Log.h"
+
+#include <filesystem>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+/***********************************************************************************/
+FileWatcher::~FileWatcher() {
+	stop();
+}
+
+/***********************************************************************************/
+void FileWatcher::start(const std::vector<std::string>& directories) {
+	stop();
+
+	m_directories = directories;
+	m_running = true;
+	m_thread = std::thread(&FileWatcher::run, this);
+}
+
+/***********************************************************************************/
+void FileWatcher::stop() {
+	m_running = false;
+	if (m_thread.joinable()) {
+		m_thread.join();
+	}
+}
+
+/***********************************************************************************/
+std::vector<std::string> FileWatcher::changes() {
+	const auto now = Clock::now();
+	std::vector<std::string> settled;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	for (auto it = m_pending.begin(); it != m_pending.end();) {
+		if (now - it->second >= SettleTime) {
+			settled.push_back(it->first);
+			it = m_pending.erase(it);
+		}
+		else {
+			++it;
+		}
+	}
+
+	return settled;
+}
+
+/***********************************************************************************/
+void FileWatcher::run() {
+#ifdef __linux__
+	if (runInotify()) {
+		return;
+	}
+	LOG_ERROR("inotify unavailable, polling for file changes.");
+#endif
+	runPolling();
+}
+
+#ifdef __linux__
+/***********************************************************************************/
+bool FileWatcher::runInotify() {
+	const auto inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (inotify < 0) {
+		return false;
+	}
+
+	// Watch descriptor -> directory, inotify watches aren't recursive
+	std::unordered_map<int, std::string> watches;
+	for (const auto& directory : m_directories) {
+		addWatches(inotify, directory, watches);
+	}
+
+	alignas(inotify_event) char buffer[16 * 1024];
+	while (m_running) {
+		// Timeout so stop() is noticed
+		pollfd descriptor { inotify, POLLIN, 0 };
+		if (poll(&descriptor, 1, 100) <= 0) {
+			continue;
+		}
+
+		ssize_t length;
+		while ((length = read(inotify, buffer, sizeof(buffer))) > 0) {
+			for (auto* p = buffer; p < buffer + length;) {
+				const auto* event = reinterpret_cast<const inotify_event*>(p);
+				p += sizeof(inotify_event) + event->len;
+
+				const auto directory = watches.find(event->wd);
+				if (directory == watches.end() || event->len == 0) {
+					continue;
+				}
+
+				const auto path = directory->second + '/' + event->name;
+				if (event->mask & IN_ISDIR) {
+					// New subdirectory: watch it, and pick up whatever was written into it already
+					if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+						addWatches(inotify, path, watches);
+					}
+					continue;
+				}
+
+				record(path);
+			}
+		}
+	}
+
+	close(inotify);
+	return true;
+}
+
+/***********************************************************************************/
+void FileWatcher::addWatches(const int inotify, const std::string& directory, std::unordered_map<int, std::string>& watches) const {
+	std::error_code error;
+	if (!fs::is_directory(directory, error)) {
+		return;
+	}
+
+	// Files finished writing (IN_CLOSE_WRITE) or moved into place (IN_MOVED_TO, how most editors save)
+	constexpr std::uint32_t Mask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE;
+
+	const auto wd = inotify_add_watch(inotify, directory.c_str(), Mask);
+	if (wd >= 0) {
+		watches[wd] = directory;
+	}
+
+	for (fs::recursive_directory_iterator it(directory, error), end; !error && it != end; it.increment(error)) {
+		if (it->is_directory(error)) {
+			const auto path = it->path().generic_string();
+			const auto subWd = inotify_add_watch(inotify, path.c_str(), Mask);
+			if (subWd >= 0) {
+				watches[subWd] = path;
+			}
+		}
+	}
+}
+#endif
+
+/***********************************************************************************/
+void FileWatcher::runPolling() {
+	std::unordered_map<std::string, fs::file_time_type> writeTimes;
+	auto firstScan = true;
+
+	while (m_running) {
+		for (const auto& directory : m_directories) {
+			std::error_code error;
+			for (fs::recursive_directory_iterator it(directory, error), end; !error && it != end; it.increment(error)) {
+				if (!it->is_regular_file(error)) {
+					continue;
+				}
+
+				const auto writeTime = it->last_write_time(error);
+				if (error) {
+					continue;
+				}
+
+				auto& known = writeTimes[it->path().generic_string()];
+				// The first scan only learns what's there
+				if (!firstScan && known != writeTime) {
+					record(it->path().generic_string());
+				}
+				known = writeTime;
+			}
+		}
+		firstScan = false;
+
+		// Sleep in short steps so stop() doesn't wait a whole interval
+		const auto wakeUp = Clock::now() + PollInterval;
+		while (m_running && Clock::now() < wakeUp) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		}
+	}
+}
+
+/***********************************************************************************/
+void FileWatcher::record(const std::string& path) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_pending[path] = Clock::now();
+}
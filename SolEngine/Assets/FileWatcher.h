@@ -0,0 +1,53 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Reports files that changed below a set of directories (subdirectories included).
+// Uses inotify on Linux and polls modification times elsewhere (or when inotify is unavailable).
+// Events are gathered on a background thread. A file is only reported once it has been quiet
+// for SettleTime, editors and compilers often write a file in several steps.
+class FileWatcher {
+
+public:
+	using Clock = std::chrono::steady_clock;
+
+	static constexpr std::chrono::milliseconds SettleTime { 200 };
+	static constexpr std::chrono::milliseconds PollInterval { 500 };
+
+	FileWatcher() = default;
+	~FileWatcher();
+
+	FileWatcher(const FileWatcher&) = delete;
+	FileWatcher& operator=(const FileWatcher&) = delete;
+
+	void start(const std::vector<std::string>& directories);
+	void stop();
+
+	// Paths that changed and settled since the last call, '/'-separated and relative the way the
+	// directories were given (e.g. "Data/Shaders/vert.spv").
+	std::vector<std::string> changes();
+
+private:
+	void run();
+#ifdef __linux__
+	// Returns false when inotify can't be used, run() falls back to polling
+	bool runInotify();
+	void addWatches(const int inotify, const std::string& directory, std::unordered_map<int, std::string>& watches) const;
+#endif
+	void runPolling();
+	void record(const std::string& path);
+
+	std::vector<std::string> m_directories;
+	std::thread m_thread;
+	std::atomic<bool> m_running { false };
+
+	std::mutex m_mutex;
+	// Path -> time of its last event
+	std::unordered_map<std::string, Clock::time_point> m_pending;
+};
@@ -0,0 +1,194 @@
+#include "HotReloader.h"
+
+#include "Core/RenderSystem.h"
+#include "Logging/Log.h"
+
+#include <stb_image.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+
+namespace {
+	constexpr std::uint32_t SpirvMagic = 0x07230203;
+
+	/***********************************************************************************/
+	std::string extension(const std::string& path) {
+		const auto dot = path.find_last_of('.');
+		if (dot == std::string::npos) {
+			return {};
+		}
+
+		auto result = path.substr(dot);
+		std::transform(result.begin(), result.end(), result.begin(), [](const unsigned char c) { return static_cast<char>(std::tolower(c)); });
+		return result;
+	}
+
+	/***********************************************************************************/
+	// A half-written or failed compile shouldn't take the old pipeline down
+	bool isSpirv(const std::string& path) {
+		std::ifstream file(path, std::ios::ate | std::ios::binary);
+		if (!file) {
+			return false;
+		}
+
+		const auto size = static_cast<std::size_t>(file.tellg());
+		if (size < 5 * sizeof(std::uint32_t) || size % sizeof(std::uint32_t) != 0) {
+			return false;
+		}
+
+		std::uint32_t magic = 0;
+		file.seekg(0);
+		file.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+
+		return magic == SpirvMagic;
+	}
+}
+
+/***********************************************************************************/
+HotReloader::HotReloader(AssetCache& assets, RenderSystem& renderSystem) : m_assets(assets), m_renderSystem(renderSystem) {
+}
+
+/***********************************************************************************/
+HotReloader::~HotReloader() {
+	stop();
+}
+
+/***********************************************************************************/
+void HotReloader::start(const std::vector<std::string>& directories) {
+	stop();
+
+	m_watcher.start(directories);
+	m_running = true;
+	m_thread = std::thread(&HotReloader::run, this);
+}
+
+/***********************************************************************************/
+void HotReloader::stop() {
+	m_running = false;
+	if (m_thread.joinable()) {
+		m_thread.join();
+	}
+	m_watcher.stop();
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_ready.clear();
+}
+
+/***********************************************************************************/
+void HotReloader::apply() {
+	std::vector<Reload> ready;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		ready.swap(m_ready);
+	}
+
+	for (auto& reload : ready) {
+		if (reload.mesh) {
+			m_renderSystem.reloadMesh(*reload.mesh, std::move(*reload.loadedMesh));
+		}
+		else if (reload.texture) {
+			m_renderSystem.reloadTexture(*reload.texture, reload.pixels.data(), reload.width, reload.height);
+		}
+		else if (reload.shader) {
+			m_renderSystem.reloadShader(reload.path);
+			continue;
+		}
+
+		spdlog::get("console")->info("Reloaded {}", reload.path);
+	}
+}
+
+/***********************************************************************************/
+void HotReloader::run() {
+	while (m_running) {
+		for (const auto& path : m_watcher.changes()) {
+			load(path);
+		}
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	}
+}
+
+/***********************************************************************************/
+void HotReloader::load(const std::string& path) {
+	const auto type = extension(path);
+	std::vector<Reload> reloads;
+
+	if (type == ".obj") {
+		const auto meshes = m_assets.findMeshes(path);
+		if (meshes.empty()) {
+			return;
+		}
+		m_assets.forgetContents(path);
+
+		// Parsed without a texture: reloadMesh keeps each mesh's own texture and shader on the main thread,
+		// which also moves mesh->texture around, so this thread must not read it
+		auto loaded = Mesh::loadModel(path, nullptr);
+		if (!loaded) {
+			spdlog::get("console")->error("Reloading {} failed, keeping the old mesh.", path);
+			return;
+		}
+
+		// Every texture the model is used with gets its own copy of the geometry
+		for (const auto& mesh : meshes) {
+			Reload reload;
+			reload.path = path;
+			reload.mesh = mesh;
+			reload.loadedMesh = mesh == meshes.back() ? std::move(loaded) : std::make_shared<Mesh>(*loaded);
+			reloads.push_back(std::move(reload));
+		}
+	}
+	else if (type == ".jpg" || type == ".jpeg" || type == ".png" || type == ".tga" || type == ".bmp") {
+		auto texture = m_assets.findTexture(path);
+		if (!texture) {
+			return;
+		}
+		m_assets.forgetContents(path);
+
+		Reload reload;
+		int channels = 0;
+		auto* pixels = stbi_load(path.c_str(), &reload.width, &reload.height, &channels, STBI_rgb_alpha);
+		if (!pixels) {
+			spdlog::get("console")->error("Reloading {} failed, keeping the old texture.", path);
+			return;
+		}
+
+		reload.pixels.assign(pixels, pixels + static_cast<std::size_t>(reload.width) * reload.height * 4);
+		stbi_image_free(pixels);
+
+		reload.path = path;
+		reload.texture = std::move(texture);
+		reloads.push_back(std::move(reload));
+	}
+	else if (type == ".vert" || type == ".frag" || type == ".comp") {
+		// Compile here so the pipeline rebuild in apply() only reads the cache
+		m_renderSystem.shaderCache().recompile(path);
+
+		Reload reload;
+		reload.path = path;
+		reload.shader = true;
+		reloads.push_back(std::move(reload));
+	}
+	else if (type == ".spv") {
+		if (!isSpirv(path)) {
+			spdlog::get("console")->error("{} is not valid SPIR-V, keeping the old pipeline.", path);
+			return;
+		}
+
+		Reload reload;
+		reload.path = path;
+		reload.shader = true;
+		reloads.push_back(std::move(reload));
+	}
+
+	if (reloads.empty()) {
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	for (auto& reload : reloads) {
+		m_ready.push_back(std::move(reload));
+	}
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "AssetCache.h"
+#include "FileWatcher.h"
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class RenderSystem;
+
+// Reloads assets whose files changed while the engine runs: OBJ models, textures and shaders (GLSL or SPIR-V).
+// Files are parsed/decoded on a worker thread. apply() hands the results to the render system
+// between frames, so a reload never waits on disk and never touches resources the GPU is using.
+// Only assets that are currently loaded get reloaded.
+class HotReloader {
+
+public:
+	HotReloader(AssetCache& assets, RenderSystem& renderSystem);
+	~HotReloader();
+
+	HotReloader(const HotReloader&) = delete;
+	HotReloader& operator=(const HotReloader&) = delete;
+
+	void start(const std::vector<std::string>& directories);
+	void stop();
+
+	// Call between frames
+	void apply();
+
+private:
+	/***********************************************************************************/
+	struct Reload {
+		std::string path;
+
+		MeshPtr mesh;
+		MeshPtr loadedMesh;
+
+		TexturePtr texture;
+		std::vector<unsigned char> pixels;
+		int width = 0, height = 0;
+
+		bool shader = false;
+	};
+	/***********************************************************************************/
+
+	void run();
+	void load(const std::string& path);
+
+	AssetCache& m_assets;
+	RenderSystem& m_renderSystem;
+
+	FileWatcher m_watcher;
+	std::thread m_thread;
+	std::atomic<bool> m_running { false };
+
+	std::mutex m_mutex;
+	// Finished loads waiting for apply()
+	std::vector<Reload> m_ready;
+};
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// 64-bit FNV-1a. Stable across runs and platforms, so it can key files on disk.
+namespace Hash {
+	constexpr std::uint64_t FnvOffsetBasis = 14695981039346656037ull;
+	constexpr std::uint64_t FnvPrime = 1099511628211ull;
+
+	// Pass the previous result as seed to hash several pieces as one
+	inline std::uint64_t fnv1a(const void* data, const std::size_t size, std::uint64_t seed = FnvOffsetBasis) noexcept {
+		const auto* bytes = static_cast<const unsigned char*>(data);
+		for (std::size_t i = 0; i < size; ++i) {
+			seed = (seed ^ bytes[i]) * FnvPrime;
+		}
+		return seed;
+	}
+}
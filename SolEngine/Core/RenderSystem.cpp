@@ -4,6 +4,7 @@
 #include "WindowSystem.h"
 #include "Input.h"
 #include "Graphics/Vertex.h"
+#include "ECS/Components.h"
 #include "Logging/Log.h"
 
 #include <GLFW/GLFW3.h>
@@ -14,6 +15,43 @@
 #include <stb_image.h>
 
 #include <fstream>
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <utility>
+#include <initializer_list>
+
+namespace {
+	// Minimum size of the shared geometry buffers, grown to fit the meshes known at init
+	constexpr VkDeviceSize VertexPoolSize = 64 * 1024 * 1024;
+	constexpr VkDeviceSize IndexPoolSize = 32 * 1024 * 1024;
+
+	// Largest on-screen deviation (in pixels) a LOD may introduce before a finer one is used
+	constexpr float LodPixelError = 1.0f;
+
+	// Hi-Z pyramid levels, enough for a 65536 pixel wide depth buffer (level 0 is half of it)
+	constexpr std::uint32_t MaxHiZLevels = 16;
+
+	// Minimum object/meshlet slots, grown to fit the world at init
+	constexpr std::uint32_t MinObjectCapacity = 1024;
+	constexpr std::uint32_t MinMeshletCapacity = 64 * 1024;
+
+	// Light clusters: screen tiles times depth slices, each listing up to MaxLightsPerCluster lights.
+	// Lights past that are left out of the cluster's shading, debug builds log when it happens.
+	// (MaxLightsPerCluster must match light_cull.comp and basic.frag)
+	constexpr std::uint32_t ClusterTilesX = 16, ClusterTilesY = 9, ClusterSlices = 24;
+	constexpr std::uint32_t ClusterCount = ClusterTilesX * ClusterTilesY * ClusterSlices;
+	constexpr std::uint32_t MaxLightsPerCluster = 128;
+
+	// Elements of basic.frag's texture array (must match MaxTextures there)
+	constexpr std::uint32_t MaxTextures = 64;
+
+	// Minimum point light slots, grown to fit the world at init
+	constexpr std::uint32_t MinLightCapacity = 16 * 1024;
+
+	// Below this many objects a linear sweep over the spheres beats maintaining the BVH
+	constexpr std::size_t BvhMinObjects = 256;
+}
 
 /***********************************************************************************/
 #ifdef _DEBUG
@@ -58,6 +96,19 @@ void DestroyDebugReportCallbackEXT(
 }
 #endif
 
+/***********************************************************************************/
+// The engine writes these descriptors into set 0. Shaders (or stale SPIR-V from compile.bat) that declare
+// something else would be fed the wrong resources, so that's fatal.
+void requireBindings(const ShaderReflection& reflection, const char* shaders, const std::initializer_list<std::pair<std::uint32_t, VkDescriptorType>> expected) {
+	for (const auto& [binding, type] : expected) {
+		const auto* declared = reflection.findBinding(0, binding);
+		if (!declared || declared->type != type) {
+			spdlog::get("console")->critical("{} don't declare binding {} the way the engine writes it, is the SPIR-V out of date?", shaders, binding);
+			std::abort();
+		}
+	}
+}
+
 /***********************************************************************************/
 VkSurfaceFormatKHR chooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& availableFormats) {
 	if (availableFormats.size() == 1 && availableFormats[0].format == VK_FORMAT_UNDEFINED) {
@@ -104,7 +155,33 @@ VkExtent2D chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities, const
 
 /***********************************************************************************/
 void RenderSystem::addMeshes(const std::vector<MeshPtr>& meshes) {
-	m_meshes = meshes;
+	for (const auto& mesh : meshes) {
+		addMesh(mesh);
+	}
+}
+
+/***********************************************************************************/
+std::uint32_t RenderSystem::addMesh(const MeshPtr& mesh) {
+	// A mesh shared through the AssetCache gets one slot (and one upload) however often it's added
+	const auto it = std::find(m_meshes.begin(), m_meshes.end(), mesh);
+	if (it != m_meshes.end()) {
+		return static_cast<std::uint32_t>(std::distance(m_meshes.begin(), it));
+	}
+
+	auto slot = std::find(m_meshes.begin(), m_meshes.end(), nullptr);
+	if (slot == m_meshes.end()) {
+		slot = m_meshes.insert(m_meshes.end(), mesh);
+	}
+	else {
+		*slot = mesh;
+	}
+
+	// Before init everything is uploaded at once by prepareMeshes
+	if (m_vertexPool.capacity() > 0) {
+		makeResident(*mesh);
+	}
+
+	return static_cast<std::uint32_t>(std::distance(m_meshes.begin(), slot));
 }
 
 /***********************************************************************************/
@@ -118,25 +195,47 @@ void RenderSystem::init() {
 	createMemoryAllocator();
 	createSwapChain();
 	createImageViews();
-	createRenderPass();
-	createDescriptorSetLayout();
-	createGraphicsPipeline();
+	createLayouts();
 	createCommandPools();
-	createDepthAttachment();
-	createFramebuffers(); // Needs to be called after depth attachment is created.
 	prepareMeshes();
 	createTextureSampler();
 	createUniformBuffer();
+	createObjectBuffers();
+	createMeshletBuffers();
+	createLightBuffers();
 	createDescriptorPools();
 	createDescriptorSet();
+	createCullPipeline();
+	createLightCulling();
+	buildRenderGraph(); // Needs the buffers the passes use
+	createGraphicsPipeline(); // Needs the forward pass's render pass
 	createCommandBuffers();
 	createSemaphores();
+	createTimestampQueries();
 }
 
 /***********************************************************************************/
-void RenderSystem::update(const float delta) {
+void RenderSystem::update(const float) {
+#ifdef _DEBUG
+	// Check last frame's GPU result while the CPU side still holds what it was culled with
+	if (m_gpuCulling) {
+		validateGpuCulling();
+	}
+	reportLightClusterOverflow();
+#endif
 
-	updateUniformBuffer(delta);
+	updateUniformBuffer();
+	updateLightBuffer();
+	updateObjectBuffer();
+	// The previous frame is done with the GPU and this one only draws meshes that have instances
+	releaseUnusedAssets();
+#ifdef _DEBUG
+	cullMeshes();
+#else
+	if (!m_gpuCulling) {
+		cullMeshes();
+	}
+#endif
 
 	// Window size changed.
 	if (Input::GetInstance().ShouldResize() && 
@@ -158,6 +257,8 @@ void RenderSystem::update(const float delta) {
 		std::abort();
 	}
 
+	recordCommandBuffer(imageIndex);
+
 	VkSubmitInfo submitInfo {};
 	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
@@ -200,28 +301,56 @@ void RenderSystem::update(const float delta) {
 	}
 
 	vkQueueWaitIdle(m_presentQueue);
+
+	reportTransientMemory();
+	updateBenchmark();
 }
 
 /***********************************************************************************/
 void RenderSystem::shutdown() {
 	cleanupSwapChain();
 
+	m_pipelineCache.shutdown();
+
 	vkDestroySampler(m_device.getDevice(), m_textureSampler, nullptr);
 
 	// Cleanup mesh resources
-	for (auto& mesh : m_meshes) {
-		// VMA cleans object and memory allocation all-in-one
-		vmaDestroyBuffer(m_allocator, mesh->indexBuffer, mesh->indexBufferAllocation);
-		vmaDestroyBuffer(m_allocator, mesh->vertexBuffer, mesh->vertexBufferAllocation);
-		vkDestroyImageView(m_device.getDevice(), mesh->texture.imageView, nullptr);
-		vmaDestroyImage(m_allocator, mesh->texture.image, mesh->texture.imageAllocation);
+	// VMA cleans object and memory allocation all-in-one
+	vmaDestroyBuffer(m_allocator, m_indexBuffer, m_indexBufferAllocation);
+	vmaDestroyBuffer(m_allocator, m_vertexBuffer, m_vertexBufferAllocation);
+	for (auto& texture : m_textures) {
+		if (texture) {
+			destroyTexture(*texture);
+		}
 	}
+	m_textures.clear();
 
+	vkDestroyPipeline(m_device.getDevice(), m_lightCullPipeline, nullptr);
+	vkDestroyPipeline(m_device.getDevice(), m_hiZMultisampledPipeline, nullptr);
+	vkDestroyPipeline(m_device.getDevice(), m_hiZPipeline, nullptr);
+	vkDestroyPipeline(m_device.getDevice(), m_clusterCullPipeline, nullptr);
+	vkDestroyPipeline(m_device.getDevice(), m_cullPipeline, nullptr);
+	vkDestroySampler(m_device.getDevice(), m_hiZSampler, nullptr);
+
+	vkDestroyDescriptorPool(m_device.getDevice(), m_hiZDescriptorPool, nullptr);
 	vkDestroyDescriptorPool(m_device.getDevice(), m_descriptorPool, nullptr);
-	vkDestroyDescriptorSetLayout(m_device.getDevice(), m_descriptorSetLayout, nullptr);
+	m_layoutCache.shutdown();
 	
+	vmaDestroyBuffer(m_allocator, m_lightCullStatsBuffer, m_lightCullStatsBufferAllocation);
+	vmaDestroyBuffer(m_allocator, m_clusterLightIndexBuffer, m_clusterLightIndexBufferAllocation);
+	vmaDestroyBuffer(m_allocator, m_clusterLightCountBuffer, m_clusterLightCountBufferAllocation);
+	vmaDestroyBuffer(m_allocator, m_lightBuffer, m_lightBufferAllocation);
+	vmaDestroyBuffer(m_allocator, m_meshletDrawBuffer, m_meshletDrawBufferAllocation);
+	vmaDestroyBuffer(m_allocator, m_objectLodBuffer, m_objectLodBufferAllocation);
+	vmaDestroyBuffer(m_allocator, m_meshletBuffer, m_meshletBufferAllocation);
+	vmaDestroyBuffer(m_allocator, m_cullStatsBuffer, m_cullStatsBufferAllocation);
+	vmaDestroyBuffer(m_allocator, m_drawCommandBuffer, m_drawCommandBufferAllocation);
+	vmaDestroyBuffer(m_allocator, m_objectBuffer, m_objectBufferAllocation);
 	vmaDestroyBuffer(m_allocator, m_uniformBuffer, m_uniformBufferAllocation);
 
+	if (m_timestampPool != VK_NULL_HANDLE) {
+		vkDestroyQueryPool(m_device.getDevice(), m_timestampPool, nullptr);
+	}
 	vkDestroySemaphore(m_device.getDevice(), m_renderFinishedSemaphore, nullptr);
 	vkDestroySemaphore(m_device.getDevice(), m_imageAvailableSemaphore, nullptr);
 
@@ -363,106 +492,268 @@ void RenderSystem::createImageViews() {
 }
 
 /***********************************************************************************/
-void RenderSystem::createRenderPass() {
-	// Colour attachment
-	VkAttachmentDescription colorAttachment {};
-	colorAttachment.format = m_swapChainImageFormat; // Should always match swap chain format
-	colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT; // Since we have no MSAA
-	// For colour and depth data
-	colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR; // Clear the values to a constant at the start
-	colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE; // Rendered contents will be stored in memory and can be read later
-	// Stencil data only
-	colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE; // Contents of the framebuffer will be undefined after the rendering operation
-	colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-	colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR; // Images to be presented in the swap chain
-
-	VkAttachmentReference colorAttachmentRef{};
-	colorAttachmentRef.attachment = 0;
-	colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+void RenderSystem::buildRenderGraph() {
+	m_renderGraph.init(m_device.getDevice(), m_allocator);
+	m_msaaSamples = supportedSampleCount(m_requestedMsaaSamples);
+
+	m_backbuffer = m_renderGraph.importImage("Backbuffer", m_swapChainImageFormat, RenderGraph::Usage::Present);
+	const auto drawCommands = m_renderGraph.importBuffer("DrawCommands", m_drawCommandBuffer);
+	const auto meshletDraws = m_renderGraph.importBuffer("MeshletDraws", m_meshletDrawBuffer);
+
+	// Written at the end of the frame, read by the next frame's cull pass
+	const auto occlusionCulling = m_gpuCulling && m_occlusionCulling;
+	if (occlusionCulling) {
+		m_hiZResource = m_renderGraph.importImage("HiZ", VK_FORMAT_R32_SFLOAT, RenderGraph::Usage::SampledCompute, RenderGraph::Usage::SampledCompute);
+	}
 
-	// Depth attachment
-	VkAttachmentDescription depthAttachment {};
-	depthAttachment.format = findDepthFormat();
-	depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT; // No MSAA
-	depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-	depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-	depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-	depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-	depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED; // Dont care about previous depth contents
-	depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+	if (m_gpuCulling) {
+		// The host reads the stats back next frame (see validateGpuCulling)
+		const auto cullStats = m_renderGraph.importBuffer("CullStats", m_cullStatsBuffer, RenderGraph::Usage::HostRead);
 
-	VkAttachmentReference depthAttachmentRef {};
-	depthAttachmentRef.attachment = 1;
-	depthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+		m_renderGraph.addPass("Cull", VK_PIPELINE_BIND_POINT_COMPUTE, [&](RenderGraph::PassBuilder& builder) {
+			builder.write(drawCommands, RenderGraph::Usage::StorageWriteCompute);
+			builder.write(meshletDraws, RenderGraph::Usage::StorageWriteCompute);
+			builder.write(cullStats, RenderGraph::Usage::StorageWriteCompute);
+			if (occlusionCulling) {
+				builder.read(m_hiZResource, RenderGraph::Usage::SampledCompute);
+			}
+		},
+		[this](const VkCommandBuffer commandBuffer) {
+			recordCullPass(commandBuffer);
+#ifdef _DEBUG
+			m_cullStatsPending = true;
+#endif
+		});
+	}
 
-	VkSubpassDescription subpass {};
-	subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-	subpass.colorAttachmentCount = 1;
-	subpass.pColorAttachments = &colorAttachmentRef;
-	subpass.pDepthStencilAttachment = &depthAttachmentRef;
+	// Rebuilt every frame, the lights move
+	const auto clusterLightCounts = m_renderGraph.importBuffer("ClusterLightCounts", m_clusterLightCountBuffer);
+	const auto clusterLightIndices = m_renderGraph.importBuffer("ClusterLightIndices", m_clusterLightIndexBuffer);
+	// The host reads the stats back next frame (see reportLightClusterOverflow)
+	const auto lightCullStats = m_renderGraph.importBuffer("LightCullStats", m_lightCullStatsBuffer, RenderGraph::Usage::HostRead);
+
+	m_renderGraph.addPass("LightCull", VK_PIPELINE_BIND_POINT_COMPUTE, [&](RenderGraph::PassBuilder& builder) {
+		builder.write(clusterLightCounts, RenderGraph::Usage::StorageWriteCompute);
+		builder.write(clusterLightIndices, RenderGraph::Usage::StorageWriteCompute);
+		builder.write(lightCullStats, RenderGraph::Usage::StorageWriteCompute);
+	},
+	[this](const VkCommandBuffer commandBuffer) {
+		recordLightCullPass(commandBuffer);
+#ifdef _DEBUG
+		m_lightCullStatsPending = true;
+#endif
+	});
+
+	const RenderGraph::ImageDescription depthDescription { findDepthFormat(occlusionCulling), 0, 0, 1, m_msaaSamples };
+	auto depth = RenderGraph::InvalidResource;
+
+	if (m_depthPrepass) {
+		m_renderGraph.addPass("DepthPrepass", VK_PIPELINE_BIND_POINT_GRAPHICS, [&](RenderGraph::PassBuilder& builder) {
+			depth = builder.createImage("Depth", depthDescription);
+			builder.depthAttachment(depth, VK_ATTACHMENT_LOAD_OP_CLEAR, { 1.0f, 0 });
+			if (m_gpuCulling) {
+				builder.read(drawCommands, RenderGraph::Usage::IndirectRead);
+				builder.read(meshletDraws, RenderGraph::Usage::IndirectRead);
+			}
+		},
+		[this](const VkCommandBuffer commandBuffer) {
+			recordDraws(commandBuffer, true);
+		});
+	}
 
-	VkSubpassDependency dependency {};
-	dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-	dependency.dstSubpass = 0;
-	dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-	dependency.srcAccessMask = 0;
-	dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-	dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+	m_renderGraph.addPass("Forward", VK_PIPELINE_BIND_POINT_GRAPHICS, [&](RenderGraph::PassBuilder& builder) {
+		if (m_msaaSamples == VK_SAMPLE_COUNT_1_BIT) {
+			builder.colorAttachment(m_backbuffer, VK_ATTACHMENT_LOAD_OP_CLEAR, { 0.0f, 0.0f, 0.0f, 1.0f });
+		}
+		else {
+			// Resolved into the swapchain image at the end of the subpass
+			const auto color = builder.createImage("Color", { m_swapChainImageFormat, 0, 0, 1, m_msaaSamples });
+			builder.colorAttachment(color, VK_ATTACHMENT_LOAD_OP_CLEAR, { 0.0f, 0.0f, 0.0f, 1.0f });
+			builder.resolveAttachment(color, m_backbuffer);
+		}
+		if (depth != RenderGraph::InvalidResource) {
+			// Only the pre-pass's surviving fragments pass EQUAL, each pixel gets shaded once
+			builder.depthReadAttachment(depth);
+		}
+		else {
+			// Nothing but the Hi-Z pass reads depth after this pass. Without it depth is never stored
+			// (and lazily allocated on tilers).
+			depth = builder.createImage("Depth", depthDescription);
+			builder.depthAttachment(depth, VK_ATTACHMENT_LOAD_OP_CLEAR, { 1.0f, 0 }); // Clear to farthest possible depth (1.0)
+		}
+		if (m_gpuCulling) {
+			builder.read(drawCommands, RenderGraph::Usage::IndirectRead);
+			builder.read(meshletDraws, RenderGraph::Usage::IndirectRead);
+		}
+		builder.read(clusterLightCounts, RenderGraph::Usage::StorageReadGraphics);
+		builder.read(clusterLightIndices, RenderGraph::Usage::StorageReadGraphics);
+	},
+	[this](const VkCommandBuffer commandBuffer) {
+		recordDraws(commandBuffer, false);
+	});
+
+	if (occlusionCulling) {
+		m_renderGraph.addPass("HiZ", VK_PIPELINE_BIND_POINT_COMPUTE, [&](RenderGraph::PassBuilder& builder) {
+			builder.read(depth, RenderGraph::Usage::SampledCompute);
+			builder.write(m_hiZResource, RenderGraph::Usage::StorageWriteCompute);
+		},
+		[this](const VkCommandBuffer commandBuffer) {
+			recordHiZPass(commandBuffer);
+		});
+	}
 
-	const std::array<VkAttachmentDescription, 2> attachments {colorAttachment, depthAttachment};
-	VkRenderPassCreateInfo renderPassInfo {};
-	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-	renderPassInfo.attachmentCount = static_cast<std::uint32_t>(attachments.size());
-	renderPassInfo.pAttachments = attachments.data();
-	renderPassInfo.subpassCount = 1;
-	renderPassInfo.dependencyCount = 1;
-	renderPassInfo.pDependencies = &dependency;
-	renderPassInfo.pSubpasses = &subpass;
+	m_renderGraph.compile(m_swapChainExtent);
+	m_renderPass = m_renderGraph.renderPass("Forward");
+	m_depthPrepassRenderPass = m_depthPrepass ? m_renderGraph.renderPass("DepthPrepass") : VK_NULL_HANDLE;
 
-	if (vkCreateRenderPass(m_device.getDevice(), &renderPassInfo, nullptr, &m_renderPass) != VK_SUCCESS) {
-		LOG_CRITICAL("Failed to create render pass!");
+	// The cull shaders bind the pyramid whether they test against it or not
+	if (m_gpuCulling) {
+		createHiZPyramid(occlusionCulling ? m_renderGraph.imageView(depth) : VK_NULL_HANDLE);
 	}
+	if (occlusionCulling) {
+		m_renderGraph.setImage(m_hiZResource, m_hiZImage, m_hiZView);
+	}
+}
+
+/***********************************************************************************/
+void RenderSystem::rebuildRenderGraph() {
+	m_device.waitIdle();
+	m_pipelineCache.waitIdle();
+	m_renderGraph.reset();
+	destroyHiZPyramid();
+	buildRenderGraph();
 }
 
 /***********************************************************************************/
-void RenderSystem::createDescriptorSetLayout() {
-	// For MVP ubo
-	VkDescriptorSetLayoutBinding uboLayoutBinding {};
-	uboLayoutBinding.binding = 0;
-	uboLayoutBinding.descriptorCount = 1;
-	uboLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	uboLayoutBinding.pImmutableSamplers = nullptr;
-	uboLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+void RenderSystem::createLayouts() {
+	m_layoutCache.init(m_device.getDevice());
+
+	// Graphics: the default variant's stages, the other variants use a subset of its bindings
+	const ShaderVariant defaultVariant;
+	const auto defines = defaultVariant.defines();
+	m_graphicsReflection = ShaderReflection::reflect(loadShader("Data/Shaders/basic.vert", defaultVariant.precompiledVertex(), defines));
+	m_graphicsReflection.merge(ShaderReflection::reflect(loadShader("Data/Shaders/basic.frag", defaultVariant.precompiledFragment(), defines)));
+
+	std::vector<VkDescriptorSetLayout> setLayouts;
+	m_pipelineLayout = m_layoutCache.pipelineLayout(m_graphicsReflection, &setLayouts);
+	if (setLayouts.size() != 1) {
+		LOG_CRITICAL("basic.vert/basic.frag must use exactly descriptor set 0.");
+	}
+	m_descriptorSetLayout = setLayouts.front();
+
+	// See createDescriptorSet
+	requireBindings(m_graphicsReflection, "basic.vert/basic.frag", {
+		{ 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER }, { 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER }, { 2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER },
+		{ 3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER }, { 4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER }, { 5, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER }
+	});
+
+	// The vertex shader has to read what the vertex layout provides
+	constexpr auto attributeDescriptions = VertexLayout<GpuVertex>::getAttributeDescriptions();
+	for (const auto& input : m_graphicsReflection.inputs) {
+		const auto attribute = std::find_if(attributeDescriptions.begin(), attributeDescriptions.end(), [&input](const auto& description) {
+			return description.location == input.location;
+		});
+
+		if (attribute == attributeDescriptions.end() || !ShaderReflection::compatible(attribute->format, input)) {
+			spdlog::get("console")->critical("basic.vert input at location {} doesn't match the vertex layout.", input.location);
+			std::abort();
+		}
+	}
+
+	if (m_graphicsReflection.pushConstants.size != sizeof(DrawPushConstants)) {
+		spdlog::get("console")->critical("basic.vert pushes {} bytes of constants, DrawPushConstants is {}.", m_graphicsReflection.pushConstants.size, sizeof(DrawPushConstants));
+		std::abort();
+	}
+
+	// Culling: both compute shaders bind the same set and push the same constants
+	m_cullReflection = ShaderReflection::reflect(loadShader("Data/Shaders/cull.comp", "Data/Shaders/cull.spv"));
+	m_cullReflection.merge(ShaderReflection::reflect(loadShader("Data/Shaders/cluster_cull.comp", "Data/Shaders/cluster_cull.spv")));
+
+	m_cullPipelineLayout = m_layoutCache.pipelineLayout(m_cullReflection, &setLayouts);
+	if (setLayouts.size() != 1) {
+		LOG_CRITICAL("cull.comp/cluster_cull.comp must use exactly descriptor set 0.");
+	}
+	m_cullDescriptorSetLayout = setLayouts.front();
+
+	// See createCullPipeline and createHiZPyramid
+	requireBindings(m_cullReflection, "cull.comp/cluster_cull.comp", {
+		{ 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER }, { 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER }, { 2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER },
+		{ 3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER }, { 4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER }, { 5, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER },
+		{ 6, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER }, { 7, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER }
+	});
+
+	if (m_cullReflection.pushConstants.size != sizeof(CullPushConstants)) {
+		spdlog::get("console")->critical("Cull shaders push {} bytes of constants, CullPushConstants is {}.", m_cullReflection.pushConstants.size, sizeof(CullPushConstants));
+		std::abort();
+	}
+
+	// Hi-Z pyramid: both variants only differ in the type of image binding 0 samples
+	const auto hiZReflection = ShaderReflection::reflect(loadShader("Data/Shaders/hiz_build.comp", "Data/Shaders/hiz_build.spv"));
+
+	m_hiZPipelineLayout = m_layoutCache.pipelineLayout(hiZReflection, &setLayouts);
+	if (setLayouts.size() != 1) {
+		LOG_CRITICAL("hiz_build.comp must use exactly descriptor set 0.");
+	}
+	m_hiZDescriptorSetLayout = setLayouts.front();
 
-	// For image sampler
-	VkDescriptorSetLayoutBinding samplerLayoutBinding {};
-	samplerLayoutBinding.binding = 1;
-	samplerLayoutBinding.descriptorCount = 1;
-	samplerLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-	samplerLayoutBinding.pImmutableSamplers = nullptr;
-	samplerLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+	requireBindings(hiZReflection, "hiz_build.comp", { { 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER }, { 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE } });
 
-	const std::array<VkDescriptorSetLayoutBinding, 2> bindings { uboLayoutBinding, samplerLayoutBinding };
+	if (hiZReflection.pushConstants.size != sizeof(HiZPushConstants)) {
+		spdlog::get("console")->critical("hiz_build.comp pushes {} bytes of constants, HiZPushConstants is {}.", hiZReflection.pushConstants.size, sizeof(HiZPushConstants));
+		std::abort();
+	}
 
-	VkDescriptorSetLayoutCreateInfo layoutInfo = {};
-	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-	layoutInfo.bindingCount = static_cast<std::uint32_t>(bindings.size());
-	layoutInfo.pBindings = bindings.data();
+	// Light binning
+	m_lightCullReflection = ShaderReflection::reflect(loadShader("Data/Shaders/light_cull.comp", "Data/Shaders/light_cull.spv"));
 
-	if (vkCreateDescriptorSetLayout(m_device.getDevice(), &layoutInfo, nullptr, &m_descriptorSetLayout) != VK_SUCCESS) {
-		LOG_CRITICAL("Failed to create descriptor set layout.");
+	m_lightCullPipelineLayout = m_layoutCache.pipelineLayout(m_lightCullReflection, &setLayouts);
+	if (setLayouts.size() != 1) {
+		LOG_CRITICAL("light_cull.comp must use exactly descriptor set 0.");
 	}
+	m_lightCullDescriptorSetLayout = setLayouts.front();
 
+	requireBindings(m_lightCullReflection, "light_cull.comp", {
+		{ 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER }, { 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER }, { 2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER }, { 3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER },
+		{ 4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER }
+	});
 }
 
 /***********************************************************************************/
 void RenderSystem::createGraphicsPipeline() {
-	const auto vertShaderCode = readShaderFile("Data/Shaders/vert.spv");
-	const auto fragShaderCode = readShaderFile("Data/Shaders/frag.spv");
+	m_pipelineCache.init(m_device.getDevice(), m_device.getPhysicalDevice(), [this](const PipelineDescription& description, const VkPipelineCache pipelineCache) {
+		return createGraphicsPipeline(description, pipelineCache);
+	});
+
+	// Everything falls back to the default pipeline, so it's waited for (from compile.bat's SPIR-V if need be)
+	if (m_pipelineCache.wait(m_pipelineDescriptions[pipelineIndex(PipelineDescription())]) == VK_NULL_HANDLE) {
+		LOG_CRITICAL("Failed to create the default graphics pipeline.");
+	}
+	requestPipelines();
+}
+
+/***********************************************************************************/
+VkPipeline RenderSystem::createGraphicsPipeline(const PipelineDescription& description, const VkPipelineCache pipelineCache) {
+	// Every #define combination has a precompiled fallback, see ShaderVariant::precompiledVertex/precompiledFragment
+	const auto& variant = description.shader;
+	const auto defines = variant.defines();
+	std::vector<char> vertShaderCode, fragShaderCode;
+	if (description.depthOnly) {
+		// DEPTH_ONLY drops the inputs FULL_PRECISION_VERTICES changes, so one precompiled shader fits both vertex layouts
+		auto depthOnlyDefines = defines;
+		depthOnlyDefines.push_back("DEPTH_ONLY");
+		vertShaderCode = loadShader("Data/Shaders/basic.vert", "Data/Shaders/vert_depth.spv", depthOnlyDefines);
+	}
+	else {
+		vertShaderCode = loadShader("Data/Shaders/basic.vert", variant.precompiledVertex(), defines);
+		fragShaderCode = loadShader("Data/Shaders/basic.frag", variant.precompiledFragment(), defines);
+	}
+
+	if (vertShaderCode.empty() || (fragShaderCode.empty() && !description.depthOnly)) {
+		return VK_NULL_HANDLE;
+	}
 
 	const VkShaderModule vertShaderModule = createShaderModule(vertShaderCode);
-	const VkShaderModule fragShaderModule = createShaderModule(fragShaderCode);
+	const VkShaderModule fragShaderModule = description.depthOnly ? VK_NULL_HANDLE : createShaderModule(fragShaderCode);
 
 	// TODO: Put into static shader class?
 	VkPipelineShaderStageCreateInfo vertShaderStageInfo {};
@@ -477,62 +768,70 @@ void RenderSystem::createGraphicsPipeline() {
 	fragShaderStageInfo.module = fragShaderModule;
 	fragShaderStageInfo.pName = "main";
 
+	// Constants baked into this variant's fragment shader, branches on them are compiled out
+	const ShaderVariantConstants constants { variant.lit, variant.ambient };
+	const std::array<VkSpecializationMapEntry, 2> specializationEntries {{
+		{ 0, offsetof(ShaderVariantConstants, lit), sizeof(constants.lit) },
+		{ 1, offsetof(ShaderVariantConstants, ambient), sizeof(constants.ambient) }
+	}};
+
+	VkSpecializationInfo specializationInfo {};
+	specializationInfo.mapEntryCount = static_cast<std::uint32_t>(specializationEntries.size());
+	specializationInfo.pMapEntries = specializationEntries.data();
+	specializationInfo.dataSize = sizeof(constants);
+	specializationInfo.pData = &constants;
+	fragShaderStageInfo.pSpecializationInfo = &specializationInfo;
+
 	const VkPipelineShaderStageCreateInfo shaderStages[] { vertShaderStageInfo, fragShaderStageInfo };
 
 	VkPipelineVertexInputStateCreateInfo vertexInputInfo {};
-	const auto bindingDescription = Vertex::getBindingDescription();
-	const auto attributeDescriptions = Vertex::getAttributeDescriptions();
+	constexpr auto bindingDescription = VertexLayout<GpuVertex>::getBindingDescription();
+	constexpr auto attributeDescriptions = VertexLayout<GpuVertex>::getAttributeDescriptions();
 	vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
 	vertexInputInfo.vertexBindingDescriptionCount = 1;
-	vertexInputInfo.vertexAttributeDescriptionCount = static_cast<std::uint32_t>(attributeDescriptions.size());
+	// The position is the first attribute
+	vertexInputInfo.vertexAttributeDescriptionCount = description.depthOnly ? 1 : static_cast<std::uint32_t>(attributeDescriptions.size());
 	vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
 	vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
 
 	// Vertex format
 	VkPipelineInputAssemblyStateCreateInfo inputAssembly {};
 	inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-	inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+	inputAssembly.topology = description.topology;
 	inputAssembly.primitiveRestartEnable = VK_FALSE;
 
-	VkViewport viewport {};
-	viewport.x = 0.0f;
-	viewport.y = 0.0f;
-	viewport.width = static_cast<float>(m_swapChainExtent.width);
-	viewport.height = static_cast<float>(m_swapChainExtent.height);
-	viewport.minDepth = 0.0f;
-	viewport.maxDepth = 1.0f;
-
-	VkRect2D scissor {};
-	scissor.offset = { 0, 0 };
-	scissor.extent = m_swapChainExtent;
-
+	// Viewport and scissor are set per frame, so pipelines don't depend on the window size
 	VkPipelineViewportStateCreateInfo viewportState {};
 	viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
 	viewportState.viewportCount = 1;
-	viewportState.pViewports = &viewport;
 	viewportState.scissorCount = 1;
-	viewportState.pScissors = &scissor;
+
+	const std::array<VkDynamicState, 2> dynamicStates { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+	VkPipelineDynamicStateCreateInfo dynamicState {};
+	dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+	dynamicState.dynamicStateCount = static_cast<std::uint32_t>(dynamicStates.size());
+	dynamicState.pDynamicStates = dynamicStates.data();
 
 	VkPipelineRasterizationStateCreateInfo rasterizer {};
 	rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
 	rasterizer.depthClampEnable = VK_FALSE;
 	rasterizer.rasterizerDiscardEnable = VK_FALSE;
-	rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+	rasterizer.polygonMode = description.polygonMode;
 	rasterizer.lineWidth = 1.0f;
-	rasterizer.cullMode = VK_CULL_MODE_BACK_BIT;
-	rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+	rasterizer.cullMode = description.cullMode;
+	rasterizer.frontFace = description.frontFace;
 	rasterizer.depthBiasEnable = VK_FALSE;
 
 	VkPipelineMultisampleStateCreateInfo multisampling {};
 	multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
 	multisampling.sampleShadingEnable = VK_FALSE;
-	multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+	multisampling.rasterizationSamples = m_msaaSamples; // Matches the forward pass's attachments
 
 	VkPipelineDepthStencilStateCreateInfo depthStencil {};
 	depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
-	depthStencil.depthTestEnable = VK_TRUE;
-	depthStencil.depthWriteEnable = VK_TRUE;
-	depthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
+	depthStencil.depthTestEnable = description.depthTest;
+	depthStencil.depthWriteEnable = description.depthWrite;
+	depthStencil.depthCompareOp = description.depthCompare;
 	depthStencil.depthBoundsTestEnable = VK_FALSE; // Only keep fragments that fall within the specified depth range.
 	depthStencil.minDepthBounds = 0.0f; // Optional
 	depthStencil.maxDepthBounds = 1.0f; // Optional
@@ -542,33 +841,30 @@ void RenderSystem::createGraphicsPipeline() {
 
 	VkPipelineColorBlendAttachmentState colorBlendAttachment = {};
 	colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-	colorBlendAttachment.blendEnable = VK_FALSE;
+	colorBlendAttachment.blendEnable = description.blend;
+	// Standard alpha blending when enabled
+	colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+	colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+	colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+	colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+	colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+	colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
 
 	VkPipelineColorBlendStateCreateInfo colorBlending {};
 	colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
 	colorBlending.logicOpEnable = VK_FALSE;
 	colorBlending.logicOp = VK_LOGIC_OP_COPY;
-	colorBlending.attachmentCount = 1;
+	colorBlending.attachmentCount = description.depthOnly ? 0 : 1; // The pre-pass has no color attachment
 	colorBlending.pAttachments = &colorBlendAttachment;
 	colorBlending.blendConstants[0] = 0.0f;
 	colorBlending.blendConstants[1] = 0.0f;
 	colorBlending.blendConstants[2] = 0.0f;
 	colorBlending.blendConstants[3] = 0.0f;
 
-	VkPipelineLayoutCreateInfo pipelineLayoutInfo {};
-	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-	pipelineLayoutInfo.setLayoutCount = 1; // # of descriptors
-	pipelineLayoutInfo.pushConstantRangeCount = 0;
-	pipelineLayoutInfo.pSetLayouts = &m_descriptorSetLayout;
-
-	if (vkCreatePipelineLayout(m_device.getDevice(), &pipelineLayoutInfo, nullptr, &m_pipelineLayout) != VK_SUCCESS) {
-		LOG_CRITICAL("Failed to create pipeline layout.");
-	}
-
 	// Now actually create the damn pipeline
 	VkGraphicsPipelineCreateInfo pipelineInfo {};
 	pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-	pipelineInfo.stageCount = 2;
+	pipelineInfo.stageCount = description.depthOnly ? 1 : 2; // No fragment shader in the pre-pass
 	pipelineInfo.pStages = shaderStages;
 	pipelineInfo.pVertexInputState = &vertexInputInfo;
 	pipelineInfo.pInputAssemblyState = &inputAssembly;
@@ -577,43 +873,96 @@ void RenderSystem::createGraphicsPipeline() {
 	pipelineInfo.pMultisampleState = &multisampling;
 	pipelineInfo.pColorBlendState = &colorBlending;
 	pipelineInfo.pDepthStencilState = &depthStencil;
+	pipelineInfo.pDynamicState = &dynamicState;
 	pipelineInfo.layout = m_pipelineLayout;
-	pipelineInfo.renderPass = m_renderPass;
+	pipelineInfo.renderPass = description.depthOnly ? m_depthPrepassRenderPass : m_renderPass;
 	pipelineInfo.subpass = 0;
 	pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
 
-	if (vkCreateGraphicsPipelines(m_device.getDevice(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_graphicsPipeline) != VK_SUCCESS) {
-		LOG_CRITICAL("Failed to create graphics pipeline.");
+	// The cache is internally synchronized, every worker shares it
+	VkPipeline pipeline;
+	if (vkCreateGraphicsPipelines(m_device.getDevice(), pipelineCache, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS) {
+		pipeline = VK_NULL_HANDLE;
 	}
 
 	// Cleanup
-	vkDestroyShaderModule(m_device.getDevice(), fragShaderModule, nullptr);
+	if (fragShaderModule != VK_NULL_HANDLE) {
+		vkDestroyShaderModule(m_device.getDevice(), fragShaderModule, nullptr);
+	}
 	vkDestroyShaderModule(m_device.getDevice(), vertShaderModule, nullptr);
+
+	return pipeline;
 }
 
 /***********************************************************************************/
-void RenderSystem::createFramebuffers() {
-	m_swapChainFramebuffers.resize(m_swapChainImageViews.size());
-	
-	for (auto i = 0; i < m_swapChainImageViews.size(); ++i) {
-		const std::array<VkImageView, 2> attachments {
-			m_swapChainImageViews[i],
-			m_depthImageView
-		};
-
-		VkFramebufferCreateInfo framebufferInfo {};
-		framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-		framebufferInfo.renderPass = m_renderPass;
-		framebufferInfo.attachmentCount = static_cast<std::uint32_t>(attachments.size());
-		framebufferInfo.pAttachments = attachments.data();
-		framebufferInfo.width = m_swapChainExtent.width;
-		framebufferInfo.height = m_swapChainExtent.height;
-		framebufferInfo.layers = 1;
-
-		if (vkCreateFramebuffer(m_device.getDevice(), &framebufferInfo, nullptr, &m_swapChainFramebuffers[i]) != VK_SUCCESS) {
-			LOG_CRITICAL("Failed to create framebuffer.");
+std::uint32_t RenderSystem::pipelineIndex(const PipelineDescription& description) {
+	const auto it = m_pipelineIndices.find(description);
+	if (it != m_pipelineIndices.end()) {
+		return it->second;
+	}
+
+	const auto index = static_cast<std::uint32_t>(m_pipelineDescriptions.size());
+	m_pipelineDescriptions.push_back(description);
+	m_pipelineIndices.emplace(description, index);
+
+	return index;
+}
+
+/***********************************************************************************/
+PipelineDescription RenderSystem::passDescription(const std::uint32_t index, const bool depthOnly) const {
+	auto description = m_pipelineDescriptions[index];
+
+	// Only what writes depth goes through the pre-pass, the rest is drawn as usual
+	if (!m_depthPrepass || !description.depthTest || !description.depthWrite) {
+		return description;
+	}
+
+	if (depthOnly) {
+		// The fragment side makes no difference without a fragment shader, so variants share pipelines
+		description.shader = ShaderVariant();
+		description.blend = VK_FALSE;
+		description.depthOnly = true;
+	}
+	else {
+		description.depthCompare = VK_COMPARE_OP_EQUAL;
+		description.depthWrite = VK_FALSE;
+	}
+
+	return description;
+}
+
+/***********************************************************************************/
+VkPipeline RenderSystem::graphicsPipeline(const std::uint32_t index, const bool depthOnly) {
+	const auto pipeline = m_pipelineCache.get(passDescription(index, depthOnly));
+	if (pipeline != VK_NULL_HANDLE) {
+		return pipeline;
+	}
+
+	// Still being created on a worker (or failed), the default pipeline stands in. Right after the cache was
+	// cleared or the passes changed, it may still be on a worker as well, then there's nothing to draw with.
+	return m_pipelineCache.get(passDescription(0, depthOnly));
+}
+
+/***********************************************************************************/
+bool RenderSystem::requestPipelines() {
+	auto ready = true;
+	const auto request = [this, &ready](const std::uint32_t index) {
+		for (const auto depthOnly : { false, true }) {
+			const auto description = passDescription(index, depthOnly);
+			ready &= m_pipelineCache.get(description) != VK_NULL_HANDLE || m_pipelineCache.failed(description);
+			if (!m_depthPrepass) {
+				break;
+			}
 		}
+	};
+
+	// The default pipeline first, it stands in for the others
+	request(0);
+	for (const auto& batch : m_drawBatches) {
+		request(batch.pipeline);
 	}
+
+	return ready;
 }
 
 /***********************************************************************************/
@@ -624,7 +973,7 @@ void RenderSystem::createCommandPools() {
 	VkCommandPoolCreateInfo drawingPoolInfo {};
 	drawingPoolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
 	drawingPoolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily;
-	drawingPoolInfo.flags = 0; // Optional
+	drawingPoolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT; // Command buffers are re-recorded every frame
 
 	if (vkCreateCommandPool(m_device.getDevice(), &drawingPoolInfo, nullptr, &m_drawingCommandPool) != VK_SUCCESS) {
 		LOG_CRITICAL("Failed to create command pool.");
@@ -641,22 +990,6 @@ void RenderSystem::createCommandPools() {
 	}
 }
 
-/***********************************************************************************/
-void RenderSystem::createDepthAttachment() {
-	const auto depthFormat = findDepthFormat();
-
-	createImage(m_swapChainExtent.width, m_swapChainExtent.height, depthFormat, 
-		VK_IMAGE_TILING_OPTIMAL, 
-		VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, 
-		m_depthImage, 
-		m_depthAllocation);
-
-	m_depthImageView = createImageView(m_depthImage, depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT);
-
-	// Use a pipeline barrier because the transition to suitable depth format only needs to happen once
-	transitionImageLayout(m_depthImage, depthFormat, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
-}
-
 /***********************************************************************************/
 void RenderSystem::createTextureImage(Texture& texture) {
 	auto* pixels = stbi_load(texture.path.data(), &texture.width, &texture.height, &texture.numChannels, STBI_rgb_alpha);
@@ -664,6 +997,13 @@ void RenderSystem::createTextureImage(Texture& texture) {
 		LOG_CRITICAL("Failed to load image.");
 	}
 
+	uploadTexture(texture, pixels);
+
+	stbi_image_free(pixels);
+}
+
+/***********************************************************************************/
+void RenderSystem::uploadTexture(Texture& texture, const unsigned char* pixels) {
 	const VkDeviceSize imageSize = texture.width * texture.height * 4;
 	VkBuffer stagingBuffer;
 	VmaAllocation allocation;
@@ -673,8 +1013,6 @@ void RenderSystem::createTextureImage(Texture& texture) {
 
 	std::memcpy(allocInfo.pMappedData, pixels, imageSize);
 
-	stbi_image_free(pixels);
-
 	createImage(texture.width, texture.height, VK_FORMAT_R8G8B8A8_UNORM, 
 		VK_IMAGE_TILING_OPTIMAL, 
 		VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, 
@@ -722,54 +1060,259 @@ void RenderSystem::createTextureSampler() {
 
 /***********************************************************************************/
 void RenderSystem::prepareMeshes() {
+	createGeometryBuffers();
+
 	for (auto& mesh : m_meshes) {
-		createVertexBuffer(mesh);
-		createIndexBuffer(mesh);
-		createTextureImage(mesh->texture);
-		createTextureImageView(mesh->texture);
+		if (mesh) {
+			makeResident(*mesh);
+		}
 	}
 }
 
 /***********************************************************************************/
-void RenderSystem::createVertexBuffer(MeshPtr& mesh) const {
-	
-	const VkDeviceSize bufferSize = sizeof(mesh->vertices[0]) * mesh->vertices.size();
-	VkBuffer stagingBuffer;
-	VmaAllocation allocation;
-	const auto allocInfo = createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, 
-		stagingBuffer, 
-		allocation);
+void RenderSystem::makeResident(Mesh& mesh) {
+	if (!mesh.resident) {
+		uploadGeometry(mesh);
+	}
 
-	std::memcpy(allocInfo.pMappedData, mesh->vertices.data(), static_cast<std::size_t>(bufferSize));
+	// Textures are shared between meshes, only the first one to need it uploads it
+	if (!mesh.texture || mesh.texture->image != VK_NULL_HANDLE) {
+		return;
+	}
 
-	createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, 
-		mesh->vertexBuffer, 
-		mesh->vertexBufferAllocation);
+	auto slot = std::find(m_textures.begin(), m_textures.end(), nullptr);
+	if (slot == m_textures.end()) {
+		if (m_textures.size() == MaxTextures) {
+			spdlog::get("console")->error("Out of texture slots ({}), {} is drawn with another texture.", MaxTextures, mesh.texture->path);
+			return;
+		}
+		slot = m_textures.insert(m_textures.end(), nullptr);
+	}
 
-	copyBuffer(stagingBuffer, mesh->vertexBuffer, bufferSize);
+	createTextureImage(*mesh.texture);
+	createTextureImageView(*mesh.texture);
+	mesh.texture->descriptorIndex = static_cast<std::uint32_t>(std::distance(m_textures.begin(), slot));
+	*slot = mesh.texture;
 
-	// Cleanup
-	vmaDestroyBuffer(m_allocator, stagingBuffer, allocation);
+	// Before init the whole array is written by createDescriptorSet
+	if (m_descriptorSet != VK_NULL_HANDLE) {
+		updateTextureDescriptors();
+	}
+}
+
+/***********************************************************************************/
+void RenderSystem::releaseUnusedAssets() {
+	// Only the mesh table still holds these and no entity draws them
+	for (std::size_t i = 0; i < m_meshes.size(); ++i) {
+		auto& mesh = m_meshes[i];
+		if (!mesh || mesh.use_count() > 1 || (i < m_meshInstanceCounts.size() && m_meshInstanceCounts[i] > 0)) {
+			continue;
+		}
+
+		if (mesh->resident) {
+			m_vertexPool.free(static_cast<std::uint64_t>(mesh->vertexOffset) * sizeof(GpuVertex));
+			m_indexPool.free(static_cast<std::uint64_t>(mesh->firstIndex) * mesh->indexSize());
+			mesh->resident = false;
+		}
+		mesh.reset();
+	}
+
+	// Then the textures no remaining mesh uses
+	auto released = false;
+	for (auto& texture : m_textures) {
+		if (texture && texture.use_count() == 1) {
+			destroyTexture(*texture);
+			texture.reset();
+			released = true;
+		}
+	}
+
+	// Their array elements would point at destroyed views
+	if (released) {
+		updateTextureDescriptors();
+	}
+}
+
+/***********************************************************************************/
+void RenderSystem::reloadMesh(Mesh& mesh, Mesh&& loaded) {
+	// Everything handed out (mesh table, asset cache, user handles) points at mesh, so it's refilled in place
+	const auto wasResident = mesh.resident;
+	if (wasResident) {
+		m_vertexPool.free(static_cast<std::uint64_t>(mesh.vertexOffset) * sizeof(GpuVertex));
+		m_indexPool.free(static_cast<std::uint64_t>(mesh.firstIndex) * mesh.indexSize());
+	}
+
+	auto texture = std::move(mesh.texture);
+	const auto shader = mesh.shader;
+	mesh = std::move(loaded);
+	mesh.texture = std::move(texture);
+	mesh.shader = shader;
+	mesh.resident = false;
+
+	if (wasResident) {
+		uploadGeometry(mesh);
+	}
+
+	// LOD ranges and meshlets in the object/meshlet buffers are stale
+	m_drawListVersion = ~0ull;
+}
+
+/***********************************************************************************/
+void RenderSystem::reloadTexture(Texture& texture, const unsigned char* pixels, const int width, const int height) {
+	if (texture.image == VK_NULL_HANDLE) {
+		return;
+	}
+
+	destroyTexture(texture);
+	texture.width = width;
+	texture.height = height;
+	uploadTexture(texture, pixels);
+	createTextureImageView(texture);
+
+	// Its own element and any free ones borrowing it
+	updateTextureDescriptors();
+}
+
+/***********************************************************************************/
+void RenderSystem::reloadShader(const std::string_view path) {
+	const auto endsWith = [path](const std::string_view name) {
+		return path.size() >= name.size() && path.compare(path.size() - name.size(), name.size(), name) == 0;
+	};
+
+	if (endsWith("basic.vert") || endsWith("basic.frag") || endsWith("vert.spv") || endsWith("vert_full_precision.spv") || endsWith("vert_depth.spv") || endsWith("frag.spv") || endsWith("frag_untextured.spv")) {
+		// Recreated on workers, the VkPipelineCache still speeds up whatever didn't change
+		m_pipelineCache.clear();
+		requestPipelines();
+	}
+	else if (endsWith("hiz_build.comp") || endsWith("hiz_build.spv") || endsWith("hiz_build_ms.spv")) {
+		vkDestroyPipeline(m_device.getDevice(), m_hiZMultisampledPipeline, nullptr);
+		vkDestroyPipeline(m_device.getDevice(), m_hiZPipeline, nullptr);
+		createHiZPipelines();
+	}
+	else if (endsWith("light_cull.comp") || endsWith("light_cull.spv")) {
+		vkDestroyPipeline(m_device.getDevice(), m_lightCullPipeline, nullptr);
+		createLightCullPipeline();
+	}
+	else if (endsWith("cull.comp") || endsWith("cull.spv")) {
+		vkDestroyPipeline(m_device.getDevice(), m_clusterCullPipeline, nullptr);
+		vkDestroyPipeline(m_device.getDevice(), m_cullPipeline, nullptr);
+		createCullPipelines();
+	}
+	else {
+		return;
+	}
+
+	spdlog::get("console")->info("Reloaded {}", path.data());
 }
 
 /***********************************************************************************/
-void RenderSystem::createIndexBuffer(MeshPtr& mesh) const {
-	const VkDeviceSize bufferSize = sizeof(mesh->indices[0]) * mesh->indices.size();
+void RenderSystem::destroyTexture(Texture& texture) const {
+	vkDestroyImageView(m_device.getDevice(), texture.imageView, nullptr);
+	vmaDestroyImage(m_allocator, texture.image, texture.imageAllocation);
 
+	texture.imageView = VK_NULL_HANDLE;
+	texture.image = VK_NULL_HANDLE;
+	texture.imageAllocation = VK_NULL_HANDLE;
+}
+
+/***********************************************************************************/
+void RenderSystem::updateTextureDescriptors() {
+	// Without any texture there are no textured meshes, and no pipeline that reads the array
+	const auto fallback = std::find_if(m_textures.begin(), m_textures.end(), [](const TexturePtr& texture) { return texture != nullptr; });
+	if (fallback == m_textures.end()) {
+		return;
+	}
+
+	// The shader indexes the array dynamically, so every element has to be valid
+	std::array<VkDescriptorImageInfo, MaxTextures> imageInfos;
+	for (std::uint32_t i = 0; i < MaxTextures; ++i) {
+		const auto& texture = i < m_textures.size() && m_textures[i] ? m_textures[i] : *fallback;
+		imageInfos[i].sampler = m_textureSampler;
+		imageInfos[i].imageView = texture->imageView;
+		imageInfos[i].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	}
+
+	VkWriteDescriptorSet descriptorWrite {};
+	descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	descriptorWrite.dstSet = m_descriptorSet;
+	descriptorWrite.dstBinding = 1;
+	descriptorWrite.dstArrayElement = 0;
+	descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	descriptorWrite.descriptorCount = MaxTextures;
+	descriptorWrite.pImageInfo = imageInfos.data();
+
+	vkUpdateDescriptorSets(m_device.getDevice(), 1, &descriptorWrite, 0, nullptr);
+}
+
+/***********************************************************************************/
+void RenderSystem::createGeometryBuffers() {
+	VkDeviceSize vertexBytes = 0, indexBytes = 0;
+	for (const auto& mesh : m_meshes) {
+		if (!mesh) {
+			continue;
+		}
+		vertexBytes += sizeof(GpuVertex) * mesh->gpuVertices.size();
+		indexBytes += mesh->indexSize() * mesh->indices.size();
+	}
+
+	const auto vertexPoolSize = std::max(VertexPoolSize, vertexBytes);
+	const auto indexPoolSize = std::max(IndexPoolSize, indexBytes);
+
+	createBuffer(vertexPoolSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, 
+		m_vertexBuffer, 
+		m_vertexBufferAllocation, 
+		VMA_MEMORY_USAGE_GPU_ONLY);
+
+	createBuffer(indexPoolSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, 
+		m_indexBuffer, 
+		m_indexBufferAllocation, 
+		VMA_MEMORY_USAGE_GPU_ONLY);
+
+	m_vertexPool.reset(vertexPoolSize);
+	m_indexPool.reset(indexPoolSize);
+}
+
+/***********************************************************************************/
+void RenderSystem::uploadGeometry(Mesh& mesh) {
+	const VkDeviceSize vertexBytes = sizeof(GpuVertex) * mesh.gpuVertices.size();
+	const auto indexSize = mesh.indexSize();
+	const VkDeviceSize indexBytes = indexSize * mesh.indices.size();
+
+	// Align to the element size so the byte offsets convert to baseVertex/firstIndex
+	const auto vertexOffset = m_vertexPool.allocate(vertexBytes, sizeof(GpuVertex));
+	const auto indexOffset = m_indexPool.allocate(indexBytes, indexSize);
+
+	if (vertexOffset == FreeListAllocator::InvalidOffset || indexOffset == FreeListAllocator::InvalidOffset) {
+		LOG_CRITICAL("Geometry pool exhausted.");
+	}
+
+	mesh.vertexOffset = static_cast<std::int32_t>(vertexOffset / sizeof(GpuVertex));
+	mesh.firstIndex = static_cast<std::uint32_t>(indexOffset / indexSize);
+	mesh.resident = true;
+
+	// One staging buffer for both ranges
 	VkBuffer stagingBuffer;
 	VmaAllocation allocation;
-	const auto allocInfo = createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, 
+	const auto allocInfo = createBuffer(vertexBytes + indexBytes, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, 
 		stagingBuffer, 
 		allocation);
 
-	std::memcpy(allocInfo.pMappedData, mesh->indices.data(), static_cast<std::size_t>(bufferSize));
-
-	createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, 
-		mesh->indexBuffer, mesh->indexBufferAllocation);
-
-	copyBuffer(stagingBuffer, mesh->indexBuffer, bufferSize);
+	auto* staging = static_cast<char*>(allocInfo.pMappedData);
+	std::memcpy(staging, mesh.gpuVertices.data(), static_cast<std::size_t>(vertexBytes));
+	if (mesh.indexType() == VK_INDEX_TYPE_UINT16) {
+		auto* indices = reinterpret_cast<std::uint16_t*>(staging + vertexBytes);
+		for (std::size_t i = 0; i < mesh.indices.size(); ++i) {
+			indices[i] = static_cast<std::uint16_t>(mesh.indices[i]);
+		}
+	}
+	else {
+		std::memcpy(staging + vertexBytes, mesh.indices.data(), static_cast<std::size_t>(indexBytes));
+	}
 
+	copyBuffer(stagingBuffer, m_vertexBuffer, vertexBytes, 0, vertexOffset);
+	copyBuffer(stagingBuffer, m_indexBuffer, indexBytes, vertexBytes, indexOffset);
 
+	// Cleanup
 	vmaDestroyBuffer(m_allocator, stagingBuffer, allocation);
 }
 
@@ -781,23 +1324,137 @@ void RenderSystem::createUniformBuffer() {
 		m_uniformBufferAllocation);
 }
 
+/***********************************************************************************/
+void RenderSystem::createObjectBuffers() {
+	if (!m_world) {
+		LOG_CRITICAL("RenderSystem has no world to draw.");
+	}
+
+	std::size_t objectCount = 0, meshletCount = 0;
+	m_world->forEachChunk<const MeshInstance>([&](const std::size_t count, const Entity*, const MeshInstance* instances) {
+		objectCount += count;
+		for (std::size_t i = 0; i < count; ++i) {
+			if (instances[i].meshIndex < m_meshes.size() && m_meshes[instances[i].meshIndex]) {
+				meshletCount += m_meshes[instances[i].meshIndex]->meshlets.size();
+			}
+		}
+	});
+
+	m_objectCapacity = std::max(MinObjectCapacity, static_cast<std::uint32_t>(objectCount));
+	m_meshletCapacity = std::max(MinMeshletCapacity, static_cast<std::uint32_t>(meshletCount));
+	const auto objectCapacity = static_cast<VkDeviceSize>(m_objectCapacity);
+
+	// Transforms are rewritten by the CPU every frame, the rest when the draw list is rebuilt
+	m_objectBufferAllocInfo = createBuffer(sizeof(ObjectData) * objectCapacity, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, 
+		m_objectBuffer, 
+		m_objectBufferAllocation, 
+		VMA_MEMORY_USAGE_CPU_TO_GPU);
+
+	// Only ever touched by the GPU: written by cull.comp, consumed by vkCmdDrawIndexedIndirect
+	createBuffer(sizeof(VkDrawIndexedIndirectCommand) * objectCapacity, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, 
+		m_drawCommandBuffer, 
+		m_drawCommandBufferAllocation, 
+		VMA_MEMORY_USAGE_GPU_ONLY);
+
+	// Visible object count and a bit per object, read back for validation
+	const auto cullStatsSize = sizeof(std::uint32_t) * (1 + (objectCapacity + 31) / 32);
+	m_cullStatsBufferAllocInfo = createBuffer(cullStatsSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, 
+		m_cullStatsBuffer, 
+		m_cullStatsBufferAllocation, 
+		VMA_MEMORY_USAGE_GPU_TO_CPU);
+	std::memset(m_cullStatsBufferAllocInfo.pMappedData, 0, cullStatsSize);
+}
+
+/***********************************************************************************/
+void RenderSystem::createMeshletBuffers() {
+	// Filled in by rebuildDrawList
+	m_meshletBufferAllocInfo = createBuffer(sizeof(MeshletData) * static_cast<VkDeviceSize>(m_meshletCapacity), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, 
+		m_meshletBuffer, 
+		m_meshletBufferAllocation, 
+		VMA_MEMORY_USAGE_CPU_TO_GPU);
+
+	// Written by cull.comp, read by cluster_cull.comp
+	createBuffer(sizeof(std::uint32_t) * static_cast<VkDeviceSize>(m_objectCapacity), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, 
+		m_objectLodBuffer, 
+		m_objectLodBufferAllocation, 
+		VMA_MEMORY_USAGE_GPU_ONLY);
+
+	// Written by cluster_cull.comp, consumed by vkCmdDrawIndexedIndirect
+	createBuffer(sizeof(VkDrawIndexedIndirectCommand) * static_cast<VkDeviceSize>(m_meshletCapacity), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, 
+		m_meshletDrawBuffer, 
+		m_meshletDrawBufferAllocation, 
+		VMA_MEMORY_USAGE_GPU_ONLY);
+}
+
+/***********************************************************************************/
+void RenderSystem::createLightBuffers() {
+	m_lightCapacity = std::max(MinLightCapacity, static_cast<std::uint32_t>(m_world->count<PointLight>()));
+
+	// Rewritten by the CPU every frame
+	m_lightBufferAllocInfo = createBuffer(sizeof(LightData) * static_cast<VkDeviceSize>(m_lightCapacity), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, 
+		m_lightBuffer, 
+		m_lightBufferAllocation, 
+		VMA_MEMORY_USAGE_CPU_TO_GPU);
+
+	// Written by light_cull.comp, read by basic.frag. A fixed number of slots per cluster, so no
+	// cluster has to wait on another to know where its list starts.
+	createBuffer(sizeof(std::uint32_t) * static_cast<VkDeviceSize>(ClusterCount), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, 
+		m_clusterLightCountBuffer, 
+		m_clusterLightCountBufferAllocation, 
+		VMA_MEMORY_USAGE_GPU_ONLY);
+
+	createBuffer(sizeof(std::uint32_t) * static_cast<VkDeviceSize>(ClusterCount) * MaxLightsPerCluster, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, 
+		m_clusterLightIndexBuffer, 
+		m_clusterLightIndexBufferAllocation, 
+		VMA_MEMORY_USAGE_GPU_ONLY);
+
+	// Clusters over MaxLightsPerCluster and the most lights any of them touched, read back in debug builds
+	const auto lightCullStatsSize = sizeof(std::uint32_t) * 2;
+	m_lightCullStatsBufferAllocInfo = createBuffer(lightCullStatsSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, 
+		m_lightCullStatsBuffer, 
+		m_lightCullStatsBufferAllocation, 
+		VMA_MEMORY_USAGE_GPU_TO_CPU);
+	std::memset(m_lightCullStatsBufferAllocInfo.pMappedData, 0, lightCullStatsSize);
+}
+
 /***********************************************************************************/
 void RenderSystem::createDescriptorPools() {
-	std::array<VkDescriptorPoolSize, 2> poolSizes {};
-	poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	poolSizes[0].descriptorCount = 1;
-	poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-	poolSizes[1].descriptorCount = 1;
+	// Room for one graphics set, one cull set and one light cull set, as many descriptors of each type as their shaders declare
+	std::vector<VkDescriptorPoolSize> poolSizes;
+	for (const auto* reflection : { &m_graphicsReflection, &m_cullReflection, &m_lightCullReflection }) {
+		for (const auto& binding : reflection->bindings) {
+			const auto poolSize = std::find_if(poolSizes.begin(), poolSizes.end(), [&binding](const auto& size) { return size.type == binding.type; });
+			if (poolSize != poolSizes.end()) {
+				poolSize->descriptorCount += binding.count;
+			}
+			else {
+				poolSizes.push_back({ binding.type, binding.count });
+			}
+		}
+	}
 
 	VkDescriptorPoolCreateInfo poolInfo {};
 	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
 	poolInfo.poolSizeCount = static_cast<std::uint32_t>(poolSizes.size());
 	poolInfo.pPoolSizes = poolSizes.data();
-	poolInfo.maxSets = 1;
+	poolInfo.maxSets = 3;
 
 	if (vkCreateDescriptorPool(m_device.getDevice(), &poolInfo, nullptr, &m_descriptorPool) != VK_SUCCESS) {
 		LOG_CRITICAL("Failed to create descriptor pool.");
 	}
+
+	// One set per Hi-Z level (a source to sample and a level to write), reset whenever the pyramid is recreated
+	const std::array<VkDescriptorPoolSize, 2> hiZPoolSizes {{
+		{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, MaxHiZLevels },
+		{ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, MaxHiZLevels }
+	}};
+	poolInfo.poolSizeCount = static_cast<std::uint32_t>(hiZPoolSizes.size());
+	poolInfo.pPoolSizes = hiZPoolSizes.data();
+	poolInfo.maxSets = MaxHiZLevels;
+
+	if (vkCreateDescriptorPool(m_device.getDevice(), &poolInfo, nullptr, &m_hiZDescriptorPool) != VK_SUCCESS) {
+		LOG_CRITICAL("Failed to create Hi-Z descriptor pool.");
+	}
 }
 
 /***********************************************************************************/
@@ -820,14 +1477,12 @@ void RenderSystem::createDescriptorSet() {
 	bufferInfo.offset = 0;
 	bufferInfo.range = sizeof(UniformBufferObject);
 	
-	// For image texture
-	// TODO: Add to texture class
-	VkDescriptorImageInfo imageInfo {};
-	imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-	imageInfo.imageView = m_meshes[0]->texture.imageView;
-	imageInfo.sampler = m_textureSampler;
+	VkDescriptorBufferInfo objectBufferInfo {};
+	objectBufferInfo.buffer = m_objectBuffer;
+	objectBufferInfo.offset = 0;
+	objectBufferInfo.range = VK_WHOLE_SIZE;
 
-	std::array<VkWriteDescriptorSet, 2> descriptorWrites {};
+	std::array<VkWriteDescriptorSet, 5> descriptorWrites {};
 
 	descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
 	descriptorWrites[0].dstSet = m_descriptorSet;
@@ -839,73 +1494,524 @@ void RenderSystem::createDescriptorSet() {
 
 	descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
 	descriptorWrites[1].dstSet = m_descriptorSet;
-	descriptorWrites[1].dstBinding = 1;
+	descriptorWrites[1].dstBinding = 2;
 	descriptorWrites[1].dstArrayElement = 0;
-	descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
 	descriptorWrites[1].descriptorCount = 1;
-	descriptorWrites[1].pImageInfo = &imageInfo;
+	descriptorWrites[1].pBufferInfo = &objectBufferInfo;
+
+	// Point lights and the clusters' lists of them
+	const std::array<VkDescriptorBufferInfo, 3> lightBufferInfos {
+		VkDescriptorBufferInfo{ m_lightBuffer, 0, VK_WHOLE_SIZE },
+		VkDescriptorBufferInfo{ m_clusterLightCountBuffer, 0, VK_WHOLE_SIZE },
+		VkDescriptorBufferInfo{ m_clusterLightIndexBuffer, 0, VK_WHOLE_SIZE }
+	};
+	for (std::uint32_t i = 0; i < lightBufferInfos.size(); ++i) {
+		auto& write = descriptorWrites[2 + i];
+		write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		write.dstSet = m_descriptorSet;
+		write.dstBinding = 3 + i;
+		write.dstArrayElement = 0;
+		write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		write.descriptorCount = 1;
+		write.pBufferInfo = &lightBufferInfos[i];
+	}
 
 	vkUpdateDescriptorSets(m_device.getDevice(), static_cast<std::uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+
+	// Binding 1, one element per texture slot
+	updateTextureDescriptors();
 }
 
 /***********************************************************************************/
-void RenderSystem::createCommandBuffers() {
-	m_commandBuffers.resize(m_swapChainFramebuffers.size());
-
-	VkCommandBufferAllocateInfo allocInfo {};
-	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-	allocInfo.commandPool = m_drawingCommandPool;
-	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY; // Can be submitted to a queue for execution, but cannot be called from other command buffers.
-	allocInfo.commandBufferCount = static_cast<std::uint32_t>(m_commandBuffers.size());
+void RenderSystem::createCullPipeline() {
+	// Layouts come from the shaders (see createLayouts)
+	createCullPipelines();
+	createHiZPipelines();
 
-	if (vkAllocateCommandBuffers(m_device.getDevice(), &allocInfo, m_commandBuffers.data()) != VK_SUCCESS) {
+	// The pyramid is read with texelFetch, only the clamping matters
+	VkSamplerCreateInfo samplerInfo {};
+	samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerInfo.magFilter = VK_FILTER_NEAREST;
+	samplerInfo.minFilter = VK_FILTER_NEAREST;
+	samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.maxLod = static_cast<float>(MaxHiZLevels);
+
+	if (vkCreateSampler(m_device.getDevice(), &samplerInfo, nullptr, &m_hiZSampler) != VK_SUCCESS) {
+		LOG_CRITICAL("Failed to create Hi-Z sampler.");
+	}
+
+	// Descriptor set
+	VkDescriptorSetAllocateInfo allocInfo {};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = m_descriptorPool;
+	allocInfo.descriptorSetCount = 1;
+	allocInfo.pSetLayouts = &m_cullDescriptorSetLayout;
+
+	if (vkAllocateDescriptorSets(m_device.getDevice(), &allocInfo, &m_cullDescriptorSet) != VK_SUCCESS) {
+		LOG_CRITICAL("Failed to allocate cull descriptor set.");
+	}
+
+	const std::array<VkDescriptorBufferInfo, 6> bufferInfos {
+		VkDescriptorBufferInfo{ m_objectBuffer, 0, VK_WHOLE_SIZE },
+		VkDescriptorBufferInfo{ m_drawCommandBuffer, 0, VK_WHOLE_SIZE },
+		VkDescriptorBufferInfo{ m_cullStatsBuffer, 0, VK_WHOLE_SIZE },
+		VkDescriptorBufferInfo{ m_objectLodBuffer, 0, VK_WHOLE_SIZE },
+		VkDescriptorBufferInfo{ m_meshletBuffer, 0, VK_WHOLE_SIZE },
+		VkDescriptorBufferInfo{ m_meshletDrawBuffer, 0, VK_WHOLE_SIZE }
+	};
+
+	std::array<VkWriteDescriptorSet, 7> descriptorWrites {};
+	for (std::uint32_t i = 0; i < bufferInfos.size(); ++i) {
+		descriptorWrites[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptorWrites[i].dstSet = m_cullDescriptorSet;
+		descriptorWrites[i].dstBinding = i;
+		descriptorWrites[i].dstArrayElement = 0;
+		descriptorWrites[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		descriptorWrites[i].descriptorCount = 1;
+		descriptorWrites[i].pBufferInfo = &bufferInfos[i];
+	}
+
+	// The UBO, for the previous view-projection. The Hi-Z pyramid (binding 6) is written when it's created.
+	const VkDescriptorBufferInfo uniformBufferInfo { m_uniformBuffer, 0, sizeof(UniformBufferObject) };
+	descriptorWrites[6].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	descriptorWrites[6].dstSet = m_cullDescriptorSet;
+	descriptorWrites[6].dstBinding = 7;
+	descriptorWrites[6].dstArrayElement = 0;
+	descriptorWrites[6].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	descriptorWrites[6].descriptorCount = 1;
+	descriptorWrites[6].pBufferInfo = &uniformBufferInfo;
+
+	vkUpdateDescriptorSets(m_device.getDevice(), static_cast<std::uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+}
+
+/***********************************************************************************/
+void RenderSystem::createCullPipelines() {
+	const auto cullShaderCode = loadShader("Data/Shaders/cull.comp", "Data/Shaders/cull.spv");
+	const VkShaderModule cullShaderModule = createShaderModule(cullShaderCode);
+	const auto clusterCullShaderCode = loadShader("Data/Shaders/cluster_cull.comp", "Data/Shaders/cluster_cull.spv");
+	const VkShaderModule clusterCullShaderModule = createShaderModule(clusterCullShaderCode);
+
+	std::array<VkComputePipelineCreateInfo, 2> pipelineInfos {};
+	for (auto& pipelineInfo : pipelineInfos) {
+		pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+		pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+		pipelineInfo.stage.pName = "main";
+		pipelineInfo.layout = m_cullPipelineLayout;
+	}
+	pipelineInfos[0].stage.module = cullShaderModule;
+	pipelineInfos[1].stage.module = clusterCullShaderModule;
+
+	VkPipeline pipelines[2];
+	if (vkCreateComputePipelines(m_device.getDevice(), VK_NULL_HANDLE, static_cast<std::uint32_t>(pipelineInfos.size()), pipelineInfos.data(), nullptr, pipelines) != VK_SUCCESS) {
+		LOG_CRITICAL("Failed to create cull pipelines.");
+	}
+	m_cullPipeline = pipelines[0];
+	m_clusterCullPipeline = pipelines[1];
+
+	vkDestroyShaderModule(m_device.getDevice(), clusterCullShaderModule, nullptr);
+	vkDestroyShaderModule(m_device.getDevice(), cullShaderModule, nullptr);
+}
+
+/***********************************************************************************/
+void RenderSystem::createHiZPipelines() {
+	const auto shaderCode = loadShader("Data/Shaders/hiz_build.comp", "Data/Shaders/hiz_build.spv");
+	const VkShaderModule shaderModule = createShaderModule(shaderCode);
+	const auto multisampledShaderCode = loadShader("Data/Shaders/hiz_build.comp", "Data/Shaders/hiz_build_ms.spv", { "MULTISAMPLED" });
+	const VkShaderModule multisampledShaderModule = createShaderModule(multisampledShaderCode);
+
+	std::array<VkComputePipelineCreateInfo, 2> pipelineInfos {};
+	for (auto& pipelineInfo : pipelineInfos) {
+		pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+		pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+		pipelineInfo.stage.pName = "main";
+		pipelineInfo.layout = m_hiZPipelineLayout;
+	}
+	pipelineInfos[0].stage.module = shaderModule;
+	pipelineInfos[1].stage.module = multisampledShaderModule;
+
+	VkPipeline pipelines[2];
+	if (vkCreateComputePipelines(m_device.getDevice(), VK_NULL_HANDLE, static_cast<std::uint32_t>(pipelineInfos.size()), pipelineInfos.data(), nullptr, pipelines) != VK_SUCCESS) {
+		LOG_CRITICAL("Failed to create Hi-Z pipelines.");
+	}
+	m_hiZPipeline = pipelines[0];
+	m_hiZMultisampledPipeline = pipelines[1];
+
+	vkDestroyShaderModule(m_device.getDevice(), multisampledShaderModule, nullptr);
+	vkDestroyShaderModule(m_device.getDevice(), shaderModule, nullptr);
+}
+
+/***********************************************************************************/
+void RenderSystem::createHiZPyramid(const VkImageView depthView) {
+	m_hiZValid = false;
+
+	// Level 0 is half the depth buffer, rounded up, and so on down to 1x1
+	m_hiZLevelExtents.clear();
+	VkExtent2D extent { (m_swapChainExtent.width + 1) / 2, (m_swapChainExtent.height + 1) / 2 };
+	while (m_hiZLevelExtents.size() < MaxHiZLevels) {
+		m_hiZLevelExtents.push_back(extent);
+		if (extent.width == 1 && extent.height == 1) {
+			break;
+		}
+		extent = { (extent.width + 1) / 2, (extent.height + 1) / 2 };
+	}
+	const auto levelCount = static_cast<std::uint32_t>(m_hiZLevelExtents.size());
+
+	VkImageCreateInfo imageInfo {};
+	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageInfo.extent = { m_hiZLevelExtents.front().width, m_hiZLevelExtents.front().height, 1 };
+	imageInfo.mipLevels = levelCount;
+	imageInfo.arrayLayers = 1;
+	imageInfo.format = VK_FORMAT_R32_SFLOAT;
+	imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	imageInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT;
+	imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	VmaAllocationCreateInfo allocInfo {};
+	allocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+
+	if (vmaCreateImage(m_allocator, &imageInfo, &allocInfo, &m_hiZImage, &m_hiZImageAllocation, nullptr) != VK_SUCCESS) {
+		LOG_CRITICAL("Failed to create Hi-Z pyramid.");
+	}
+
+	VkImageViewCreateInfo viewInfo {};
+	viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	viewInfo.image = m_hiZImage;
+	viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	viewInfo.format = imageInfo.format;
+	viewInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, levelCount, 0, 1 };
+
+	if (vkCreateImageView(m_device.getDevice(), &viewInfo, nullptr, &m_hiZView) != VK_SUCCESS) {
+		LOG_CRITICAL("Failed to create Hi-Z pyramid view.");
+	}
+
+	m_hiZLevelViews.resize(levelCount);
+	for (std::uint32_t level = 0; level < levelCount; ++level) {
+		viewInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, level, 1, 0, 1 };
+		if (vkCreateImageView(m_device.getDevice(), &viewInfo, nullptr, &m_hiZLevelViews[level]) != VK_SUCCESS) {
+			LOG_CRITICAL("Failed to create Hi-Z pyramid level view.");
+		}
+	}
+
+	// The render graph expects it the way every frame leaves it
+	const auto commandBuffer = createAndBeginCommandBuffer(m_memoryTransferCommandPool);
+
+	VkImageMemoryBarrier barrier {};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = m_hiZImage;
+	barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, levelCount, 0, 1 };
+	barrier.srcAccessMask = 0;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+		0, nullptr,
+		0, nullptr,
+		1, &barrier);
+
+	endAndSubmitCommandBuffer(m_memoryTransferCommandPool, commandBuffer);
+
+	// The cull shaders sample every level
+	const VkDescriptorImageInfo pyramidInfo { m_hiZSampler, m_hiZView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+
+	VkWriteDescriptorSet pyramidWrite {};
+	pyramidWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	pyramidWrite.dstSet = m_cullDescriptorSet;
+	pyramidWrite.dstBinding = 6;
+	pyramidWrite.dstArrayElement = 0;
+	pyramidWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	pyramidWrite.descriptorCount = 1;
+	pyramidWrite.pImageInfo = &pyramidInfo;
+
+	vkUpdateDescriptorSets(m_device.getDevice(), 1, &pyramidWrite, 0, nullptr);
+
+	if (depthView == VK_NULL_HANDLE) {
+		return;
+	}
+
+	// Each level is built from the one below, level 0 from the depth buffer. The pyramid stays in
+	// VK_IMAGE_LAYOUT_GENERAL while it's being built.
+	const std::vector<VkDescriptorSetLayout> setLayouts(levelCount, m_hiZDescriptorSetLayout);
+
+	VkDescriptorSetAllocateInfo setInfo {};
+	setInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	setInfo.descriptorPool = m_hiZDescriptorPool;
+	setInfo.descriptorSetCount = levelCount;
+	setInfo.pSetLayouts = setLayouts.data();
+
+	m_hiZDescriptorSets.resize(levelCount);
+	if (vkAllocateDescriptorSets(m_device.getDevice(), &setInfo, m_hiZDescriptorSets.data()) != VK_SUCCESS) {
+		LOG_CRITICAL("Failed to allocate Hi-Z descriptor sets.");
+	}
+
+	for (std::uint32_t level = 0; level < levelCount; ++level) {
+		const VkDescriptorImageInfo sourceInfo = level == 0 ?
+			VkDescriptorImageInfo{ m_hiZSampler, depthView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL } :
+			VkDescriptorImageInfo{ m_hiZSampler, m_hiZLevelViews[level - 1], VK_IMAGE_LAYOUT_GENERAL };
+		const VkDescriptorImageInfo destinationInfo { VK_NULL_HANDLE, m_hiZLevelViews[level], VK_IMAGE_LAYOUT_GENERAL };
+
+		std::array<VkWriteDescriptorSet, 2> descriptorWrites {};
+		for (std::uint32_t i = 0; i < descriptorWrites.size(); ++i) {
+			descriptorWrites[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			descriptorWrites[i].dstSet = m_hiZDescriptorSets[level];
+			descriptorWrites[i].dstBinding = i;
+			descriptorWrites[i].dstArrayElement = 0;
+			descriptorWrites[i].descriptorCount = 1;
+		}
+		descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		descriptorWrites[0].pImageInfo = &sourceInfo;
+		descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+		descriptorWrites[1].pImageInfo = &destinationInfo;
+
+		vkUpdateDescriptorSets(m_device.getDevice(), static_cast<std::uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+	}
+}
+
+/***********************************************************************************/
+void RenderSystem::destroyHiZPyramid() {
+	if (m_hiZImage == VK_NULL_HANDLE) {
+		return;
+	}
+
+	vkResetDescriptorPool(m_device.getDevice(), m_hiZDescriptorPool, 0);
+	m_hiZDescriptorSets.clear();
+
+	for (const auto view : m_hiZLevelViews) {
+		vkDestroyImageView(m_device.getDevice(), view, nullptr);
+	}
+	m_hiZLevelViews.clear();
+	vkDestroyImageView(m_device.getDevice(), m_hiZView, nullptr);
+	vmaDestroyImage(m_allocator, m_hiZImage, m_hiZImageAllocation);
+
+	m_hiZImage = VK_NULL_HANDLE;
+	m_hiZValid = false;
+}
+
+/***********************************************************************************/
+void RenderSystem::createLightCulling() {
+	// Layout comes from the shader (see createLayouts)
+	createLightCullPipeline();
+
+	VkDescriptorSetAllocateInfo allocInfo {};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = m_descriptorPool;
+	allocInfo.descriptorSetCount = 1;
+	allocInfo.pSetLayouts = &m_lightCullDescriptorSetLayout;
+
+	if (vkAllocateDescriptorSets(m_device.getDevice(), &allocInfo, &m_lightCullDescriptorSet) != VK_SUCCESS) {
+		LOG_CRITICAL("Failed to allocate light cull descriptor set.");
+	}
+
+	// The UBO, for the projection and cluster grid, then the lights, the cluster lists and the overflow stats
+	const std::array<VkDescriptorBufferInfo, 5> bufferInfos {
+		VkDescriptorBufferInfo{ m_uniformBuffer, 0, sizeof(UniformBufferObject) },
+		VkDescriptorBufferInfo{ m_lightBuffer, 0, VK_WHOLE_SIZE },
+		VkDescriptorBufferInfo{ m_clusterLightCountBuffer, 0, VK_WHOLE_SIZE },
+		VkDescriptorBufferInfo{ m_clusterLightIndexBuffer, 0, VK_WHOLE_SIZE },
+		VkDescriptorBufferInfo{ m_lightCullStatsBuffer, 0, VK_WHOLE_SIZE }
+	};
+
+	std::array<VkWriteDescriptorSet, 5> descriptorWrites {};
+	for (std::uint32_t i = 0; i < bufferInfos.size(); ++i) {
+		descriptorWrites[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptorWrites[i].dstSet = m_lightCullDescriptorSet;
+		descriptorWrites[i].dstBinding = i;
+		descriptorWrites[i].dstArrayElement = 0;
+		descriptorWrites[i].descriptorType = i == 0 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		descriptorWrites[i].descriptorCount = 1;
+		descriptorWrites[i].pBufferInfo = &bufferInfos[i];
+	}
+
+	vkUpdateDescriptorSets(m_device.getDevice(), static_cast<std::uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+}
+
+/***********************************************************************************/
+void RenderSystem::createLightCullPipeline() {
+	const auto shaderCode = loadShader("Data/Shaders/light_cull.comp", "Data/Shaders/light_cull.spv");
+	const VkShaderModule shaderModule = createShaderModule(shaderCode);
+
+	VkComputePipelineCreateInfo pipelineInfo {};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	pipelineInfo.stage.module = shaderModule;
+	pipelineInfo.stage.pName = "main";
+	pipelineInfo.layout = m_lightCullPipelineLayout;
+
+	if (vkCreateComputePipelines(m_device.getDevice(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_lightCullPipeline) != VK_SUCCESS) {
+		LOG_CRITICAL("Failed to create light cull pipeline.");
+	}
+
+	vkDestroyShaderModule(m_device.getDevice(), shaderModule, nullptr);
+}
+
+/***********************************************************************************/
+void RenderSystem::createCommandBuffers() {
+	m_commandBuffers.resize(m_swapChainImages.size());
+
+	VkCommandBufferAllocateInfo allocInfo {};
+	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocInfo.commandPool = m_drawingCommandPool;
+	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY; // Can be submitted to a queue for execution, but cannot be called from other command buffers.
+	allocInfo.commandBufferCount = static_cast<std::uint32_t>(m_commandBuffers.size());
+
+	if (vkAllocateCommandBuffers(m_device.getDevice(), &allocInfo, m_commandBuffers.data()) != VK_SUCCESS) {
 		LOG_ERROR("Failed to allocate command buffers.");
 	}
+}
+
+/***********************************************************************************/
+void RenderSystem::recordCommandBuffer(const std::uint32_t imageIndex) {
+	const auto commandBuffer = m_commandBuffers[imageIndex];
 
-	for (auto i = 0; i < m_commandBuffers.size(); ++i) {
-		VkCommandBufferBeginInfo beginInfo {};
-		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
+	// The previous frame has finished with this buffer (see vkQueueWaitIdle in update), so it can be reset.
+	vkResetCommandBuffer(commandBuffer, 0);
+
+	VkCommandBufferBeginInfo beginInfo {};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 
-		vkBeginCommandBuffer(m_commandBuffers[i], &beginInfo);
+	vkBeginCommandBuffer(commandBuffer, &beginInfo);
 
-		VkRenderPassBeginInfo renderPassInfo {};
-		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-		renderPassInfo.renderPass = m_renderPass;
-		renderPassInfo.framebuffer = m_swapChainFramebuffers[i];
-		renderPassInfo.renderArea.offset = { 0, 0 };
-		renderPassInfo.renderArea.extent = m_swapChainExtent;
+	if (m_timestampPool != VK_NULL_HANDLE) {
+		vkCmdResetQueryPool(commandBuffer, m_timestampPool, 0, 2);
+		vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_timestampPool, 0);
+	}
 
-		// Specify clear values for colour attachment, and depth/stencil.
-		std::array<VkClearValue, 2> clearValues;
-		clearValues[0].color = { 0.0f, 0.0f, 0.0f, 1.0f };
-		clearValues[1].depthStencil = { 1.0f, 0 }; // Clear to farthest possible depth (1.0)
-		renderPassInfo.clearValueCount = static_cast<std::uint32_t>(clearValues.size());
-		renderPassInfo.pClearValues = clearValues.data();
+	m_renderGraph.setImage(m_backbuffer, m_swapChainImages[imageIndex], m_swapChainImageViews[imageIndex]);
+	m_renderGraph.execute(commandBuffer);
 
-		vkCmdBeginRenderPass(m_commandBuffers[i], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+	if (m_timestampPool != VK_NULL_HANDLE) {
+		vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_timestampPool, 1);
+	}
 
-			vkCmdBindPipeline(m_commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, m_graphicsPipeline);
+	if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+		LOG_CRITICAL("Failed to record command buffer.");
+	}
+}
 
-			const VkBuffer vertexBuffers[] { m_meshes[0]->vertexBuffer };
-			const VkDeviceSize offsets[] { 0 };
-			
-			vkCmdBindVertexBuffers(m_commandBuffers[i], 0, 1, vertexBuffers, offsets);
+/***********************************************************************************/
+void RenderSystem::recordDraws(const VkCommandBuffer commandBuffer, const bool depthOnly) {
+	VkViewport viewport {};
+	viewport.width = static_cast<float>(m_swapChainExtent.width);
+	viewport.height = static_cast<float>(m_swapChainExtent.height);
+	viewport.minDepth = 0.0f;
+	viewport.maxDepth = 1.0f;
+	vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
 
-			vkCmdBindIndexBuffer(m_commandBuffers[i], m_meshes[0]->indexBuffer, 0, VK_INDEX_TYPE_UINT32);
-			// Bind UBO
-			vkCmdBindDescriptorSets(m_commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout, 0, 1, &m_descriptorSet, 0, nullptr);
-			// Draw
-			vkCmdDrawIndexed(m_commandBuffers[i], static_cast<std::uint32_t>(m_meshes[0]->indices.size()), 1, 0, 0, 0);
+	const VkRect2D scissor { { 0, 0 }, m_swapChainExtent };
+	vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
 
-		vkCmdEndRenderPass(m_commandBuffers[i]);
+	// All pipelines share the pipeline layout, so the UBO stays bound across pipeline switches
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout, 0, 1, &m_descriptorSet, 0, nullptr);
 
-		if (vkEndCommandBuffer(m_commandBuffers[i]) != VK_SUCCESS) {
-			LOG_CRITICAL("Failed to record command buffer.");
+	// Every mesh lives in the same vertex/index buffers
+	const VkBuffer vertexBuffers[] { m_vertexBuffer };
+	const VkDeviceSize offsets[] { 0 };
+
+	vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
+
+	// 16-bit and 32-bit indices share the index buffer, firstIndex is in units of the bound type
+	auto boundPipeline = VkPipeline(VK_NULL_HANDLE);
+	auto boundIndexType = VK_INDEX_TYPE_MAX_ENUM;
+	// False when there's no pipeline to draw the batch with yet, its draws are skipped this frame
+	const auto bindBatch = [&](const DrawBatch& batch) {
+		const auto pipeline = graphicsPipeline(batch.pipeline, depthOnly);
+		if (pipeline == VK_NULL_HANDLE) {
+			return false;
+		}
+		if (pipeline != boundPipeline) {
+			boundPipeline = pipeline;
+			vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+		}
+		if (batch.indexType != boundIndexType) {
+			boundIndexType = batch.indexType;
+			vkCmdBindIndexBuffer(commandBuffer, m_indexBuffer, 0, boundIndexType);
+		}
+		return true;
+	};
+
+	if (m_gpuCulling) {
+		// The object index comes from each command's firstInstance
+		const DrawPushConstants pushConstants {};
+		vkCmdPushConstants(commandBuffer, m_pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(DrawPushConstants), &pushConstants);
+
+		// One indirect draw per object, culled ones were written with instanceCount = 0,
+		// plus one per meshlet for objects cull.comp left to cluster_cull.comp
+		for (const auto& batch : m_drawBatches) {
+			// Batches that don't write depth stay out of the pre-pass
+			if (depthOnly && !passDescription(batch.pipeline, true).depthOnly) {
+				continue;
+			}
+			if (!bindBatch(batch)) {
+				continue;
+			}
+			recordIndirectDraws(commandBuffer, m_drawCommandBuffer, batch.firstObject, batch.objectCount);
+			if (m_clusterCulling) {
+				recordIndirectDraws(commandBuffer, m_meshletDrawBuffer, batch.firstMeshlet, batch.meshletCount);
+			}
+		}
+	}
+	else {
+		// Ranges come in ascending object order, so the batch only ever moves forward
+		auto batch = m_drawBatches.cbegin();
+		auto batchBound = false, batchDrawable = false;
+
+		for (const auto& range : m_drawRanges) {
+			while (range.objectIndex >= batch->firstObject + batch->objectCount) {
+				++batch;
+				batchBound = false;
+			}
+			if (depthOnly && !passDescription(batch->pipeline, true).depthOnly) {
+				continue;
+			}
+			if (!batchBound) {
+				batchDrawable = bindBatch(*batch);
+				batchBound = true;
+			}
+			if (!batchDrawable) {
+				continue;
+			}
+
+			const auto& mesh = m_meshes[m_drawObjects[range.objectIndex]];
+
+			// Selects the object's entry in the object buffer
+			const DrawPushConstants pushConstants { range.objectIndex };
+			vkCmdPushConstants(commandBuffer, m_pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(DrawPushConstants), &pushConstants);
+			vkCmdDrawIndexed(commandBuffer, range.indexCount, 1, range.firstIndex, mesh->vertexOffset, 0);
 		}
 	}
 }
 
+/***********************************************************************************/
+void RenderSystem::recordIndirectDraws(const VkCommandBuffer commandBuffer, const VkBuffer drawBuffer, const std::uint32_t firstDraw, const std::uint32_t drawCount) const {
+	constexpr auto stride = static_cast<std::uint32_t>(sizeof(VkDrawIndexedIndirectCommand));
+
+	if (drawCount == 0) {
+		return;
+	}
+
+	if (m_device.getEnabledFeatures().multiDrawIndirect) {
+		vkCmdDrawIndexedIndirect(commandBuffer, drawBuffer, firstDraw * stride, drawCount, stride);
+		return;
+	}
+
+	for (std::uint32_t i = firstDraw; i < firstDraw + drawCount; ++i) {
+		vkCmdDrawIndexedIndirect(commandBuffer, drawBuffer, i * stride, 1, stride);
+	}
+}
+
 /***********************************************************************************/
 void RenderSystem::createSemaphores() {
 	VkSemaphoreCreateInfo semaphoreInfo {};
@@ -920,19 +2026,13 @@ void RenderSystem::createSemaphores() {
 
 /***********************************************************************************/
 void RenderSystem::cleanupSwapChain() {
-	// Cleanup depth buffer
-	vkDestroyImageView(m_device.getDevice(), m_depthImageView, nullptr);
-	vmaDestroyImage(m_allocator, m_depthImage, m_depthAllocation);
-
-	for (const auto& fb : m_swapChainFramebuffers) {
-		vkDestroyFramebuffer(m_device.getDevice(), fb, nullptr);
-	}
-
 	vkFreeCommandBuffers(m_device.getDevice(), m_drawingCommandPool, static_cast<std::uint32_t>(m_commandBuffers.size()), m_commandBuffers.data());
 
-	vkDestroyPipeline(m_device.getDevice(), m_graphicsPipeline, nullptr);
-	vkDestroyPipelineLayout(m_device.getDevice(), m_pipelineLayout, nullptr);
-	vkDestroyRenderPass(m_device.getDevice(), m_renderPass, nullptr);
+	// Pipelines outlive the swapchain (the new render pass is compatible), only creations using the old one must finish
+	m_pipelineCache.waitIdle();
+	// Render passes, framebuffers and the transient images, and the pyramid built from depth
+	m_renderGraph.reset();
+	destroyHiZPyramid();
 
 	for (const auto& view : m_swapChainImageViews) {
 		vkDestroyImageView(m_device.getDevice(), view, nullptr);
@@ -950,13 +2050,206 @@ void RenderSystem::recreateSwapChain() {
 	
 	createSwapChain();
 	createImageViews();
-	createRenderPass();
-	createGraphicsPipeline();
-	createDepthAttachment();
-	createFramebuffers();
+	buildRenderGraph();
 	createCommandBuffers();
 }
 
+/***********************************************************************************/
+void RenderSystem::setMsaaSamples(const std::uint32_t samples) {
+	m_requestedMsaaSamples = samples;
+	if (m_renderPass == VK_NULL_HANDLE || supportedSampleCount(samples) == m_msaaSamples) {
+		return;
+	}
+
+	// The swapchain stays, only the attachments and everything created against the render pass change
+	rebuildRenderGraph();
+	m_pipelineCache.clear();
+	requestPipelines();
+
+	spdlog::get("console")->info("MSAA: {}x", m_msaaSamples);
+}
+
+/***********************************************************************************/
+void RenderSystem::benchmarkMsaa(const std::uint32_t framesPerSampleCount) {
+	GpuBenchmark benchmark;
+	benchmark.name = "MSAA";
+	benchmark.framesPerSetting = framesPerSampleCount;
+
+	for (const auto samples : { VK_SAMPLE_COUNT_1_BIT, VK_SAMPLE_COUNT_2_BIT, VK_SAMPLE_COUNT_4_BIT, VK_SAMPLE_COUNT_8_BIT }) {
+		if (supportedSampleCount(samples) == samples) {
+			benchmark.settings.push_back({ std::to_string(samples) + "x", [this, samples]() { setMsaaSamples(samples); } });
+		}
+	}
+
+	const auto restoreSamples = m_requestedMsaaSamples;
+	benchmark.restore = [this, restoreSamples]() { setMsaaSamples(restoreSamples); };
+
+	startBenchmark(std::move(benchmark));
+}
+
+/***********************************************************************************/
+void RenderSystem::setDepthPrepass(const bool enabled) {
+	if (enabled == m_depthPrepass) {
+		return;
+	}
+	m_depthPrepass = enabled;
+	if (m_renderPass == VK_NULL_HANDLE) {
+		return;
+	}
+
+	// Pipelines made for the forward pass stay valid, its render pass only changes in ways that keep it compatible.
+	// The pass descriptions change though, depth-writing batches need pre-pass and depth-equal pipelines.
+	rebuildRenderGraph();
+	requestPipelines();
+
+	spdlog::get("console")->info("Depth pre-pass: {}", m_depthPrepass ? "on" : "off");
+}
+
+/***********************************************************************************/
+void RenderSystem::benchmarkDepthPrepass(const std::uint32_t framesPerSetting) {
+	GpuBenchmark benchmark;
+	benchmark.name = "Depth pre-pass";
+	benchmark.framesPerSetting = framesPerSetting;
+	benchmark.settings.push_back({ "off", [this]() { setDepthPrepass(false); } });
+	benchmark.settings.push_back({ "on", [this]() { setDepthPrepass(true); } });
+
+	const auto restore = m_depthPrepass;
+	benchmark.restore = [this, restore]() { setDepthPrepass(restore); };
+
+	startBenchmark(std::move(benchmark));
+}
+
+/***********************************************************************************/
+void RenderSystem::benchmarkLights(const std::uint32_t framesPerSetting) {
+	GpuBenchmark benchmark;
+	benchmark.name = "Point lights";
+	benchmark.framesPerSetting = framesPerSetting;
+
+	// Up to every light there is room for
+	const auto lightCount = std::min(static_cast<std::uint32_t>(m_world->count<PointLight>()), m_lightCapacity);
+	for (const auto count : { 0u, 1000u, 2500u, 5000u, 10000u }) {
+		if (count < lightCount) {
+			benchmark.settings.push_back({ std::to_string(count), [this, count]() { setMaxLights(count); } });
+		}
+	}
+	benchmark.settings.push_back({ std::to_string(lightCount), [this, lightCount]() { setMaxLights(lightCount); } });
+
+	const auto restore = m_maxLights;
+	benchmark.restore = [this, restore]() { setMaxLights(restore); };
+
+	startBenchmark(std::move(benchmark));
+}
+
+/***********************************************************************************/
+VkSampleCountFlagBits RenderSystem::supportedSampleCount(const std::uint32_t samples) const {
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(m_device.getPhysicalDevice(), &properties);
+
+	auto supported = properties.limits.framebufferColorSampleCounts & properties.limits.framebufferDepthSampleCounts;
+	if (m_gpuCulling && m_occlusionCulling) {
+		// The Hi-Z pass samples depth
+		supported &= properties.limits.sampledImageDepthSampleCounts;
+	}
+	for (const auto count : { VK_SAMPLE_COUNT_8_BIT, VK_SAMPLE_COUNT_4_BIT, VK_SAMPLE_COUNT_2_BIT }) {
+		if (count <= samples && (supported & count) != 0) {
+			return count;
+		}
+	}
+
+	return VK_SAMPLE_COUNT_1_BIT;
+}
+
+/***********************************************************************************/
+void RenderSystem::createTimestampQueries() {
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(m_device.getPhysicalDevice(), &properties);
+
+	if (!properties.limits.timestampComputeAndGraphics) {
+		LOG_INFO("No timestamp queries, GPU frame times aren't measured.");
+		return;
+	}
+	m_timestampPeriod = properties.limits.timestampPeriod;
+
+	VkQueryPoolCreateInfo queryPoolInfo {};
+	queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	queryPoolInfo.queryCount = 2;
+
+	if (vkCreateQueryPool(m_device.getDevice(), &queryPoolInfo, nullptr, &m_timestampPool) != VK_SUCCESS) {
+		LOG_CRITICAL("Failed to create timestamp query pool.");
+	}
+}
+
+/***********************************************************************************/
+void RenderSystem::startBenchmark(GpuBenchmark&& benchmark) {
+	if (!m_benchmark.settings.empty() || benchmark.settings.empty()) {
+		return;
+	}
+	if (m_timestampPool == VK_NULL_HANDLE) {
+		spdlog::get("console")->error("Can't benchmark {} without timestamp queries.", benchmark.name);
+		return;
+	}
+
+	m_benchmark = std::move(benchmark);
+	m_benchmark.framesPerSetting = std::max(m_benchmark.framesPerSetting, 1u);
+	m_benchmark.settings.front().apply();
+}
+
+/***********************************************************************************/
+void RenderSystem::updateBenchmark() {
+	// The first frames at a setting pay for cold caches
+	constexpr std::uint32_t warmupFrames = 16;
+
+	auto& benchmark = m_benchmark;
+	if (benchmark.settings.empty()) {
+		return;
+	}
+
+	// Frames that skipped draws for pipelines still on workers don't count, not even towards the warm-up
+	if (!requestPipelines()) {
+		benchmark.frame = 0;
+		benchmark.gpuTime = 0.0;
+		return;
+	}
+
+	// The frame is done (see vkQueueWaitIdle in update), unless it was skipped for a swapchain recreation
+	std::array<std::uint64_t, 2> timestamps {};
+	if (benchmark.frame++ >= warmupFrames &&
+		vkGetQueryPoolResults(m_device.getDevice(), m_timestampPool, 0, 2, sizeof(timestamps), timestamps.data(), sizeof(std::uint64_t), VK_QUERY_RESULT_64_BIT) == VK_SUCCESS) {
+		benchmark.gpuTime += static_cast<double>(timestamps[1] - timestamps[0]) * m_timestampPeriod * 1e-6;
+	}
+
+	if (benchmark.frame < warmupFrames + benchmark.framesPerSetting) {
+		return;
+	}
+
+	spdlog::get("console")->info("{} benchmark: {} takes {:.3f} ms of GPU time per frame ({} frames).",
+		benchmark.name, benchmark.settings[benchmark.current].name, benchmark.gpuTime / benchmark.framesPerSetting, benchmark.framesPerSetting);
+
+	benchmark.frame = 0;
+	benchmark.gpuTime = 0.0;
+	if (++benchmark.current < benchmark.settings.size()) {
+		benchmark.settings[benchmark.current].apply();
+		return;
+	}
+
+	const auto restore = std::move(benchmark.restore);
+	benchmark = {};
+	restore();
+}
+
+/***********************************************************************************/
+void RenderSystem::reportTransientMemory() {
+	const auto stats = m_renderGraph.memoryStats();
+	if (stats.allocated == m_reportedTransientMemory.allocated && stats.committed == m_reportedTransientMemory.committed) {
+		return;
+	}
+	m_reportedTransientMemory = stats;
+
+	spdlog::get("console")->info("Transient attachments: {} KiB allocated ({} KiB saved by aliasing), {} KiB lazily allocated with {} KiB committed.",
+		stats.allocated / 1024, (stats.unaliased - stats.allocated) / 1024, stats.lazy / 1024, stats.committed / 1024);
+}
+
 /***********************************************************************************/
 std::vector<const char*> RenderSystem::getRequiredExtensions() const {
 	std::vector<const char*> extensions;
@@ -1011,7 +2304,7 @@ void RenderSystem::endAndSubmitCommandBuffer(const VkCommandPool commandPool, co
 }
 
 /***********************************************************************************/
-VmaAllocationInfo RenderSystem::createBuffer(const VkDeviceSize size, const VkBufferUsageFlags usage, VkBuffer& buffer, VmaAllocation& allocation) const {
+VmaAllocationInfo RenderSystem::createBuffer(const VkDeviceSize size, const VkBufferUsageFlags usage, VkBuffer& buffer, VmaAllocation& allocation, const VmaMemoryUsage memoryUsage) const {
 	VkBufferCreateInfo bufferInfo{};
 	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
 	bufferInfo.size = size;
@@ -1019,8 +2312,8 @@ VmaAllocationInfo RenderSystem::createBuffer(const VkDeviceSize size, const VkBu
 	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
 	VmaAllocationCreateInfo allocCreateInfo {};
-	allocCreateInfo.usage = VMA_MEMORY_USAGE_CPU_ONLY;
-	allocCreateInfo.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT;
+	allocCreateInfo.usage = memoryUsage;
+	allocCreateInfo.flags = memoryUsage == VMA_MEMORY_USAGE_GPU_ONLY ? static_cast<VmaAllocationCreateFlags>(0) : static_cast<VmaAllocationCreateFlags>(VMA_ALLOCATION_CREATE_MAPPED_BIT);
 
 	VmaAllocationInfo allocInfo;
 
@@ -1032,10 +2325,12 @@ VmaAllocationInfo RenderSystem::createBuffer(const VkDeviceSize size, const VkBu
 }
 
 /***********************************************************************************/
-void RenderSystem::copyBuffer(const VkBuffer src, const VkBuffer dest, const VkDeviceSize size) const {
+void RenderSystem::copyBuffer(const VkBuffer src, const VkBuffer dest, const VkDeviceSize size, const VkDeviceSize srcOffset, const VkDeviceSize destOffset) const {
 	const auto cmdBuffer = createAndBeginCommandBuffer(m_memoryTransferCommandPool);
 
 	VkBufferCopy copyRegion {};
+	copyRegion.srcOffset = srcOffset;
+	copyRegion.dstOffset = destOffset;
 	copyRegion.size = size;
 	vkCmdCopyBuffer(cmdBuffer, src, dest, 1, &copyRegion);
 	
@@ -1043,21 +2338,449 @@ void RenderSystem::copyBuffer(const VkBuffer src, const VkBuffer dest, const VkD
 }
 
 /***********************************************************************************/
-void RenderSystem::updateUniformBuffer(const float dt) const {
-	static auto startTime = std::chrono::high_resolution_clock::now();
-
-	const auto currentTime = std::chrono::high_resolution_clock::now();
-	const auto time = std::chrono::duration_cast<std::chrono::milliseconds>(currentTime - startTime).count() / 1000.0f;
+void RenderSystem::updateUniformBuffer() {
+	// Model matrices live in the object buffer, only per-frame data lives in the UBO
+	const auto fieldOfView = glm::radians(45.0f);
+	const auto nearPlane = 0.1f, farPlane = 10.0f;
+	m_cameraPosition = glm::vec3(2.0f, 2.0f, 2.0f);
 
 	UniformBufferObject ubo {};
-	ubo.model = glm::rotate(glm::mat4(1.0f), time * glm::radians(30.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-	ubo.view = glm::lookAt(glm::vec3(2.0f, 2.0f, 2.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-	ubo.proj = glm::perspective(glm::radians(45.0f), m_swapChainExtent.width / static_cast<float>(m_swapChainExtent.height), 0.1f, 10.0f);
+	// What last frame's depth, and so the Hi-Z pyramid, was rendered with
+	ubo.previousViewProjection = m_viewProjection;
+	ubo.view = glm::lookAt(m_cameraPosition, glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+	ubo.proj = glm::perspective(fieldOfView, m_swapChainExtent.width / static_cast<float>(m_swapChainExtent.height), nearPlane, farPlane);
 	ubo.proj[1][1] *= -1; // Prevent image from being rendered upside down
 
+	// Depth slices are spaced exponentially from the near to the far plane, the light count is filled in by updateLightBuffer
+	const auto sliceScale = ClusterSlices / std::log(farPlane / nearPlane);
+	ubo.clusterCount = glm::uvec4(ClusterTilesX, ClusterTilesY, ClusterSlices, 0);
+	ubo.clusterScale = glm::vec4(ClusterTilesX / static_cast<float>(m_swapChainExtent.width), ClusterTilesY / static_cast<float>(m_swapChainExtent.height), 
+		sliceScale, -std::log(nearPlane) * sliceScale);
+
+	m_view = ubo.view;
+	m_viewProjection = ubo.proj * ubo.view;
+	// Pixels covered by one world-space unit at distance 1
+	m_lodScale = m_swapChainExtent.height / (2.0f * std::tan(fieldOfView * 0.5f)) / LodPixelError;
+
 	std::memcpy(m_uniformBufferAllocInfo.pMappedData, &ubo, sizeof(ubo));
 }
 
+/***********************************************************************************/
+void RenderSystem::cullMeshes() {
+	// The culler's spheres and the BVH's boxes were refreshed by updateObjectBuffer
+	const Frustum frustum(m_viewProjection);
+	if (m_drawObjects.size() < BvhMinObjects) {
+		m_frustumCuller.cull(frustum, m_visibleObjects);
+	}
+	else {
+		m_bvh.update(m_objectBounds.data(), m_objectBounds.size());
+		m_bvh.cullFrustum(frustum, m_visibleObjects);
+
+		// The boxes enclose the spheres, so the exact sphere test keeps the result identical to the linear path (and cull.comp)
+		m_visibleObjects.erase(std::remove_if(m_visibleObjects.begin(), m_visibleObjects.end(), [&](const std::uint32_t objectIndex) {
+			return !frustum.intersects(m_frustumCuller.sphere(objectIndex));
+		}), m_visibleObjects.end());
+		// Slot order keeps the 16-bit index draws together
+		std::sort(m_visibleObjects.begin(), m_visibleObjects.end());
+	}
+
+	// Same selection as cull.comp/cluster_cull.comp. Only index ranges change, so switching LODs never allocates.
+	m_drawRanges.clear();
+	for (const auto objectIndex : m_visibleObjects) {
+		const auto& mesh = m_meshes[m_drawObjects[objectIndex]];
+		const auto& transform = m_objectTransforms[objectIndex];
+		const auto worldSphere = mesh->boundingSphere.transformed(transform);
+
+		const auto distance = std::max(glm::length(worldSphere.center - m_cameraPosition) - worldSphere.radius, 1e-4f);
+		const auto worldScale = mesh->boundingSphere.radius > 0.0f ? worldSphere.radius / mesh->boundingSphere.radius : 1.0f;
+
+		const auto lodIndex = mesh->selectLod(m_lodScale * worldScale / distance);
+
+		if (lodIndex > 0 || !m_clusterCulling || mesh->meshlets.empty()) {
+			const auto& lod = mesh->lods[lodIndex];
+			m_drawRanges.push_back({ objectIndex, mesh->firstIndex + lod.firstIndex, lod.indexCount });
+			continue;
+		}
+
+		const glm::mat3 rotation(transform);
+		for (const auto& meshlet : mesh->meshlets) {
+			const auto meshletSphere = meshlet.boundingSphere.transformed(transform);
+			const auto coneAxis = glm::normalize(rotation * meshlet.coneAxis);
+
+			if (!frustum.intersects(meshletSphere) || meshlet.isBackfacing(meshletSphere, coneAxis, m_cameraPosition)) {
+				continue;
+			}
+
+			// Meshlets are contiguous in the index buffer, so neighbouring visible ones merge into one draw
+			const auto firstIndex = mesh->firstIndex + meshlet.firstIndex;
+			if (!m_drawRanges.empty() && m_drawRanges.back().objectIndex == objectIndex && m_drawRanges.back().firstIndex + m_drawRanges.back().indexCount == firstIndex) {
+				m_drawRanges.back().indexCount += meshlet.indexCount;
+			}
+			else {
+				m_drawRanges.push_back({ objectIndex, firstIndex, meshlet.indexCount });
+			}
+		}
+	}
+}
+
+/***********************************************************************************/
+void RenderSystem::rebuildDrawList() {
+	auto* objects = static_cast<ObjectData*>(m_objectBufferAllocInfo.pMappedData);
+	auto* meshlets = static_cast<MeshletData*>(m_meshletBufferAllocInfo.pMappedData);
+
+	m_drawObjects.clear();
+	m_drawBatches.clear();
+	m_meshletCount = 0;
+	m_meshInstanceCounts.assign(m_meshes.size(), 0);
+	auto overflow = false;
+
+	// Sort key: index type, then pipeline. Each key becomes one contiguous batch of objects/indirect draws,
+	// so switching pipelines or index buffers happens once per batch rather than per object.
+	std::vector<std::pair<std::uint64_t, MeshInstance*>> instances;
+	m_world->forEachChunk<const Transform, MeshInstance, const WorldBounds>([&](const std::size_t count, const Entity*, const Transform*, MeshInstance* chunkInstances, const WorldBounds*) {
+		for (std::size_t i = 0; i < count; ++i) {
+			auto& instance = chunkInstances[i];
+			if (instance.meshIndex >= m_meshes.size() || !m_meshes[instance.meshIndex]) {
+				instance.drawIndex = MeshInstance::InvalidDrawIndex;
+				continue;
+			}
+
+			++m_meshInstanceCounts[instance.meshIndex];
+
+			const auto& mesh = m_meshes[instance.meshIndex];
+			const std::uint64_t indexTypeKey = mesh->indexType() == VK_INDEX_TYPE_UINT16 ? 0 : 1;
+			instances.emplace_back(indexTypeKey << 32 | pipelineIndex({ mesh->shader }), &instance);
+		}
+	});
+	std::stable_sort(instances.begin(), instances.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+
+	for (const auto& [key, instancePtr] : instances) {
+		auto& instance = *instancePtr;
+		const auto& mesh = m_meshes[instance.meshIndex];
+
+		if (m_drawObjects.size() == m_objectCapacity) {
+			instance.drawIndex = MeshInstance::InvalidDrawIndex;
+			overflow = true;
+			continue;
+		}
+
+		const auto drawIndex = static_cast<std::uint32_t>(m_drawObjects.size());
+		instance.drawIndex = drawIndex;
+		m_drawObjects.push_back(instance.meshIndex);
+
+		if (m_drawBatches.empty() || m_drawBatches.back().pipeline != static_cast<std::uint32_t>(key) || m_drawBatches.back().indexType != mesh->indexType()) {
+			m_drawBatches.push_back({ static_cast<std::uint32_t>(key), mesh->indexType(), drawIndex, 0, m_meshletCount, 0 });
+		}
+		auto& batch = m_drawBatches.back();
+		++batch.objectCount;
+
+		auto& object = objects[drawIndex];
+		object.boundingSphere = glm::vec4(mesh->boundingSphere.center, mesh->boundingSphere.radius);
+		object.positionScale = glm::vec4(mesh->positionScale, 0.0f);
+		object.positionOffset = glm::vec4(mesh->positionOffset, 0.0f);
+		object.lodCount = static_cast<std::uint32_t>(mesh->lods.size());
+		object.vertexOffset = mesh->vertexOffset;
+		object.textureIndex = mesh->texture ? mesh->texture->descriptorIndex : 0;
+
+		for (std::size_t lod = 0; lod < mesh->lods.size(); ++lod) {
+			object.lodFirstIndex[lod] = mesh->firstIndex + mesh->lods[lod].firstIndex;
+			object.lodIndexCount[lod] = mesh->lods[lod].indexCount;
+			object.lodError[lod] = mesh->lods[lod].error;
+		}
+
+		// Out of meshlet slots: the object is drawn whole by cull.comp
+		object.meshletOffset = m_meshletCount;
+		object.meshletCount = 0;
+		if (!m_clusterCulling || m_meshletCount + mesh->meshlets.size() > m_meshletCapacity) {
+			overflow = overflow || m_clusterCulling;
+			continue;
+		}
+
+		for (const auto& meshlet : mesh->meshlets) {
+			auto& data = meshlets[m_meshletCount++];
+			data.boundingSphere = glm::vec4(meshlet.boundingSphere.center, meshlet.boundingSphere.radius);
+			data.cone = glm::vec4(meshlet.coneAxis, meshlet.coneCutoff);
+			data.objectIndex = drawIndex;
+			data.firstIndex = mesh->firstIndex + meshlet.firstIndex;
+			data.indexCount = meshlet.indexCount;
+			data.vertexOffset = mesh->vertexOffset;
+		}
+		object.meshletCount = static_cast<std::uint32_t>(mesh->meshlets.size());
+		batch.meshletCount += object.meshletCount;
+	}
+
+	if (overflow) {
+		spdlog::get("console")->error("Draw list exceeds the object buffers ({} objects, {} meshlets), some entities are not drawn or not meshlet culled.", m_objectCapacity, m_meshletCapacity);
+	}
+
+	// The CPU culler keeps one sphere per slot and the BVH its box, refreshed every frame
+	m_objectTransforms.resize(m_drawObjects.size());
+	m_objectBounds.resize(m_drawObjects.size());
+	m_frustumCuller.clear();
+	m_frustumCuller.reserve(m_drawObjects.size());
+	for (std::size_t i = 0; i < m_drawObjects.size(); ++i) {
+		m_frustumCuller.add(BoundingSphere());
+	}
+
+	m_drawListVersion = m_world->version();
+}
+
+/***********************************************************************************/
+void RenderSystem::updateObjectBuffer() {
+	if (m_world->version() != m_drawListVersion) {
+		rebuildDrawList();
+	}
+
+	auto* objects = static_cast<ObjectData*>(m_objectBufferAllocInfo.pMappedData);
+
+	// Every entity owns its slot, so chunks can be processed on any thread
+	m_world->parallelForEachChunk<const Transform, const MeshInstance, WorldBounds>([&](const std::size_t count, const Entity*, const Transform* transforms, const MeshInstance* instances, WorldBounds* bounds) {
+		for (std::size_t i = 0; i < count; ++i) {
+			const auto drawIndex = instances[i].drawIndex;
+			if (drawIndex == MeshInstance::InvalidDrawIndex) {
+				continue;
+			}
+
+			const auto& transform = transforms[i].matrix;
+			bounds[i].sphere = m_meshes[instances[i].meshIndex]->boundingSphere.transformed(transform);
+
+			objects[drawIndex].model = transform;
+			m_objectTransforms[drawIndex] = transform;
+			m_frustumCuller.set(drawIndex, bounds[i].sphere);
+
+			auto& box = m_objectBounds[drawIndex];
+			box.min = bounds[i].sphere.center - bounds[i].sphere.radius;
+			box.max = bounds[i].sphere.center + bounds[i].sphere.radius;
+		}
+	});
+}
+
+/***********************************************************************************/
+void RenderSystem::updateLightBuffer() {
+	auto* lights = static_cast<LightData*>(m_lightBufferAllocInfo.pMappedData);
+	const Frustum frustum(m_viewProjection);
+
+	// Lights that can't reach the view can't touch a cluster either, light_cull.comp never sees them
+	std::uint32_t considered = 0, count = 0;
+	m_world->forEachChunk<const Transform, const PointLight>([&](const std::size_t chunkCount, const Entity*, const Transform* transforms, const PointLight* pointLights) {
+		for (std::size_t i = 0; i < chunkCount && considered < m_maxLights && count < m_lightCapacity; ++i, ++considered) {
+			const auto& light = pointLights[i];
+			const glm::vec3 position = transforms[i].matrix[3];
+			if (!frustum.intersects({ position, light.radius })) {
+				continue;
+			}
+
+			lights[count++] = { glm::vec4(glm::vec3(m_view * glm::vec4(position, 1.0f)), light.radius), glm::vec4(light.color * light.intensity, 0.0f) };
+		}
+	});
+
+	static_cast<UniformBufferObject*>(m_uniformBufferAllocInfo.pMappedData)->clusterCount.w = count;
+}
+
+/***********************************************************************************/
+void RenderSystem::recordCullPass(const VkCommandBuffer commandBuffer) const {
+	vkCmdFillBuffer(commandBuffer, m_cullStatsBuffer, 0, VK_WHOLE_SIZE, 0);
+
+	// Clear has to land before the shader's atomics
+	VkBufferMemoryBarrier clearBarrier {};
+	clearBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+	clearBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	clearBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+	clearBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	clearBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	clearBarrier.buffer = m_cullStatsBuffer;
+	clearBarrier.offset = 0;
+	clearBarrier.size = VK_WHOLE_SIZE;
+
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 
+		0, nullptr, 
+		1, &clearBarrier, 
+		0, nullptr);
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_cullPipeline);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_cullPipelineLayout, 0, 1, &m_cullDescriptorSet, 0, nullptr);
+
+	CullPushConstants pushConstants {};
+	const Frustum frustum(m_viewProjection);
+	std::copy(frustum.planes.begin(), frustum.planes.end(), pushConstants.frustumPlanes.begin());
+	pushConstants.cameraPosition = m_cameraPosition;
+	pushConstants.lodScale = m_lodScale;
+	pushConstants.objectCount = static_cast<std::uint32_t>(m_drawObjects.size());
+	pushConstants.meshletCount = m_meshletCount;
+	if (m_occlusionCulling && m_hiZValid) {
+		pushConstants.depthSize = m_swapChainExtent.width | m_swapChainExtent.height << 16;
+	}
+
+	vkCmdPushConstants(commandBuffer, m_cullPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullPushConstants), &pushConstants);
+	vkCmdDispatch(commandBuffer, (pushConstants.objectCount + 63) / 64, 1, 1); // local_size_x = 64
+
+	if (m_clusterCulling && m_meshletCount > 0) {
+		// cluster_cull.comp reads the LODs cull.comp picked
+		VkBufferMemoryBarrier lodBarrier {};
+		lodBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+		lodBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		lodBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		lodBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		lodBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		lodBarrier.buffer = m_objectLodBuffer;
+		lodBarrier.offset = 0;
+		lodBarrier.size = VK_WHOLE_SIZE;
+
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 
+			0, nullptr, 
+			1, &lodBarrier, 
+			0, nullptr);
+
+		// Same layout and push constants, only the pipeline changes
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_clusterCullPipeline);
+		vkCmdDispatch(commandBuffer, (m_meshletCount + 63) / 64, 1, 1); // local_size_x = 64
+	}
+}
+
+/***********************************************************************************/
+void RenderSystem::recordHiZPass(const VkCommandBuffer commandBuffer) {
+	HiZPushConstants pushConstants {};
+	pushConstants.sourceSize = { m_swapChainExtent.width, m_swapChainExtent.height };
+	pushConstants.sampleCount = static_cast<std::int32_t>(m_msaaSamples);
+
+	for (std::uint32_t level = 0; level < m_hiZLevelExtents.size(); ++level) {
+		const auto& extent = m_hiZLevelExtents[level];
+		pushConstants.destinationSize = { extent.width, extent.height };
+
+		// Only level 0 reads the depth buffer, which may be multisampled
+		if (level <= 1) {
+			const auto pipeline = level == 0 && m_msaaSamples != VK_SAMPLE_COUNT_1_BIT ? m_hiZMultisampledPipeline : m_hiZPipeline;
+			vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+		}
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_hiZPipelineLayout, 0, 1, &m_hiZDescriptorSets[level], 0, nullptr);
+		vkCmdPushConstants(commandBuffer, m_hiZPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(HiZPushConstants), &pushConstants);
+		vkCmdDispatch(commandBuffer, (extent.width + 7) / 8, (extent.height + 7) / 8, 1); // local_size 8x8
+
+		if (level + 1 == m_hiZLevelExtents.size()) {
+			break;
+		}
+
+		// The next level reads this one
+		VkImageMemoryBarrier barrier {};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+		barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = m_hiZImage;
+		barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, level, 1, 0, 1 };
+		barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+			0, nullptr,
+			0, nullptr,
+			1, &barrier);
+
+		pushConstants.sourceSize = { extent.width, extent.height };
+	}
+
+	// Next frame's cull pass can test against it
+	m_hiZValid = true;
+}
+
+/***********************************************************************************/
+void RenderSystem::recordLightCullPass(const VkCommandBuffer commandBuffer) const {
+	vkCmdFillBuffer(commandBuffer, m_lightCullStatsBuffer, 0, VK_WHOLE_SIZE, 0);
+
+	// Clear has to land before the shader's atomics
+	VkBufferMemoryBarrier clearBarrier {};
+	clearBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+	clearBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	clearBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+	clearBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	clearBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	clearBarrier.buffer = m_lightCullStatsBuffer;
+	clearBarrier.offset = 0;
+	clearBarrier.size = VK_WHOLE_SIZE;
+
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 
+		0, nullptr, 
+		1, &clearBarrier, 
+		0, nullptr);
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_lightCullPipeline);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_lightCullPipelineLayout, 0, 1, &m_lightCullDescriptorSet, 0, nullptr);
+	vkCmdDispatch(commandBuffer, (ClusterCount + 63) / 64, 1, 1); // local_size_x = 64
+}
+
+#ifdef _DEBUG
+/***********************************************************************************/
+void RenderSystem::validateGpuCulling() {
+	if (!m_cullStatsPending) {
+		return;
+	}
+	m_cullStatsPending = false;
+
+	// The previous frame has been waited on at the end of update(), so the stats are ready. Nothing has
+	// touched the camera, the draw list or the culler's spheres since its cull pass was recorded.
+	const auto* stats = static_cast<const std::uint32_t*>(m_cullStatsBufferAllocInfo.pMappedData);
+	const auto gpuVisibleCount = stats[0];
+	const auto* visibleMask = stats + 1;
+
+	// Spheres this close to a plane may land on either side depending on rounding
+	const Frustum frustum(m_viewProjection);
+	const auto borderline = [&frustum](const BoundingSphere& sphere) {
+		for (const auto& plane : frustum.planes) {
+			const auto distance = glm::dot(glm::vec3(plane), sphere.center) + plane.w + sphere.radius;
+			if (std::abs(distance) <= 1e-4f * (1.0f + std::abs(plane.w) + glm::length(sphere.center) + sphere.radius)) {
+				return true;
+			}
+		}
+		return false;
+	};
+
+	// Both lists are in ascending object order
+	auto cpuVisible = m_visibleObjects.cbegin();
+	std::size_t mismatches = 0;
+	auto firstMismatch = 0u;
+	for (std::uint32_t objectIndex = 0; objectIndex < m_drawObjects.size(); ++objectIndex) {
+		const auto visibleOnGpu = (visibleMask[objectIndex / 32] & (1u << (objectIndex % 32))) != 0;
+		const auto visibleOnCpu = cpuVisible != m_visibleObjects.cend() && *cpuVisible == objectIndex;
+		if (visibleOnCpu) {
+			++cpuVisible;
+		}
+
+		if (visibleOnGpu != visibleOnCpu && !borderline(m_frustumCuller.sphere(objectIndex))) {
+			if (mismatches++ == 0) {
+				firstMismatch = objectIndex;
+			}
+		}
+	}
+
+	if (mismatches > 0) {
+		spdlog::get("console")->error("GPU culling mismatch: {} objects disagree with the CPU culler (first is object {}), {} visible on the GPU, {} on the CPU.", 
+			mismatches, firstMismatch, gpuVisibleCount, m_visibleObjects.size());
+	}
+}
+
+/***********************************************************************************/
+void RenderSystem::reportLightClusterOverflow() {
+	if (!m_lightCullStatsPending) {
+		return;
+	}
+	m_lightCullStatsPending = false;
+
+	// Waited on at the end of update() like the cull stats. Logged on change only, lights move every frame.
+	const auto* stats = static_cast<const std::uint32_t*>(m_lightCullStatsBufferAllocInfo.pMappedData);
+	const auto overflowClusters = stats[0], maxClusterLights = stats[1];
+
+	if (overflowClusters > 0 && !m_lightClustersOverflowing) {
+		spdlog::get("console")->warn("Light cluster overflow: {} clusters touch more than {} lights (up to {}), the rest are not shaded.", 
+			overflowClusters, MaxLightsPerCluster, maxClusterLights);
+	}
+	else if (overflowClusters == 0 && m_lightClustersOverflowing) {
+		spdlog::get("console")->info("Light clusters are back under {} lights.", MaxLightsPerCluster);
+	}
+	m_lightClustersOverflowing = overflowClusters > 0;
+}
+#endif
+
 /***********************************************************************************/
 void RenderSystem::createImage(const std::uint32_t width, const std::uint32_t height, const VkFormat format, const VkImageTiling tiling, const VkImageUsageFlags usage, VkImage& image, VmaAllocation& allocation) const {
 	VkImageCreateInfo imageInfo {};
@@ -1231,7 +2954,16 @@ VkFormat RenderSystem::findSupportedFormat(const std::vector<VkFormat>& candidat
 }
 
 /***********************************************************************************/
-VkFormat RenderSystem::findDepthFormat() const {
+VkFormat RenderSystem::findDepthFormat(const bool sampled) const {
+	if (sampled) {
+		// D16 is always sampleable as a depth attachment
+		return findSupportedFormat(
+		{ VK_FORMAT_D32_SFLOAT, VK_FORMAT_X8_D24_UNORM_PACK32, VK_FORMAT_D16_UNORM },
+			VK_IMAGE_TILING_OPTIMAL,
+			VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT
+		);
+	}
+
 	return findSupportedFormat(
 	{ VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT },
 		VK_IMAGE_TILING_OPTIMAL,
@@ -1244,6 +2976,17 @@ bool RenderSystem::hasStencilComponent(const VkFormat format) const {
 	return format == VK_FORMAT_D32_SFLOAT_S8_UINT || format == VK_FORMAT_D24_UNORM_S8_UINT;
 }
 
+/***********************************************************************************/
+std::vector<char> RenderSystem::loadShader(const std::string& sourcePath, const std::string_view precompiledPath, const ShaderCache::Defines& defines) {
+	auto code = m_shaderCache.get(sourcePath, defines);
+	if (!code.empty()) {
+		return code;
+	}
+
+	spdlog::get("console")->info("Using precompiled {}", precompiledPath.data());
+	return readShaderFile(precompiledPath);
+}
+
 /***********************************************************************************/
 std::vector<char> RenderSystem::readShaderFile(const std::string_view filename) const {
 	std::ifstream file(filename.data(), std::ios::ate | std::ios::binary);
@@ -3,7 +3,18 @@
 #include "ISystem.h"
 #include "Graphics/Device.h"
 #include "Graphics/Mesh.h"
+#include "Graphics/FrustumCuller.h"
+#include "Graphics/FreeListAllocator.h"
+#include "Graphics/ShaderCache.h"
+#include "Graphics/PipelineCache.h"
+#include "Graphics/LayoutCache.h"
+#include "Graphics/RenderGraph.h"
+#include "Scene/Bvh.h"
+#include "ECS/World.h"
 
+#include <functional>
+#include <string>
+#include <unordered_map>
 #include <vector>
 
 struct GLFWwindow;
@@ -18,6 +29,40 @@ public:
 	RenderSystem& operator=(const RenderSystem&) = delete;
 
 	void addMeshes(const std::vector<MeshPtr>& meshes);
+	// Returns the index to put in MeshInstance::meshIndex. Adding a mesh that is already in the table
+	// returns its existing index. After init the mesh is uploaded right away.
+	// The GPU copy is released once the table holds the last reference and no entity uses the mesh.
+	std::uint32_t addMesh(const MeshPtr& mesh);
+
+	// Hot reload, only between frames (update() leaves the GPU idle).
+	// Replaces the mesh's contents (keeping its texture and shader variant) with a freshly loaded copy.
+	void reloadMesh(Mesh& mesh, Mesh&& loaded);
+	// Replaces the texture's image with new RGBA8 pixels. Textures that were never uploaded are skipped.
+	void reloadTexture(Texture& texture, const unsigned char* pixels, const int width, const int height);
+	// Recreates the pipeline(s) built from the given GLSL or SPIR-V file, if any.
+	void reloadShader(const std::string_view path);
+
+	// Thread-safe, the hot reloader compiles changed sources on its worker
+	auto& shaderCache() noexcept { return m_shaderCache; }
+	// Entities with Transform, MeshInstance and WorldBounds get drawn. Must outlive the render system.
+	void setWorld(World& world) noexcept { m_world = &world; }
+	// MSAA samples per pixel (1, 2, 4 or 8), lowered to what the device supports. After init this
+	// rebuilds the render graph and the pipelines, so only between frames.
+	void setMsaaSamples(const std::uint32_t samples);
+	// Renders framesPerSampleCount frames at every supported sample count, logs the average GPU frame
+	// time of each, then goes back to the current setting. Does nothing while a benchmark is running.
+	void benchmarkMsaa(const std::uint32_t framesPerSampleCount = 256);
+	// Lays depth down in a depth-only pass first, so the forward pass shades each pixel once (depth
+	// test EQUAL, no depth writes). Pays off when overdraw is high and fragments are expensive.
+	// After init this rebuilds the render graph, so only between frames.
+	void setDepthPrepass(const bool enabled);
+	auto depthPrepass() const noexcept { return m_depthPrepass; }
+	// Same as benchmarkMsaa, with the depth pre-pass off and on
+	void benchmarkDepthPrepass(const std::uint32_t framesPerSetting = 256);
+	// Shades with at most this many of the world's point lights (in the order the world stores them), all by default
+	void setMaxLights(const std::uint32_t count) noexcept { m_maxLights = count; }
+	// Same as benchmarkMsaa, with more and more of the world's point lights
+	void benchmarkLights(const std::uint32_t framesPerSetting = 256);
 
 	void init() override;
 	void update(const float delta) override;
@@ -43,6 +88,37 @@ private:
 		}
 	};
 	/***********************************************************************************/
+	// Index range drawn for a visible object on the CPU culling path
+	struct DrawRange {
+		std::uint32_t objectIndex;
+		std::uint32_t firstIndex;
+		std::uint32_t indexCount;
+	};
+	/***********************************************************************************/
+	// Run of object buffer slots (and their meshlets) drawn with one pipeline and index type
+	struct DrawBatch {
+		std::uint32_t pipeline; // Index into m_pipelineDescriptions
+		VkIndexType indexType;
+		std::uint32_t firstObject, objectCount;
+		std::uint32_t firstMeshlet, meshletCount;
+	};
+	/***********************************************************************************/
+	// GPU frame time of a few renderer settings, one after the other
+	struct GpuBenchmark {
+		struct Setting {
+			std::string name;
+			std::function<void()> apply;
+		};
+
+		std::string name;
+		std::vector<Setting> settings; // Empty when not running
+		std::function<void()> restore; // Back to what was set before
+		std::size_t current = 0;
+		std::uint32_t framesPerSetting = 0;
+		std::uint32_t frame = 0; // At the current setting, warm-up included
+		double gpuTime = 0.0; // Milliseconds, summed over the measured frames
+	};
+	/***********************************************************************************/
 
 	// Core Vulkan setup
 	void createInstance();
@@ -52,34 +128,100 @@ private:
 	void createMemoryAllocator();
 	void createSwapChain();
 	void createImageViews();
-	void createRenderPass();
-	void createDescriptorSetLayout();
-	// Where shader objects are created and options set for Vertex layout, viewport, scissors, MSAA, etc.
+	// Describes the frame (culling, light binning, depth pre-pass, forward pass, Hi-Z pyramid) and compiles it for the swapchain. Rebuilt with the swapchain.
+	void buildRenderGraph();
+	// After a setting the graph depends on changed, keeping the swapchain. Leaves the GPU idle.
+	void rebuildRenderGraph();
+	// Descriptor set and pipeline layouts of the graphics and compute shaders, reflected from their SPIR-V
+	void createLayouts();
+	// Creates the pipeline layout shared by every graphics pipeline, the pipeline cache, and the default pipeline.
 	void createGraphicsPipeline();
-	void createFramebuffers();
+	// Where shader objects are created and options set for Vertex layout, rasterizer, depth, blending, etc.
+	// Runs on the pipeline cache's workers. VK_NULL_HANDLE when the variant's shaders aren't available.
+	VkPipeline createGraphicsPipeline(const PipelineDescription& description, const VkPipelineCache pipelineCache);
+	// Index of the description in m_pipelineDescriptions, adding it if it's new
+	std::uint32_t pipelineIndex(const PipelineDescription& description);
+	// What m_pipelineDescriptions[index] becomes in the depth pre-pass, or in the forward pass behind it
+	PipelineDescription passDescription(const std::uint32_t index, const bool depthOnly) const;
+	// The pipeline, starting its creation on first use. The default pipeline stands in while it's
+	// being created, and for good if that fails. Never waits: VK_NULL_HANDLE if neither is ready.
+	VkPipeline graphicsPipeline(const std::uint32_t index, const bool depthOnly = false);
+	// Starts creating, without waiting, the default pipeline and every draw batch's, in each pass they're
+	// drawn in. True once none is left on a worker.
+	bool requestPipelines();
 	void createCommandPools();
-	// Setup and configure depth images for depth buffering
-	void createDepthAttachment();
+	// Reads the texture's file and uploads it
 	void createTextureImage(Texture& texture);
+	// Creates the image for texture.width x texture.height RGBA8 pixels and copies them in
+	void uploadTexture(Texture& texture, const unsigned char* pixels);
 	void createTextureImageView(Texture& texture);
 	// The sampler is a distinct object that provides an interface to extract colors from a texture. 
 	// It can be applied to any image you want, whether it is 1D, 2D or 3D. 
 	// This is different from many older APIs, which combined texture images and filtering into a single state.
 	// Samplers can be shared across different textures.
 	void createTextureSampler();
-	// Loops through given vector of MeshPtr's and instantiates the Vulkan-specific members (allocates memory, 
-	// create index + vertex buffers, etc).
+	// Loops through given vector of MeshPtr's and instantiates the Vulkan-specific members (suballocates
+	// geometry, uploads textures, etc).
 	void prepareMeshes();
-	void createVertexBuffer(MeshPtr& mesh) const;
-	void createIndexBuffer(MeshPtr& mesh) const;
+	// Creates the device-local vertex + index buffers every mesh is suballocated from.
+	void createGeometryBuffers();
+	// Reserves a range of the geometry buffers for the mesh and copies its vertices + indices into it.
+	void uploadGeometry(Mesh& mesh);
+	// Uploads the mesh's geometry and texture unless they already are on the GPU.
+	void makeResident(Mesh& mesh);
+	// Drops meshes nothing else references and no entity draws, then textures no mesh uses any more.
+	void releaseUnusedAssets();
+	void destroyTexture(Texture& texture) const;
+	// Points the descriptor set's texture array at m_textures, free slots at any live texture
+	void updateTextureDescriptors();
 	void createUniformBuffer();
+	// Per-object data read by the culling shader + vertex shader, and the indirect draw commands written by cull.comp.
+	// Sized for the renderable entities in the world at init.
+	void createObjectBuffers();
+	// Meshlets of every drawn object and the buffers cluster_cull.comp writes into.
+	void createMeshletBuffers();
+	// Point lights, written by the CPU every frame, and the per-cluster light lists light_cull.comp fills.
+	// Sized for the lights in the world at init.
+	void createLightBuffers();
 	void createDescriptorPools();
 	void createDescriptorSet();
+	// Compute pipelines + descriptor set for GPU frustum culling (cull.comp) and meshlet culling (cluster_cull.comp).
+	void createCullPipeline();
+	// Just the two compute pipelines, recreated when their shaders are reloaded.
+	void createCullPipelines();
+	// The hiz_build.comp pipelines, for single and multisampled depth buffers.
+	void createHiZPipelines();
+	// The pyramid for a swapchain-sized depth buffer, its views and the descriptor sets that build it from depthView.
+	// Starts out without history, so the first frame isn't occlusion culled.
+	void createHiZPyramid(const VkImageView depthView);
+	void destroyHiZPyramid();
+	// Descriptor set + pipeline for binning lights into clusters (light_cull.comp)
+	void createLightCulling();
+	// Just the compute pipeline, recreated when its shader is reloaded.
+	void createLightCullPipeline();
 	void createCommandBuffers();
+	// Draws [firstDraw, firstDraw + drawCount) of an indirect draw buffer, in one call when multiDrawIndirect is available.
+	void recordIndirectDraws(const VkCommandBuffer commandBuffer, const VkBuffer drawBuffer, const std::uint32_t firstDraw, const std::uint32_t drawCount) const;
+	// Re-records the render graph for the given swapchain image. Called every frame so per-draw
+	// data (push constants, visible mesh list) can change without touching descriptors.
+	void recordCommandBuffer(const std::uint32_t imageIndex);
+	// The draws, recorded inside the forward pass's render pass, or the depth pre-pass's with depthOnly
+	void recordDraws(const VkCommandBuffer commandBuffer, const bool depthOnly);
 	void createSemaphores();
 	void cleanupSwapChain();
-	// Called when the window resizes to recreate the swapchain and depth attachments.
+	// Called when the window resizes to recreate the swapchain and the render graph.
 	void recreateSwapChain();
+	// Highest sample count color and depth attachments support that doesn't exceed samples
+	VkSampleCountFlagBits supportedSampleCount(const std::uint32_t samples) const;
+	// Two timestamps around each frame's GPU work, if the device has them
+	void createTimestampQueries();
+	// Starts on the first setting, unless a benchmark is already running or there are no timestamps
+	void startBenchmark(GpuBenchmark&& benchmark);
+	// Reads the last frame's GPU time into the running benchmark and moves it along
+	void updateBenchmark();
+	// Logs the render graph's transient memory whenever it changes: after a rebuild, or when the
+	// driver commits lazily allocated memory. Checked every frame.
+	void reportTransientMemory();
 	
 	// Helper stuff
 	std::vector<const char*> getRequiredExtensions() const;
@@ -90,11 +232,38 @@ private:
 	// Helper function to create a Vulkan buffer (vertex, index, etc).
 	// Returns a VmaAllocationInfo in case you want to do a persistent memory mapping:
 	// https://gpuopen-librariesandsdks.github.io/VulkanMemoryAllocator/html/memory_mapping.html
-	VmaAllocationInfo createBuffer(const VkDeviceSize size, const VkBufferUsageFlags usage, VkBuffer& buffer, VmaAllocation& allocation) const;
-	// Helper function to copy a Vulkan buffer to a destination buffer.
-	void copyBuffer(const VkBuffer src, const VkBuffer dest, const VkDeviceSize size) const;
+	// Anything but VMA_MEMORY_USAGE_GPU_ONLY is persistently mapped.
+	VmaAllocationInfo createBuffer(const VkDeviceSize size, const VkBufferUsageFlags usage, VkBuffer& buffer, VmaAllocation& allocation, const VmaMemoryUsage memoryUsage = VMA_MEMORY_USAGE_CPU_ONLY) const;
+	// Helper function to copy a range of a Vulkan buffer to a destination buffer.
+	void copyBuffer(const VkBuffer src, const VkBuffer dest, const VkDeviceSize size, const VkDeviceSize srcOffset = 0, const VkDeviceSize destOffset = 0) const;
 	// Updates uniform buffer every frame before rendering.
-	void updateUniformBuffer(const float dt) const;
+	void updateUniformBuffer();
+	// Tests every object's world-space bounding sphere against the camera frustum (through the BVH once
+	// there are enough objects) and fills m_visibleObjects with the ones that need to be drawn this frame. m_drawRanges gets the index ranges to draw: the
+	// selected LOD, or the visible meshlets of objects drawn at LOD 0.
+	void cullMeshes();
+	// Assigns every renderable entity a slot in the object buffer (16-bit index meshes first) and writes
+	// the per-object data that only depends on the mesh. Only runs when the world's structure changed.
+	void rebuildDrawList();
+	// Walks the renderable chunks in parallel: refreshes WorldBounds and copies transforms into the object buffer.
+	void updateObjectBuffer();
+	// Copies the point lights that reach into the view frustum into the light buffer, in view space,
+	// and their count into the UBO. Runs after updateUniformBuffer.
+	void updateLightBuffer();
+	// Records the culling dispatch. The render graph makes its draws visible to vkCmdDrawIndexedIndirect.
+	// Must be recorded outside of a render pass.
+	void recordCullPass(const VkCommandBuffer commandBuffer) const;
+	// Reduces this frame's depth into the Hi-Z pyramid, one dispatch per level, for next frame's culling.
+	void recordHiZPass(const VkCommandBuffer commandBuffer);
+	// Records the light binning dispatch, one invocation per cluster
+	void recordLightCullPass(const VkCommandBuffer commandBuffer) const;
+#ifdef _DEBUG
+	// Compares the objects the previous frame's cull pass found inside the frustum against the CPU culler's.
+	// Has to run before anything this frame touches the camera, the draw list or the object bounds.
+	void validateGpuCulling();
+	// Logs when the previous frame's light clusters start or stop running past MaxLightsPerCluster
+	void reportLightClusterOverflow();
+#endif
 	// Helper function to create a Vulkan image buffer.
 	void createImage(const std::uint32_t width, const std::uint32_t height, const VkFormat format, const VkImageTiling tiling, const VkImageUsageFlags usage, VkImage& image, VmaAllocation& allocation) const;
 	// Helper function to move an image into GPU memory.
@@ -105,19 +274,70 @@ private:
 	// Takes a list of candidate image formats in order from most desirable to least desirable, and checks which is the first one that is supported.
 	VkFormat findSupportedFormat(const std::vector<VkFormat>& candidates, const VkImageTiling tiling, const VkFormatFeatureFlags features) const;
 	// Helper function to select a format with a depth component that supports usage as depth attachment.
-	VkFormat findDepthFormat() const;
+	// sampled: also readable by shaders, and without stencil so a view can cover the whole format.
+	VkFormat findDepthFormat(const bool sampled = false) const;
 	// Helper function that checks if a given image format contains a stencil component.
 	bool hasStencilComponent(const VkFormat format) const;
 
 	// Shader creation
 
+	// Compiles (or finds in the shader cache) the GLSL source. Falls back to the SPIR-V built by
+	// compile.bat when this build has no compiler and the cache doesn't have it.
+	std::vector<char> loadShader(const std::string& sourcePath, const std::string_view precompiledPath, const ShaderCache::Defines& defines = {});
 	// Reads a compiled SPIR-V shader file from disk.
 	std::vector<char> readShaderFile(const std::string_view filename) const;
 	// Creates a Vulkan shader module from loaded shader file.
 	VkShaderModule createShaderModule(const std::vector<char>& code) const;
 
-	// Holds all meshes to be rendered
+	ShaderCache m_shaderCache;
+
+	// Mesh table, indexed by MeshInstance::meshIndex. Released meshes leave a null slot for reuse.
 	std::vector<MeshPtr> m_meshes;
+	// Entities using each mesh, counted when the draw list is rebuilt
+	std::vector<std::uint32_t> m_meshInstanceCounts;
+	// Every uploaded texture once, however many meshes share it. Indexed by Texture::descriptorIndex,
+	// released textures leave a null slot for reuse.
+	std::vector<TexturePtr> m_textures;
+
+	World* m_world = nullptr;
+	// World::version() the draw list was built for
+	std::uint64_t m_drawListVersion = ~0ull;
+	// Mesh of each object buffer slot, sorted by index type and then pipeline variant
+	std::vector<std::uint32_t> m_drawObjects;
+	std::vector<DrawBatch> m_drawBatches;
+	// Object-to-world matrix of each slot, for the CPU culling path
+	std::vector<glm::mat4> m_objectTransforms;
+	std::uint32_t m_objectCapacity = 0, m_meshletCapacity = 0;
+
+	// Object buffer slots that survived culling this frame
+	std::vector<std::uint32_t> m_visibleObjects;
+	std::vector<DrawRange> m_drawRanges;
+	FrustumCuller m_frustumCuller;
+	// Box around each slot's world sphere, the BVH is refit to them before culling
+	std::vector<AABB> m_objectBounds;
+	Bvh m_bvh;
+	glm::mat4 m_view, m_viewProjection;
+	glm::vec3 m_cameraPosition;
+	// Converts object-space LOD error at distance 1 into pixels (see LodPixelError)
+	float m_lodScale;
+	// Cull on the GPU and draw through vkCmdDrawIndexedIndirect, otherwise cull on the CPU and draw directly.
+	bool m_gpuCulling = true;
+	// Cull meshlets of meshes drawn at LOD 0, otherwise draw them whole
+	bool m_clusterCulling = true;
+	// On the GPU path, also cull objects and meshlets hidden behind last frame's depth
+	bool m_occlusionCulling = true;
+	std::uint32_t m_requestedMsaaSamples = 4;
+	// What the device allows of the request, picked when the render graph is built
+	VkSampleCountFlagBits m_msaaSamples = VK_SAMPLE_COUNT_1_BIT;
+	bool m_depthPrepass = false;
+	std::uint32_t m_lightCapacity = 0;
+	std::uint32_t m_maxLights = ~0u;
+	GpuBenchmark m_benchmark;
+#ifdef _DEBUG
+	bool m_cullStatsPending = false;
+	bool m_lightCullStatsPending = false;
+	bool m_lightClustersOverflowing = false;
+#endif
 
 	VkInstance m_instance;
 
@@ -125,7 +345,7 @@ private:
 	
 	// Memory Allocation
 	VmaAllocator m_allocator;
-	VmaAllocation m_depthAllocation, m_uniformBufferAllocation;
+	VmaAllocation m_uniformBufferAllocation;
 	VmaAllocationInfo m_uniformBufferAllocInfo;
 
 	VkQueue m_graphicsQueue, m_presentQueue;
@@ -135,14 +355,27 @@ private:
 	VkSwapchainKHR m_swapChain;
 	std::vector<VkImage> m_swapChainImages;
 	std::vector<VkImageView> m_swapChainImageViews;
-	std::vector<VkFramebuffer> m_swapChainFramebuffers;
 	VkFormat m_swapChainImageFormat;
 	VkExtent2D m_swapChainExtent;
 
-	VkRenderPass m_renderPass;
+	RenderGraph m_renderGraph;
+	RenderGraph::Resource m_backbuffer;
+	RenderGraph::MemoryStats m_reportedTransientMemory;
+	// The forward pass's and the depth pre-pass's (when enabled), owned by the graph
+	VkRenderPass m_renderPass = VK_NULL_HANDLE;
+	VkRenderPass m_depthPrepassRenderPass = VK_NULL_HANDLE;
+	VkQueryPool m_timestampPool = VK_NULL_HANDLE;
+	float m_timestampPeriod = 1.0f; // Nanoseconds per tick
+	// Owns every layout, the handles below point into it
+	LayoutCache m_layoutCache;
+	ShaderReflection m_graphicsReflection, m_cullReflection, m_lightCullReflection;
 	VkDescriptorSetLayout m_descriptorSetLayout;
 	VkPipelineLayout m_pipelineLayout;
-	VkPipeline m_graphicsPipeline;
+	PipelineCache m_pipelineCache;
+	// Every description drawn with so far, m_pipelineDescriptions[0] is the default. Indices stay valid
+	// when the pipelines are recreated, the draw batches hold them.
+	std::vector<PipelineDescription> m_pipelineDescriptions;
+	std::unordered_map<PipelineDescription, std::uint32_t, PipelineDescription::Hasher> m_pipelineIndices;
 
 	VkCommandPool m_drawingCommandPool, m_memoryTransferCommandPool;
 	std::vector<VkCommandBuffer> m_commandBuffers;
@@ -150,13 +383,59 @@ private:
 	VkSemaphore m_imageAvailableSemaphore;
 	VkSemaphore m_renderFinishedSemaphore;
 
-	VkImage m_depthImage;
-	VkImageView m_depthImageView;
 	VkSampler m_textureSampler;
 	VkBuffer m_uniformBuffer;
 
 	VkDescriptorPool m_descriptorPool;
-	VkDescriptorSet m_descriptorSet;
+	VkDescriptorSet m_descriptorSet = VK_NULL_HANDLE; // Allocated after the meshes are prepared
+
+	// Geometry shared by all meshes, bound once per frame
+	VkBuffer m_vertexBuffer, m_indexBuffer;
+	VmaAllocation m_vertexBufferAllocation, m_indexBufferAllocation;
+	// Byte ranges of m_vertexBuffer/m_indexBuffer handed out to meshes
+	FreeListAllocator m_vertexPool, m_indexPool;
+
+	// GPU culling
+	VkDescriptorSetLayout m_cullDescriptorSetLayout;
+	VkPipelineLayout m_cullPipelineLayout;
+	VkPipeline m_cullPipeline, m_clusterCullPipeline;
+	VkDescriptorSet m_cullDescriptorSet;
+
+	// Hi-Z occlusion culling: last frame's depth, reduced to the farthest depth per texel at every level
+	VkDescriptorSetLayout m_hiZDescriptorSetLayout;
+	VkPipelineLayout m_hiZPipelineLayout;
+	VkPipeline m_hiZPipeline, m_hiZMultisampledPipeline;
+	VkDescriptorPool m_hiZDescriptorPool;
+	VkSampler m_hiZSampler;
+	VkImage m_hiZImage = VK_NULL_HANDLE;
+	VmaAllocation m_hiZImageAllocation;
+	VkImageView m_hiZView; // Every level, read by the cull shaders
+	std::vector<VkImageView> m_hiZLevelViews;
+	std::vector<VkExtent2D> m_hiZLevelExtents;
+	std::vector<VkDescriptorSet> m_hiZDescriptorSets; // Per level, level 0 reads the depth buffer
+	RenderGraph::Resource m_hiZResource;
+	// The pyramid holds a frame's depth, it doesn't right after being created
+	bool m_hiZValid = false;
+
+	// Clustered lighting: the lights of this frame and, per cluster, how many touch it and which
+	VkDescriptorSetLayout m_lightCullDescriptorSetLayout;
+	VkPipelineLayout m_lightCullPipelineLayout;
+	VkPipeline m_lightCullPipeline;
+	VkDescriptorSet m_lightCullDescriptorSet;
+	VkBuffer m_lightBuffer, m_clusterLightCountBuffer, m_clusterLightIndexBuffer, m_lightCullStatsBuffer;
+	VmaAllocation m_lightBufferAllocation, m_clusterLightCountBufferAllocation, m_clusterLightIndexBufferAllocation, m_lightCullStatsBufferAllocation;
+	VmaAllocationInfo m_lightBufferAllocInfo, m_lightCullStatsBufferAllocInfo;
+
+	VkBuffer m_objectBuffer, m_drawCommandBuffer, m_cullStatsBuffer;
+	VmaAllocation m_objectBufferAllocation, m_drawCommandBufferAllocation, m_cullStatsBufferAllocation;
+	VmaAllocationInfo m_objectBufferAllocInfo, m_cullStatsBufferAllocInfo;
+
+	// Meshlets of all objects in object buffer order, the per-object LOD cull.comp hands to cluster_cull.comp,
+	// and one indirect draw per meshlet
+	VkBuffer m_meshletBuffer, m_objectLodBuffer, m_meshletDrawBuffer;
+	VmaAllocation m_meshletBufferAllocation, m_objectLodBufferAllocation, m_meshletDrawBufferAllocation;
+	VmaAllocationInfo m_meshletBufferAllocInfo;
+	std::uint32_t m_meshletCount = 0;
 
 /***********************************************************************************/
 	// Debug stuff
@@ -1,35 +1,132 @@
 ﻿#include "SolEngine.h"
 
 #include "Graphics/Mesh.h"
+#include "ECS/Components.h"
+#include "Math/BatchMath.h"
+#include "Logging/Log.h"
+#include "Input.h"
 
 #include <GLFW/glfw3.h>
 
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <chrono>
+#include <random>
+
 /***********************************************************************************/
 void SolEngine::init() {
+	spdlog::get("console")->info("Batch math kernels: {}", BatchMath::instructionSet());
+
+	const auto mesh = m_assets.loadMesh("Data/chalet.obj", "Data/chalet.jpg");
+	mesh->shader.lit = VK_TRUE; // Picks up the point lights below
+	const auto meshIndex = m_renderSystem.addMesh(mesh);
+
+	// Spins about Z at 30 degrees per second
+	m_world.create(Transform(), SceneNode{ m_hierarchy.create() }, MeshInstance{ meshIndex }, WorldBounds(), Spin{ glm::vec3(0.0f, 0.0f, 1.0f), glm::radians(30.0f) });
+
+#ifdef SOL_OVERDRAW_SCENE
+	// Copies lined up behind the first one as seen from the camera, created (and so drawn) farthest
+	// first: every pixel gets shaded once per copy unless the depth pre-pass is on
+	constexpr auto overdrawCopies = 12;
+	const auto awayFromCamera = glm::normalize(glm::vec3(-1.0f));
+	for (auto i = overdrawCopies; i > 0; --i) {
+		const auto local = glm::translate(glm::mat4(1.0f), awayFromCamera * (0.4f * i));
+		m_world.create(Transform(), SceneNode{ m_hierarchy.create(local) }, MeshInstance{ meshIndex }, WorldBounds(), Spin{ glm::vec3(0.0f, 0.0f, 1.0f), glm::radians(30.0f) });
+	}
+#endif
 
-	const auto mesh = Mesh::loadModel("Data/chalet.obj", "Data/chalet.jpg");
+	// Small colored point lights scattered around the chalet, carried around it by a spinning parent
+	constexpr auto lightCount = 10000;
+	const auto lightRig = m_hierarchy.create();
+	m_world.create(Transform(), SceneNode{ lightRig }, Spin{ glm::vec3(0.0f, 0.0f, 1.0f), glm::radians(-20.0f) });
 
-	m_renderSystem.addMeshes({ mesh });
+	std::mt19937 random(1234); // Same scene every run
+	std::uniform_real_distribution<float> horizontal(-3.0f, 3.0f), vertical(-0.5f, 2.0f), unit(0.0f, 1.0f);
+	for (auto i = 0; i < lightCount; ++i) {
+		const auto local = glm::translate(glm::mat4(1.0f), glm::vec3(horizontal(random), horizontal(random), vertical(random)));
+		const PointLight light { glm::vec3(unit(random), unit(random), unit(random)), 1.0f, 0.1f + 0.1f * unit(random) };
+		m_world.create(Transform(), SceneNode{ m_hierarchy.create(local, lightRig) }, light);
+	}
+
+	m_renderSystem.setWorld(m_world);
 
 	m_windowSystem.init();
 	m_renderSystem.init();
+
+	m_hotReloader.start({ "Data" });
 }
 
 /***********************************************************************************/
 void SolEngine::update() {
 
+	auto lastTime = std::chrono::high_resolution_clock::now();
+
 	while (!m_windowSystem.shouldClose()) {
 
 		glfwPollEvents();
 
-		m_renderSystem.update(0.0);
+		const auto currentTime = std::chrono::high_resolution_clock::now();
+		const auto delta = std::chrono::duration<float>(currentTime - lastTime).count();
+		lastTime = currentTime;
+
+		// The previous frame left the GPU idle
+		m_hotReloader.apply();
+
+		updateTransforms(delta);
+
+		// Depth pre-pass on/off
+		if (keyPressed(GLFW_KEY_F8)) {
+			m_renderSystem.setDepthPrepass(!m_renderSystem.depthPrepass());
+		}
+
+		// Logs the GPU cost of every MSAA sample count this machine supports
+		// (SolEngineTests' BenchmarkMsaa, BenchmarkDepthPrepass and BenchmarkPointLights time the same offscreen)
+		if (keyPressed(GLFW_KEY_F9)) {
+			m_renderSystem.benchmarkMsaa();
+		}
+		// Same with the depth pre-pass off and on (build with SOL_OVERDRAW_SCENE for a scene where it matters)
+		if (keyPressed(GLFW_KEY_F10)) {
+			m_renderSystem.benchmarkDepthPrepass();
+		}
+		// GPU cost of shading with more and more of the scene's point lights
+		if (keyPressed(GLFW_KEY_F11)) {
+			m_renderSystem.benchmarkLights();
+		}
+
+		m_renderSystem.update(delta);
 	}
 
 	m_renderSystem.waitDeviceIdle();
 }
 
+/***********************************************************************************/
+void SolEngine::updateTransforms(const float delta) {
+	// Serial: setLocal queues dirty subtrees
+	m_world.forEach<const SceneNode, const Spin>([this, delta](const Entity, const SceneNode& sceneNode, const Spin& spin) {
+		m_hierarchy.setLocal(sceneNode.node, glm::rotate(m_hierarchy.local(sceneNode.node), delta * spin.radiansPerSecond, spin.axis));
+	});
+
+	m_hierarchy.update();
+
+	m_world.parallelForEachChunk<Transform, const SceneNode>([this](const std::size_t count, const Entity*, Transform* transforms, const SceneNode* sceneNodes) {
+		for (std::size_t i = 0; i < count; ++i) {
+			transforms[i].matrix = m_hierarchy.world(sceneNodes[i].node);
+		}
+	});
+}
+
+/***********************************************************************************/
+bool SolEngine::keyPressed(const int key) {
+	const auto down = Input::GetInstance().IsKeyPressed(key);
+	const auto pressed = down && !m_keysHeld[key];
+	m_keysHeld[key] = down;
+
+	return pressed;
+}
+
 /***********************************************************************************/
 void SolEngine::shutdown() {
+	m_hotReloader.stop();
 	m_renderSystem.shutdown();
 	m_windowSystem.shutdown();
 }
\ No newline at end of file
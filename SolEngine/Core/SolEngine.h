@@ -2,6 +2,12 @@
 
 #include "WindowSystem.h"
 #include "RenderSystem.h"
+#include "ECS/World.h"
+#include "Scene/TransformHierarchy.h"
+#include "Assets/AssetCache.h"
+#include "Assets/HotReloader.h"
+
+#include <array>
 
 class SolEngine {
 	
@@ -16,6 +22,18 @@ public:
 	void shutdown();
 
 private:
+	// Applies Spin to local transforms, propagates them through the hierarchy and copies the results into Transform
+	void updateTransforms(const float delta);
+	// True on the frame the key goes down only, Input reports it for as long as it's held
+	bool keyPressed(const int key);
+
+	AssetCache m_assets;
+	World m_world;
+	TransformHierarchy m_hierarchy;
 	WindowSystem m_windowSystem;
 	RenderSystem m_renderSystem;
+	// Which keys were down last frame, see keyPressed
+	std::array<bool, 1024> m_keysHeld {};
+	// Last, so it stops before what it reloads into goes away
+	HotReloader m_hotReloader { m_assets, m_renderSystem };
 };
@@ -1,13 +1,90 @@
 #version 450
 #extension GL_ARB_separate_shader_objects : enable
 
-layout(location = 0) in vec3 fragColor;
+// Permutations (see ShaderVariant): TEXTURED is a #define, the rest are specialization constants
+layout(constant_id = 0) const bool LIT = false;
+layout(constant_id = 1) const float AMBIENT = 0.2;
+
+// Must match MaxLightsPerCluster in RenderSystem.cpp and light_cull.comp
+const uint MaxLightsPerCluster = 128;
+
+layout(location = 0) in vec3 fragNormal;
 layout(location = 1) in vec2 fragTexCoord;
+layout(location = 2) in vec3 fragViewPosition;
 
 layout(location = 0) out vec4 outColor;
 
-layout(binding = 1) uniform sampler2D texSampler;
+layout(binding = 0) uniform UniformBufferObject {
+    mat4 view;
+    mat4 proj;
+    mat4 previousViewProjection;
+    uvec4 clusterCount; // x, y, depth slices, w = light count
+    vec4 clusterScale; // Clusters per pixel (xy), slice = log(view depth) * z + w
+} ubo;
+
+#ifdef TEXTURED
+// Every uploaded texture, objects pick theirs with ObjectData::textureIndex.
+// Must match MaxTextures in RenderSystem.cpp
+const uint MaxTextures = 64;
+
+layout(location = 3) flat in uint fragTextureIndex;
+
+layout(binding = 1) uniform sampler2D textures[MaxTextures];
+#endif
+
+// See LightData in Vertex.h
+struct LightData {
+    vec4 positionRadius; // View space
+    vec4 color;
+};
+
+// Point lights, binned into clusters by light_cull.comp
+layout(std430, binding = 3) readonly buffer LightBuffer {
+    LightData lights[];
+};
+
+layout(std430, binding = 4) readonly buffer ClusterLightCountBuffer {
+    uint clusterLightCounts[];
+};
+
+layout(std430, binding = 5) readonly buffer ClusterLightIndexBuffer {
+    uint clusterLightIndices[];
+};
+
+// Diffuse light from the point lights of the fragment's cluster, with a windowed falloff that
+// reaches zero at the light's radius
+vec3 pointLighting(const vec3 normal) {
+    const uvec3 id = uvec3(min(uvec2(gl_FragCoord.xy * ubo.clusterScale.xy), ubo.clusterCount.xy - 1),
+                           uint(clamp(log(-fragViewPosition.z) * ubo.clusterScale.z + ubo.clusterScale.w, 0.0, float(ubo.clusterCount.z - 1))));
+    const uint cluster = id.x + (id.y + id.z * ubo.clusterCount.y) * ubo.clusterCount.x;
+
+    vec3 result = vec3(0.0);
+    // light_cull.comp counts past the cap, only the first MaxLightsPerCluster are listed
+    const uint count = min(clusterLightCounts[cluster], MaxLightsPerCluster);
+    for (uint i = 0; i < count; ++i) {
+        const LightData light = lights[clusterLightIndices[cluster * MaxLightsPerCluster + i]];
+
+        const vec3 toLight = light.positionRadius.xyz - fragViewPosition;
+        const float distanceSquared = dot(toLight, toLight);
+        const float window = clamp(1.0 - distanceSquared / (light.positionRadius.w * light.positionRadius.w), 0.0, 1.0);
+
+        result += light.color.rgb * (window * window * max(dot(normal, toLight * inversesqrt(max(distanceSquared, 1e-8))), 0.0));
+    }
+    return result;
+}
 
 void main() {
-    outColor = texture(texSampler, fragTexCoord);
-}
\ No newline at end of file
+#ifdef TEXTURED
+    vec4 color = texture(textures[fragTextureIndex], fragTexCoord);
+#else
+    vec4 color = vec4(1.0);
+#endif
+
+    if (LIT) {
+        const vec3 normal = normalize(fragNormal);
+        const vec3 lightDirection = normalize(vec3(0.3, 0.5, 1.0));
+        color.rgb *= AMBIENT + (1.0 - AMBIENT) * max(dot(normal, lightDirection), 0.0) + pointLighting(normalize(mat3(ubo.view) * normal));
+    }
+
+    outColor = color;
+}
@@ -1,25 +1,89 @@
 #version 450
 #extension GL_ARB_separate_shader_objects : enable
 
+// Compact vertices by default (PackedVertex in Vertex.h): AABB-normalized position,
+// octahedral normal. Build with -DFULL_PRECISION_VERTICES for the float Vertex layout.
+// -DDEPTH_ONLY only reads and transforms positions, for the depth pre-pass.
 layout(location = 0) in vec3 inPosition;
-layout(location = 1) in vec3 inColor;
+#ifndef DEPTH_ONLY
+#ifdef FULL_PRECISION_VERTICES
+layout(location = 1) in vec3 inNormal;
+#else
+layout(location = 1) in vec2 inNormal;
+#endif
 layout(location = 2) in vec2 inTexCoord;
+#endif
 
 layout(binding = 0) uniform UniformBufferObject {
-    mat4 model;
     mat4 view;
     mat4 proj;
 } ubo;
 
-layout(location = 0) out vec3 fragColor;
+// Per-object data (see ObjectData in Vertex.h), indexed by objectIndex + the draw's firstInstance
+struct ObjectData {
+    mat4 model;
+    vec4 boundingSphere;
+    vec4 positionScale;
+    vec4 positionOffset;
+    uvec4 lodFirstIndex;
+    uvec4 lodIndexCount;
+    vec4 lodError;
+    uint lodCount;
+    int vertexOffset;
+    uint meshletOffset;
+    uint meshletCount;
+    uint textureIndex;
+};
+
+layout(std430, binding = 2) readonly buffer ObjectBuffer {
+    ObjectData objects[];
+};
+
+// See DrawPushConstants in Vertex.h. Direct draws push their object, indirect ones push 0 and
+// carry it in firstInstance, which a push constant can't vary across.
+layout(push_constant) uniform DrawPushConstants {
+    uint objectIndex;
+} pc;
+
+#ifndef DEPTH_ONLY
+layout(location = 0) out vec3 fragNormal;
 layout(location = 1) out vec2 fragTexCoord;
+layout(location = 2) out vec3 fragViewPosition; // For the clustered lights in basic.frag
+layout(location = 3) flat out uint fragTextureIndex;
+#endif
 
+// The forward pass tests against the pre-pass's depth with EQUAL, both variants have to compute
+// bit-identical positions
 out gl_PerVertex {
-    vec4 gl_Position;
+    invariant vec4 gl_Position;
 };
 
+vec3 octDecode(const vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0) {
+        n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    }
+    return normalize(n);
+}
+
 void main() {
-    gl_Position = ubo.proj * ubo.view * ubo.model * vec4(inPosition, 1.0);
-    fragColor = inColor;
+    const ObjectData object = objects[pc.objectIndex + gl_InstanceIndex];
+
+    const vec3 position = inPosition * object.positionScale.xyz + object.positionOffset.xyz;
+
+    const vec4 worldPosition = object.model * vec4(position, 1.0);
+    gl_Position = ubo.proj * ubo.view * worldPosition;
+
+#ifndef DEPTH_ONLY
+#ifdef FULL_PRECISION_VERTICES
+    const vec3 normal = inNormal;
+#else
+    const vec3 normal = octDecode(inNormal);
+#endif
+
+    fragNormal = mat3(object.model) * normal;
     fragTexCoord = inTexCoord;
+    fragViewPosition = (ubo.view * worldPosition).xyz;
+    fragTextureIndex = object.textureIndex;
+#endif
 }
\ No newline at end of file
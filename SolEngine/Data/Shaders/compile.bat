@@ -1,6 +1,16 @@
 REM https://vulkan.lunarg.com/doc/view/1.0.61.1/windows/spirv_toolchain.html
 
+REM Precompiled fallbacks for every ShaderVariant #define combination (see ShaderVariant::precompiledVertex/precompiledFragment)
 C:/VulkanSDK/1.0.65.0/Bin/glslangValidator.exe -V basic.vert
-C:/VulkanSDK/1.0.65.0/Bin/glslangValidator.exe -V basic.frag
+C:/VulkanSDK/1.0.65.0/Bin/glslangValidator.exe -V -DFULL_PRECISION_VERTICES basic.vert -o vert_full_precision.spv
+C:/VulkanSDK/1.0.65.0/Bin/glslangValidator.exe -V -DTEXTURED basic.frag
+C:/VulkanSDK/1.0.65.0/Bin/glslangValidator.exe -V basic.frag -o frag_untextured.spv
+REM Depth pre-pass, positions only for either vertex layout
+C:/VulkanSDK/1.0.65.0/Bin/glslangValidator.exe -V -DDEPTH_ONLY basic.vert -o vert_depth.spv
+C:/VulkanSDK/1.0.65.0/Bin/glslangValidator.exe -V cull.comp -o cull.spv
+C:/VulkanSDK/1.0.65.0/Bin/glslangValidator.exe -V cluster_cull.comp -o cluster_cull.spv
+C:/VulkanSDK/1.0.65.0/Bin/glslangValidator.exe -V hiz_build.comp -o hiz_build.spv
+C:/VulkanSDK/1.0.65.0/Bin/glslangValidator.exe -V -DMULTISAMPLED hiz_build.comp -o hiz_build_ms.spv
+C:/VulkanSDK/1.0.65.0/Bin/glslangValidator.exe -V light_cull.comp -o light_cull.spv
 
 pause
\ No newline at end of file
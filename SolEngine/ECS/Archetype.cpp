@@ -0,0 +1,98 @@
+#include "Archetype.h"
+
+#include "Logging/Log.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+namespace {
+	/***********************************************************************************/
+	constexpr std::size_t alignUp(const std::size_t value, const std::size_t alignment) noexcept {
+		return (value + alignment - 1) / alignment * alignment;
+	}
+}
+
+/***********************************************************************************/
+std::uint32_t detail::nextComponentId() noexcept {
+	static std::atomic<std::uint32_t> next { 0 };
+
+	const auto id = next++;
+	// Every archetype signature and column table is sized for MaxComponentTypes
+	if (id >= MaxComponentTypes) {
+		LOG_CRITICAL("Too many component types, raise MaxComponentTypes.");
+	}
+	return id;
+}
+
+/***********************************************************************************/
+Archetype::Archetype(const ComponentMask& mask, std::vector<ComponentInfo> components) : m_mask(mask), m_components(std::move(components)) {
+	std::size_t rowSize = sizeof(Entity);
+	for (std::size_t i = 0; i < m_components.size(); ++i) {
+		m_columns[m_components[i].id] = static_cast<std::uint8_t>(i);
+		rowSize += m_components[i].size;
+	}
+
+	// Start from the unpadded estimate and shrink until the aligned columns fit
+	m_offsets.resize(m_components.size());
+	for (auto capacity = ChunkSize / rowSize; capacity > 0; --capacity) {
+		auto offset = sizeof(Entity) * capacity;
+		for (std::size_t i = 0; i < m_components.size(); ++i) {
+			offset = alignUp(offset, std::max<std::size_t>(ColumnAlignment, m_components[i].alignment));
+			m_offsets[i] = offset;
+			offset += m_components[i].size * capacity;
+		}
+
+		if (offset <= ChunkSize) {
+			m_capacity = static_cast<std::uint32_t>(capacity);
+			break;
+		}
+	}
+
+	if (m_capacity == 0) {
+		LOG_CRITICAL("Components too large to fit a chunk.");
+	}
+}
+
+/***********************************************************************************/
+Archetype::Location Archetype::allocate(const Entity entity) {
+	if (m_chunks.empty() || m_chunks.back().count == m_capacity) {
+		Chunk chunk;
+		chunk.data.reset(static_cast<std::byte*>(::operator new(ChunkSize, std::align_val_t(ColumnAlignment))));
+		m_chunks.push_back(std::move(chunk));
+	}
+
+	auto& chunk = m_chunks.back();
+	const Location location { static_cast<std::uint32_t>(m_chunks.size() - 1), chunk.count++ };
+
+	entities(chunk)[location.row] = entity;
+	++m_size;
+
+	return location;
+}
+
+/***********************************************************************************/
+Entity Archetype::remove(const Location location) {
+	auto& chunk = m_chunks[location.chunk];
+	auto& last = m_chunks.back();
+	const auto lastRow = last.count - 1;
+
+	// Keep the rows dense: the last row fills the hole
+	Entity moved;
+	if (&chunk != &last || location.row != lastRow) {
+		for (std::size_t i = 0; i < m_components.size(); ++i) {
+			const auto size = m_components[i].size;
+			std::memcpy(chunk.data.get() + m_offsets[i] + location.row * size, last.data.get() + m_offsets[i] + lastRow * size, size);
+		}
+
+		moved = entities(last)[lastRow];
+		entities(chunk)[location.row] = moved;
+	}
+
+	if (--last.count == 0) {
+		m_chunks.pop_back();
+	}
+	--m_size;
+
+	return moved;
+}
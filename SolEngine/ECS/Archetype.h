@@ -0,0 +1,86 @@
+#pragma once
+
+#include "Entity.h"
+#include "ComponentType.h"
+
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <vector>
+
+// Storage for every entity with exactly the same set of components.
+// Entities live in fixed-size chunks, each chunk holding one tightly packed array per component
+// (SoA) plus the owning entities, so iterating a component touches nothing but that component.
+class Archetype {
+
+public:
+	static constexpr std::size_t ChunkSize = 16 * 1024;
+	// Every column starts on a cache line
+	static constexpr std::size_t ColumnAlignment = 64;
+
+	/***********************************************************************************/
+	struct ChunkDeleter {
+		void operator()(std::byte* data) const noexcept {
+			::operator delete(data, std::align_val_t(ColumnAlignment));
+		}
+	};
+	/***********************************************************************************/
+	struct Chunk {
+		std::unique_ptr<std::byte[], ChunkDeleter> data;
+		std::uint32_t count = 0;
+	};
+	/***********************************************************************************/
+	// Where an entity's components live
+	struct Location {
+		std::uint32_t chunk;
+		std::uint32_t row;
+	};
+	/***********************************************************************************/
+
+	// Components must be sorted by id
+	Archetype(const ComponentMask& mask, std::vector<ComponentInfo> components);
+
+	Archetype(const Archetype&) = delete;
+	Archetype& operator=(const Archetype&) = delete;
+
+	// Appends a row for the entity. Its components are left uninitialised.
+	Location allocate(const Entity entity);
+	// Fills the hole with the last row, returns the entity that moved into it (invalid if none did)
+	Entity remove(const Location location);
+
+	auto has(const std::uint32_t id) const noexcept { return m_mask.test(id); }
+
+	// Start of a component's array inside the chunk
+	std::byte* column(const Chunk& chunk, const std::uint32_t id) const noexcept {
+		return chunk.data.get() + m_offsets[m_columns[id]];
+	}
+	template<typename T>
+	T* column(const Chunk& chunk) const noexcept {
+		return reinterpret_cast<T*>(column(chunk, componentId<std::remove_const_t<T>>()));
+	}
+	Entity* entities(const Chunk& chunk) const noexcept {
+		return reinterpret_cast<Entity*>(chunk.data.get());
+	}
+
+	auto& mask() const noexcept { return m_mask; }
+	auto& components() const noexcept { return m_components; }
+	auto& chunks() noexcept { return m_chunks; }
+	auto& chunks() const noexcept { return m_chunks; }
+	// Rows per chunk
+	auto capacity() const noexcept { return m_capacity; }
+	auto size() const noexcept { return m_size; }
+
+private:
+	ComponentMask m_mask;
+	std::vector<ComponentInfo> m_components;
+	// Component id -> index into m_components/m_offsets
+	std::array<std::uint8_t, MaxComponentTypes> m_columns {};
+	// Byte offset of each column inside a chunk, the entity column sits at 0
+	std::vector<std::size_t> m_offsets;
+
+	std::uint32_t m_capacity = 0;
+	std::size_t m_size = 0;
+
+	std::vector<Chunk> m_chunks;
+};
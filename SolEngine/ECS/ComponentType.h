@@ -0,0 +1,49 @@
+#pragma once
+
+#include <bitset>
+#include <cstdint>
+#include <type_traits>
+
+// Upper bound on distinct component types, sizes the archetype signature
+constexpr std::size_t MaxComponentTypes = 64;
+
+// Set of component types an archetype stores, one bit per component id
+using ComponentMask = std::bitset<MaxComponentTypes>;
+
+// What an archetype needs to know to lay out a component type in its chunks
+struct ComponentInfo {
+	std::uint32_t id;
+	std::uint32_t size;
+	std::uint32_t alignment;
+};
+
+namespace detail {
+	// Hands out ids in registration order, aborts past MaxComponentTypes (defined in Archetype.cpp)
+	std::uint32_t nextComponentId() noexcept;
+}
+
+/***********************************************************************************/
+// Dense id of a component type, assigned on first use
+template<typename T>
+std::uint32_t componentId() noexcept {
+	static_assert(std::is_trivially_copyable_v<T>, "Components are moved between chunks with memcpy.");
+	static_assert(std::is_same_v<T, std::remove_cv_t<T>>, "Use the unqualified component type.");
+
+	static const auto id = detail::nextComponentId();
+	return id;
+}
+
+/***********************************************************************************/
+template<typename T>
+ComponentInfo componentInfo() noexcept {
+	return { componentId<T>(), static_cast<std::uint32_t>(sizeof(T)), static_cast<std::uint32_t>(alignof(T)) };
+}
+
+/***********************************************************************************/
+// Queries may ask for const T, it maps to the same component
+template<typename... Ts>
+ComponentMask componentMask() {
+	ComponentMask mask;
+	(mask.set(componentId<std::remove_const_t<Ts>>()), ...);
+	return mask;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "Graphics/Bounds.h"
+#include "Scene/TransformHierarchy.h"
+
+#include <cstdint>
+
+// Components shared by the engine's systems. Keep them small and trivially copyable.
+
+// Object-to-world matrix. Copied from the TransformHierarchy for entities with a SceneNode.
+struct Transform {
+	glm::mat4 matrix { 1.0f };
+};
+
+// The entity's node in the TransformHierarchy, which owns its local transform and parent
+struct SceneNode {
+	TransformHierarchy::Handle node = TransformHierarchy::InvalidHandle;
+};
+
+// Draws a mesh from the RenderSystem's mesh table (the order meshes were passed to addMeshes).
+// drawIndex is owned by the RenderSystem: the entity's slot in the object buffer, reassigned
+// whenever the draw list is rebuilt.
+struct MeshInstance {
+	static constexpr std::uint32_t InvalidDrawIndex = ~0u;
+
+	std::uint32_t meshIndex = 0;
+	std::uint32_t drawIndex = InvalidDrawIndex;
+};
+
+// World-space bounding sphere of a MeshInstance, refreshed by the RenderSystem every frame
+struct WorldBounds {
+	BoundingSphere sphere;
+};
+
+// Rotates the SceneNode's local transform about a local axis every frame
+struct Spin {
+	glm::vec3 axis { 0.0f, 0.0f, 1.0f };
+	float radiansPerSecond = 0.0f;
+};
+
+// Point light at the Transform's origin, shaded through the clustered light lists (see light_cull.comp)
+struct PointLight {
+	glm::vec3 color { 1.0f };
+	float intensity = 1.0f;
+	float radius = 1.0f; // Falls off to nothing here
+};
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstdint>
+
+// Handle to an entity in a World. The generation is bumped whenever an index is recycled,
+// so handles to destroyed entities stop resolving instead of aliasing the new occupant.
+struct Entity {
+	static constexpr std::uint32_t InvalidIndex = ~0u;
+
+	std::uint32_t index = InvalidIndex;
+	std::uint32_t generation = 0;
+
+	auto isValid() const noexcept { return index != InvalidIndex; }
+
+	auto operator==(const Entity& other) const noexcept { return index == other.index && generation == other.generation; }
+	auto operator!=(const Entity& other) const noexcept { return !(*this == other); }
+};
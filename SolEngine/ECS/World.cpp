@@ -0,0 +1,114 @@
+#include "World.h"
+
+#include <cstring>
+
+/***********************************************************************************/
+void World::destroy(const Entity entity) {
+	if (!isAlive(entity)) {
+		return;
+	}
+
+	auto& record = m_records[entity.index];
+	removeRow(record);
+
+	record.archetype = nullptr;
+	++record.generation;
+	m_freeIndices.push_back(entity.index);
+
+	++m_version;
+}
+
+/***********************************************************************************/
+bool World::isAlive(const Entity entity) const noexcept {
+	return findRecord(entity) != nullptr;
+}
+
+/***********************************************************************************/
+Archetype& World::findOrCreateArchetype(std::vector<ComponentInfo> components) {
+	std::sort(components.begin(), components.end(), [](const ComponentInfo& a, const ComponentInfo& b) {
+		return a.id < b.id;
+	});
+
+	ComponentMask mask;
+	for (const auto& component : components) {
+		mask.set(component.id);
+	}
+
+	auto& archetype = m_archetypes[mask];
+	if (!archetype) {
+		archetype = std::make_unique<Archetype>(mask, std::move(components));
+		m_archetypeList.push_back(archetype.get());
+	}
+
+	return *archetype;
+}
+
+/***********************************************************************************/
+Entity World::allocateEntity(Archetype& archetype) {
+	Entity entity;
+	if (m_freeIndices.empty()) {
+		entity.index = static_cast<std::uint32_t>(m_records.size());
+		m_records.emplace_back();
+	}
+	else {
+		entity.index = m_freeIndices.back();
+		m_freeIndices.pop_back();
+	}
+
+	auto& record = m_records[entity.index];
+	entity.generation = record.generation;
+
+	record.archetype = &archetype;
+	record.location = archetype.allocate(entity);
+
+	++m_version;
+
+	return entity;
+}
+
+/***********************************************************************************/
+void World::moveEntity(EntityRecord& record, Archetype& target) {
+	auto& source = *record.archetype;
+	const auto& sourceChunk = source.chunks()[record.location.chunk];
+	const auto entity = source.entities(sourceChunk)[record.location.row];
+
+	const auto location = target.allocate(entity);
+	const auto& targetChunk = target.chunks()[location.chunk];
+
+	for (const auto& component : target.components()) {
+		if (source.has(component.id)) {
+			std::memcpy(target.column(targetChunk, component.id) + location.row * component.size, 
+				source.column(sourceChunk, component.id) + record.location.row * component.size, 
+				component.size);
+		}
+	}
+
+	removeRow(record);
+
+	record.archetype = &target;
+	record.location = location;
+
+	++m_version;
+}
+
+/***********************************************************************************/
+void World::removeRow(const EntityRecord& record) {
+	const auto moved = record.archetype->remove(record.location);
+	if (moved.isValid()) {
+		m_records[moved.index].location = record.location;
+	}
+}
+
+/***********************************************************************************/
+const World::EntityRecord* World::findRecord(const Entity entity) const noexcept {
+	if (entity.index >= m_records.size()) {
+		return nullptr;
+	}
+
+	const auto& record = m_records[entity.index];
+	if (record.archetype == nullptr || record.generation != entity.generation) {
+		return nullptr;
+	}
+
+	return &record;
+}
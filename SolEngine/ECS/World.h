@@ -0,0 +1,223 @@
+#pragma once
+
+#include "Archetype.h"
+
+#include <algorithm>
+#include <unordered_map>
+
+// Owns every entity and its components, grouped into archetypes by component set.
+// Queries walk whole chunks so systems get plain arrays to loop over instead of chasing pointers.
+// Adding/removing components moves the entity to another archetype, so keep that out of hot loops.
+class World {
+
+public:
+	World() = default;
+
+	World(const World&) = delete;
+	World& operator=(const World&) = delete;
+
+	template<typename... Ts>
+	Entity create(const Ts&... components);
+	void destroy(const Entity entity);
+	bool isAlive(const Entity entity) const noexcept;
+
+	// Overwrites the component if the entity already has one
+	template<typename T>
+	void add(const Entity entity, const T& component);
+	template<typename T>
+	void remove(const Entity entity);
+	template<typename T>
+	bool has(const Entity entity) const noexcept;
+	// nullptr if the entity is dead or lacks the component. Invalidated by structural changes.
+	template<typename T>
+	T* get(const Entity entity) const noexcept;
+
+	// Calls func(count, entities, Ts*...) once per chunk that has all of Ts.
+	template<typename... Ts, typename Func>
+	void forEachChunk(Func&& func) const;
+	// Same as forEachChunk, with the chunks spread over OpenMP threads. func must only write to the
+	// chunk it was given (or to per-entity slots nobody else touches).
+	template<typename... Ts, typename Func>
+	void parallelForEachChunk(Func&& func) const;
+	// Calls func(entity, Ts&...) for every entity that has all of Ts.
+	template<typename... Ts, typename Func>
+	void forEach(Func&& func) const;
+	// Entities that have all of Ts
+	template<typename... Ts>
+	std::size_t count() const;
+
+	// Bumped by every create/destroy/add/remove, so caches built from queries know when to rebuild
+	auto version() const noexcept { return m_version; }
+	auto size() const noexcept { return m_records.size() - m_freeIndices.size(); }
+
+private:
+	/***********************************************************************************/
+	struct EntityRecord {
+		Archetype* archetype = nullptr;
+		Archetype::Location location {};
+		std::uint32_t generation = 0;
+	};
+	/***********************************************************************************/
+
+	Archetype& findOrCreateArchetype(std::vector<ComponentInfo> components);
+	// Grabs a free index (or a new one) and places it in the archetype
+	Entity allocateEntity(Archetype& archetype);
+	// Moves the entity to the target archetype, carrying over the components both have
+	void moveEntity(EntityRecord& record, Archetype& target);
+	// Removes the record's row and patches the record of the entity that moved into it
+	void removeRow(const EntityRecord& record);
+	const EntityRecord* findRecord(const Entity entity) const noexcept;
+
+	// Starts the component's lifetime in chunk memory
+	template<typename T>
+	static void construct(T* at, const T& component) {
+		new (at) T(component);
+	}
+
+	std::vector<EntityRecord> m_records;
+	std::vector<std::uint32_t> m_freeIndices;
+
+	std::unordered_map<ComponentMask, std::unique_ptr<Archetype>> m_archetypes;
+	// Creation order, so iteration order doesn't depend on hashing
+	std::vector<Archetype*> m_archetypeList;
+
+	std::uint64_t m_version = 0;
+};
+
+/***********************************************************************************/
+template<typename... Ts>
+Entity World::create(const Ts&... components) {
+	auto& archetype = findOrCreateArchetype({ componentInfo<Ts>()... });
+	const auto entity = allocateEntity(archetype);
+	const auto& location = m_records[entity.index].location;
+	const auto& chunk = archetype.chunks()[location.chunk];
+
+	(construct(archetype.template column<Ts>(chunk) + location.row, components), ...);
+
+	return entity;
+}
+
+/***********************************************************************************/
+template<typename T>
+void World::add(const Entity entity, const T& component) {
+	if (auto* existing = get<T>(entity)) {
+		*existing = component;
+		return;
+	}
+	if (!isAlive(entity)) {
+		return;
+	}
+
+	auto& record = m_records[entity.index];
+	auto components = record.archetype->components();
+	components.push_back(componentInfo<T>());
+
+	moveEntity(record, findOrCreateArchetype(std::move(components)));
+
+	const auto& chunk = record.archetype->chunks()[record.location.chunk];
+	construct(record.archetype->template column<T>(chunk) + record.location.row, component);
+}
+
+/***********************************************************************************/
+template<typename T>
+void World::remove(const Entity entity) {
+	if (!has<T>(entity)) {
+		return;
+	}
+
+	auto& record = m_records[entity.index];
+	auto components = record.archetype->components();
+	components.erase(std::remove_if(components.begin(), components.end(), [](const ComponentInfo& info) {
+		return info.id == componentId<T>();
+	}), components.end());
+
+	moveEntity(record, findOrCreateArchetype(std::move(components)));
+}
+
+/***********************************************************************************/
+template<typename T>
+bool World::has(const Entity entity) const noexcept {
+	const auto* record = findRecord(entity);
+	return record && record->archetype->has(componentId<T>());
+}
+
+/***********************************************************************************/
+template<typename T>
+T* World::get(const Entity entity) const noexcept {
+	const auto* record = findRecord(entity);
+	if (!record || !record->archetype->has(componentId<std::remove_const_t<T>>())) {
+		return nullptr;
+	}
+
+	const auto& chunk = record->archetype->chunks()[record->location.chunk];
+	return record->archetype->template column<T>(chunk) + record->location.row;
+}
+
+/***********************************************************************************/
+template<typename... Ts, typename Func>
+void World::forEachChunk(Func&& func) const {
+	const auto mask = componentMask<Ts...>();
+
+	for (const auto* archetype : m_archetypeList) {
+		if ((archetype->mask() & mask) != mask) {
+			continue;
+		}
+
+		for (const auto& chunk : archetype->chunks()) {
+			func(static_cast<std::size_t>(chunk.count), static_cast<const Entity*>(archetype->entities(chunk)), archetype->template column<Ts>(chunk)...);
+		}
+	}
+}
+
+/***********************************************************************************/
+template<typename... Ts, typename Func>
+void World::parallelForEachChunk(Func&& func) const {
+	const auto mask = componentMask<Ts...>();
+
+	// Flatten the matching chunks so the threads split them evenly regardless of archetype
+	std::vector<std::pair<const Archetype*, const Archetype::Chunk*>> chunks;
+	for (const auto* archetype : m_archetypeList) {
+		if ((archetype->mask() & mask) != mask) {
+			continue;
+		}
+
+		for (const auto& chunk : archetype->chunks()) {
+			chunks.emplace_back(archetype, &chunk);
+		}
+	}
+
+	const auto chunkCount = static_cast<int>(chunks.size());
+
+#pragma omp parallel for schedule(static)
+	for (int i = 0; i < chunkCount; ++i) {
+		const auto* archetype = chunks[i].first;
+		const auto& chunk = *chunks[i].second;
+
+		func(static_cast<std::size_t>(chunk.count), static_cast<const Entity*>(archetype->entities(chunk)), archetype->template column<Ts>(chunk)...);
+	}
+}
+
+/***********************************************************************************/
+template<typename... Ts, typename Func>
+void World::forEach(Func&& func) const {
+	forEachChunk<Ts...>([&func](const std::size_t count, const Entity* entities, Ts*... columns) {
+		for (std::size_t i = 0; i < count; ++i) {
+			func(entities[i], columns[i]...);
+		}
+	});
+}
+
+/***********************************************************************************/
+template<typename... Ts>
+std::size_t World::count() const {
+	const auto mask = componentMask<Ts...>();
+
+	std::size_t total = 0;
+	for (const auto* archetype : m_archetypeList) {
+		if ((archetype->mask() & mask) == mask) {
+			total += archetype->size();
+		}
+	}
+
+	return total;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/mat4x4.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// Axis-aligned bounding box
+struct AABB {
+	glm::vec3 min { std::numeric_limits<float>::max() };
+	glm::vec3 max { std::numeric_limits<float>::lowest() };
+
+	void expand(const glm::vec3& point) noexcept {
+		min = glm::min(min, point);
+		max = glm::max(max, point);
+	}
+
+	auto center() const noexcept { return (min + max) * 0.5f; }
+	auto extents() const noexcept { return (max - min) * 0.5f; }
+};
+
+// Bounding sphere
+struct BoundingSphere {
+	glm::vec3 center { 0.0f };
+	float radius = 0.0f;
+
+	// Moves the sphere into the space of the given matrix. The radius is scaled by the
+	// largest axis scale so the result stays conservative under non-uniform scaling.
+	auto transformed(const glm::mat4& m) const noexcept {
+		const auto scaleX = glm::dot(glm::vec3(m[0]), glm::vec3(m[0]));
+		const auto scaleY = glm::dot(glm::vec3(m[1]), glm::vec3(m[1]));
+		const auto scaleZ = glm::dot(glm::vec3(m[2]), glm::vec3(m[2]));
+
+		BoundingSphere result;
+		result.center = glm::vec3(m * glm::vec4(center, 1.0f));
+		result.radius = radius * std::sqrt(std::max(scaleX, std::max(scaleY, scaleZ)));
+
+		return result;
+	}
+};
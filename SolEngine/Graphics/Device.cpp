@@ -48,14 +48,21 @@ void Device::init(const VkInstance& vkInstance, const VkSurfaceKHR& surface, VkQ
 	}
 
 	// Enable hardware features
+	VkPhysicalDeviceFeatures supportedFeatures;
+	vkGetPhysicalDeviceFeatures(m_physicalDevice, &supportedFeatures);
+
 	VkPhysicalDeviceFeatures deviceFeatures{};
 	deviceFeatures.samplerAnisotropy = VK_TRUE;
+	deviceFeatures.drawIndirectFirstInstance = VK_TRUE; // GPU culling writes the object index into firstInstance
+	deviceFeatures.multiDrawIndirect = supportedFeatures.multiDrawIndirect; // Optional, lets all objects go out in one indirect draw
+	deviceFeatures.shaderSampledImageArrayDynamicIndexing = VK_TRUE; // basic.frag picks each object's texture out of an array
 
 	VkDeviceCreateInfo createInfo{};
 	createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
 	createInfo.queueCreateInfoCount = static_cast<std::uint32_t>(queueCreateInfos.size());
 	createInfo.pQueueCreateInfos = queueCreateInfos.data();
 	createInfo.pEnabledFeatures = &deviceFeatures;
+	m_enabledFeatures = deviceFeatures;
 	createInfo.enabledExtensionCount = static_cast<std::uint32_t>(m_deviceExtensions.size());
 	createInfo.ppEnabledExtensionNames = m_deviceExtensions.data();
 #ifdef _DEBUG
@@ -99,7 +106,9 @@ bool Device::isDeviceSuitable(const VkPhysicalDevice device, const VkSurfaceKHR
 	VkPhysicalDeviceFeatures supportedFeatures;
 	vkGetPhysicalDeviceFeatures(device, &supportedFeatures);
 
-	return indices.isComplete() && extensionsSupported && swapChainAdequate && supportedFeatures.samplerAnisotropy;
+	return indices.isComplete() && extensionsSupported && swapChainAdequate && 
+		supportedFeatures.samplerAnisotropy && 
+		supportedFeatures.drawIndirectFirstInstance;
 }
 
 /***********************************************************************************/
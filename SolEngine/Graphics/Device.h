@@ -19,10 +19,12 @@ public:
 	auto checkSwapChainSupport(const VkSurfaceKHR& surface) const { return querySwapChainSupport(m_physicalDevice, surface); }
 	auto getPhysicalDevice() const noexcept { return m_physicalDevice; }
 	auto getDevice() const noexcept { return m_device; }
+	auto& getEnabledFeatures() const noexcept { return m_enabledFeatures; }
 
 private:
 	VkPhysicalDevice m_physicalDevice;
 	VkDevice m_device;
+	VkPhysicalDeviceFeatures m_enabledFeatures;
 
 	const std::vector<const char*> m_deviceExtensions{
 		VK_KHR_SWAPCHAIN_EXTENSION_NAME
@@ -0,0 +1,89 @@
+#include "FreeListAllocator.h"
+
+/***********************************************************************************/
+FreeListAllocator::FreeListAllocator(const std::uint64_t capacity) {
+	reset(capacity);
+}
+
+/***********************************************************************************/
+void FreeListAllocator::reset(const std::uint64_t capacity) {
+	m_capacity = capacity;
+	m_used = 0;
+	m_freeRanges.clear();
+	m_allocations.clear();
+
+	if (capacity > 0) {
+		m_freeRanges.emplace(0, capacity);
+	}
+}
+
+/***********************************************************************************/
+std::uint64_t FreeListAllocator::allocate(const std::uint64_t size, const std::uint64_t alignment) {
+	if (size == 0) {
+		return InvalidOffset;
+	}
+
+	for (auto it = m_freeRanges.begin(); it != m_freeRanges.end(); ++it) {
+		const auto rangeOffset = it->first;
+		const auto rangeSize = it->second;
+
+		const auto alignedOffset = (rangeOffset + alignment - 1) / alignment * alignment;
+		const auto padding = alignedOffset - rangeOffset;
+
+		if (padding + size > rangeSize) {
+			continue;
+		}
+
+		m_freeRanges.erase(it);
+
+		// Give back whatever is left on either side of the allocation
+		if (padding > 0) {
+			m_freeRanges.emplace(rangeOffset, padding);
+		}
+		const auto remaining = rangeSize - padding - size;
+		if (remaining > 0) {
+			m_freeRanges.emplace(alignedOffset + size, remaining);
+		}
+
+		m_allocations.emplace(alignedOffset, size);
+		m_used += size;
+
+		return alignedOffset;
+	}
+
+	return InvalidOffset;
+}
+
+/***********************************************************************************/
+void FreeListAllocator::free(const std::uint64_t offset) {
+	const auto it = m_allocations.find(offset);
+	if (it == m_allocations.end()) {
+		return;
+	}
+
+	m_used -= it->second;
+	insertFreeRange(offset, it->second);
+	m_allocations.erase(it);
+}
+
+/***********************************************************************************/
+void FreeListAllocator::insertFreeRange(std::uint64_t offset, std::uint64_t size) {
+	// Merge with the following range
+	const auto next = m_freeRanges.find(offset + size);
+	if (next != m_freeRanges.end()) {
+		size += next->second;
+		m_freeRanges.erase(next);
+	}
+
+	// Merge with the preceding range
+	auto prev = m_freeRanges.lower_bound(offset);
+	if (prev != m_freeRanges.begin()) {
+		--prev;
+		if (prev->first + prev->second == offset) {
+			prev->second += size;
+			return;
+		}
+	}
+
+	m_freeRanges.emplace(offset, size);
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <unordered_map>
+
+// Hands out ranges of one large buffer (offsets only, no Vulkan objects).
+// First-fit over an offset-sorted free list; neighbouring free ranges are merged
+// when a range is returned so the pool doesn't fragment over time.
+class FreeListAllocator {
+
+public:
+	static constexpr std::uint64_t InvalidOffset = ~0ull;
+
+	explicit FreeListAllocator(const std::uint64_t capacity = 0);
+
+	void reset(const std::uint64_t capacity);
+
+	// Returns InvalidOffset when no free range is large enough.
+	std::uint64_t allocate(const std::uint64_t size, const std::uint64_t alignment = 1);
+	void free(const std::uint64_t offset);
+
+	auto capacity() const noexcept { return m_capacity; }
+	auto used() const noexcept { return m_used; }
+
+private:
+	void insertFreeRange(std::uint64_t offset, std::uint64_t size);
+
+	std::uint64_t m_capacity = 0;
+	std::uint64_t m_used = 0;
+
+	std::map<std::uint64_t, std::uint64_t> m_freeRanges; // offset -> size
+	std::unordered_map<std::uint64_t, std::uint64_t> m_allocations; // offset -> size
+};
@@ -0,0 +1,34 @@
+#include "Frustum.h"
+
+#include <glm/geometric.hpp>
+
+/***********************************************************************************/
+Frustum::Frustum(const glm::mat4& viewProjection) {
+	// glm is column-major, so grab the rows of the matrix first
+	const glm::vec4 row0 { viewProjection[0][0], viewProjection[1][0], viewProjection[2][0], viewProjection[3][0] };
+	const glm::vec4 row1 { viewProjection[0][1], viewProjection[1][1], viewProjection[2][1], viewProjection[3][1] };
+	const glm::vec4 row2 { viewProjection[0][2], viewProjection[1][2], viewProjection[2][2], viewProjection[3][2] };
+	const glm::vec4 row3 { viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3] };
+
+	planes[Left] = row3 + row0;
+	planes[Right] = row3 - row0;
+	planes[Bottom] = row3 + row1;
+	planes[Top] = row3 - row1;
+	planes[Near] = row2; // z >= 0 in Vulkan clip space
+	planes[Far] = row3 - row2;
+
+	for (auto& plane : planes) {
+		plane /= glm::length(glm::vec3(plane));
+	}
+}
+
+/***********************************************************************************/
+bool Frustum::intersects(const BoundingSphere& sphere) const noexcept {
+	for (const auto& plane : planes) {
+		if (glm::dot(glm::vec3(plane), sphere.center) + plane.w < -sphere.radius) {
+			return false;
+		}
+	}
+
+	return true;
+}
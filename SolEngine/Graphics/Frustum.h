@@ -0,0 +1,24 @@
+#pragma once
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/mat4x4.hpp>
+
+#include "Bounds.h"
+
+#include <array>
+
+// View frustum described by six normalized planes (xyz = normal, w = distance).
+// A point p is inside a plane when dot(plane.xyz, p) + plane.w >= 0.
+struct Frustum {
+	// Extracts the planes from a combined projection * view matrix (Gribb/Hartmann),
+	// assuming Vulkan's [0, 1] clip space depth range.
+	explicit Frustum(const glm::mat4& viewProjection);
+
+	enum Plane { Left = 0, Right, Bottom, Top, Near, Far };
+
+	// Scalar test for one sphere, FrustumCuller handles batches.
+	bool intersects(const BoundingSphere& sphere) const noexcept;
+
+	std::array<glm::vec4, 6> planes;
+};
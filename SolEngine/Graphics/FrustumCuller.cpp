@@ -0,0 +1,65 @@
+#include "FrustumCuller.h"
+
+#include "Math/BatchMath.h"
+
+#include <limits>
+
+namespace {
+	// Padding lanes get a radius no plane test can pass
+	constexpr auto PaddingRadius = std::numeric_limits<float>::lowest();
+}
+
+/***********************************************************************************/
+void FrustumCuller::clear() noexcept {
+	m_count = 0;
+	m_centerX.clear();
+	m_centerY.clear();
+	m_centerZ.clear();
+	m_radius.clear();
+}
+
+/***********************************************************************************/
+void FrustumCuller::reserve(const std::size_t count) {
+	const auto padded = (count + BatchWidth - 1) / BatchWidth * BatchWidth;
+
+	m_centerX.reserve(padded);
+	m_centerY.reserve(padded);
+	m_centerZ.reserve(padded);
+	m_radius.reserve(padded);
+}
+
+/***********************************************************************************/
+std::uint32_t FrustumCuller::add(const BoundingSphere& worldSphere) {
+	const auto index = static_cast<std::uint32_t>(m_count++);
+
+	// Grow a whole batch at a time, the new lanes start out as padding
+	if (m_count > m_radius.size()) {
+		const auto padded = m_radius.size() + BatchWidth;
+		m_centerX.resize(padded, 0.0f);
+		m_centerY.resize(padded, 0.0f);
+		m_centerZ.resize(padded, 0.0f);
+		m_radius.resize(padded, PaddingRadius);
+	}
+
+	set(index, worldSphere);
+
+	return index;
+}
+
+/***********************************************************************************/
+void FrustumCuller::set(const std::uint32_t index, const BoundingSphere& worldSphere) noexcept {
+	m_centerX[index] = worldSphere.center.x;
+	m_centerY[index] = worldSphere.center.y;
+	m_centerZ[index] = worldSphere.center.z;
+	m_radius[index] = worldSphere.radius;
+}
+
+/***********************************************************************************/
+void FrustumCuller::cull(const Frustum& frustum, std::vector<std::uint32_t>& visible) const {
+	visible.clear();
+	visible.reserve(m_count);
+
+	BatchMath::cullSpheres(frustum.planes.data(), frustum.planes.size(), 
+		m_centerX.data(), m_centerY.data(), m_centerZ.data(), m_radius.data(), m_count, 
+		visible);
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "Bounds.h"
+#include "Frustum.h"
+#include "Math/BatchMath.h"
+
+#include <cstdint>
+#include <vector>
+
+// Tests batches of world-space bounding spheres against a view frustum.
+// Spheres are kept in SoA form (separate x/y/z/radius streams) so BatchMath::cullSpheres can
+// test 4 (SSE) or 8 (AVX) objects per plane with a single instruction sequence.
+class FrustumCuller {
+
+public:
+	FrustumCuller() = default;
+
+	void clear() noexcept;
+	void reserve(const std::size_t count);
+
+	// Returns the index the object will be reported with in the visible list
+	std::uint32_t add(const BoundingSphere& worldSphere);
+	void set(const std::uint32_t index, const BoundingSphere& worldSphere) noexcept;
+
+	auto size() const noexcept { return m_count; }
+	auto sphere(const std::uint32_t index) const noexcept { return BoundingSphere{ { m_centerX[index], m_centerY[index], m_centerZ[index] }, m_radius[index] }; }
+
+	// Writes the indices of all objects intersecting the frustum into visible (cleared first).
+	void cull(const Frustum& frustum, std::vector<std::uint32_t>& visible) const;
+
+private:
+	// Number of lanes every stream is padded to so the widest kernel never reads past the end
+	static constexpr std::size_t BatchWidth = BatchMath::SpherePadding;
+
+	std::size_t m_count = 0;
+
+	std::vector<float> m_centerX, m_centerY, m_centerZ, m_radius;
+};
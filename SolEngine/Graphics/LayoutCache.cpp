@@ -0,0 +1,113 @@
+#include "LayoutCache.h"
+
+#include "Logging/Log.h"
+
+#include <algorithm>
+
+namespace {
+	/***********************************************************************************/
+	template <typename T>
+	void append(std::string& key, const T& value) {
+		key.append(reinterpret_cast<const char*>(&value), sizeof(value));
+	}
+}
+
+/***********************************************************************************/
+void LayoutCache::shutdown() {
+	for (const auto& [key, layout] : m_pipelineLayouts) {
+		vkDestroyPipelineLayout(m_device, layout, nullptr);
+	}
+	for (const auto& [key, layout] : m_descriptorSetLayouts) {
+		vkDestroyDescriptorSetLayout(m_device, layout, nullptr);
+	}
+
+	m_pipelineLayouts.clear();
+	m_descriptorSetLayouts.clear();
+}
+
+/***********************************************************************************/
+VkDescriptorSetLayout LayoutCache::descriptorSetLayout(std::vector<VkDescriptorSetLayoutBinding> bindings) {
+	// Binding order doesn't change the layout
+	std::sort(bindings.begin(), bindings.end(), [](const auto& a, const auto& b) { return a.binding < b.binding; });
+
+	std::string key;
+	for (const auto& binding : bindings) {
+		append(key, binding.binding);
+		append(key, binding.descriptorType);
+		append(key, binding.descriptorCount);
+		append(key, binding.stageFlags);
+	}
+
+	const auto it = m_descriptorSetLayouts.find(key);
+	if (it != m_descriptorSetLayouts.end()) {
+		return it->second;
+	}
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo {};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = static_cast<std::uint32_t>(bindings.size());
+	layoutInfo.pBindings = bindings.data();
+
+	VkDescriptorSetLayout layout;
+	if (vkCreateDescriptorSetLayout(m_device, &layoutInfo, nullptr, &layout) != VK_SUCCESS) {
+		LOG_CRITICAL("Failed to create descriptor set layout.");
+	}
+
+	m_descriptorSetLayouts.emplace(std::move(key), layout);
+	return layout;
+}
+
+/***********************************************************************************/
+VkPipelineLayout LayoutCache::pipelineLayout(const std::vector<VkDescriptorSetLayout>& setLayouts, const std::vector<VkPushConstantRange>& pushConstants) {
+	std::string key;
+	append(key, setLayouts.size());
+	for (const auto setLayout : setLayouts) {
+		append(key, setLayout);
+	}
+	for (const auto& range : pushConstants) {
+		append(key, range.stageFlags);
+		append(key, range.offset);
+		append(key, range.size);
+	}
+
+	const auto it = m_pipelineLayouts.find(key);
+	if (it != m_pipelineLayouts.end()) {
+		return it->second;
+	}
+
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo {};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = static_cast<std::uint32_t>(setLayouts.size());
+	pipelineLayoutInfo.pSetLayouts = setLayouts.data();
+	pipelineLayoutInfo.pushConstantRangeCount = static_cast<std::uint32_t>(pushConstants.size());
+	pipelineLayoutInfo.pPushConstantRanges = pushConstants.data();
+
+	VkPipelineLayout layout;
+	if (vkCreatePipelineLayout(m_device, &pipelineLayoutInfo, nullptr, &layout) != VK_SUCCESS) {
+		LOG_CRITICAL("Failed to create pipeline layout.");
+	}
+
+	m_pipelineLayouts.emplace(std::move(key), layout);
+	return layout;
+}
+
+/***********************************************************************************/
+VkPipelineLayout LayoutCache::pipelineLayout(const ShaderReflection& reflection, std::vector<VkDescriptorSetLayout>* setLayouts) {
+	// Sets in between that no shader uses still need a (empty) layout
+	std::vector<VkDescriptorSetLayout> layouts;
+	for (std::uint32_t set = 0; set < reflection.setCount(); ++set) {
+		layouts.push_back(descriptorSetLayout(reflection.setBindings(set)));
+	}
+
+	std::vector<VkPushConstantRange> pushConstants;
+	if (reflection.pushConstants.size > 0) {
+		pushConstants.push_back(reflection.pushConstants);
+	}
+
+	const auto layout = pipelineLayout(layouts, pushConstants);
+	if (setLayouts) {
+		*setLayouts = std::move(layouts);
+	}
+
+	return layout;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "ShaderReflection.h"
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Creates descriptor set and pipeline layouts once per distinct description and hands out the same
+// handle for identical ones, so shaders with matching interfaces share them. Owns every layout.
+class LayoutCache {
+
+public:
+	LayoutCache() = default;
+	LayoutCache(const LayoutCache&) = delete;
+	LayoutCache& operator=(const LayoutCache&) = delete;
+
+	void init(const VkDevice device) noexcept { m_device = device; }
+	void shutdown();
+
+	VkDescriptorSetLayout descriptorSetLayout(std::vector<VkDescriptorSetLayoutBinding> bindings);
+	VkPipelineLayout pipelineLayout(const std::vector<VkDescriptorSetLayout>& setLayouts, const std::vector<VkPushConstantRange>& pushConstants);
+	// One set layout per set the shaders use (written to setLayouts when given) and the pipeline layout around them
+	VkPipelineLayout pipelineLayout(const ShaderReflection& reflection, std::vector<VkDescriptorSetLayout>* setLayouts = nullptr);
+
+	auto descriptorSetLayoutCount() const noexcept { return m_descriptorSetLayouts.size(); }
+	auto pipelineLayoutCount() const noexcept { return m_pipelineLayouts.size(); }
+
+private:
+	VkDevice m_device = VK_NULL_HANDLE;
+
+	// Keyed by the description's fields written out one after another
+	std::unordered_map<std::string, VkDescriptorSetLayout> m_descriptorSetLayouts;
+	std::unordered_map<std::string, VkPipelineLayout> m_pipelineLayouts;
+};
@@ -1,18 +1,77 @@
 #include "Mesh.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
 
 #define TINYOBJLOADER_IMPLEMENTATION
 #include <tiny_obj_loader.h>
 
 #include "Logging/Log.h"
 
+#include <glm/gtc/packing.hpp>
+
+#include <type_traits>
 #include <unordered_map>
 
+namespace {
+	// Largest simplification error any LOD may reach, relative to the bounding sphere radius
+	constexpr float MaxLodError = 0.05f;
+
+	// Maps a unit vector onto the [-1, 1] square (octahedral encoding)
+	glm::vec2 octEncode(const glm::vec3& n) {
+		const auto p = glm::vec2(n) / (std::abs(n.x) + std::abs(n.y) + std::abs(n.z));
+		if (n.z >= 0.0f) {
+			return p;
+		}
+
+		const glm::vec2 signs(p.x >= 0.0f ? 1.0f : -1.0f, p.y >= 0.0f ? 1.0f : -1.0f);
+		return (1.0f - glm::abs(glm::vec2(p.y, p.x))) * signs;
+	}
+
+	// Builds the upload stream in either vertex format, see GpuVertex
+	template<typename Packed>
+	void packVertices(const std::vector<Vertex>& vertices, const AABB& aabb, std::vector<Packed>& packed, glm::vec3& scale, glm::vec3& offset) {
+		if constexpr (!std::is_same_v<Packed, PackedVertex>) {
+			// Full-precision upload, nothing to quantize
+			packed = vertices;
+			scale = glm::vec3(1.0f);
+			offset = glm::vec3(0.0f);
+		}
+		else {
+			// Map the AABB onto [-1, 1] so the full SNORM range is used on every axis
+			offset = aabb.center();
+			scale = glm::max(aabb.extents(), glm::vec3(std::numeric_limits<float>::epsilon()));
+			const auto invScale = 1.0f / scale;
+
+			packed.clear();
+			packed.reserve(vertices.size());
+
+			for (const auto& vertex : vertices) {
+				const auto position = glm::clamp((vertex.pos - offset) * invScale, -1.0f, 1.0f);
+				const auto normal = octEncode(vertex.normal);
+
+				PackedVertex v;
+				v.position[0] = static_cast<std::int16_t>(glm::packSnorm1x16(position.x));
+				v.position[1] = static_cast<std::int16_t>(glm::packSnorm1x16(position.y));
+				v.position[2] = static_cast<std::int16_t>(glm::packSnorm1x16(position.z));
+				v.position[3] = 0;
+				v.normal[0] = static_cast<std::int16_t>(glm::packSnorm1x16(normal.x));
+				v.normal[1] = static_cast<std::int16_t>(glm::packSnorm1x16(normal.y));
+				v.texCoord[0] = glm::packHalf1x16(vertex.texCoord.x);
+				v.texCoord[1] = glm::packHalf1x16(vertex.texCoord.y);
+
+				packed.push_back(v);
+			}
+		}
+	}
+}
+
 /***********************************************************************************/
-Mesh::Mesh(const std::vector<Vertex>& verts, const std::vector<std::uint32_t>& inds, const std::string_view imgPath) : vertices(verts), indices(inds), texture(imgPath) {
+Mesh::Mesh(const std::vector<Vertex>& verts, const std::vector<std::uint32_t>& inds, TexturePtr tex) : vertices(verts), indices(inds), lods{ { 0, static_cast<std::uint32_t>(inds.size()), 0.0f } }, texture(std::move(tex)) {
+	shader.textured = texture != nullptr;
 }
 
 /***********************************************************************************/
-MeshPtr Mesh::loadModel(const std::string_view modelPath, const std::string_view texturePath) {
+MeshPtr Mesh::loadModel(const std::string_view modelPath, TexturePtr texture) {
 	LOG_INFO("Loading model...");
 	tinyobj::attrib_t attrib;
 	std::vector<tinyobj::shape_t> shapes;
@@ -20,9 +79,12 @@ MeshPtr Mesh::loadModel(const std::string_view modelPath, const std::string_view
 	std::string err;
 
 	if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &err, modelPath.data())) {
-		LOG_CRITICAL(err);
+		LOG_ERROR(err);
+		return nullptr;
 	}
 
+	const auto hasNormals = !attrib.normals.empty();
+
 	std::vector<Vertex> vertices;
 	std::vector<std::uint32_t> indices;
 	// For removing duplicate vertices
@@ -35,7 +97,11 @@ MeshPtr Mesh::loadModel(const std::string_view modelPath, const std::string_view
 				attrib.vertices[3 * index.vertex_index + 1],
 				attrib.vertices[3 * index.vertex_index + 2] 
 			},
-			{1.0f, 1.0f, 1.0f}, // Color
+			hasNormals && index.normal_index >= 0 ? glm::vec3 {
+				attrib.normals[3 * index.normal_index],
+				attrib.normals[3 * index.normal_index + 1],
+				attrib.normals[3 * index.normal_index + 2]
+			} : glm::vec3(0.0f), // Generated below if the file has none
 			{
 				attrib.texcoords[2 * index.texcoord_index],
 				1.0f - attrib.texcoords[2 * index.texcoord_index + 1] // Flip origin to top-left
@@ -51,5 +117,198 @@ MeshPtr Mesh::loadModel(const std::string_view modelPath, const std::string_view
 		}
 	}
 
-	return std::make_shared<Mesh>(vertices, indices, texturePath);
+	if (!hasNormals) {
+		// Area-weighted face normals (the cross product's length is twice the triangle area)
+		for (std::size_t i = 0; i + 2 < indices.size(); i += 3) {
+			auto& v0 = vertices[indices[i]];
+			auto& v1 = vertices[indices[i + 1]];
+			auto& v2 = vertices[indices[i + 2]];
+
+			const auto faceNormal = glm::cross(v1.pos - v0.pos, v2.pos - v0.pos);
+			v0.normal += faceNormal;
+			v1.normal += faceNormal;
+			v2.normal += faceNormal;
+		}
+	}
+
+	for (auto& vertex : vertices) {
+		const auto length = glm::length(vertex.normal);
+		vertex.normal = length > 0.0f ? vertex.normal / length : glm::vec3(0.0f, 0.0f, 1.0f);
+	}
+
+	// OBJ face order is arbitrary, reorder for the vertex cache/overdraw/vertex fetch
+	MeshOptimizer::optimize(vertices, indices);
+
+	auto mesh = std::make_shared<Mesh>(vertices, indices, std::move(texture));
+	mesh->computeBounds();
+	mesh->generateLods();
+	mesh->buildMeshlets();
+	mesh->quantize();
+
+	return mesh;
+}
+
+/***********************************************************************************/
+void Mesh::computeBounds() {
+	aabb = AABB();
+	for (const auto& vertex : vertices) {
+		aabb.expand(vertex.pos);
+	}
+
+	// Center the sphere on the box, then shrink the radius to the farthest vertex
+	// (tighter than half the box diagonal for most meshes).
+	boundingSphere.center = aabb.center();
+	auto radiusSquared = 0.0f;
+	for (const auto& vertex : vertices) {
+		const auto d = vertex.pos - boundingSphere.center;
+		radiusSquared = std::max(radiusSquared, glm::dot(d, d));
+	}
+	boundingSphere.radius = std::sqrt(radiusSquared);
+}
+
+/***********************************************************************************/
+void Mesh::generateLods() {
+	const auto baseIndexCount = lods.front().indexCount;
+	indices.resize(baseIndexCount);
+	lods.assign(1, MeshLod { 0, baseIndexCount, 0.0f });
+
+	const auto maxError = boundingSphere.radius * MaxLodError;
+
+	std::vector<std::uint32_t> previous(indices);
+	auto error = 0.0f;
+
+	while (lods.size() < MaxLods && error < maxError) {
+		// Each LOD halves the previous one. Errors add up along the chain, which keeps them conservative.
+		auto lodError = 0.0f;
+		auto simplified = MeshSimplifier::simplify(vertices, previous, previous.size() / 6 * 3, maxError - error, lodError);
+
+		// Not worth a LOD if the simplifier stalled (locked seams/borders or error limit)
+		if (simplified.size() > previous.size() * 3 / 4) {
+			break;
+		}
+
+		MeshOptimizer::optimizeVertexCache(simplified, vertices.size());
+
+		error += lodError;
+		lods.push_back(MeshLod { static_cast<std::uint32_t>(indices.size()), static_cast<std::uint32_t>(simplified.size()), error });
+		indices.insert(indices.end(), simplified.begin(), simplified.end());
+
+		previous = std::move(simplified);
+	}
+
+	spdlog::get("console")->info("Generated {} LODs, coarsest has {} of {} triangles.", lods.size(), lods.back().indexCount / 3, baseIndexCount / 3);
+}
+
+/***********************************************************************************/
+void Mesh::buildMeshlets() {
+	meshlets.clear();
+
+	const auto& lod = lods.front();
+
+	// Greedily fill meshlets in index order. The order is already optimized for the vertex cache,
+	// so consecutive triangles are close together and the clusters stay compact.
+	constexpr auto NotInMeshlet = ~0u;
+	std::vector<std::uint32_t> vertexMeshlet(vertices.size(), NotInMeshlet);
+	std::uint32_t meshletVertexCount = 0;
+
+	Meshlet current;
+	current.firstIndex = lod.firstIndex;
+
+	const auto finishMeshlet = [this, &current]() {
+		// Bounds: sphere around the cluster's AABB center, cone around the average triangle normal
+		AABB bounds;
+		glm::vec3 normalSum(0.0f);
+
+		for (auto i = current.firstIndex; i < current.firstIndex + current.indexCount; i += 3) {
+			const auto& p0 = vertices[indices[i]].pos;
+			const auto& p1 = vertices[indices[i + 1]].pos;
+			const auto& p2 = vertices[indices[i + 2]].pos;
+
+			bounds.expand(p0);
+			bounds.expand(p1);
+			bounds.expand(p2);
+
+			const auto normal = glm::cross(p1 - p0, p2 - p0);
+			const auto length = glm::length(normal);
+			if (length > 0.0f) {
+				normalSum += normal / length;
+			}
+		}
+
+		current.boundingSphere.center = bounds.center();
+		auto radiusSquared = 0.0f;
+		auto minDot = 1.0f;
+
+		const auto axisLength = glm::length(normalSum);
+		current.coneAxis = axisLength > 0.0f ? normalSum / axisLength : glm::vec3(0.0f, 0.0f, 1.0f);
+
+		for (auto i = current.firstIndex; i < current.firstIndex + current.indexCount; i += 3) {
+			const auto& p0 = vertices[indices[i]].pos;
+			const auto& p1 = vertices[indices[i + 1]].pos;
+			const auto& p2 = vertices[indices[i + 2]].pos;
+
+			for (const auto* p : { &p0, &p1, &p2 }) {
+				const auto d = *p - current.boundingSphere.center;
+				radiusSquared = std::max(radiusSquared, glm::dot(d, d));
+			}
+
+			const auto normal = glm::cross(p1 - p0, p2 - p0);
+			const auto length = glm::length(normal);
+			if (length > 0.0f) {
+				minDot = std::min(minDot, glm::dot(normal / length, current.coneAxis));
+			}
+		}
+
+		current.boundingSphere.radius = std::sqrt(radiusSquared);
+		current.coneCutoff = axisLength > 0.0f && minDot > 0.0f ? std::sqrt(1.0f - minDot * minDot) : 1.0f;
+
+		meshlets.push_back(current);
+	};
+
+	for (auto i = lod.firstIndex; i < lod.firstIndex + lod.indexCount; i += 3) {
+		const auto meshletIndex = static_cast<std::uint32_t>(meshlets.size());
+
+		std::uint32_t newVertices = 0;
+		for (std::uint32_t k = 0; k < 3; ++k) {
+			newVertices += vertexMeshlet[indices[i + k]] != meshletIndex ? 1 : 0;
+		}
+
+		if (meshletVertexCount + newVertices > Meshlet::MaxVertices || current.indexCount / 3 == Meshlet::MaxTriangles) {
+			finishMeshlet();
+
+			current = Meshlet();
+			current.firstIndex = i;
+			meshletVertexCount = 0;
+		}
+
+		const auto activeMeshlet = static_cast<std::uint32_t>(meshlets.size());
+		for (std::uint32_t k = 0; k < 3; ++k) {
+			auto& owner = vertexMeshlet[indices[i + k]];
+			if (owner != activeMeshlet) {
+				owner = activeMeshlet;
+				++meshletVertexCount;
+			}
+		}
+		current.indexCount += 3;
+	}
+
+	if (current.indexCount > 0) {
+		finishMeshlet();
+	}
+}
+
+/***********************************************************************************/
+std::uint32_t Mesh::selectLod(const float pixelsPerUnit) const noexcept {
+	for (auto lod = static_cast<std::uint32_t>(lods.size()) - 1; lod > 0; --lod) {
+		if (lods[lod].error * pixelsPerUnit < 1.0f) {
+			return lod;
+		}
+	}
+
+	return 0;
+}
+
+/***********************************************************************************/
+void Mesh::quantize() {
+	packVertices(vertices, aabb, gpuVertices, positionScale, positionOffset);
 }
@@ -1,22 +1,69 @@
 #pragma once
 
 #include "Vertex.h"
+#include "Bounds.h"
+#include "Meshlet.h"
 #include "Texture.h"
+#include "ShaderVariant.h"
 
 #include <string_view>
 #include <memory>
 
+// A simplified version of a mesh: a range of its indices, relative to the mesh's firstIndex
+struct MeshLod {
+	std::uint32_t firstIndex = 0;
+	std::uint32_t indexCount = 0;
+	float error = 0.0f; // Object-space deviation from LOD 0
+};
+
 struct Mesh {
-	Mesh(const std::vector<Vertex>& verts, const std::vector<std::uint32_t>& inds, const std::string_view imgpath);
+	// Size of the LOD table in ObjectData
+	static constexpr std::size_t MaxLods = 4;
+
+	Mesh(const std::vector<Vertex>& verts, const std::vector<std::uint32_t>& inds, TexturePtr tex);
+
+	// Always loads from disk, go through the AssetCache to share meshes and textures. Returns nullptr on failure.
+	static std::shared_ptr<Mesh> loadModel(const std::string_view modelPath, TexturePtr texture);
 
-	static std::shared_ptr<Mesh> loadModel(const std::string_view modelPath, const std::string_view texturePath);
+	// Fits the object-space AABB and bounding sphere around the vertices.
+	void computeBounds();
+	// Simplifies LOD 0 into a chain of coarser LODs, appended to indices. Needs the bounds.
+	void generateLods();
+	// Splits LOD 0 into meshlets (contiguous index ranges, so the triangle order is kept). Needs LOD 0's final order.
+	void buildMeshlets();
+	// Coarsest LOD whose error stays under a pixel, given how many pixels one object-space unit covers.
+	std::uint32_t selectLod(const float pixelsPerUnit) const noexcept;
+	// Builds gpuVertices from vertices. Needs the bounds, positions are quantized relative to the AABB.
+	void quantize();
+
+	// Indices are relative to vertexOffset, so 16 bits are enough while every vertex is addressable with them
+	auto indexType() const noexcept { return vertices.size() <= 65536 ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32; }
+	auto indexSize() const noexcept { return indexType() == VK_INDEX_TYPE_UINT16 ? sizeof(std::uint16_t) : sizeof(std::uint32_t); }
 
 	std::vector<Vertex> vertices;
-	std::vector<std::uint32_t> indices;
+	std::vector<std::uint32_t> indices; // All LODs back to back, narrowed on upload (see indexType())
+	std::vector<MeshLod> lods; // lods[0] is the full mesh
+	std::vector<Meshlet> meshlets; // Cover LOD 0
+
+	// Vertex stream that gets uploaded, see GpuVertex
+	std::vector<GpuVertex> gpuVertices;
+	// Undoes the position quantization: position = gpuVertex.position * positionScale + positionOffset
+	glm::vec3 positionScale { 1.0f };
+	glm::vec3 positionOffset { 0.0f };
+
+	// Object-space bounds, used for culling
+	AABB aabb;
+	BoundingSphere boundingSphere;
 	
-	VkBuffer vertexBuffer, indexBuffer;
-	VmaAllocation vertexBufferAllocation, indexBufferAllocation;
-	Texture texture;
+	// Where the mesh lives inside the shared geometry buffers, in elements (baseVertex/firstIndex of a draw).
+	// firstIndex counts in units of indexType(). Only valid while resident.
+	std::int32_t vertexOffset = 0;
+	std::uint32_t firstIndex = 0;
+	bool resident = false;
+
+	TexturePtr texture;
+	// Meshes with equal variants are drawn with the same pipeline. Picked up when the draw list is rebuilt.
+	ShaderVariant shader;
 };
 
 using MeshPtr = std::shared_ptr<Mesh>;
\ No newline at end of file
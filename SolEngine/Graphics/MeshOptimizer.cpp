@@ -0,0 +1,325 @@
+#include "MeshOptimizer.h"
+
+#include "Logging/Log.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+namespace {
+	// Forsyth's tuning constants
+	constexpr std::size_t LRUCacheSize = 32;
+	constexpr float CacheDecayPower = 1.5f;
+	constexpr float LastTriangleScore = 0.75f;
+	constexpr float ValenceBoostScale = 2.0f;
+	constexpr float ValenceBoostPower = 0.5f;
+
+	// Cache size the overdraw clusters are built against (matches analyzeVertexCache's default)
+	constexpr std::size_t FIFOCacheSize = 16;
+
+	float vertexScore(const int cachePosition, const std::uint32_t remainingTriangles) {
+		if (remainingTriangles == 0) {
+			return -1.0f;
+		}
+
+		auto score = 0.0f;
+		if (cachePosition >= 0) {
+			// The last triangle's vertices get a fixed score so it isn't simply repeated
+			if (cachePosition < 3) {
+				score = LastTriangleScore;
+			}
+			else {
+				const auto scaler = 1.0f / static_cast<float>(LRUCacheSize - 3);
+				score = std::pow(1.0f - static_cast<float>(cachePosition - 3) * scaler, CacheDecayPower);
+			}
+		}
+
+		// Favour vertices with few triangles left so they don't get stranded
+		score += ValenceBoostScale * std::pow(static_cast<float>(remainingTriangles), -ValenceBoostPower);
+
+		return score;
+	}
+}
+
+/***********************************************************************************/
+MeshOptimizer::VertexCacheStats MeshOptimizer::analyzeVertexCache(const std::vector<std::uint32_t>& indices, const std::size_t vertexCount, const std::size_t cacheSize) {
+	VertexCacheStats stats;
+	if (indices.empty()) {
+		return stats;
+	}
+
+	// Time stamp of each vertex's entry into the FIFO, in units of misses
+	std::vector<std::size_t> cacheTimestamps(vertexCount, 0);
+	std::vector<bool> referenced(vertexCount, false);
+	std::size_t misses = 0;
+
+	for (const auto index : indices) {
+		referenced[index] = true;
+
+		// Hits leave a FIFO unchanged
+		if (cacheTimestamps[index] == 0 || misses - cacheTimestamps[index] + 1 > cacheSize) {
+			++misses;
+			cacheTimestamps[index] = misses;
+		}
+	}
+
+	const auto uniqueVertices = std::count(referenced.begin(), referenced.end(), true);
+
+	stats.acmr = static_cast<float>(misses) / static_cast<float>(indices.size() / 3);
+	stats.atvr = static_cast<float>(misses) / static_cast<float>(uniqueVertices);
+
+	return stats;
+}
+
+/***********************************************************************************/
+void MeshOptimizer::optimizeVertexCache(std::vector<std::uint32_t>& indices, const std::size_t vertexCount) {
+	const auto triangleCount = indices.size() / 3;
+	if (triangleCount == 0) {
+		return;
+	}
+
+	// Vertex -> triangle adjacency, compacted. The first remainingTriangles[v] entries of
+	// each vertex's range are the triangles that haven't been emitted yet.
+	std::vector<std::uint32_t> remainingTriangles(vertexCount, 0);
+	for (const auto index : indices) {
+		++remainingTriangles[index];
+	}
+
+	std::vector<std::uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+	std::partial_sum(remainingTriangles.begin(), remainingTriangles.end(), adjacencyOffsets.begin() + 1);
+
+	std::vector<std::uint32_t> adjacency(indices.size());
+	{
+		auto cursor = adjacencyOffsets;
+		for (std::size_t i = 0; i < indices.size(); ++i) {
+			adjacency[cursor[indices[i]]++] = static_cast<std::uint32_t>(i / 3);
+		}
+	}
+
+	std::vector<int> cachePositions(vertexCount, -1);
+	std::vector<float> vertexScores(vertexCount);
+	for (std::size_t v = 0; v < vertexCount; ++v) {
+		vertexScores[v] = vertexScore(-1, remainingTriangles[v]);
+	}
+
+	std::vector<float> triangleScores(triangleCount);
+	for (std::size_t t = 0; t < triangleCount; ++t) {
+		triangleScores[t] = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+	}
+
+	std::vector<bool> emitted(triangleCount, false);
+	std::vector<std::uint32_t> cache, nextCache;
+	cache.reserve(LRUCacheSize + 3);
+	nextCache.reserve(LRUCacheSize + 3);
+
+	std::vector<std::uint32_t> output;
+	output.reserve(indices.size());
+
+	auto bestTriangle = static_cast<std::size_t>(std::max_element(triangleScores.begin(), triangleScores.end()) - triangleScores.begin());
+	std::size_t fallbackCursor = 0;
+
+	for (std::size_t emittedCount = 0; emittedCount < triangleCount; ++emittedCount) {
+		// Nothing adjacent to the cache is left, continue with the next unemitted triangle
+		if (bestTriangle == triangleCount) {
+			while (emitted[fallbackCursor]) {
+				++fallbackCursor;
+			}
+			bestTriangle = fallbackCursor;
+		}
+
+		emitted[bestTriangle] = true;
+
+		const std::uint32_t triangle[3] { indices[bestTriangle * 3], indices[bestTriangle * 3 + 1], indices[bestTriangle * 3 + 2] };
+		for (const auto v : triangle) {
+			output.push_back(v);
+
+			// Remove the triangle from the vertex's pending list
+			const auto begin = adjacency.begin() + adjacencyOffsets[v];
+			const auto end = begin + remainingTriangles[v];
+			const auto it = std::find(begin, end, static_cast<std::uint32_t>(bestTriangle));
+			if (it != end) {
+				std::iter_swap(it, end - 1);
+				--remainingTriangles[v];
+			}
+		}
+
+		// Move the triangle's vertices to the front of the LRU cache
+		nextCache.assign(triangle, triangle + 3);
+		for (const auto v : cache) {
+			if (v != triangle[0] && v != triangle[1] && v != triangle[2]) {
+				nextCache.push_back(v);
+			}
+		}
+		std::swap(cache, nextCache);
+
+		// Rescore everything that was in the cache, including what just fell out of it
+		for (std::size_t i = 0; i < cache.size(); ++i) {
+			const auto v = cache[i];
+			cachePositions[v] = i < LRUCacheSize ? static_cast<int>(i) : -1;
+			vertexScores[v] = vertexScore(cachePositions[v], remainingTriangles[v]);
+		}
+
+		bestTriangle = triangleCount;
+		auto bestScore = -1.0f;
+
+		for (std::size_t i = 0; i < cache.size(); ++i) {
+			const auto v = cache[i];
+			const auto begin = adjacencyOffsets[v];
+
+			for (auto a = begin; a < begin + remainingTriangles[v]; ++a) {
+				const auto t = adjacency[a];
+				const auto score = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+				triangleScores[t] = score;
+
+				if (score > bestScore) {
+					bestScore = score;
+					bestTriangle = t;
+				}
+			}
+		}
+
+		if (cache.size() > LRUCacheSize) {
+			cache.resize(LRUCacheSize);
+		}
+	}
+
+	indices = std::move(output);
+}
+
+/***********************************************************************************/
+void MeshOptimizer::optimizeOverdraw(std::vector<std::uint32_t>& indices, const std::vector<Vertex>& vertices, const float threshold) {
+	const auto triangleCount = indices.size() / 3;
+	if (triangleCount == 0) {
+		return;
+	}
+
+	const auto meshACMR = analyzeVertexCache(indices, vertices.size(), FIFOCacheSize).acmr;
+
+	// Hard boundaries: triangles where all three vertices miss, i.e. the cache has restarted.
+	// Soft boundaries: split a cluster early once its ACMR is within threshold of the mesh's.
+	std::vector<std::size_t> clusterStarts { 0 };
+	{
+		std::vector<std::size_t> cacheTimestamps(vertices.size(), 0);
+		std::size_t misses = 0, clusterMisses = 0;
+
+		for (std::size_t t = 0; t < triangleCount; ++t) {
+			std::size_t triangleMisses = 0;
+
+			for (std::size_t k = 0; k < 3; ++k) {
+				const auto index = indices[t * 3 + k];
+				if (cacheTimestamps[index] == 0 || misses - cacheTimestamps[index] + 1 > FIFOCacheSize) {
+					++misses;
+					++triangleMisses;
+					cacheTimestamps[index] = misses;
+				}
+			}
+
+			const auto clusterStart = clusterStarts.back();
+			if (t > clusterStart && triangleMisses == 3) {
+				// Already a cold start, clusters can be reordered here for free
+				clusterStarts.push_back(t);
+				clusterMisses = triangleMisses;
+				continue;
+			}
+
+			clusterMisses += triangleMisses;
+			const auto clusterACMR = static_cast<float>(clusterMisses) / static_cast<float>(t - clusterStart + 1);
+			if (t + 1 < triangleCount && clusterACMR <= meshACMR * threshold) {
+				clusterStarts.push_back(t + 1);
+				clusterMisses = 0;
+				// Each cluster is measured as if drawn on its own, flush the simulated cache
+				misses += FIFOCacheSize;
+			}
+		}
+	}
+	clusterStarts.push_back(triangleCount);
+
+	// Mesh centroid, area weighted
+	glm::vec3 meshCentroid(0.0f);
+	auto meshArea = 0.0f;
+	for (std::size_t t = 0; t < triangleCount; ++t) {
+		const auto& p0 = vertices[indices[t * 3]].pos;
+		const auto& p1 = vertices[indices[t * 3 + 1]].pos;
+		const auto& p2 = vertices[indices[t * 3 + 2]].pos;
+
+		const auto area = glm::length(glm::cross(p1 - p0, p2 - p0));
+		meshCentroid += (p0 + p1 + p2) * (area / 3.0f);
+		meshArea += area;
+	}
+	meshCentroid /= std::max(meshArea, std::numeric_limits<float>::min());
+
+	// Clusters facing away from the centre are the ones most likely to occlude the rest
+	const auto clusterCount = clusterStarts.size() - 1;
+	std::vector<float> sortKeys(clusterCount);
+
+	for (std::size_t c = 0; c < clusterCount; ++c) {
+		glm::vec3 centroid(0.0f), normal(0.0f);
+		auto area = 0.0f;
+
+		for (auto t = clusterStarts[c]; t < clusterStarts[c + 1]; ++t) {
+			const auto& p0 = vertices[indices[t * 3]].pos;
+			const auto& p1 = vertices[indices[t * 3 + 1]].pos;
+			const auto& p2 = vertices[indices[t * 3 + 2]].pos;
+
+			const auto faceNormal = glm::cross(p1 - p0, p2 - p0);
+			const auto faceArea = glm::length(faceNormal);
+
+			centroid += (p0 + p1 + p2) * (faceArea / 3.0f);
+			normal += faceNormal;
+			area += faceArea;
+		}
+
+		centroid /= std::max(area, std::numeric_limits<float>::min());
+		const auto normalLength = glm::length(normal);
+		normal = normalLength > 0.0f ? normal / normalLength : glm::vec3(0.0f);
+
+		sortKeys[c] = glm::dot(centroid - meshCentroid, normal);
+	}
+
+	std::vector<std::size_t> clusterOrder(clusterCount);
+	std::iota(clusterOrder.begin(), clusterOrder.end(), 0);
+	std::stable_sort(clusterOrder.begin(), clusterOrder.end(), [&sortKeys](const std::size_t a, const std::size_t b) {
+		return sortKeys[a] > sortKeys[b];
+	});
+
+	std::vector<std::uint32_t> output;
+	output.reserve(indices.size());
+	for (const auto c : clusterOrder) {
+		output.insert(output.end(), indices.begin() + clusterStarts[c] * 3, indices.begin() + clusterStarts[c + 1] * 3);
+	}
+
+	indices = std::move(output);
+}
+
+/***********************************************************************************/
+void MeshOptimizer::optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<std::uint32_t>& indices) {
+	constexpr auto Unused = ~0u;
+	std::vector<std::uint32_t> remap(vertices.size(), Unused);
+
+	std::vector<Vertex> output;
+	output.reserve(vertices.size());
+
+	for (auto& index : indices) {
+		if (remap[index] == Unused) {
+			remap[index] = static_cast<std::uint32_t>(output.size());
+			output.push_back(vertices[index]);
+		}
+		index = remap[index];
+	}
+
+	vertices = std::move(output);
+}
+
+/***********************************************************************************/
+void MeshOptimizer::optimize(std::vector<Vertex>& vertices, std::vector<std::uint32_t>& indices) {
+	const auto before = analyzeVertexCache(indices, vertices.size());
+
+	optimizeVertexCache(indices, vertices.size());
+	optimizeOverdraw(indices, vertices);
+	optimizeVertexFetch(vertices, indices);
+
+	const auto after = analyzeVertexCache(indices, vertices.size());
+
+	spdlog::get("console")->info("Mesh optimized: ACMR {:.3f} -> {:.3f}, ATVR {:.3f} -> {:.3f}", before.acmr, after.acmr, before.atvr, after.atvr);
+}
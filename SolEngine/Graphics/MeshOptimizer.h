@@ -0,0 +1,34 @@
+#pragma once
+
+#include "Vertex.h"
+
+#include <cstdint>
+#include <vector>
+
+// Reorders mesh data for the GPU: triangles for the post-transform vertex cache and
+// for overdraw, then vertices for fetch locality. Only the order changes, never the surface.
+namespace MeshOptimizer {
+
+	struct VertexCacheStats {
+		float acmr = 0.0f; // Average cache miss ratio: transformed vertices per triangle (0.5 - 3.0)
+		float atvr = 0.0f; // Average transform to vertex ratio: transformed vertices per unique vertex (1.0 is optimal)
+	};
+
+	// Simulates a FIFO post-transform cache of the given size over the index list.
+	VertexCacheStats analyzeVertexCache(const std::vector<std::uint32_t>& indices, const std::size_t vertexCount, const std::size_t cacheSize = 16);
+
+	// Tom Forsyth's "Linear-Speed Vertex Cache Optimisation": greedily emits the triangle
+	// whose vertices score highest on LRU cache position and remaining valence.
+	void optimizeVertexCache(std::vector<std::uint32_t>& indices, const std::size_t vertexCount);
+
+	// Tipsify-style overdraw pass, run after optimizeVertexCache. Splits the index list into
+	// clusters where the cache restarts anyway (or where the cluster's ACMR is already within
+	// threshold of the whole mesh) and sorts the clusters so outward-facing ones draw first.
+	void optimizeOverdraw(std::vector<std::uint32_t>& indices, const std::vector<Vertex>& vertices, const float threshold = 1.05f);
+
+	// Reorders vertices by first use in the index list and drops unreferenced ones.
+	void optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<std::uint32_t>& indices);
+
+	// Runs all passes above in order and logs the cache stats before and after.
+	void optimize(std::vector<Vertex>& vertices, std::vector<std::uint32_t>& indices);
+}
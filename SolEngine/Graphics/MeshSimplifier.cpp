@@ -0,0 +1,265 @@
+#include "MeshSimplifier.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <unordered_map>
+
+namespace {
+	// Symmetric 4x4 error quadric: Q(p) = p'Ap + 2b'p + c
+	struct Quadric {
+		double a00 = 0.0, a01 = 0.0, a02 = 0.0, a11 = 0.0, a12 = 0.0, a22 = 0.0;
+		double b0 = 0.0, b1 = 0.0, b2 = 0.0;
+		double c = 0.0;
+
+		// Squared distance to the plane n.p + d = 0 (n normalized)
+		static Quadric fromPlane(const glm::dvec3& n, const double d) {
+			Quadric q;
+			q.a00 = n.x * n.x; q.a01 = n.x * n.y; q.a02 = n.x * n.z;
+			q.a11 = n.y * n.y; q.a12 = n.y * n.z;
+			q.a22 = n.z * n.z;
+			q.b0 = n.x * d; q.b1 = n.y * d; q.b2 = n.z * d;
+			q.c = d * d;
+			return q;
+		}
+
+		Quadric& operator+=(const Quadric& rhs) {
+			a00 += rhs.a00; a01 += rhs.a01; a02 += rhs.a02;
+			a11 += rhs.a11; a12 += rhs.a12;
+			a22 += rhs.a22;
+			b0 += rhs.b0; b1 += rhs.b1; b2 += rhs.b2;
+			c += rhs.c;
+			return *this;
+		}
+
+		double evaluate(const glm::vec3& p) const {
+			const double x = p.x, y = p.y, z = p.z;
+			const auto result =
+				a00 * x * x + a11 * y * y + a22 * z * z +
+				2.0 * (a01 * x * y + a02 * x * z + a12 * y * z) +
+				2.0 * (b0 * x + b1 * y + b2 * z) +
+				c;
+			return std::max(result, 0.0);
+		}
+	};
+
+	struct Collapse {
+		double cost;
+		std::uint32_t from, to;
+	};
+
+	std::uint64_t edgeKey(std::uint32_t a, std::uint32_t b) {
+		if (a > b) {
+			std::swap(a, b);
+		}
+		return (static_cast<std::uint64_t>(a) << 32) | b;
+	}
+
+	struct PositionHash {
+		std::size_t operator()(const glm::vec3& v) const {
+			return std::hash<float>()(v.x) ^ (std::hash<float>()(v.y) << 1) ^ (std::hash<float>()(v.z) << 2);
+		}
+	};
+}
+
+/***********************************************************************************/
+std::vector<std::uint32_t> MeshSimplifier::simplify(const std::vector<Vertex>& vertices, const std::vector<std::uint32_t>& indices, const std::size_t targetIndexCount, const float maxError, float& resultError) {
+	resultError = 0.0f;
+
+	const auto vertexCount = static_cast<std::uint32_t>(vertices.size());
+	std::vector<std::uint32_t> result(indices);
+
+	// Lock seam vertices: anything sharing its position with another vertex
+	std::vector<bool> locked(vertexCount, false);
+	{
+		std::unordered_map<glm::vec3, std::uint32_t, PositionHash> firstAtPosition;
+		firstAtPosition.reserve(vertexCount);
+
+		for (std::uint32_t v = 0; v < vertexCount; ++v) {
+			const auto it = firstAtPosition.emplace(vertices[v].pos, v);
+			if (!it.second) {
+				locked[v] = true;
+				locked[it.first->second] = true;
+			}
+		}
+	}
+
+	// Lock border and non-manifold edges, i.e. edges not shared by exactly two triangles
+	{
+		std::unordered_map<std::uint64_t, std::uint32_t> edgeUse;
+		edgeUse.reserve(indices.size());
+
+		for (std::size_t i = 0; i < indices.size(); i += 3) {
+			for (std::size_t k = 0; k < 3; ++k) {
+				++edgeUse[edgeKey(indices[i + k], indices[i + (k + 1) % 3])];
+			}
+		}
+
+		for (const auto& edge : edgeUse) {
+			if (edge.second != 2) {
+				locked[static_cast<std::uint32_t>(edge.first >> 32)] = true;
+				locked[static_cast<std::uint32_t>(edge.first & 0xFFFFFFFF)] = true;
+			}
+		}
+	}
+
+	// Plane quadrics of every triangle, accumulated on its vertices
+	std::vector<Quadric> quadrics(vertexCount);
+	for (std::size_t i = 0; i < indices.size(); i += 3) {
+		const glm::dvec3 p0(vertices[indices[i]].pos);
+		const glm::dvec3 p1(vertices[indices[i + 1]].pos);
+		const glm::dvec3 p2(vertices[indices[i + 2]].pos);
+
+		const auto normal = glm::cross(p1 - p0, p2 - p0);
+		const auto length = glm::length(normal);
+		if (length == 0.0) {
+			continue;
+		}
+
+		const auto n = normal / length;
+		const auto q = Quadric::fromPlane(n, -glm::dot(n, p0));
+		quadrics[indices[i]] += q;
+		quadrics[indices[i + 1]] += q;
+		quadrics[indices[i + 2]] += q;
+	}
+
+	constexpr auto Infinity = std::numeric_limits<double>::max();
+	const auto maxErrorSquared = static_cast<double>(maxError) * maxError;
+	auto resultErrorSquared = 0.0;
+
+	std::vector<std::uint32_t> adjacencyOffsets, adjacency, collapseTarget(vertexCount);
+	std::vector<Collapse> collapses;
+	std::vector<std::uint64_t> edges;
+	std::vector<bool> touched(vertexCount);
+
+	// Each pass collapses a batch of independent edges (no shared neighbourhoods), then rebuilds
+	while (result.size() > targetIndexCount) {
+		// Vertex -> triangle adjacency
+		adjacencyOffsets.assign(vertexCount + 1, 0);
+		for (const auto index : result) {
+			++adjacencyOffsets[index + 1];
+		}
+		for (std::uint32_t v = 0; v < vertexCount; ++v) {
+			adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+		}
+		adjacency.resize(result.size());
+		{
+			auto cursor = adjacencyOffsets;
+			for (std::size_t i = 0; i < result.size(); ++i) {
+				adjacency[cursor[result[i]]++] = static_cast<std::uint32_t>(i / 3);
+			}
+		}
+
+		edges.clear();
+		for (std::size_t i = 0; i < result.size(); i += 3) {
+			for (std::size_t k = 0; k < 3; ++k) {
+				edges.push_back(edgeKey(result[i + k], result[i + (k + 1) % 3]));
+			}
+		}
+		std::sort(edges.begin(), edges.end());
+		edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+		// Cheapest direction of every edge with at least one movable end
+		collapses.clear();
+		for (const auto edge : edges) {
+			const auto a = static_cast<std::uint32_t>(edge >> 32);
+			const auto b = static_cast<std::uint32_t>(edge & 0xFFFFFFFF);
+
+			if (locked[a] && locked[b]) {
+				continue;
+			}
+
+			auto q = quadrics[a];
+			q += quadrics[b];
+
+			const auto costAB = locked[a] ? Infinity : q.evaluate(vertices[b].pos);
+			const auto costBA = locked[b] ? Infinity : q.evaluate(vertices[a].pos);
+
+			collapses.push_back(costAB <= costBA ? Collapse { costAB, a, b } : Collapse { costBA, b, a });
+		}
+
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& lhs, const Collapse& rhs) {
+			return lhs.cost < rhs.cost;
+		});
+
+		for (std::uint32_t v = 0; v < vertexCount; ++v) {
+			collapseTarget[v] = v;
+		}
+		std::fill(touched.begin(), touched.end(), false);
+
+		const auto targetTriangles = targetIndexCount / 3;
+		auto remainingTriangles = result.size() / 3;
+		std::size_t collapseCount = 0;
+
+		for (const auto& collapse : collapses) {
+			if (collapse.cost > maxErrorSquared || remainingTriangles <= targetTriangles) {
+				break;
+			}
+			if (touched[collapse.from] || touched[collapse.to]) {
+				continue;
+			}
+
+			// Reject collapses that flip any of the surviving triangles around 'from'
+			auto flips = false;
+			std::size_t removedTriangles = 0;
+			const auto& to = vertices[collapse.to].pos;
+
+			for (auto a = adjacencyOffsets[collapse.from]; a < adjacencyOffsets[collapse.from + 1] && !flips; ++a) {
+				const auto* triangle = &result[adjacency[a] * 3];
+				if (triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to) {
+					++removedTriangles;
+					continue;
+				}
+
+				glm::vec3 before[3], after[3];
+				for (std::size_t k = 0; k < 3; ++k) {
+					before[k] = vertices[triangle[k]].pos;
+					after[k] = triangle[k] == collapse.from ? to : before[k];
+				}
+
+				const auto normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+				const auto normalAfter = glm::cross(after[1] - after[0], after[2] - after[0]);
+				flips = glm::dot(normalBefore, normalAfter) <= 0.0f;
+			}
+
+			if (flips) {
+				continue;
+			}
+
+			collapseTarget[collapse.from] = collapse.to;
+			quadrics[collapse.to] += quadrics[collapse.from];
+			resultErrorSquared = std::max(resultErrorSquared, collapse.cost);
+			remainingTriangles -= removedTriangles;
+			++collapseCount;
+
+			// Freeze the neighbourhood for the rest of the pass so the adjacency stays valid
+			for (auto a = adjacencyOffsets[collapse.from]; a < adjacencyOffsets[collapse.from + 1]; ++a) {
+				const auto* triangle = &result[adjacency[a] * 3];
+				touched[triangle[0]] = touched[triangle[1]] = touched[triangle[2]] = true;
+			}
+		}
+
+		if (collapseCount == 0) {
+			break;
+		}
+
+		// Apply the collapses and drop the triangles that became degenerate
+		std::size_t write = 0;
+		for (std::size_t i = 0; i < result.size(); i += 3) {
+			const auto i0 = collapseTarget[result[i]];
+			const auto i1 = collapseTarget[result[i + 1]];
+			const auto i2 = collapseTarget[result[i + 2]];
+
+			if (i0 != i1 && i1 != i2 && i0 != i2) {
+				result[write++] = i0;
+				result[write++] = i1;
+				result[write++] = i2;
+			}
+		}
+		result.resize(write);
+	}
+
+	resultError = static_cast<float>(std::sqrt(resultErrorSquared));
+
+	return result;
+}
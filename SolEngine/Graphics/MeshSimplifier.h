@@ -0,0 +1,17 @@
+#pragma once
+
+#include "Vertex.h"
+
+#include <cstdint>
+#include <vector>
+
+// Quadric error metric simplification (Garland & Heckbert), restricted to half-edge collapses
+// so the result indexes the original vertex array and LODs can share one vertex buffer.
+// Vertices on open borders and attribute seams (several vertices at one position) never move.
+namespace MeshSimplifier {
+
+	// Collapses edges in order of increasing error until the index list is at or below targetIndexCount
+	// or the next collapse would exceed maxError (object-space distance). resultError receives the
+	// largest error of any collapse that was made.
+	std::vector<std::uint32_t> simplify(const std::vector<Vertex>& vertices, const std::vector<std::uint32_t>& indices, const std::size_t targetIndexCount, const float maxError, float& resultError);
+}
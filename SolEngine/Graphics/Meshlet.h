@@ -0,0 +1,28 @@
+#pragma once
+
+#include "Bounds.h"
+
+#include <cstdint>
+
+// A cluster of a mesh's LOD 0 triangles with its own bounds, so culling can drop parts of a mesh.
+// Meshlets are contiguous ranges of the index list, adjacent visible ones can be drawn as one range.
+struct Meshlet {
+	static constexpr std::uint32_t MaxVertices = 64;
+	static constexpr std::uint32_t MaxTriangles = 124;
+
+	std::uint32_t firstIndex = 0; // Relative to the mesh's firstIndex
+	std::uint32_t indexCount = 0;
+
+	// Object space
+	BoundingSphere boundingSphere;
+	// Every triangle's normal lies within the cone around coneAxis. coneCutoff is the sine of its
+	// spread angle; 1 when the spread reaches 90 degrees and the cone can't cull anything.
+	glm::vec3 coneAxis { 0.0f, 0.0f, 1.0f };
+	float coneCutoff = 1.0f;
+
+	// True when every triangle faces away from the camera (conservative, accounts for the cluster's extent).
+	auto isBackfacing(const BoundingSphere& worldSphere, const glm::vec3& worldConeAxis, const glm::vec3& cameraPosition) const noexcept {
+		const auto toCenter = worldSphere.center - cameraPosition;
+		return glm::dot(toCenter, worldConeAxis) >= coneCutoff * glm::length(toCenter) + worldSphere.radius;
+	}
+};
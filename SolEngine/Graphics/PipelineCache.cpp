@@ -0,0 +1,194 @@
+#include "PipelineCache.h"
+
+#include "Core/Hash.h"
+#include "Logging/Log.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+namespace {
+	// Header every VkPipelineCache blob starts with (VK_PIPELINE_CACHE_HEADER_VERSION_ONE)
+	struct PipelineCacheHeader {
+		std::uint32_t size;
+		std::uint32_t version;
+		std::uint32_t vendorID;
+		std::uint32_t deviceID;
+		std::uint8_t uuid[VK_UUID_SIZE];
+	};
+
+	/***********************************************************************************/
+	template <typename T>
+	std::uint64_t hashField(const T& field, const std::uint64_t seed) noexcept {
+		return Hash::fnv1a(&field, sizeof(field), seed);
+	}
+}
+
+/***********************************************************************************/
+std::uint64_t PipelineDescription::hash() const noexcept {
+	auto result = shader.hash();
+	result = hashField(topology, result);
+	result = hashField(polygonMode, result);
+	result = hashField(cullMode, result);
+	result = hashField(frontFace, result);
+	result = hashField(depthTest, result);
+	result = hashField(depthWrite, result);
+	result = hashField(depthCompare, result);
+	result = hashField(blend, result);
+	return hashField(depthOnly, result);
+}
+
+/***********************************************************************************/
+bool PipelineDescription::operator==(const PipelineDescription& other) const noexcept {
+	return shader == other.shader &&
+		topology == other.topology &&
+		polygonMode == other.polygonMode &&
+		cullMode == other.cullMode &&
+		frontFace == other.frontFace &&
+		depthTest == other.depthTest &&
+		depthWrite == other.depthWrite &&
+		depthCompare == other.depthCompare &&
+		blend == other.blend &&
+		depthOnly == other.depthOnly;
+}
+
+/***********************************************************************************/
+PipelineCache::PipelineCache(std::string path) : m_path(std::move(path)) {
+}
+
+/***********************************************************************************/
+void PipelineCache::init(const VkDevice device, const VkPhysicalDevice physicalDevice, CreateFunction create) {
+	m_device = device;
+	m_physicalDevice = physicalDevice;
+	m_create = std::move(create);
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(m_physicalDevice, &properties);
+
+	// Drivers are meant to reject foreign data themselves, not all of them do
+	std::vector<char> data;
+	std::ifstream file(m_path, std::ios::binary);
+	if (file) {
+		data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+
+		PipelineCacheHeader header {};
+		if (data.size() >= sizeof(header)) {
+			std::memcpy(&header, data.data(), sizeof(header));
+		}
+
+		if (data.size() < sizeof(header) ||
+			header.version != VK_PIPELINE_CACHE_HEADER_VERSION_ONE ||
+			header.vendorID != properties.vendorID ||
+			header.deviceID != properties.deviceID ||
+			std::memcmp(header.uuid, properties.pipelineCacheUUID, VK_UUID_SIZE) != 0) {
+
+			LOG_INFO("Pipeline cache is from another GPU or driver, starting empty.");
+			data.clear();
+		}
+	}
+
+	VkPipelineCacheCreateInfo createInfo {};
+	createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+	createInfo.initialDataSize = data.size();
+	createInfo.pInitialData = data.empty() ? nullptr : data.data();
+
+	if (vkCreatePipelineCache(m_device, &createInfo, nullptr, &m_cache) != VK_SUCCESS) {
+		LOG_CRITICAL("Failed to create pipeline cache.");
+	}
+}
+
+/***********************************************************************************/
+void PipelineCache::shutdown() {
+	clear();
+
+	std::size_t size = 0;
+	vkGetPipelineCacheData(m_device, m_cache, &size, nullptr);
+
+	std::vector<char> data(size);
+	if (size > 0 && vkGetPipelineCacheData(m_device, m_cache, &size, data.data()) == VK_SUCCESS) {
+		std::error_code error;
+		std::filesystem::create_directories(std::filesystem::path(m_path).parent_path(), error);
+
+		std::ofstream file(m_path, std::ios::binary | std::ios::trunc);
+		file.write(data.data(), static_cast<std::streamsize>(size));
+		if (!file) {
+			spdlog::get("console")->error("Failed to write pipeline cache {}.", m_path);
+		}
+	}
+
+	vkDestroyPipelineCache(m_device, m_cache, nullptr);
+	m_cache = VK_NULL_HANDLE;
+}
+
+/***********************************************************************************/
+VkPipeline PipelineCache::get(const PipelineDescription& description) {
+	auto& entry = request(description);
+
+	if (entry.pending.valid() && entry.pending.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+		collect(entry, description);
+	}
+
+	return entry.pipeline;
+}
+
+/***********************************************************************************/
+VkPipeline PipelineCache::wait(const PipelineDescription& description) {
+	auto& entry = request(description);
+
+	if (entry.pending.valid()) {
+		collect(entry, description);
+	}
+
+	return entry.pipeline;
+}
+
+/***********************************************************************************/
+bool PipelineCache::failed(const PipelineDescription& description) const {
+	const auto it = m_pipelines.find(description);
+	return it != m_pipelines.end() && it->second.failed;
+}
+
+/***********************************************************************************/
+void PipelineCache::waitIdle() {
+	for (auto& [description, entry] : m_pipelines) {
+		if (entry.pending.valid()) {
+			collect(entry, description);
+		}
+	}
+}
+
+/***********************************************************************************/
+void PipelineCache::clear() {
+	waitIdle();
+
+	for (const auto& [description, entry] : m_pipelines) {
+		if (entry.pipeline != VK_NULL_HANDLE) {
+			vkDestroyPipeline(m_device, entry.pipeline, nullptr);
+		}
+	}
+	m_pipelines.clear();
+}
+
+/***********************************************************************************/
+PipelineCache::Entry& PipelineCache::request(const PipelineDescription& description) {
+	auto& entry = m_pipelines[description];
+
+	if (entry.pipeline == VK_NULL_HANDLE && !entry.failed && !entry.pending.valid()) {
+		entry.pending = std::async(std::launch::async, m_create, description, m_cache).share();
+	}
+
+	return entry;
+}
+
+/***********************************************************************************/
+void PipelineCache::collect(Entry& entry, const PipelineDescription& description) {
+	entry.pipeline = entry.pending.get();
+	entry.pending = {};
+	entry.failed = entry.pipeline == VK_NULL_HANDLE;
+
+	if (entry.failed) {
+		spdlog::get("console")->error("Failed to create graphics pipeline {:016x}.", description.hash());
+	}
+}
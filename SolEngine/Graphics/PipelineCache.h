@@ -0,0 +1,91 @@
+#pragma once
+
+#include "ShaderVariant.h"
+
+#include <vulkan/vulkan.h>
+
+#include <functional>
+#include <future>
+#include <string>
+#include <unordered_map>
+
+// Everything that differs between graphics pipelines. The layout and vertex format are shared by
+// all of them, viewport and scissor are dynamic.
+struct PipelineDescription {
+	ShaderVariant shader;
+	VkPrimitiveTopology topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+	VkPolygonMode polygonMode = VK_POLYGON_MODE_FILL;
+	VkCullModeFlags cullMode = VK_CULL_MODE_BACK_BIT;
+	VkFrontFace frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+	VkBool32 depthTest = VK_TRUE;
+	VkBool32 depthWrite = VK_TRUE;
+	VkCompareOp depthCompare = VK_COMPARE_OP_LESS;
+	VkBool32 blend = VK_FALSE;
+	// Positions only and no fragment shader, for the depth pre-pass's render pass instead of the forward pass's
+	bool depthOnly = false;
+
+	// Stable across runs and builds (hashed field by field), fine to log or persist
+	std::uint64_t hash() const noexcept;
+
+	bool operator==(const PipelineDescription& other) const noexcept;
+	bool operator!=(const PipelineDescription& other) const noexcept { return !(*this == other); }
+
+	/***********************************************************************************/
+	struct Hasher {
+		std::size_t operator()(const PipelineDescription& description) const noexcept { return static_cast<std::size_t>(description.hash()); }
+	};
+	/***********************************************************************************/
+};
+
+// Graphics pipelines by description. Missing ones are created on a worker thread, so asking for a
+// new one never stalls the frame, and every creation goes through one VkPipelineCache that is
+// saved on shutdown and reloaded on the next start. Only the main thread calls into this class.
+class PipelineCache {
+
+public:
+	// Runs on a worker, VK_NULL_HANDLE on failure
+	using CreateFunction = std::function<VkPipeline(const PipelineDescription&, VkPipelineCache)>;
+
+	explicit PipelineCache(std::string path = "Data/Shaders/Cache/pipelines.bin");
+
+	PipelineCache(const PipelineCache&) = delete;
+	PipelineCache& operator=(const PipelineCache&) = delete;
+
+	// Creates the VkPipelineCache, seeded from the file when it was written by this GPU and driver
+	void init(const VkDevice device, const VkPhysicalDevice physicalDevice, CreateFunction create);
+	// Destroys every pipeline and the VkPipelineCache after saving its contents
+	void shutdown();
+
+	// The pipeline if it's ready, otherwise VK_NULL_HANDLE (starting its creation the first time it's asked for).
+	// Failed pipelines stay VK_NULL_HANDLE until clear().
+	VkPipeline get(const PipelineDescription& description);
+	// Same, but blocks until the pipeline exists
+	VkPipeline wait(const PipelineDescription& description);
+	// Whether creating the pipeline failed, as found by get() or wait(). Cleared by clear().
+	bool failed(const PipelineDescription& description) const;
+	// Blocks until no creation is running, e.g. before destroying what they read
+	void waitIdle();
+	// Destroys every pipeline (after their shaders changed), the VkPipelineCache keeps its contents
+	void clear();
+
+	auto pipelineCount() const noexcept { return m_pipelines.size(); }
+
+private:
+	struct Entry {
+		std::shared_future<VkPipeline> pending;
+		VkPipeline pipeline = VK_NULL_HANDLE;
+		bool failed = false;
+	};
+
+	Entry& request(const PipelineDescription& description);
+	// Moves a finished creation's result into the entry
+	static void collect(Entry& entry, const PipelineDescription& description);
+
+	std::string m_path;
+	VkDevice m_device = VK_NULL_HANDLE;
+	VkPhysicalDevice m_physicalDevice = VK_NULL_HANDLE;
+	VkPipelineCache m_cache = VK_NULL_HANDLE;
+	CreateFunction m_create;
+
+	std::unordered_map<PipelineDescription, Entry, PipelineDescription::Hasher> m_pipelines;
+};
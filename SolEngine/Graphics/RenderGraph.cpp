@@ -0,0 +1,802 @@
+#include "RenderGraph.h"
+
+#include "Logging/Log.h"
+
+#include <algorithm>
+#include <numeric>
+
+/***********************************************************************************/
+RenderGraph::Resource RenderGraph::PassBuilder::createImage(const std::string_view name, const ImageDescription& description) {
+	ResourceData resource;
+	resource.name = name;
+	resource.isImage = true;
+	resource.description = description;
+
+	m_graph.m_resources.push_back(resource);
+	return static_cast<Resource>(m_graph.m_resources.size() - 1);
+}
+
+/***********************************************************************************/
+void RenderGraph::PassBuilder::read(const Resource resource, const Usage usage) {
+	m_graph.addAccess(m_pass, { resource, usage, true, false });
+}
+
+/***********************************************************************************/
+void RenderGraph::PassBuilder::write(const Resource resource, const Usage usage) {
+	// Storage writes are read-modify-write, the rest overwrite what they touch
+	m_graph.addAccess(m_pass, { resource, usage, usage == Usage::StorageWriteCompute, true });
+}
+
+/***********************************************************************************/
+void RenderGraph::PassBuilder::colorAttachment(const Resource resource, const VkAttachmentLoadOp loadOp, const VkClearColorValue clear) {
+	m_graph.addAccess(m_pass, { resource, Usage::ColorAttachment, loadOp == VK_ATTACHMENT_LOAD_OP_LOAD, true });
+
+	VkClearValue clearValue {};
+	clearValue.color = clear;
+	m_graph.m_passes[m_pass].attachments.push_back({ resource, loadOp, clearValue, Usage::ColorAttachment });
+}
+
+/***********************************************************************************/
+void RenderGraph::PassBuilder::depthAttachment(const Resource resource, const VkAttachmentLoadOp loadOp, const VkClearDepthStencilValue clear) {
+	m_graph.addAccess(m_pass, { resource, Usage::DepthAttachment, loadOp == VK_ATTACHMENT_LOAD_OP_LOAD, true });
+
+	VkClearValue clearValue {};
+	clearValue.depthStencil = clear;
+	m_graph.m_passes[m_pass].attachments.push_back({ resource, loadOp, clearValue, Usage::DepthAttachment });
+}
+
+/***********************************************************************************/
+void RenderGraph::PassBuilder::depthReadAttachment(const Resource resource) {
+	m_graph.addAccess(m_pass, { resource, Usage::DepthRead, true, false });
+	m_graph.m_passes[m_pass].attachments.push_back({ resource, VK_ATTACHMENT_LOAD_OP_LOAD, {}, Usage::DepthRead });
+}
+
+/***********************************************************************************/
+void RenderGraph::PassBuilder::resolveAttachment(const Resource source, const Resource target) {
+	const auto& attachments = m_graph.m_passes[m_pass].attachments;
+	const auto sourceAttachment = std::find_if(attachments.begin(), attachments.end(), [source](const auto& attachment) {
+		return attachment.resource == source && attachment.usage == Usage::ColorAttachment && attachment.resolveSource == InvalidResource;
+	});
+	if (sourceAttachment == attachments.end()) {
+		spdlog::get("console")->error("Pass {} resolves {}, which isn't one of its color attachments.", m_graph.m_passes[m_pass].name, m_graph.m_resources[source].name);
+		std::abort();
+	}
+
+	// Every sample of the target gets written, nothing needs loading
+	m_graph.addAccess(m_pass, { target, Usage::ColorAttachment, false, true });
+	m_graph.m_passes[m_pass].attachments.push_back({ target, VK_ATTACHMENT_LOAD_OP_DONT_CARE, {}, Usage::ColorAttachment, source });
+}
+
+/***********************************************************************************/
+void RenderGraph::PassBuilder::sideEffects() {
+	m_graph.m_passes[m_pass].sideEffects = true;
+}
+
+/***********************************************************************************/
+void RenderGraph::reset() {
+	for (const auto& [key, framebuffer] : m_framebuffers) {
+		vkDestroyFramebuffer(m_device, framebuffer, nullptr);
+	}
+	for (const auto& pass : m_passes) {
+		if (pass.renderPass != VK_NULL_HANDLE) {
+			vkDestroyRenderPass(m_device, pass.renderPass, nullptr);
+		}
+	}
+	for (const auto& resource : m_resources) {
+		if (resource.imported) {
+			continue;
+		}
+		if (resource.view != VK_NULL_HANDLE) {
+			vkDestroyImageView(m_device, resource.view, nullptr);
+		}
+		if (resource.image != VK_NULL_HANDLE) {
+			vkDestroyImage(m_device, resource.image, nullptr);
+		}
+	}
+	for (const auto& slot : m_memorySlots) {
+		vmaFreeMemory(m_allocator, slot.allocation);
+	}
+
+	m_framebuffers.clear();
+	m_passes.clear();
+	m_resources.clear();
+	m_memorySlots.clear();
+	m_finalBarriers = {};
+	m_memoryStats = {};
+}
+
+/***********************************************************************************/
+RenderGraph::Resource RenderGraph::importImage(const std::string_view name, const VkFormat format, const Usage finalUsage, const Usage initialUsage) {
+	ResourceData resource;
+	resource.name = name;
+	resource.isImage = true;
+	resource.imported = true;
+	resource.description.format = format;
+	resource.initialUsage = initialUsage;
+	resource.finalUsage = finalUsage;
+
+	m_resources.push_back(resource);
+	return static_cast<Resource>(m_resources.size() - 1);
+}
+
+/***********************************************************************************/
+RenderGraph::Resource RenderGraph::importBuffer(const std::string_view name, const VkBuffer buffer, const Usage finalUsage) {
+	ResourceData resource;
+	resource.name = name;
+	resource.imported = true;
+	resource.buffer = buffer;
+	resource.finalUsage = finalUsage;
+
+	m_resources.push_back(resource);
+	return static_cast<Resource>(m_resources.size() - 1);
+}
+
+/***********************************************************************************/
+void RenderGraph::setImage(const Resource resource, const VkImage image, const VkImageView view) {
+	m_resources[resource].image = image;
+	m_resources[resource].view = view;
+}
+
+/***********************************************************************************/
+void RenderGraph::addPass(const std::string_view name, const VkPipelineBindPoint bindPoint, const Setup& setup, Execute execute) {
+	Pass pass;
+	pass.name = name;
+	pass.bindPoint = bindPoint;
+	pass.execute = std::move(execute);
+	m_passes.push_back(std::move(pass));
+
+	PassBuilder builder(*this, m_passes.size() - 1);
+	setup(builder);
+}
+
+/***********************************************************************************/
+void RenderGraph::addAccess(const std::size_t pass, const Access& access) {
+	const auto& resource = m_resources[access.resource];
+
+	for (const auto& other : m_passes[pass].accesses) {
+		if (other.resource == access.resource) {
+			spdlog::get("console")->error("Pass {} uses {} more than once.", m_passes[pass].name, resource.name);
+			std::abort();
+		}
+	}
+	if (resource.isImage && usageInfo(access.usage).layout == VK_IMAGE_LAYOUT_UNDEFINED) {
+		spdlog::get("console")->error("Pass {} uses image {} in a buffer-only way.", m_passes[pass].name, resource.name);
+		std::abort();
+	}
+
+	m_passes[pass].accesses.push_back(access);
+}
+
+/***********************************************************************************/
+void RenderGraph::compile(const VkExtent2D extent) {
+	cullPasses();
+	createTransients(extent);
+	createRenderPasses(extent);
+	computeBarriers();
+
+	const auto keptPasses = std::count_if(m_passes.begin(), m_passes.end(), [](const auto& pass) { return !pass.culled; });
+	std::size_t transients = 0, lazy = 0;
+	for (const auto& resource : m_resources) {
+		transients += resource.image != VK_NULL_HANDLE && !resource.imported;
+		lazy += resource.lazy;
+	}
+	spdlog::get("console")->info("Render graph: {}/{} passes, {} transient images ({} transient attachments) in {} memory slots.",
+		keptPasses, m_passes.size(), transients, lazy, m_memorySlots.size());
+}
+
+/***********************************************************************************/
+void RenderGraph::execute(const VkCommandBuffer commandBuffer) {
+	for (auto& pass : m_passes) {
+		if (pass.culled) {
+			continue;
+		}
+
+		recordBarriers(commandBuffer, pass.before);
+
+		if (pass.bindPoint != VK_PIPELINE_BIND_POINT_GRAPHICS) {
+			pass.execute(commandBuffer);
+			continue;
+		}
+
+		std::vector<VkClearValue> clearValues;
+		for (const auto& attachment : pass.attachments) {
+			clearValues.push_back(attachment.clear);
+		}
+
+		VkRenderPassBeginInfo renderPassInfo {};
+		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+		renderPassInfo.renderPass = pass.renderPass;
+		renderPassInfo.framebuffer = framebuffer(pass);
+		renderPassInfo.renderArea.offset = { 0, 0 };
+		renderPassInfo.renderArea.extent = pass.extent;
+		renderPassInfo.clearValueCount = static_cast<std::uint32_t>(clearValues.size());
+		renderPassInfo.pClearValues = clearValues.data();
+
+		vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+		pass.execute(commandBuffer);
+		vkCmdEndRenderPass(commandBuffer);
+	}
+
+	recordBarriers(commandBuffer, m_finalBarriers);
+}
+
+/***********************************************************************************/
+RenderGraph::MemoryStats RenderGraph::memoryStats() const {
+	auto stats = m_memoryStats;
+
+	for (const auto& slot : m_memorySlots) {
+		if (slot.lazilyAllocated) {
+			VkDeviceSize committed = 0;
+			vkGetDeviceMemoryCommitment(m_device, slot.memory, &committed);
+			stats.committed += committed;
+		}
+	}
+
+	return stats;
+}
+
+/***********************************************************************************/
+VkRenderPass RenderGraph::renderPass(const std::string_view passName) const {
+	const auto pass = findPass(passName);
+	return pass ? pass->renderPass : VK_NULL_HANDLE;
+}
+
+/***********************************************************************************/
+bool RenderGraph::culled(const std::string_view passName) const {
+	const auto pass = findPass(passName);
+	return pass && pass->culled;
+}
+
+/***********************************************************************************/
+VkAttachmentStoreOp RenderGraph::storeOp(const std::string_view passName, const Resource resource) const {
+	const auto pass = findPass(passName);
+	if (pass) {
+		for (const auto& attachment : pass->attachments) {
+			if (attachment.resource == resource) {
+				return attachment.storeOp;
+			}
+		}
+	}
+
+	return VK_ATTACHMENT_STORE_OP_DONT_CARE;
+}
+
+/***********************************************************************************/
+const RenderGraph::BarrierBatch* RenderGraph::barriers(const std::string_view passName) const {
+	const auto pass = findPass(passName);
+	return pass ? &pass->before : nullptr;
+}
+
+/***********************************************************************************/
+const RenderGraph::Pass* RenderGraph::findPass(const std::string_view name) const {
+	const auto pass = std::find_if(m_passes.begin(), m_passes.end(), [name](const auto& pass) { return pass.name == name; });
+	return pass != m_passes.end() ? &*pass : nullptr;
+}
+
+/***********************************************************************************/
+RenderGraph::UsageInfo RenderGraph::usageInfo(const Usage usage) noexcept {
+	constexpr auto depthStages = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+	constexpr auto graphicsStages = VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+
+	switch (usage) {
+	case Usage::ColorAttachment:
+		return { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+			VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, true };
+	case Usage::DepthAttachment:
+		return { depthStages, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+			VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, true };
+	case Usage::DepthRead:
+		return { depthStages, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, false };
+	case Usage::SampledGraphics:
+		return { graphicsStages, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, false };
+	case Usage::SampledCompute:
+		return { VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, false };
+	case Usage::StorageReadGraphics:
+		return { graphicsStages, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_GENERAL, false };
+	case Usage::StorageReadCompute:
+		return { VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_GENERAL, false };
+	case Usage::StorageWriteCompute:
+		return { VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL, true };
+	case Usage::IndirectRead:
+		return { VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED, false };
+	case Usage::TransferRead:
+		return { VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, false };
+	case Usage::TransferWrite:
+		return { VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, true };
+	case Usage::HostRead:
+		return { VK_PIPELINE_STAGE_HOST_BIT, VK_ACCESS_HOST_READ_BIT, VK_IMAGE_LAYOUT_GENERAL, false };
+	case Usage::Present:
+		return { VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, false };
+	default:
+		return { VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, 0, VK_IMAGE_LAYOUT_UNDEFINED, false };
+	}
+}
+
+/***********************************************************************************/
+bool RenderGraph::isDepthFormat(const VkFormat format) noexcept {
+	return format == VK_FORMAT_D16_UNORM || format == VK_FORMAT_D32_SFLOAT || format == VK_FORMAT_D16_UNORM_S8_UINT ||
+		format == VK_FORMAT_D24_UNORM_S8_UINT || format == VK_FORMAT_D32_SFLOAT_S8_UINT || format == VK_FORMAT_X8_D24_UNORM_PACK32;
+}
+
+/***********************************************************************************/
+VkImageAspectFlags RenderGraph::aspectMask(const VkFormat format) noexcept {
+	if (!isDepthFormat(format)) {
+		return VK_IMAGE_ASPECT_COLOR_BIT;
+	}
+
+	const bool stencil = format == VK_FORMAT_D16_UNORM_S8_UINT || format == VK_FORMAT_D24_UNORM_S8_UINT || format == VK_FORMAT_D32_SFLOAT_S8_UINT;
+	return VK_IMAGE_ASPECT_DEPTH_BIT | (stencil ? static_cast<VkImageAspectFlags>(VK_IMAGE_ASPECT_STENCIL_BIT) : 0);
+}
+
+/***********************************************************************************/
+void RenderGraph::cullPasses() {
+	// Walk backwards from what leaves the graph: a pass is needed if it writes something a needed pass reads
+	std::vector<bool> needed(m_resources.size());
+	for (std::size_t i = 0; i < m_resources.size(); ++i) {
+		needed[i] = m_resources[i].imported && m_resources[i].finalUsage != Usage::None;
+	}
+
+	for (auto pass = m_passes.rbegin(); pass != m_passes.rend(); ++pass) {
+		pass->culled = !pass->sideEffects && std::none_of(pass->accesses.begin(), pass->accesses.end(), [&](const auto& access) {
+			return access.write && needed[access.resource];
+		});
+		if (pass->culled) {
+			continue;
+		}
+
+		// Earlier writers only matter to this pass if it reads what they wrote
+		for (const auto& access : pass->accesses) {
+			if (access.write && !access.read) {
+				needed[access.resource] = false;
+			}
+		}
+		for (const auto& access : pass->accesses) {
+			if (access.read) {
+				needed[access.resource] = true;
+			}
+		}
+	}
+
+	for (std::size_t i = 0; i < m_passes.size(); ++i) {
+		if (m_passes[i].culled) {
+			continue;
+		}
+		for (const auto& access : m_passes[i].accesses) {
+			auto& resource = m_resources[access.resource];
+			resource.firstPass = std::min(resource.firstPass, i);
+			resource.lastPass = std::max(resource.lastPass, i);
+		}
+	}
+}
+
+/***********************************************************************************/
+void RenderGraph::createTransients(const VkExtent2D extent) {
+	std::vector<Resource> transients;
+
+	for (const auto& pass : m_passes) {
+		if (pass.culled) {
+			continue;
+		}
+		for (const auto& access : pass.accesses) {
+			auto& resource = m_resources[access.resource];
+			if (resource.imported) {
+				continue;
+			}
+
+			switch (access.usage) {
+			case Usage::ColorAttachment: resource.imageUsage |= VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT; break;
+			case Usage::DepthAttachment:
+			case Usage::DepthRead: resource.imageUsage |= VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT; break;
+			case Usage::SampledGraphics:
+			case Usage::SampledCompute: resource.imageUsage |= VK_IMAGE_USAGE_SAMPLED_BIT; break;
+			case Usage::StorageReadGraphics:
+			case Usage::StorageReadCompute:
+			case Usage::StorageWriteCompute: resource.imageUsage |= VK_IMAGE_USAGE_STORAGE_BIT; break;
+			case Usage::TransferRead: resource.imageUsage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT; break;
+			case Usage::TransferWrite: resource.imageUsage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT; break;
+			default: break;
+			}
+		}
+	}
+
+	// Attachments of one pass that are cleared or discarded on load and never stored
+	std::vector<bool> loaded(m_resources.size());
+	for (const auto& pass : m_passes) {
+		for (const auto& attachment : pass.attachments) {
+			loaded[attachment.resource] = loaded[attachment.resource] || attachment.loadOp == VK_ATTACHMENT_LOAD_OP_LOAD;
+		}
+	}
+
+	constexpr VkImageUsageFlags attachmentUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+
+	for (Resource i = 0; i < m_resources.size(); ++i) {
+		auto& resource = m_resources[i];
+		if (resource.imported || resource.imageUsage == 0) {
+			continue;
+		}
+
+		resource.lazy = (resource.imageUsage & ~attachmentUsage) == 0 && resource.firstPass == resource.lastPass && !loaded[i];
+		if (resource.lazy) {
+			resource.imageUsage |= VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+		}
+
+		const auto& description = resource.description;
+
+		VkImageCreateInfo imageInfo {};
+		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageInfo.extent.width = description.width ? description.width : extent.width;
+		imageInfo.extent.height = description.height ? description.height : extent.height;
+		imageInfo.extent.depth = 1;
+		imageInfo.mipLevels = description.mipLevels;
+		imageInfo.arrayLayers = 1;
+		imageInfo.format = description.format;
+		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		imageInfo.usage = resource.imageUsage;
+		imageInfo.samples = description.samples;
+		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+		if (vkCreateImage(m_device, &imageInfo, nullptr, &resource.image) != VK_SUCCESS) {
+			spdlog::get("console")->error("Failed to create render graph image {}.", resource.name);
+			std::abort();
+		}
+
+		vkGetImageMemoryRequirements(m_device, resource.image, &resource.memoryRequirements);
+		m_memoryStats.unaliased += resource.memoryRequirements.size;
+		transients.push_back(i);
+	}
+
+	// Biggest first, each goes into the first slot whose images are all dead while it's alive
+	std::stable_sort(transients.begin(), transients.end(), [this](const auto a, const auto b) {
+		return m_resources[a].memoryRequirements.size > m_resources[b].memoryRequirements.size;
+	});
+
+	for (const auto i : transients) {
+		auto& resource = m_resources[i];
+		const auto& requirements = resource.memoryRequirements;
+
+		auto slot = std::find_if(m_memorySlots.begin(), m_memorySlots.end(), [&](const auto& slot) {
+			if (slot.lazy != resource.lazy || (slot.requirements.memoryTypeBits & requirements.memoryTypeBits) == 0) {
+				return false;
+			}
+			return std::all_of(slot.resources.begin(), slot.resources.end(), [&](const auto other) {
+				return m_resources[other].lastPass < resource.firstPass || resource.lastPass < m_resources[other].firstPass;
+			});
+		});
+
+		if (slot == m_memorySlots.end()) {
+			m_memorySlots.push_back({ requirements, {}, resource.lazy });
+			slot = m_memorySlots.end() - 1;
+		}
+
+		slot->requirements.size = std::max(slot->requirements.size, requirements.size);
+		slot->requirements.alignment = std::max(slot->requirements.alignment, requirements.alignment);
+		slot->requirements.memoryTypeBits &= requirements.memoryTypeBits;
+		slot->resources.push_back(i);
+		resource.memorySlot = static_cast<std::size_t>(slot - m_memorySlots.begin());
+	}
+
+	for (auto& slot : m_memorySlots) {
+		VmaAllocationCreateInfo allocInfo {};
+		allocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+		if (slot.lazy) {
+			// Tilers have it, everything else falls back to plain device local memory
+			allocInfo.flags = VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT;
+			allocInfo.preferredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
+		}
+
+		VmaAllocationInfo info {};
+		if (vmaAllocateMemory(m_allocator, &slot.requirements, &allocInfo, &slot.allocation, &info) != VK_SUCCESS) {
+			LOG_CRITICAL("Failed to allocate render graph memory.");
+		}
+
+		VkMemoryPropertyFlags memoryFlags = 0;
+		vmaGetMemoryTypeProperties(m_allocator, info.memoryType, &memoryFlags);
+		slot.memory = info.deviceMemory;
+		slot.lazilyAllocated = (memoryFlags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT) != 0;
+
+		m_memoryStats.allocated += slot.requirements.size;
+		if (slot.lazilyAllocated) {
+			m_memoryStats.lazy += slot.requirements.size;
+		}
+
+		for (const auto i : slot.resources) {
+			auto& resource = m_resources[i];
+			vkBindImageMemory(m_device, resource.image, info.deviceMemory, info.offset);
+
+			VkImageViewCreateInfo viewInfo {};
+			viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+			viewInfo.image = resource.image;
+			viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+			viewInfo.format = resource.description.format;
+			viewInfo.subresourceRange.aspectMask = aspectMask(resource.description.format);
+			viewInfo.subresourceRange.baseMipLevel = 0;
+			viewInfo.subresourceRange.levelCount = resource.description.mipLevels;
+			viewInfo.subresourceRange.baseArrayLayer = 0;
+			viewInfo.subresourceRange.layerCount = 1;
+
+			if (vkCreateImageView(m_device, &viewInfo, nullptr, &resource.view) != VK_SUCCESS) {
+				spdlog::get("console")->error("Failed to create render graph image view {}.", resource.name);
+				std::abort();
+			}
+		}
+	}
+}
+
+/***********************************************************************************/
+void RenderGraph::createRenderPasses(const VkExtent2D extent) {
+	for (std::size_t i = 0; i < m_passes.size(); ++i) {
+		auto& pass = m_passes[i];
+		if (pass.culled || pass.bindPoint != VK_PIPELINE_BIND_POINT_GRAPHICS) {
+			continue;
+		}
+
+		std::vector<VkAttachmentDescription> attachments;
+		std::vector<VkAttachmentReference> colorReferences, resolveReferences;
+		std::vector<Resource> colorResources;
+		VkAttachmentReference depthReference {};
+		bool hasDepth = false;
+
+		pass.extent = extent;
+		for (auto& attachment : pass.attachments) {
+			const auto& resource = m_resources[attachment.resource];
+			const auto layout = usageInfo(attachment.usage).layout;
+			// Only keep what a later pass or the outside world looks at
+			const bool stored = resource.imported || resource.lastPass > i;
+			attachment.storeOp = stored ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+
+			VkAttachmentDescription description {};
+			description.format = resource.description.format;
+			description.samples = resource.description.samples;
+			description.loadOp = attachment.loadOp;
+			description.storeOp = attachment.storeOp;
+			description.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+			description.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+			// Layout transitions happen in the barriers before the pass
+			description.initialLayout = layout;
+			description.finalLayout = layout;
+
+			const VkAttachmentReference reference { static_cast<std::uint32_t>(attachments.size()), layout };
+			if (attachment.usage != Usage::ColorAttachment) {
+				depthReference = reference;
+				hasDepth = true;
+			}
+			else if (attachment.resolveSource == InvalidResource) {
+				colorReferences.push_back(reference);
+				colorResources.push_back(attachment.resource);
+			}
+			attachments.push_back(description);
+
+			if (!resource.imported && resource.description.width) {
+				pass.extent = { resource.description.width, resource.description.height };
+			}
+		}
+
+		// One entry per color attachment, unused where it isn't resolved
+		for (std::uint32_t j = 0; j < pass.attachments.size(); ++j) {
+			const auto& attachment = pass.attachments[j];
+			if (attachment.resolveSource == InvalidResource) {
+				continue;
+			}
+
+			resolveReferences.resize(colorReferences.size(), { VK_ATTACHMENT_UNUSED, VK_IMAGE_LAYOUT_UNDEFINED });
+			const auto source = std::find(colorResources.begin(), colorResources.end(), attachment.resolveSource) - colorResources.begin();
+			resolveReferences[source] = { j, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+		}
+
+		VkSubpassDescription subpass {};
+		subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+		subpass.colorAttachmentCount = static_cast<std::uint32_t>(colorReferences.size());
+		subpass.pColorAttachments = colorReferences.data();
+		subpass.pResolveAttachments = resolveReferences.empty() ? nullptr : resolveReferences.data();
+		subpass.pDepthStencilAttachment = hasDepth ? &depthReference : nullptr;
+
+		VkRenderPassCreateInfo renderPassInfo {};
+		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+		renderPassInfo.attachmentCount = static_cast<std::uint32_t>(attachments.size());
+		renderPassInfo.pAttachments = attachments.data();
+		renderPassInfo.subpassCount = 1;
+		renderPassInfo.pSubpasses = &subpass;
+
+		if (vkCreateRenderPass(m_device, &renderPassInfo, nullptr, &pass.renderPass) != VK_SUCCESS) {
+			spdlog::get("console")->error("Failed to create render pass {}.", pass.name);
+			std::abort();
+		}
+	}
+}
+
+/***********************************************************************************/
+void RenderGraph::computeBarriers() {
+	std::vector<State> states(m_resources.size());
+
+	// Already in their state when the frame starts. Whatever the previous frame did to them was made
+	// visible to that state by its final barriers, only later writes have to wait for the reads.
+	for (Resource i = 0; i < m_resources.size(); ++i) {
+		if (m_resources[i].initialUsage != Usage::None) {
+			const auto info = usageInfo(m_resources[i].initialUsage);
+			auto& state = states[i];
+			state.layout = info.layout;
+			state.readStages = info.stages;
+			state.readAccess = info.access;
+			state.stages = info.stages;
+			state.touched = true;
+		}
+	}
+
+	for (auto& pass : m_passes) {
+		pass.before = {};
+		if (pass.culled) {
+			continue;
+		}
+		for (const auto& access : pass.accesses) {
+			transition(pass.before, states, access.resource, access.usage);
+		}
+	}
+
+	m_finalBarriers = {};
+	for (Resource i = 0; i < m_resources.size(); ++i) {
+		if (m_resources[i].imported && m_resources[i].finalUsage != Usage::None) {
+			transition(m_finalBarriers, states, i, m_resources[i].finalUsage);
+		}
+	}
+}
+
+/***********************************************************************************/
+void RenderGraph::transition(BarrierBatch& batch, std::vector<State>& states, const Resource resource, const Usage usage) const {
+	const auto& data = m_resources[resource];
+	const auto info = usageInfo(usage);
+	const auto layout = data.isImage ? info.layout : VK_IMAGE_LAYOUT_UNDEFINED;
+	auto& state = states[resource];
+
+	VkPipelineStageFlags srcStages = 0;
+	VkAccessFlags srcAccess = 0;
+	bool barrier = false;
+
+	if (!state.touched) {
+		// Whatever was in there before is garbage, but someone else may still be using the memory:
+		// the presentation engine (chained through the acquire semaphore, which waits on a stage
+		// the first use covers) or the transient that had this memory slot before
+		if (data.imported && data.isImage) {
+			srcStages = info.stages;
+		}
+		else if (data.memorySlot < m_memorySlots.size()) {
+			for (const auto other : m_memorySlots[data.memorySlot].resources) {
+				if (m_resources[other].lastPass < data.firstPass) {
+					srcStages |= states[other].stages;
+					srcAccess |= states[other].writeAccess;
+				}
+			}
+		}
+		barrier = data.isImage || srcStages != 0;
+		state.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+	}
+	else if (info.write || state.layout != layout) {
+		// WAW/WAR, or a layout transition, which writes the image
+		srcStages = state.writeStages | state.readStages;
+		srcAccess = state.writeAccess;
+		barrier = srcStages != 0 || state.layout != layout;
+	}
+	else if (state.writeStages != 0 && ((info.stages & ~state.readStages) != 0 || (info.access & ~state.readAccess) != 0)) {
+		// RAW, unless this stage already waited for the write
+		srcStages = state.writeStages;
+		srcAccess = state.writeAccess;
+		barrier = true;
+	}
+
+	if (barrier) {
+		batch.srcStages |= srcStages;
+		batch.dstStages |= info.stages;
+		batch.barriers.push_back({ resource, srcAccess, info.access, state.layout, layout });
+	}
+
+	if (info.write) {
+		state.writeStages = info.stages;
+		state.writeAccess = info.access;
+		state.readStages = 0;
+		state.readAccess = 0;
+	}
+	else if (barrier && state.layout != layout) {
+		// Later readers in other stages need to wait for the transition too
+		state.writeStages = info.stages;
+		state.readStages = info.stages;
+		state.readAccess = info.access;
+	}
+	else {
+		state.readStages |= info.stages;
+		state.readAccess |= info.access;
+	}
+
+	state.layout = layout;
+	state.stages |= info.stages;
+	state.touched = true;
+}
+
+/***********************************************************************************/
+void RenderGraph::recordBarriers(const VkCommandBuffer commandBuffer, const BarrierBatch& batch) const {
+	if (batch.barriers.empty()) {
+		return;
+	}
+
+	std::vector<VkBufferMemoryBarrier> bufferBarriers;
+	std::vector<VkImageMemoryBarrier> imageBarriers;
+
+	for (const auto& barrier : batch.barriers) {
+		const auto& resource = m_resources[barrier.resource];
+
+		if (!resource.isImage) {
+			VkBufferMemoryBarrier bufferBarrier {};
+			bufferBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+			bufferBarrier.srcAccessMask = barrier.srcAccess;
+			bufferBarrier.dstAccessMask = barrier.dstAccess;
+			bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			bufferBarrier.buffer = resource.buffer;
+			bufferBarrier.offset = 0;
+			bufferBarrier.size = VK_WHOLE_SIZE;
+			bufferBarriers.push_back(bufferBarrier);
+			continue;
+		}
+
+		if (resource.image == VK_NULL_HANDLE) {
+			spdlog::get("console")->error("Render graph image {} was never set.", resource.name);
+			std::abort();
+		}
+
+		VkImageMemoryBarrier imageBarrier {};
+		imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		imageBarrier.srcAccessMask = barrier.srcAccess;
+		imageBarrier.dstAccessMask = barrier.dstAccess;
+		imageBarrier.oldLayout = barrier.oldLayout;
+		imageBarrier.newLayout = barrier.newLayout;
+		imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		imageBarrier.image = resource.image;
+		imageBarrier.subresourceRange.aspectMask = aspectMask(resource.description.format);
+		imageBarrier.subresourceRange.baseMipLevel = 0;
+		imageBarrier.subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS;
+		imageBarrier.subresourceRange.baseArrayLayer = 0;
+		imageBarrier.subresourceRange.layerCount = 1;
+		imageBarriers.push_back(imageBarrier);
+	}
+
+	vkCmdPipelineBarrier(commandBuffer,
+		batch.srcStages ? batch.srcStages : static_cast<VkPipelineStageFlags>(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT), batch.dstStages, 0,
+		0, nullptr,
+		static_cast<std::uint32_t>(bufferBarriers.size()), bufferBarriers.data(),
+		static_cast<std::uint32_t>(imageBarriers.size()), imageBarriers.data());
+}
+
+/***********************************************************************************/
+VkFramebuffer RenderGraph::framebuffer(const Pass& pass) {
+	std::vector<VkImageView> views;
+	for (const auto& attachment : pass.attachments) {
+		const auto view = m_resources[attachment.resource].view;
+		if (view == VK_NULL_HANDLE) {
+			spdlog::get("console")->error("Render graph image {} was never set.", m_resources[attachment.resource].name);
+			std::abort();
+		}
+		views.push_back(view);
+	}
+
+	auto& framebuffer = m_framebuffers[{ pass.renderPass, views }];
+	if (framebuffer != VK_NULL_HANDLE) {
+		return framebuffer;
+	}
+
+	VkFramebufferCreateInfo framebufferInfo {};
+	framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+	framebufferInfo.renderPass = pass.renderPass;
+	framebufferInfo.attachmentCount = static_cast<std::uint32_t>(views.size());
+	framebufferInfo.pAttachments = views.data();
+	framebufferInfo.width = pass.extent.width;
+	framebufferInfo.height = pass.extent.height;
+	framebufferInfo.layers = 1;
+
+	if (vkCreateFramebuffer(m_device, &framebufferInfo, nullptr, &framebuffer) != VK_SUCCESS) {
+		spdlog::get("console")->error("Failed to create framebuffer for pass {}.", pass.name);
+		std::abort();
+	}
+
+	return framebuffer;
+}
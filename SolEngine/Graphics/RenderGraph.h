@@ -0,0 +1,254 @@
+#pragma once
+
+#include <vk_mem_alloc.h>
+
+#include <functional>
+#include <map>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// A frame described as passes that declare what they read and write. Passes run in the order they
+// were added. compile() drops passes whose results nothing uses, creates the render passes,
+// framebuffers and transient images (sharing memory between transients whose lifetimes don't
+// overlap) and works out the barriers between passes, so execute() only records.
+// Rebuild (reset, add passes, compile) when the swapchain or the shape of the frame changes.
+class RenderGraph {
+
+public:
+	using Resource = std::uint32_t;
+	static constexpr Resource InvalidResource = ~0u;
+
+	// How a pass touches a resource. Each maps to a pipeline stage, access mask and image layout.
+	enum class Usage {
+		None,
+		ColorAttachment,
+		DepthAttachment, // Depth test + write
+		DepthRead, // Depth test only
+		SampledGraphics,
+		SampledCompute,
+		StorageReadGraphics,
+		StorageReadCompute,
+		StorageWriteCompute, // Read-write
+		IndirectRead,
+		TransferRead,
+		TransferWrite,
+		HostRead,
+		Present
+	};
+
+	/***********************************************************************************/
+	struct ImageDescription {
+		VkFormat format = VK_FORMAT_UNDEFINED;
+		std::uint32_t width = 0, height = 0; // 0: the extent given to compile()
+		std::uint32_t mipLevels = 1;
+		VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+	};
+	/***********************************************************************************/
+	class PassBuilder {
+
+	public:
+		// An image owned by the graph, only valid during this frame
+		Resource createImage(const std::string_view name, const ImageDescription& description);
+
+		void read(const Resource resource, const Usage usage);
+		void write(const Resource resource, const Usage usage);
+
+		// Graphics passes only. Attachments must all have the same size.
+		void colorAttachment(const Resource resource, const VkAttachmentLoadOp loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR, const VkClearColorValue clear = {});
+		void depthAttachment(const Resource resource, const VkAttachmentLoadOp loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR, const VkClearDepthStencilValue clear = { 1.0f, 0 });
+		// Depth test only, against what an earlier pass left in the image. Pipelines must not write depth.
+		void depthReadAttachment(const Resource resource);
+		// Resolves a multisampled color attachment of this pass into target at the end of the subpass
+		void resolveAttachment(const Resource source, const Resource target);
+
+		// Keeps the pass even if nothing reads what it writes
+		void sideEffects();
+
+	private:
+		friend class RenderGraph;
+		PassBuilder(RenderGraph& graph, const std::size_t pass) : m_graph(graph), m_pass(pass) {}
+
+		RenderGraph& m_graph;
+		std::size_t m_pass;
+	};
+	/***********************************************************************************/
+
+	using Setup = std::function<void(PassBuilder&)>;
+	using Execute = std::function<void(VkCommandBuffer)>;
+
+	RenderGraph() = default;
+	RenderGraph(const RenderGraph&) = delete;
+	RenderGraph& operator=(const RenderGraph&) = delete;
+
+	void init(const VkDevice device, const VmaAllocator allocator) noexcept { m_device = device; m_allocator = allocator; }
+	// Destroys everything compile() created and forgets the passes and resources
+	void reset();
+
+	// Images and buffers that live outside the graph. Their contents are undefined on entry (images
+	// start in VK_IMAGE_LAYOUT_UNDEFINED, waited on at their first use's stage, e.g. the swapchain
+	// semaphore's), finalUsage is the state they are left in. Imported images are bound per frame.
+	// An image with an initialUsage keeps its contents: it enters every frame in that state, usually
+	// the finalUsage of the frame before.
+	Resource importImage(const std::string_view name, const VkFormat format, const Usage finalUsage, const Usage initialUsage = Usage::None);
+	Resource importBuffer(const std::string_view name, const VkBuffer buffer, const Usage finalUsage = Usage::None);
+	void setImage(const Resource resource, const VkImage image, const VkImageView view);
+
+	// Calls setup right away. bindPoint picks graphics (a render pass around execute) or compute.
+	void addPass(const std::string_view name, const VkPipelineBindPoint bindPoint, const Setup& setup, Execute execute);
+
+	void compile(const VkExtent2D extent);
+	void execute(const VkCommandBuffer commandBuffer);
+
+	// Render pass of a graphics pass, for creating pipelines. VK_NULL_HANDLE if it was culled.
+	VkRenderPass renderPass(const std::string_view passName) const;
+	VkImage image(const Resource resource) const { return m_resources[resource].image; }
+	VkImageView imageView(const Resource resource) const { return m_resources[resource].view; }
+
+	/***********************************************************************************/
+	// Transient image memory, in bytes
+	struct MemoryStats {
+		VkDeviceSize allocated = 0;
+		VkDeviceSize unaliased = 0; // What it would take without aliasing
+		VkDeviceSize lazy = 0; // Part of allocated that is lazily allocated
+		VkDeviceSize committed = 0; // Part of lazy the driver actually backed, so far
+	};
+	/***********************************************************************************/
+
+	// Queries how much lazily allocated memory is committed, cheap enough to call every frame
+	MemoryStats memoryStats() const;
+
+	/***********************************************************************************/
+	struct Barrier {
+		Resource resource;
+		VkAccessFlags srcAccess, dstAccess;
+		VkImageLayout oldLayout, newLayout;
+	};
+	/***********************************************************************************/
+	struct BarrierBatch {
+		VkPipelineStageFlags srcStages = 0, dstStages = 0;
+		std::vector<Barrier> barriers;
+	};
+	/***********************************************************************************/
+
+	// What compile() decided, for tests and debugging. False for passes that don't exist.
+	bool culled(const std::string_view passName) const;
+	// Of one of the pass's attachments
+	VkAttachmentStoreOp storeOp(const std::string_view passName, const Resource resource) const;
+	// Of a transient image, 0 if it wasn't created
+	VkImageUsageFlags imageUsage(const Resource resource) const noexcept { return m_resources[resource].imageUsage; }
+	// Recorded before the pass, nullptr if there's no pass by that name
+	const BarrierBatch* barriers(const std::string_view passName) const;
+
+private:
+	/***********************************************************************************/
+	struct UsageInfo {
+		VkPipelineStageFlags stages;
+		VkAccessFlags access;
+		VkImageLayout layout;
+		bool write;
+	};
+	/***********************************************************************************/
+	struct ResourceData {
+		std::string name;
+		bool isImage = false;
+		bool imported = false;
+		ImageDescription description;
+		Usage initialUsage = Usage::None, finalUsage = Usage::None;
+		VkImageUsageFlags imageUsage = 0;
+		// Only ever an attachment of one pass that doesn't load or store it, so it can live in
+		// tile memory and never needs backing (VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT)
+		bool lazy = false;
+
+		VkBuffer buffer = VK_NULL_HANDLE;
+		VkImage image = VK_NULL_HANDLE;
+		VkImageView view = VK_NULL_HANDLE;
+
+		// Kept passes using it, for aliasing and store ops
+		std::size_t firstPass = ~std::size_t(0), lastPass = 0;
+		std::size_t memorySlot = ~std::size_t(0);
+		VkMemoryRequirements memoryRequirements {};
+	};
+	/***********************************************************************************/
+	struct Access {
+		Resource resource;
+		Usage usage;
+		bool read, write; // For culling, a loaded attachment is both
+	};
+	/***********************************************************************************/
+	struct Attachment {
+		Resource resource;
+		VkAttachmentLoadOp loadOp;
+		VkClearValue clear;
+		Usage usage; // ColorAttachment, DepthAttachment or DepthRead
+		Resource resolveSource = InvalidResource; // Set on resolve attachments
+		VkAttachmentStoreOp storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE; // Set by compile()
+	};
+	/***********************************************************************************/
+	struct Pass {
+		std::string name;
+		VkPipelineBindPoint bindPoint;
+		std::vector<Access> accesses;
+		std::vector<Attachment> attachments;
+		bool sideEffects = false;
+		bool culled = false;
+		Execute execute;
+
+		BarrierBatch before;
+		VkRenderPass renderPass = VK_NULL_HANDLE;
+		VkExtent2D extent {};
+	};
+	/***********************************************************************************/
+	// Synchronization state of a resource while walking the passes
+	struct State {
+		VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+		VkPipelineStageFlags writeStages = 0;
+		VkAccessFlags writeAccess = 0;
+		// Stages/accesses that already waited for the last write
+		VkPipelineStageFlags readStages = 0;
+		VkAccessFlags readAccess = 0;
+		// Everything that used it, for whoever gets its memory next
+		VkPipelineStageFlags stages = 0;
+		bool touched = false;
+	};
+	/***********************************************************************************/
+	// Memory shared by transients that are never alive at the same time
+	struct MemorySlot {
+		VkMemoryRequirements requirements {};
+		std::vector<Resource> resources;
+		bool lazy = false;
+		VmaAllocation allocation = VK_NULL_HANDLE;
+		// Dedicated memory when lazily allocated, so its commitment can be queried
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+		bool lazilyAllocated = false; // The device has such memory
+	};
+	/***********************************************************************************/
+
+	static UsageInfo usageInfo(const Usage usage) noexcept;
+	static bool isDepthFormat(const VkFormat format) noexcept;
+	static VkImageAspectFlags aspectMask(const VkFormat format) noexcept;
+
+	const Pass* findPass(const std::string_view name) const;
+	void cullPasses();
+	void createTransients(const VkExtent2D extent);
+	void createRenderPasses(const VkExtent2D extent);
+	void computeBarriers();
+	void addAccess(const std::size_t pass, const Access& access);
+	// Adds the barrier taking the resource from its current state to the usage, if one is needed
+	void transition(BarrierBatch& batch, std::vector<State>& states, const Resource resource, const Usage usage) const;
+	void recordBarriers(const VkCommandBuffer commandBuffer, const BarrierBatch& batch) const;
+	VkFramebuffer framebuffer(const Pass& pass);
+
+	VkDevice m_device = VK_NULL_HANDLE;
+	VmaAllocator m_allocator = VK_NULL_HANDLE;
+
+	std::vector<ResourceData> m_resources;
+	std::vector<Pass> m_passes;
+	std::vector<MemorySlot> m_memorySlots;
+	BarrierBatch m_finalBarriers;
+	// By render pass and attachment views, imported images change from frame to frame
+	std::map<std::pair<VkRenderPass, std::vector<VkImageView>>, VkFramebuffer> m_framebuffers;
+
+	MemoryStats m_memoryStats;
+};
@@ -0,0 +1,192 @@
+#include "ShaderCache.h"
+
+#include "Core/Hash.h"
+#include "Logging/Log.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+#if __has_include(<shaderc/shaderc.hpp>)
+#include <shaderc/shaderc.hpp>
+#define SOL_SHADERC 1
+#ifdef _MSC_VER
+#pragma comment(lib, "shaderc_combined.lib")
+#endif
+#endif
+
+namespace {
+	// Bump when the compile options change so stale binaries aren't picked up
+	constexpr std::uint64_t CacheVersion = 1;
+
+	/***********************************************************************************/
+	bool readFile(const std::string& path, std::string& contents) {
+		std::ifstream file(path, std::ios::binary);
+		if (!file) {
+			return false;
+		}
+
+		std::ostringstream stream;
+		stream << file.rdbuf();
+		contents = stream.str();
+
+		return true;
+	}
+}
+
+/***********************************************************************************/
+ShaderCache::ShaderCache(std::string directory) : m_directory(std::move(directory)) {
+}
+
+/***********************************************************************************/
+bool ShaderCache::canCompile() noexcept {
+#ifdef SOL_SHADERC
+	return true;
+#else
+	return false;
+#endif
+}
+
+/***********************************************************************************/
+std::uint64_t ShaderCache::variantKey(const std::string& source, Defines defines) {
+	std::sort(defines.begin(), defines.end());
+
+	auto key = Hash::fnv1a(&CacheVersion, sizeof(CacheVersion));
+	key = Hash::fnv1a(source.data(), source.size(), key);
+	for (const auto& define : defines) {
+		// Include the terminator so {"AB"} and {"A", "B"} differ
+		key = Hash::fnv1a(define.c_str(), define.size() + 1, key);
+	}
+	return key;
+}
+
+/***********************************************************************************/
+std::vector<char> ShaderCache::get(const std::string& sourcePath, const Defines& defines) {
+	return load(sourcePath, defines);
+}
+
+/***********************************************************************************/
+void ShaderCache::recompile(const std::string& sourcePath) {
+	std::vector<Defines> variants;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		const auto it = m_variants.find(sourcePath);
+		if (it != m_variants.end()) {
+			variants = it->second;
+		}
+	}
+
+	// The new source hashes differently, so this compiles (or finds an earlier identical version)
+	for (const auto& defines : variants) {
+		load(sourcePath, defines);
+	}
+}
+
+/***********************************************************************************/
+std::vector<char> ShaderCache::load(const std::string& sourcePath, Defines defines) {
+	std::sort(defines.begin(), defines.end());
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto& variants = m_variants[sourcePath];
+		if (std::find(variants.begin(), variants.end(), defines) == variants.end()) {
+			variants.push_back(defines);
+		}
+	}
+
+	std::string source;
+	if (!readFile(sourcePath, source)) {
+		spdlog::get("console")->error("Failed to read shader {}.", sourcePath);
+		return {};
+	}
+
+	const auto path = cachePath(sourcePath, variantKey(source, defines));
+
+	std::string cached;
+	if (readFile(path, cached) && !cached.empty() && cached.size() % sizeof(std::uint32_t) == 0) {
+		return std::vector<char>(cached.begin(), cached.end());
+	}
+
+	auto code = compile(sourcePath, source, defines);
+	if (code.empty()) {
+		return code;
+	}
+
+	// Write next to the final name and rename, so a concurrent reader never sees half a file
+	std::error_code error;
+	std::filesystem::create_directories(m_directory, error);
+
+	const auto temporaryPath = path + ".tmp";
+	{
+		std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+		file.write(code.data(), static_cast<std::streamsize>(code.size()));
+	}
+	std::filesystem::rename(temporaryPath, path, error);
+	if (error) {
+		spdlog::get("console")->error("Failed to write shader cache {}: {}", path, error.message());
+	}
+
+	return code;
+}
+
+/***********************************************************************************/
+std::string ShaderCache::cachePath(const std::string& sourcePath, const std::uint64_t key) const {
+	char name[17];
+	std::snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(key));
+
+	// basic.vert -> <directory>/basic.vert.<key>.spv
+	return m_directory + '/' + std::filesystem::path(sourcePath).filename().string() + '.' + name + ".spv";
+}
+
+/***********************************************************************************/
+std::vector<char> ShaderCache::compile(const std::string& sourcePath, const std::string& source, const Defines& defines) {
+#ifdef SOL_SHADERC
+	const auto extension = std::filesystem::path(sourcePath).extension().string();
+
+	shaderc_shader_kind kind;
+	if (extension == ".vert") {
+		kind = shaderc_glsl_vertex_shader;
+	}
+	else if (extension == ".frag") {
+		kind = shaderc_glsl_fragment_shader;
+	}
+	else if (extension == ".comp") {
+		kind = shaderc_glsl_compute_shader;
+	}
+	else {
+		spdlog::get("console")->error("Unknown shader stage for {}.", sourcePath);
+		return {};
+	}
+
+	shaderc::CompileOptions options;
+	for (const auto& define : defines) {
+		const auto equals = define.find('=');
+		if (equals == std::string::npos) {
+			options.AddMacroDefinition(define);
+		}
+		else {
+			options.AddMacroDefinition(define.substr(0, equals), define.substr(equals + 1));
+		}
+	}
+
+	// One compiler per call: shaderc::Compiler isn't meant to be shared between threads
+	shaderc::Compiler compiler;
+	const auto result = compiler.CompileGlslToSpv(source, kind, sourcePath.c_str(), options);
+	if (result.GetCompilationStatus() != shaderc_compilation_status_success) {
+		spdlog::get("console")->error("Failed to compile {}:\n{}", sourcePath, result.GetErrorMessage());
+		return {};
+	}
+
+	const auto* begin = reinterpret_cast<const char*>(result.cbegin());
+	const auto* end = reinterpret_cast<const char*>(result.cend());
+	return std::vector<char>(begin, end);
+#else
+	// Callers fall back to the precompiled SPIR-V
+	static_cast<void>(sourcePath);
+	static_cast<void>(source);
+	static_cast<void>(defines);
+	return {};
+#endif
+}
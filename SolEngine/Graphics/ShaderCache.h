@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Compiles GLSL to SPIR-V at runtime (shaderc, when the Vulkan SDK provides it) and keeps the
+// results on disk, keyed by a hash of the source text and the #defines. A cache hit only reads
+// the .spv file, so a warm start never compiles. Without shaderc only cached variants are available.
+class ShaderCache {
+
+public:
+	// "NAME" or "NAME=VALUE"
+	using Defines = std::vector<std::string>;
+
+	explicit ShaderCache(std::string directory = "Data/Shaders/Cache");
+
+	// Whether this build links the compiler
+	static bool canCompile() noexcept;
+
+	// Names the cached binary: the source text and the defines, in any order
+	static std::uint64_t variantKey(const std::string& source, Defines defines);
+
+	// SPIR-V for the source + defines, from the disk cache or compiled now. Empty on failure.
+	// The stage comes from the extension (.vert, .frag, .comp). Safe to call from the pipeline workers.
+	std::vector<char> get(const std::string& sourcePath, const Defines& defines = {});
+	// Compiles every variant of the source requested so far, after the source changed.
+	void recompile(const std::string& sourcePath);
+
+private:
+	std::vector<char> load(const std::string& sourcePath, Defines defines);
+	std::string cachePath(const std::string& sourcePath, const std::uint64_t key) const;
+	static std::vector<char> compile(const std::string& sourcePath, const std::string& source, const Defines& defines);
+
+	std::string m_directory;
+
+	std::mutex m_mutex;
+	// Every define set each source was requested with, for recompile()
+	std::unordered_map<std::string, std::vector<Defines>> m_variants;
+};
@@ -0,0 +1,489 @@
+#include "ShaderReflection.h"
+
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+
+namespace {
+	constexpr std::uint32_t SpirvMagic = 0x07230203;
+	constexpr std::size_t HeaderWords = 5;
+
+	// The subset of the SPIR-V spec this reads
+	enum Op : std::uint32_t {
+		OpEntryPoint = 15,
+		OpTypeBool = 20,
+		OpTypeInt = 21,
+		OpTypeFloat = 22,
+		OpTypeVector = 23,
+		OpTypeMatrix = 24,
+		OpTypeImage = 25,
+		OpTypeSampler = 26,
+		OpTypeSampledImage = 27,
+		OpTypeArray = 28,
+		OpTypeRuntimeArray = 29,
+		OpTypeStruct = 30,
+		OpTypePointer = 32,
+		OpConstant = 43,
+		OpVariable = 59,
+		OpDecorate = 71,
+		OpMemberDecorate = 72
+	};
+
+	enum Decoration : std::uint32_t {
+		DecorationBlock = 2,
+		DecorationBufferBlock = 3,
+		DecorationArrayStride = 6,
+		DecorationMatrixStride = 7,
+		DecorationBuiltIn = 11,
+		DecorationLocation = 30,
+		DecorationBinding = 33,
+		DecorationDescriptorSet = 34,
+		DecorationOffset = 35
+	};
+
+	enum StorageClass : std::uint32_t {
+		StorageClassUniformConstant = 0,
+		StorageClassInput = 1,
+		StorageClassUniform = 2,
+		StorageClassPushConstant = 9,
+		StorageClassStorageBuffer = 12
+	};
+
+	enum ExecutionModel : std::uint32_t {
+		ExecutionModelVertex = 0,
+		ExecutionModelTessellationControl = 1,
+		ExecutionModelTessellationEvaluation = 2,
+		ExecutionModelGeometry = 3,
+		ExecutionModelFragment = 4,
+		ExecutionModelGLCompute = 5
+	};
+
+	constexpr std::uint32_t DimBuffer = 5;
+	constexpr std::uint32_t DimSubpassData = 6;
+
+	// Universal limit on struct members, anything past it is a corrupt module
+	constexpr std::uint32_t MaxStructMembers = 16383;
+	// Types nest far less than this, deeper chains are corrupt or cyclic
+	constexpr std::uint32_t MaxTypeDepth = 32;
+
+	/***********************************************************************************/
+	// Operands (words after the opcode) the spec requires of the instructions read here, so they can be indexed
+	std::uint32_t minimumOperands(const std::uint32_t op) {
+		switch (op) {
+		case OpEntryPoint: return 3; // Execution model, function, name
+		case OpTypeBool: return 1;
+		case OpTypeInt: return 3; // Result, width, signedness
+		case OpTypeFloat: return 2;
+		case OpTypeVector: return 3; // Result, component type, count
+		case OpTypeMatrix: return 3;
+		case OpTypeImage: return 8; // Result, sampled type, dim, depth, arrayed, multisampled, sampled, format
+		case OpTypeSampler: return 1;
+		case OpTypeSampledImage: return 2;
+		case OpTypeArray: return 3; // Result, element type, length
+		case OpTypeRuntimeArray: return 2;
+		case OpTypeStruct: return 1;
+		case OpTypePointer: return 3; // Result, storage class, type
+		case OpConstant: return 3; // Result type, result, value
+		case OpVariable: return 3; // Result type, result, storage class
+		case OpDecorate: return 2; // Target, decoration
+		case OpMemberDecorate: return 3; // Struct, member, decoration
+		default: return 0;
+		}
+	}
+
+	/***********************************************************************************/
+	struct Decorations {
+		std::uint32_t set = 0, binding = 0, location = 0, arrayStride = 0;
+		bool hasBinding = false, hasLocation = false, builtIn = false, block = false, bufferBlock = false;
+	};
+	/***********************************************************************************/
+	struct MemberDecorations {
+		std::uint32_t offset = 0, matrixStride = 0;
+		bool builtIn = false;
+	};
+	/***********************************************************************************/
+	struct Variable {
+		std::uint32_t id, pointerType, storageClass;
+	};
+	/***********************************************************************************/
+	struct Module {
+		// Operands after the result id, by result id
+		std::unordered_map<std::uint32_t, std::pair<std::uint32_t, std::vector<std::uint32_t>>> types;
+		std::unordered_map<std::uint32_t, std::uint32_t> constants;
+		std::unordered_map<std::uint32_t, Decorations> decorations;
+		std::unordered_map<std::uint32_t, std::vector<MemberDecorations>> members;
+		std::vector<Variable> variables;
+		VkShaderStageFlags stage = 0;
+
+		/***********************************************************************************/
+		const std::pair<std::uint32_t, std::vector<std::uint32_t>>* type(const std::uint32_t id) const {
+			const auto it = types.find(id);
+			return it != types.end() ? &it->second : nullptr;
+		}
+
+		/***********************************************************************************/
+		Decorations decoration(const std::uint32_t id) const {
+			const auto it = decorations.find(id);
+			return it != decorations.end() ? it->second : Decorations();
+		}
+
+		/***********************************************************************************/
+		MemberDecorations memberDecoration(const std::uint32_t structId, const std::size_t member) const {
+			const auto it = members.find(structId);
+			return it != members.end() && member < it->second.size() ? it->second[member] : MemberDecorations();
+		}
+
+		/***********************************************************************************/
+		// Byte size of a type laid out with its explicit offsets/strides (push constant blocks)
+		std::uint32_t size(const std::uint32_t id, const std::uint32_t matrixStride = 0, const std::uint32_t depth = 0) const {
+			const auto* t = type(id);
+			if (!t || depth > MaxTypeDepth) {
+				return 0;
+			}
+
+			const auto& [op, operands] = *t;
+			switch (op) {
+			case OpTypeBool:
+				return 4;
+			case OpTypeInt:
+			case OpTypeFloat:
+				return operands[0] / 8;
+			case OpTypeVector:
+				return size(operands[0], 0, depth + 1) * operands[1];
+			case OpTypeMatrix:
+				return (matrixStride > 0 ? matrixStride : size(operands[0], 0, depth + 1)) * operands[1];
+			case OpTypeArray: {
+				const auto stride = decoration(id).arrayStride;
+				const auto length = constants.count(operands[1]) ? constants.at(operands[1]) : 0;
+				return (stride > 0 ? stride : size(operands[0], matrixStride, depth + 1)) * length;
+			}
+			case OpTypeStruct: {
+				std::uint32_t end = 0;
+				for (std::size_t i = 0; i < operands.size(); ++i) {
+					const auto member = memberDecoration(id, i);
+					end = std::max(end, member.offset + size(operands[i], member.matrixStride, depth + 1));
+				}
+				return end;
+			}
+			default:
+				return 0;
+			}
+		}
+	};
+	/***********************************************************************************/
+
+	/***********************************************************************************/
+	VkShaderStageFlags stageOf(const std::uint32_t executionModel) {
+		switch (executionModel) {
+		case ExecutionModelVertex: return VK_SHADER_STAGE_VERTEX_BIT;
+		case ExecutionModelTessellationControl: return VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT;
+		case ExecutionModelTessellationEvaluation: return VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT;
+		case ExecutionModelGeometry: return VK_SHADER_STAGE_GEOMETRY_BIT;
+		case ExecutionModelFragment: return VK_SHADER_STAGE_FRAGMENT_BIT;
+		case ExecutionModelGLCompute: return VK_SHADER_STAGE_COMPUTE_BIT;
+		default: return 0;
+		}
+	}
+
+	/***********************************************************************************/
+	bool descriptorType(const Module& module, const Variable& variable, std::uint32_t typeId, VkDescriptorType& type, std::uint32_t& count) {
+		count = 1;
+
+		// Arrays of descriptors, runtime-sized ones count as one
+		auto depth = 0u;
+		for (auto* t = module.type(typeId); t && (t->first == OpTypeArray || t->first == OpTypeRuntimeArray); t = module.type(typeId)) {
+			if (++depth > MaxTypeDepth) {
+				return false;
+			}
+			if (t->first == OpTypeArray) {
+				const auto length = module.constants.find(t->second[1]);
+				count *= length != module.constants.end() ? length->second : 1;
+			}
+			typeId = t->second[0];
+		}
+
+		const auto* t = module.type(typeId);
+		if (!t) {
+			return false;
+		}
+
+		const auto& [op, operands] = *t;
+		switch (variable.storageClass) {
+		case StorageClassUniform:
+			type = module.decoration(typeId).bufferBlock ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+			return true;
+		case StorageClassStorageBuffer:
+			type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			return true;
+		case StorageClassUniformConstant:
+			if (op == OpTypeSampledImage) {
+				type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+				return true;
+			}
+			if (op == OpTypeSampler) {
+				type = VK_DESCRIPTOR_TYPE_SAMPLER;
+				return true;
+			}
+			if (op == OpTypeImage) {
+				// operands: sampled type, dim, depth, arrayed, multisampled, sampled (1 = with a sampler, 2 = storage)
+				const auto dim = operands[1];
+				const auto storage = operands[5] == 2;
+				if (dim == DimSubpassData) {
+					type = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+				}
+				else if (dim == DimBuffer) {
+					type = storage ? VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+				}
+				else {
+					type = storage ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+				}
+				return true;
+			}
+			return false;
+		default:
+			return false;
+		}
+	}
+}
+
+/***********************************************************************************/
+ShaderReflection ShaderReflection::reflect(const std::vector<char>& code) {
+	ShaderReflection reflection;
+
+	if (code.size() % sizeof(std::uint32_t) != 0 || code.size() < HeaderWords * sizeof(std::uint32_t)) {
+		return reflection;
+	}
+
+	std::vector<std::uint32_t> words(code.size() / sizeof(std::uint32_t));
+	std::memcpy(words.data(), code.data(), code.size());
+	if (words[0] != SpirvMagic) {
+		return reflection;
+	}
+
+	Module module;
+	for (std::size_t i = HeaderWords; i < words.size();) {
+		const auto wordCount = words[i] >> 16;
+		const auto op = words[i] & 0xFFFF;
+		if (wordCount == 0 || i + wordCount > words.size()) {
+			return ShaderReflection();
+		}
+
+		const auto* operands = &words[i + 1];
+		const auto operandCount = wordCount - 1;
+		if (operandCount < minimumOperands(op)) {
+			return ShaderReflection();
+		}
+
+		switch (op) {
+		case OpEntryPoint:
+			module.stage = module.stage ? module.stage : stageOf(operands[0]);
+			break;
+		case OpTypeBool:
+		case OpTypeInt:
+		case OpTypeFloat:
+		case OpTypeVector:
+		case OpTypeMatrix:
+		case OpTypeImage:
+		case OpTypeSampler:
+		case OpTypeSampledImage:
+		case OpTypeArray:
+		case OpTypeRuntimeArray:
+		case OpTypeStruct:
+		case OpTypePointer:
+			module.types[operands[0]] = { op, std::vector<std::uint32_t>(operands + 1, operands + operandCount) };
+			break;
+		case OpConstant:
+			module.constants[operands[1]] = operands[2];
+			break;
+		case OpVariable:
+			module.variables.push_back({ operands[1], operands[0], operands[2] });
+			break;
+		case OpDecorate: {
+			auto& decoration = module.decorations[operands[0]];
+			const auto value = operandCount >= 3 ? operands[2] : 0;
+			switch (operands[1]) {
+			case DecorationBlock: decoration.block = true; break;
+			case DecorationBufferBlock: decoration.bufferBlock = true; break;
+			case DecorationArrayStride: decoration.arrayStride = value; break;
+			case DecorationBuiltIn: decoration.builtIn = true; break;
+			case DecorationLocation: decoration.location = value; decoration.hasLocation = true; break;
+			case DecorationBinding: decoration.binding = value; decoration.hasBinding = true; break;
+			case DecorationDescriptorSet: decoration.set = value; break;
+			default: break;
+			}
+			break;
+		}
+		case OpMemberDecorate: {
+			if (operands[1] >= MaxStructMembers) {
+				return ShaderReflection();
+			}
+
+			auto& members = module.members[operands[0]];
+			if (members.size() <= operands[1]) {
+				members.resize(operands[1] + 1);
+			}
+			auto& member = members[operands[1]];
+			const auto value = operandCount >= 4 ? operands[3] : 0;
+			switch (operands[2]) {
+			case DecorationOffset: member.offset = value; break;
+			case DecorationMatrixStride: member.matrixStride = value; break;
+			case DecorationBuiltIn: member.builtIn = true; break;
+			default: break;
+			}
+			break;
+		}
+		default:
+			break;
+		}
+
+		i += wordCount;
+	}
+
+	reflection.stages = module.stage;
+
+	for (const auto& variable : module.variables) {
+		const auto* pointer = module.type(variable.pointerType);
+		if (!pointer || pointer->first != OpTypePointer) {
+			continue;
+		}
+		const auto typeId = pointer->second[1];
+		const auto decoration = module.decoration(variable.id);
+
+		if (variable.storageClass == StorageClassPushConstant) {
+			reflection.pushConstants.stageFlags = module.stage;
+			reflection.pushConstants.offset = 0;
+			reflection.pushConstants.size = module.size(typeId);
+			continue;
+		}
+
+		if (variable.storageClass == StorageClassInput) {
+			const auto* t = module.type(typeId);
+			if (module.stage != VK_SHADER_STAGE_VERTEX_BIT || decoration.builtIn || !decoration.hasLocation || !t) {
+				continue;
+			}
+
+			auto componentCount = 1u;
+			if (t->first == OpTypeVector) {
+				componentCount = t->second[1];
+				t = module.type(t->second[0]);
+			}
+			if (!t || (t->first != OpTypeFloat && t->first != OpTypeInt)) {
+				continue;
+			}
+
+			const auto numericType = t->first == OpTypeFloat ? NumericType::Float : (t->second[1] ? NumericType::SInt : NumericType::UInt);
+			reflection.inputs.push_back({ decoration.location, numericType, componentCount });
+			continue;
+		}
+
+		VkDescriptorType type;
+		std::uint32_t count;
+		if (decoration.hasBinding && descriptorType(module, variable, typeId, type, count)) {
+			reflection.bindings.push_back({ decoration.set, decoration.binding, type, count, module.stage });
+		}
+	}
+
+	std::sort(reflection.bindings.begin(), reflection.bindings.end(), [](const Binding& a, const Binding& b) {
+		return a.set != b.set ? a.set < b.set : a.binding < b.binding;
+	});
+	std::sort(reflection.inputs.begin(), reflection.inputs.end(), [](const Input& a, const Input& b) {
+		return a.location < b.location;
+	});
+
+	return reflection;
+}
+
+/***********************************************************************************/
+void ShaderReflection::merge(const ShaderReflection& other) {
+	stages |= other.stages;
+
+	for (const auto& binding : other.bindings) {
+		const auto it = std::find_if(bindings.begin(), bindings.end(), [&binding](const Binding& existing) {
+			return existing.set == binding.set && existing.binding == binding.binding;
+		});
+
+		if (it != bindings.end()) {
+			it->stages |= binding.stages;
+			it->count = std::max(it->count, binding.count);
+		}
+		else {
+			bindings.push_back(binding);
+		}
+	}
+	std::sort(bindings.begin(), bindings.end(), [](const Binding& a, const Binding& b) {
+		return a.set != b.set ? a.set < b.set : a.binding < b.binding;
+	});
+
+	// One range covering every stage's block, they all use offset 0
+	if (other.pushConstants.size > 0) {
+		pushConstants.stageFlags |= other.pushConstants.stageFlags;
+		pushConstants.size = std::max(pushConstants.size, other.pushConstants.size);
+	}
+
+	if (inputs.empty()) {
+		inputs = other.inputs;
+	}
+}
+
+/***********************************************************************************/
+const ShaderReflection::Binding* ShaderReflection::findBinding(const std::uint32_t set, const std::uint32_t binding) const noexcept {
+	const auto it = std::find_if(bindings.begin(), bindings.end(), [set, binding](const Binding& existing) {
+		return existing.set == set && existing.binding == binding;
+	});
+	return it != bindings.end() ? &*it : nullptr;
+}
+
+/***********************************************************************************/
+std::vector<VkDescriptorSetLayoutBinding> ShaderReflection::setBindings(const std::uint32_t set) const {
+	std::vector<VkDescriptorSetLayoutBinding> result;
+
+	for (const auto& binding : bindings) {
+		if (binding.set == set) {
+			result.push_back({ binding.binding, binding.type, binding.count, binding.stages, nullptr });
+		}
+	}
+
+	return result;
+}
+
+/***********************************************************************************/
+std::uint32_t ShaderReflection::setCount() const noexcept {
+	return bindings.empty() ? 0 : bindings.back().set + 1;
+}
+
+/***********************************************************************************/
+bool ShaderReflection::compatible(const VkFormat format, const Input& input) noexcept {
+	auto formatType = NumericType::Float;
+
+	switch (format) {
+	case VK_FORMAT_R8_UINT:
+	case VK_FORMAT_R8G8_UINT:
+	case VK_FORMAT_R8G8B8A8_UINT:
+	case VK_FORMAT_R16_UINT:
+	case VK_FORMAT_R16G16_UINT:
+	case VK_FORMAT_R16G16B16A16_UINT:
+	case VK_FORMAT_R32_UINT:
+	case VK_FORMAT_R32G32_UINT:
+	case VK_FORMAT_R32G32B32_UINT:
+	case VK_FORMAT_R32G32B32A32_UINT:
+		formatType = NumericType::UInt;
+		break;
+	case VK_FORMAT_R8_SINT:
+	case VK_FORMAT_R8G8_SINT:
+	case VK_FORMAT_R8G8B8A8_SINT:
+	case VK_FORMAT_R16_SINT:
+	case VK_FORMAT_R16G16_SINT:
+	case VK_FORMAT_R16G16B16A16_SINT:
+	case VK_FORMAT_R32_SINT:
+	case VK_FORMAT_R32G32_SINT:
+	case VK_FORMAT_R32G32B32_SINT:
+	case VK_FORMAT_R32G32B32A32_SINT:
+		formatType = NumericType::SInt;
+		break;
+	default:
+		break;
+	}
+
+	// Missing components are filled in by the vertex fetch, so only the numeric type has to match
+	return formatType == input.type;
+}
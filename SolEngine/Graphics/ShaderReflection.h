@@ -0,0 +1,49 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <vector>
+
+// What a SPIR-V module expects from its pipeline: descriptor bindings, the push constant block and
+// vertex inputs. Read from decorations and types only, layouts are built from it (see LayoutCache).
+struct ShaderReflection {
+	enum class NumericType { Float, SInt, UInt };
+
+	/***********************************************************************************/
+	struct Binding {
+		std::uint32_t set;
+		std::uint32_t binding;
+		VkDescriptorType type;
+		std::uint32_t count; // Array size, 1 for single descriptors
+		VkShaderStageFlags stages;
+	};
+	/***********************************************************************************/
+	struct Input {
+		std::uint32_t location;
+		NumericType type;
+		std::uint32_t componentCount;
+	};
+	/***********************************************************************************/
+
+	// stages is 0 when the code isn't SPIR-V
+	static ShaderReflection reflect(const std::vector<char>& code);
+
+	// Adds another stage of the same pipeline: bindings are unioned (shared ones get both stages),
+	// push constant ranges widened, vertex inputs kept from whichever stage has them.
+	void merge(const ShaderReflection& other);
+
+	// nullptr if the stages don't declare it
+	const Binding* findBinding(const std::uint32_t set, const std::uint32_t binding) const noexcept;
+	// Bindings of one set, for VkDescriptorSetLayoutCreateInfo
+	std::vector<VkDescriptorSetLayoutBinding> setBindings(const std::uint32_t set) const;
+	// Highest set index used + 1
+	std::uint32_t setCount() const noexcept;
+	// Whether a vertex attribute of this format feeds the input (UNORM/SNORM/SFLOAT read as float, etc.)
+	static bool compatible(const VkFormat format, const Input& input) noexcept;
+
+	VkShaderStageFlags stages = 0;
+	std::vector<Binding> bindings; // Sorted by set, then binding
+	VkPushConstantRange pushConstants {}; // size 0 without a push constant block
+	std::vector<Input> inputs; // Vertex stage only, sorted by location
+};
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "Core/Hash.h"
+#include "ShaderCache.h"
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+
+// One permutation of basic.vert/basic.frag. Meshes with equal variants share a pipeline.
+// Features that change the shader interface are #defines (a separate SPIR-V per combination),
+// plain values are specialization constants (same SPIR-V, folded by the driver when the pipeline
+// is created). Either way a disabled feature leaves no work in the shader.
+struct ShaderVariant {
+	// #define TEXTURED: sample the base color texture, otherwise white
+	bool textured = true;
+
+	// Specialization constants of basic.frag (constant_id 0 and 1)
+	// Lambert lighting from a fixed direction plus the clustered point lights, otherwise unlit
+	VkBool32 lit = VK_FALSE;
+	// Light reaching faces turned away from the light
+	float ambient = 0.2f;
+
+	// Only the #defines, the SPIR-V is shared by variants that differ in constants
+	ShaderCache::Defines defines() const {
+		ShaderCache::Defines result;
+		if (textured) {
+			result.push_back("TEXTURED");
+		}
+#ifdef SOL_FULL_PRECISION_VERTICES
+		result.push_back("FULL_PRECISION_VERTICES");
+#endif
+		return result;
+	}
+
+	// compile.bat's SPIR-V for these #defines, used when the shader cache has no compiler and no cached copy
+	const char* precompiledVertex() const noexcept {
+#ifdef SOL_FULL_PRECISION_VERTICES
+		return "Data/Shaders/vert_full_precision.spv";
+#else
+		return "Data/Shaders/vert.spv";
+#endif
+	}
+	const char* precompiledFragment() const noexcept { return textured ? "Data/Shaders/frag.spv" : "Data/Shaders/frag_untextured.spv"; }
+
+	bool operator==(const ShaderVariant& other) const noexcept {
+		return textured == other.textured && lit == other.lit && ambient == other.ambient;
+	}
+	bool operator!=(const ShaderVariant& other) const noexcept { return !(*this == other); }
+
+	// Field by field, so padding never leaks in and the value is the same on every run
+	std::uint64_t hash(const std::uint64_t seed = Hash::FnvOffsetBasis) const noexcept {
+		auto result = Hash::fnv1a(&textured, sizeof(textured), seed);
+		result = Hash::fnv1a(&lit, sizeof(lit), result);
+		return Hash::fnv1a(&ambient, sizeof(ambient), result);
+	}
+
+	/***********************************************************************************/
+	struct Hasher {
+		std::size_t operator()(const ShaderVariant& variant) const noexcept { return static_cast<std::size_t>(variant.hash()); }
+	};
+	/***********************************************************************************/
+};
+
+// Layout of the specialization data handed to basic.frag
+struct ShaderVariantConstants {
+	VkBool32 lit;
+	float ambient;
+};
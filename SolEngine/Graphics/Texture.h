@@ -2,6 +2,8 @@
 
 #include <vk_mem_alloc.h>
 
+#include <memory>
+#include <string>
 #include <string_view>
 
 // Wrapper around the Vulkan objects required to create 
@@ -12,10 +14,16 @@ struct Texture {
 	void init(const VkDevice device);
 	void destroy(const VkDevice device);
 
-	const std::string_view path;
+	const std::string path;
 	int width, height, numChannels;
 
-	VkImage image;
-	VmaAllocation imageAllocation;
-	VkImageView imageView;
+	// VK_NULL_HANDLE until the render system uploads it
+	VkImage image = VK_NULL_HANDLE;
+	VmaAllocation imageAllocation = VK_NULL_HANDLE;
+	VkImageView imageView = VK_NULL_HANDLE;
+	// Element of the forward pass's texture array, assigned on upload
+	std::uint32_t descriptorIndex = 0;
 };
+
+// Meshes loaded through the AssetCache share one Texture per unique image
+using TexturePtr = std::shared_ptr<Texture>;
@@ -1,6 +1,6 @@
 #pragma once
 
-#include <vulkan/vulkan.h>
+#include "VertexLayout.h"
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
@@ -9,66 +9,63 @@
 #include <glm/gtx/hash.hpp>
 
 #include <array>
+#include <cstddef>
 #include <vector>
 
-// Describes a vertex in Vulkan
+// Full-precision vertex, as loaded from disk and used for CPU-side processing
 struct Vertex {
-	Vertex(const glm::vec3& position, const glm::vec3& col, const glm::vec2& texcoords) : pos(position), color(col), texCoord(texcoords) {}
+	Vertex(const glm::vec3& position, const glm::vec3& norm, const glm::vec2& texcoords) : pos(position), normal(norm), texCoord(texcoords) {}
 
 	auto operator==(const Vertex& rhs) const {
-		return pos == rhs.pos && color == rhs.color && texCoord == rhs.texCoord;
+		return pos == rhs.pos && normal == rhs.normal && texCoord == rhs.texCoord;
 	}
 
-#ifdef VULKAN_H_
-	
-	// Describes at which rate to load data from memory
-	static auto getBindingDescription() {
-		VkVertexInputBindingDescription bindingDescription {};
-		
-		bindingDescription.binding = 0;
-		bindingDescription.stride = sizeof(Vertex);
-		bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-
-		return bindingDescription;
-	}
-
-	// How to extract a vertex attribute from a chunk of vertex data
-	static auto getAttributeDescriptions() {
-		std::array<VkVertexInputAttributeDescription, 3> attributeDescriptions {};
-
-		// Position
-		attributeDescriptions[0].binding = 0;
-		attributeDescriptions[0].location = 0;
-		attributeDescriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
-		attributeDescriptions[0].offset = offsetof(Vertex, pos);
-
-		// Color
-		attributeDescriptions[1].binding = 0;
-		attributeDescriptions[1].location = 1;
-		attributeDescriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
-		attributeDescriptions[1].offset = offsetof(Vertex, color);
-
-		// TexCoords
-		attributeDescriptions[2].binding = 0;
-		attributeDescriptions[2].location = 2;
-		attributeDescriptions[2].format = VK_FORMAT_R32G32_SFLOAT;
-		attributeDescriptions[2].offset = offsetof(Vertex, texCoord);
-
-		return attributeDescriptions;
-	}
-#endif
-
 	glm::vec3 pos;
-	glm::vec3 color;
+	glm::vec3 normal;
 	glm::vec2 texCoord;
 };
 
+template<>
+struct VertexAttributes<Vertex> {
+	static constexpr std::array<VertexAttribute, 3> value {{
+		{ VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, pos) },
+		{ VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, normal) },
+		{ VK_FORMAT_R32G32_SFLOAT, offsetof(Vertex, texCoord) }
+	}};
+};
+
+// Quantized vertex, 16 bytes instead of 32. Position is normalized to the mesh's AABB
+// (decoded with ObjectData::positionScale/positionOffset), the normal is octahedral-encoded
+// and texture coordinates are half floats.
+struct PackedVertex {
+	std::int16_t position[4]; // w is padding
+	std::int16_t normal[2];
+	std::uint16_t texCoord[2];
+};
+
+template<>
+struct VertexAttributes<PackedVertex> {
+	static constexpr std::array<VertexAttribute, 3> value {{
+		{ VK_FORMAT_R16G16B16A16_SNORM, offsetof(PackedVertex, position) },
+		{ VK_FORMAT_R16G16_SNORM, offsetof(PackedVertex, normal) },
+		{ VK_FORMAT_R16G16_SFLOAT, offsetof(PackedVertex, texCoord) }
+	}};
+};
+
+// Vertex format uploaded to the GPU. Defining SOL_FULL_PRECISION_VERTICES uploads Vertex as-is;
+// basic.vert then has to be compiled with -DFULL_PRECISION_VERTICES to match.
+#ifdef SOL_FULL_PRECISION_VERTICES
+using GpuVertex = Vertex;
+#else
+using GpuVertex = PackedVertex;
+#endif
+
 namespace std {
 	template<> 
 	struct hash<Vertex> {
 		auto operator()(Vertex const& vertex) const {
 			return ((hash<glm::vec3>()(vertex.pos) ^
-				(hash<glm::vec3>()(vertex.color) << 1)) >> 1) ^
+				(hash<glm::vec3>()(vertex.normal) << 1)) >> 1) ^
 				(hash<glm::vec2>()(vertex.texCoord) << 1);
 		}
 	};
@@ -76,7 +73,72 @@ namespace std {
 
 // Temp junk
 struct UniformBufferObject {
-	glm::mat4 model;
 	glm::mat4 view;
 	glm::mat4 proj;
+	glm::mat4 previousViewProjection; // What the Hi-Z pyramid cull.comp tests against was rendered with
+	// Light clusters (see light_cull.comp): counts along x, y and depth, w is the number of lights
+	glm::uvec4 clusterCount;
+	// Clusters per pixel (xy). The depth slice of a view depth is log(depth) * z + w.
+	glm::vec4 clusterScale;
+};
+
+// Per-object data read by the culling compute shader and by basic.vert (see DrawPushConstants).
+// Layout must match ObjectData in cull.comp / basic.vert (std430).
+struct ObjectData {
+	glm::mat4 model;
+	glm::vec4 boundingSphere; // Object-space center (xyz) + radius (w)
+	glm::vec4 positionScale; // Dequantization: position = packed * scale + offset
+	glm::vec4 positionOffset;
+	// LOD table (Mesh::MaxLods entries), firstIndex is absolute in the index buffer
+	glm::uvec4 lodFirstIndex;
+	glm::uvec4 lodIndexCount;
+	glm::vec4 lodError;
+	std::uint32_t lodCount;
+	std::int32_t vertexOffset;
+	// Range of MeshletData used when LOD 0 is selected, meshletCount = 0 draws the whole LOD instead
+	std::uint32_t meshletOffset;
+	std::uint32_t meshletCount;
+	// Element of basic.frag's texture array, see Texture::descriptorIndex
+	std::uint32_t textureIndex;
+	std::uint32_t padding[3]; // std430 rounds the struct up to a multiple of its 16 byte alignment
+};
+
+// Per-meshlet data read by cluster_cull.comp. Layout must match MeshletData there (std430).
+struct MeshletData {
+	glm::vec4 boundingSphere; // Object-space center (xyz) + radius (w)
+	glm::vec4 cone; // Object-space axis (xyz) + cutoff (w), see Meshlet
+	std::uint32_t objectIndex;
+	std::uint32_t firstIndex; // Absolute in the index buffer
+	std::uint32_t indexCount;
+	std::int32_t vertexOffset;
+};
+
+// Point light read by light_cull.comp and basic.frag. Layout must match LightData there (std430).
+struct LightData {
+	glm::vec4 positionRadius; // View-space position (xyz) + range (w)
+	glm::vec4 color; // Color times intensity (rgb), w unused
+};
+
+// Push constants for basic.vert
+struct DrawPushConstants {
+	std::uint32_t objectIndex; // Added to gl_InstanceIndex, 0 for indirect draws
+};
+
+// Push constants for cull.comp and cluster_cull.comp
+struct CullPushConstants {
+	std::array<glm::vec4, 6> frustumPlanes;
+	glm::vec3 cameraPosition;
+	float lodScale; // Pixels covered by one world-space unit at distance 1, divided by the allowed pixel error
+	std::uint32_t objectCount;
+	std::uint32_t meshletCount;
+	// Width | height << 16 of the depth buffer the Hi-Z pyramid was built from, 0 to skip occlusion culling.
+	// Packed to stay within the 128 bytes of push constants every device has.
+	std::uint32_t depthSize;
+};
+
+// Push constants for hiz_build.comp
+struct HiZPushConstants {
+	glm::ivec2 sourceSize;
+	glm::ivec2 destinationSize;
+	std::int32_t sampleCount; // Of the depth buffer, when building level 0 from a multisampled one
 };
\ No newline at end of file
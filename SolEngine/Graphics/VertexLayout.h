@@ -0,0 +1,40 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <array>
+#include <cstdint>
+#include <utility>
+
+// One attribute of a vertex type: its format and byte offset in the vertex
+struct VertexAttribute {
+	VkFormat format;
+	std::uint32_t offset;
+};
+
+// Specialise for each vertex type with a constexpr std::array<VertexAttribute, N> named value,
+// listed in shader location order.
+template<typename T>
+struct VertexAttributes;
+
+// Generates the Vulkan binding/attribute descriptions for vertex type T at compile time.
+template<typename T>
+struct VertexLayout {
+	static constexpr auto AttributeCount = VertexAttributes<T>::value.size();
+
+	// Describes at which rate to load data from memory
+	static constexpr VkVertexInputBindingDescription getBindingDescription(const std::uint32_t binding = 0) {
+		return { binding, static_cast<std::uint32_t>(sizeof(T)), VK_VERTEX_INPUT_RATE_VERTEX };
+	}
+
+	// How to extract each vertex attribute from a chunk of vertex data
+	static constexpr std::array<VkVertexInputAttributeDescription, AttributeCount> getAttributeDescriptions(const std::uint32_t binding = 0) {
+		return makeAttributeDescriptions(binding, std::make_index_sequence<AttributeCount>{});
+	}
+
+private:
+	template<std::size_t... Locations>
+	static constexpr std::array<VkVertexInputAttributeDescription, AttributeCount> makeAttributeDescriptions(const std::uint32_t binding, std::index_sequence<Locations...>) {
+		return {{ { static_cast<std::uint32_t>(Locations), binding, VertexAttributes<T>::value[Locations].format, VertexAttributes<T>::value[Locations].offset }... }};
+	}
+};
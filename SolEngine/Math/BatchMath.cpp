@@ -0,0 +1,421 @@
+#include "BatchMath.h"
+#include "CpuFeatures.h"
+
+#include <cstring>
+
+// MSVC compiles any intrinsic in any function, GCC/Clang need the target enabled per function
+#if defined(_MSC_VER) && !defined(__clang__)
+#define SOL_TARGET_AVX2
+#else
+#define SOL_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#endif
+
+namespace {
+	/***********************************************************************************/
+	inline void emitVisible(std::uint32_t mask, const std::uint32_t base, std::vector<std::uint32_t>& visible) {
+		while (mask != 0) {
+#ifdef _MSC_VER
+			unsigned long bit;
+			_BitScanForward(&bit, mask);
+#else
+			const auto bit = static_cast<std::uint32_t>(__builtin_ctz(mask));
+#endif
+			visible.push_back(base + bit);
+			mask &= mask - 1;
+		}
+	}
+
+	/***********************************************************************************/
+	inline void storeVec3(glm::vec3& out, const __m128 value) noexcept {
+		alignas(16) float lanes[4];
+		_mm_store_ps(lanes, value);
+		std::memcpy(&out, lanes, sizeof(glm::vec3));
+	}
+
+	// Scalar kernels, the reference the SIMD ones are tested against
+	/***********************************************************************************/
+	void multiplyPairsScalar(const glm::mat4* a, const glm::mat4* b, glm::mat4* out, const std::size_t count) {
+		for (std::size_t i = 0; i < count; ++i) {
+			out[i] = a[i] * b[i];
+		}
+	}
+
+	/***********************************************************************************/
+	void multiplySharedScalar(const glm::mat4& a, const glm::mat4* b, glm::mat4* out, const std::size_t count) {
+		for (std::size_t i = 0; i < count; ++i) {
+			out[i] = a * b[i];
+		}
+	}
+
+	/***********************************************************************************/
+	void transformPointsScalar(const glm::mat4& m, const glm::vec3* points, glm::vec3* out, const std::size_t count) {
+		for (std::size_t i = 0; i < count; ++i) {
+			out[i] = glm::vec3(m * glm::vec4(points[i], 1.0f));
+		}
+	}
+
+	/***********************************************************************************/
+	void transformAABBsScalar(const glm::mat4* matrices, const AABB* boxes, AABB* out, const std::size_t count) {
+		for (std::size_t i = 0; i < count; ++i) {
+			const auto& m = matrices[i];
+			const auto center = glm::vec3(m * glm::vec4((boxes[i].min + boxes[i].max) * 0.5f, 1.0f));
+			const auto extents = (boxes[i].max - boxes[i].min) * 0.5f;
+
+			const auto newExtents = glm::abs(glm::vec3(m[0])) * extents.x + glm::abs(glm::vec3(m[1])) * extents.y + glm::abs(glm::vec3(m[2])) * extents.z;
+
+			out[i].min = center - newExtents;
+			out[i].max = center + newExtents;
+		}
+	}
+
+	/***********************************************************************************/
+	void cullSpheresScalar(const glm::vec4* planes, const std::size_t planeCount, 
+		const float* x, const float* y, const float* z, const float* radius, const std::size_t count, 
+		std::vector<std::uint32_t>& visible) {
+		for (std::size_t i = 0; i < count; ++i) {
+			auto inside = true;
+			for (std::size_t p = 0; p < planeCount && inside; ++p) {
+				inside = planes[p].x * x[i] + planes[p].w + planes[p].y * y[i] + planes[p].z * z[i] >= -radius[i];
+			}
+
+			if (inside) {
+				visible.push_back(static_cast<std::uint32_t>(i));
+			}
+		}
+	}
+
+	// SSE2 kernels, always available on x64
+	/***********************************************************************************/
+	inline __m128 mulColumnSSE(const __m128 a[4], const float* column) noexcept {
+		auto result = _mm_mul_ps(a[0], _mm_set1_ps(column[0]));
+		result = _mm_add_ps(result, _mm_mul_ps(a[1], _mm_set1_ps(column[1])));
+		result = _mm_add_ps(result, _mm_mul_ps(a[2], _mm_set1_ps(column[2])));
+		return _mm_add_ps(result, _mm_mul_ps(a[3], _mm_set1_ps(column[3])));
+	}
+
+	/***********************************************************************************/
+	inline void mulSSE(const glm::mat4& a, const glm::mat4& b, glm::mat4& out) noexcept {
+		const __m128 columns[4] { _mm_loadu_ps(&a[0][0]), _mm_loadu_ps(&a[1][0]), _mm_loadu_ps(&a[2][0]), _mm_loadu_ps(&a[3][0]) };
+
+		// All of b is read before out is written, so out may alias either input
+		const auto c0 = mulColumnSSE(columns, &b[0][0]);
+		const auto c1 = mulColumnSSE(columns, &b[1][0]);
+		const auto c2 = mulColumnSSE(columns, &b[2][0]);
+		const auto c3 = mulColumnSSE(columns, &b[3][0]);
+
+		_mm_storeu_ps(&out[0][0], c0);
+		_mm_storeu_ps(&out[1][0], c1);
+		_mm_storeu_ps(&out[2][0], c2);
+		_mm_storeu_ps(&out[3][0], c3);
+	}
+
+	/***********************************************************************************/
+	void multiplyPairsSSE(const glm::mat4* a, const glm::mat4* b, glm::mat4* out, const std::size_t count) {
+		for (std::size_t i = 0; i < count; ++i) {
+			mulSSE(a[i], b[i], out[i]);
+		}
+	}
+
+	/***********************************************************************************/
+	void multiplySharedSSE(const glm::mat4& a, const glm::mat4* b, glm::mat4* out, const std::size_t count) {
+		const __m128 columns[4] { _mm_loadu_ps(&a[0][0]), _mm_loadu_ps(&a[1][0]), _mm_loadu_ps(&a[2][0]), _mm_loadu_ps(&a[3][0]) };
+
+		for (std::size_t i = 0; i < count; ++i) {
+			const auto c0 = mulColumnSSE(columns, &b[i][0][0]);
+			const auto c1 = mulColumnSSE(columns, &b[i][1][0]);
+			const auto c2 = mulColumnSSE(columns, &b[i][2][0]);
+			const auto c3 = mulColumnSSE(columns, &b[i][3][0]);
+
+			_mm_storeu_ps(&out[i][0][0], c0);
+			_mm_storeu_ps(&out[i][1][0], c1);
+			_mm_storeu_ps(&out[i][2][0], c2);
+			_mm_storeu_ps(&out[i][3][0], c3);
+		}
+	}
+
+	/***********************************************************************************/
+	void transformPointsSSE(const glm::mat4& m, const glm::vec3* points, glm::vec3* out, const std::size_t count) {
+		const auto m0 = _mm_loadu_ps(&m[0][0]);
+		const auto m1 = _mm_loadu_ps(&m[1][0]);
+		const auto m2 = _mm_loadu_ps(&m[2][0]);
+		const auto m3 = _mm_loadu_ps(&m[3][0]);
+
+		for (std::size_t i = 0; i < count; ++i) {
+			auto result = _mm_add_ps(_mm_mul_ps(m0, _mm_set1_ps(points[i].x)), m3);
+			result = _mm_add_ps(result, _mm_mul_ps(m1, _mm_set1_ps(points[i].y)));
+			result = _mm_add_ps(result, _mm_mul_ps(m2, _mm_set1_ps(points[i].z)));
+
+			storeVec3(out[i], result);
+		}
+	}
+
+	/***********************************************************************************/
+	void transformAABBsSSE(const glm::mat4* matrices, const AABB* boxes, AABB* out, const std::size_t count) {
+		const auto absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+
+		for (std::size_t i = 0; i < count; ++i) {
+			const auto& m = matrices[i];
+			const auto center = (boxes[i].min + boxes[i].max) * 0.5f;
+			const auto extents = (boxes[i].max - boxes[i].min) * 0.5f;
+
+			const auto m0 = _mm_loadu_ps(&m[0][0]);
+			const auto m1 = _mm_loadu_ps(&m[1][0]);
+			const auto m2 = _mm_loadu_ps(&m[2][0]);
+
+			// Centre goes through the full transform, extents through |M3x3|
+			auto newCenter = _mm_add_ps(_mm_mul_ps(m0, _mm_set1_ps(center.x)), _mm_loadu_ps(&m[3][0]));
+			newCenter = _mm_add_ps(newCenter, _mm_mul_ps(m1, _mm_set1_ps(center.y)));
+			newCenter = _mm_add_ps(newCenter, _mm_mul_ps(m2, _mm_set1_ps(center.z)));
+
+			auto newExtents = _mm_mul_ps(_mm_and_ps(m0, absMask), _mm_set1_ps(extents.x));
+			newExtents = _mm_add_ps(newExtents, _mm_mul_ps(_mm_and_ps(m1, absMask), _mm_set1_ps(extents.y)));
+			newExtents = _mm_add_ps(newExtents, _mm_mul_ps(_mm_and_ps(m2, absMask), _mm_set1_ps(extents.z)));
+
+			storeVec3(out[i].min, _mm_sub_ps(newCenter, newExtents));
+			storeVec3(out[i].max, _mm_add_ps(newCenter, newExtents));
+		}
+	}
+
+	/***********************************************************************************/
+	void cullSpheresSSE(const glm::vec4* planes, const std::size_t planeCount, 
+		const float* x, const float* y, const float* z, const float* radius, const std::size_t count, 
+		std::vector<std::uint32_t>& visible) {
+		const auto signMask = _mm_set1_ps(-0.0f);
+
+		for (std::size_t i = 0; i < count; i += 4) {
+			const auto cx = _mm_loadu_ps(x + i);
+			const auto cy = _mm_loadu_ps(y + i);
+			const auto cz = _mm_loadu_ps(z + i);
+			const auto negRadius = _mm_xor_ps(_mm_loadu_ps(radius + i), signMask);
+
+			auto inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+			for (std::size_t p = 0; p < planeCount; ++p) {
+				auto distance = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(planes[p].x), cx), _mm_set1_ps(planes[p].w));
+				distance = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(planes[p].y), cy), distance);
+				distance = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(planes[p].z), cz), distance);
+
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negRadius));
+			}
+
+			emitVisible(static_cast<std::uint32_t>(_mm_movemask_ps(inside)), static_cast<std::uint32_t>(i), visible);
+		}
+	}
+
+	// AVX2 + FMA kernels, only called when the CPU has them
+	/***********************************************************************************/
+	SOL_TARGET_AVX2 inline __m256 mulColumnsAVX2(const __m256 a[4], const float* columns) noexcept {
+		// Two adjacent columns of b, each lane broadcast within its half
+		const auto b01 = _mm256_loadu_ps(columns);
+
+		auto result = _mm256_mul_ps(a[0], _mm256_permute_ps(b01, 0x00));
+		result = _mm256_fmadd_ps(a[1], _mm256_permute_ps(b01, 0x55), result);
+		result = _mm256_fmadd_ps(a[2], _mm256_permute_ps(b01, 0xAA), result);
+		return _mm256_fmadd_ps(a[3], _mm256_permute_ps(b01, 0xFF), result);
+	}
+
+	/***********************************************************************************/
+	SOL_TARGET_AVX2 inline void loadBroadcastColumns(const glm::mat4& a, __m256 columns[4]) noexcept {
+		for (int i = 0; i < 4; ++i) {
+			columns[i] = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(&a[i][0]));
+		}
+	}
+
+	/***********************************************************************************/
+	SOL_TARGET_AVX2 void multiplyPairsAVX2(const glm::mat4* a, const glm::mat4* b, glm::mat4* out, const std::size_t count) {
+		__m256 columns[4];
+
+		for (std::size_t i = 0; i < count; ++i) {
+			loadBroadcastColumns(a[i], columns);
+
+			const auto c01 = mulColumnsAVX2(columns, &b[i][0][0]);
+			const auto c23 = mulColumnsAVX2(columns, &b[i][2][0]);
+
+			_mm256_storeu_ps(&out[i][0][0], c01);
+			_mm256_storeu_ps(&out[i][2][0], c23);
+		}
+	}
+
+	/***********************************************************************************/
+	SOL_TARGET_AVX2 void multiplySharedAVX2(const glm::mat4& a, const glm::mat4* b, glm::mat4* out, const std::size_t count) {
+		__m256 columns[4];
+		loadBroadcastColumns(a, columns);
+
+		for (std::size_t i = 0; i < count; ++i) {
+			const auto c01 = mulColumnsAVX2(columns, &b[i][0][0]);
+			const auto c23 = mulColumnsAVX2(columns, &b[i][2][0]);
+
+			_mm256_storeu_ps(&out[i][0][0], c01);
+			_mm256_storeu_ps(&out[i][2][0], c23);
+		}
+	}
+
+	/***********************************************************************************/
+	SOL_TARGET_AVX2 void transformPointsAVX2(const glm::mat4& m, const glm::vec3* points, glm::vec3* out, const std::size_t count) {
+		__m256 columns[4];
+		loadBroadcastColumns(m, columns);
+
+		// Two points per iteration, one per half
+		std::size_t i = 0;
+		for (; i + 1 < count; i += 2) {
+			const auto px = _mm256_set_m128(_mm_set1_ps(points[i + 1].x), _mm_set1_ps(points[i].x));
+			const auto py = _mm256_set_m128(_mm_set1_ps(points[i + 1].y), _mm_set1_ps(points[i].y));
+			const auto pz = _mm256_set_m128(_mm_set1_ps(points[i + 1].z), _mm_set1_ps(points[i].z));
+
+			auto result = _mm256_fmadd_ps(columns[0], px, columns[3]);
+			result = _mm256_fmadd_ps(columns[1], py, result);
+			result = _mm256_fmadd_ps(columns[2], pz, result);
+
+			storeVec3(out[i], _mm256_castps256_ps128(result));
+			storeVec3(out[i + 1], _mm256_extractf128_ps(result, 1));
+		}
+
+		if (i < count) {
+			transformPointsSSE(m, points + i, out + i, count - i);
+		}
+	}
+
+	/***********************************************************************************/
+	SOL_TARGET_AVX2 void transformAABBsAVX2(const glm::mat4* matrices, const AABB* boxes, AABB* out, const std::size_t count) {
+		const auto absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+		const auto half = _mm256_set1_ps(0.5f);
+
+		// Two boxes per iteration, one per half
+		std::size_t i = 0;
+		for (; i + 1 < count; i += 2) {
+			const auto& m0 = matrices[i];
+			const auto& m1 = matrices[i + 1];
+
+			__m256 columns[4];
+			for (int c = 0; c < 4; ++c) {
+				columns[c] = _mm256_set_m128(_mm_loadu_ps(&m1[c][0]), _mm_loadu_ps(&m0[c][0]));
+			}
+
+			const auto boxMin = _mm256_setr_ps(boxes[i].min.x, boxes[i].min.y, boxes[i].min.z, 0.0f, boxes[i + 1].min.x, boxes[i + 1].min.y, boxes[i + 1].min.z, 0.0f);
+			const auto boxMax = _mm256_setr_ps(boxes[i].max.x, boxes[i].max.y, boxes[i].max.z, 0.0f, boxes[i + 1].max.x, boxes[i + 1].max.y, boxes[i + 1].max.z, 0.0f);
+			const auto center = _mm256_mul_ps(_mm256_add_ps(boxMin, boxMax), half);
+			const auto extents = _mm256_mul_ps(_mm256_sub_ps(boxMax, boxMin), half);
+
+			auto newCenter = _mm256_fmadd_ps(columns[0], _mm256_permute_ps(center, 0x00), columns[3]);
+			newCenter = _mm256_fmadd_ps(columns[1], _mm256_permute_ps(center, 0x55), newCenter);
+			newCenter = _mm256_fmadd_ps(columns[2], _mm256_permute_ps(center, 0xAA), newCenter);
+
+			auto newExtents = _mm256_mul_ps(_mm256_and_ps(columns[0], absMask), _mm256_permute_ps(extents, 0x00));
+			newExtents = _mm256_fmadd_ps(_mm256_and_ps(columns[1], absMask), _mm256_permute_ps(extents, 0x55), newExtents);
+			newExtents = _mm256_fmadd_ps(_mm256_and_ps(columns[2], absMask), _mm256_permute_ps(extents, 0xAA), newExtents);
+
+			const auto newMin = _mm256_sub_ps(newCenter, newExtents);
+			const auto newMax = _mm256_add_ps(newCenter, newExtents);
+
+			storeVec3(out[i].min, _mm256_castps256_ps128(newMin));
+			storeVec3(out[i].max, _mm256_castps256_ps128(newMax));
+			storeVec3(out[i + 1].min, _mm256_extractf128_ps(newMin, 1));
+			storeVec3(out[i + 1].max, _mm256_extractf128_ps(newMax, 1));
+		}
+
+		if (i < count) {
+			transformAABBsSSE(matrices + i, boxes + i, out + i, count - i);
+		}
+	}
+
+	/***********************************************************************************/
+	SOL_TARGET_AVX2 void cullSpheresAVX2(const glm::vec4* planes, const std::size_t planeCount, 
+		const float* x, const float* y, const float* z, const float* radius, const std::size_t count, 
+		std::vector<std::uint32_t>& visible) {
+		const auto signMask = _mm256_set1_ps(-0.0f);
+
+		for (std::size_t i = 0; i < count; i += 8) {
+			const auto cx = _mm256_loadu_ps(x + i);
+			const auto cy = _mm256_loadu_ps(y + i);
+			const auto cz = _mm256_loadu_ps(z + i);
+			const auto negRadius = _mm256_xor_ps(_mm256_loadu_ps(radius + i), signMask);
+
+			auto inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+			for (std::size_t p = 0; p < planeCount; ++p) {
+				auto distance = _mm256_fmadd_ps(_mm256_broadcast_ss(&planes[p].x), cx, _mm256_broadcast_ss(&planes[p].w));
+				distance = _mm256_fmadd_ps(_mm256_broadcast_ss(&planes[p].y), cy, distance);
+				distance = _mm256_fmadd_ps(_mm256_broadcast_ss(&planes[p].z), cz, distance);
+
+				inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, negRadius, _CMP_GE_OQ));
+			}
+
+			emitVisible(static_cast<std::uint32_t>(_mm256_movemask_ps(inside)), static_cast<std::uint32_t>(i), visible);
+		}
+	}
+
+	/***********************************************************************************/
+	struct Kernels {
+		decltype(&multiplyPairsSSE) multiplyPairs;
+		decltype(&multiplySharedSSE) multiplyShared;
+		decltype(&transformPointsSSE) transformPoints;
+		decltype(&transformAABBsSSE) transformAABBs;
+		decltype(&cullSpheresSSE) cullSpheres;
+		const char* name;
+	};
+
+	/***********************************************************************************/
+	Kernels kernelsFor(const BatchMath::InstructionSet set) noexcept {
+		switch (set) {
+		case BatchMath::InstructionSet::Scalar:
+			return Kernels { multiplyPairsScalar, multiplySharedScalar, transformPointsScalar, transformAABBsScalar, cullSpheresScalar, "Scalar" };
+		case BatchMath::InstructionSet::SSE2:
+			return Kernels { multiplyPairsSSE, multiplySharedSSE, transformPointsSSE, transformAABBsSSE, cullSpheresSSE, "SSE2" };
+		case BatchMath::InstructionSet::AVX2:
+			break;
+		}
+		return Kernels { multiplyPairsAVX2, multiplySharedAVX2, transformPointsAVX2, transformAABBsAVX2, cullSpheresAVX2, "AVX2" };
+	}
+
+	/***********************************************************************************/
+	Kernels& kernels() noexcept {
+		static auto selected = kernelsFor(BatchMath::supports(BatchMath::InstructionSet::AVX2) ? BatchMath::InstructionSet::AVX2 : BatchMath::InstructionSet::SSE2);
+		return selected;
+	}
+}
+
+/***********************************************************************************/
+void BatchMath::multiply(const glm::mat4* a, const glm::mat4* b, glm::mat4* out, const std::size_t count) {
+	kernels().multiplyPairs(a, b, out, count);
+}
+
+/***********************************************************************************/
+void BatchMath::multiply(const glm::mat4& a, const glm::mat4* b, glm::mat4* out, const std::size_t count) {
+	kernels().multiplyShared(a, b, out, count);
+}
+
+/***********************************************************************************/
+void BatchMath::transformPoints(const glm::mat4& m, const glm::vec3* points, glm::vec3* out, const std::size_t count) {
+	kernels().transformPoints(m, points, out, count);
+}
+
+/***********************************************************************************/
+void BatchMath::transformAABBs(const glm::mat4* matrices, const AABB* boxes, AABB* out, const std::size_t count) {
+	kernels().transformAABBs(matrices, boxes, out, count);
+}
+
+/***********************************************************************************/
+void BatchMath::cullSpheres(const glm::vec4* planes, const std::size_t planeCount, 
+	const float* x, const float* y, const float* z, const float* radius, const std::size_t count, 
+	std::vector<std::uint32_t>& visible) {
+	kernels().cullSpheres(planes, planeCount, x, y, z, radius, count, visible);
+}
+
+/***********************************************************************************/
+bool BatchMath::supports(const InstructionSet set) noexcept {
+	const auto& features = cpuFeatures();
+	return set != InstructionSet::AVX2 || (features.avx2 && features.fma);
+}
+
+/***********************************************************************************/
+bool BatchMath::setInstructionSet(const InstructionSet set) noexcept {
+	if (!supports(set)) {
+		return false;
+	}
+
+	kernels() = kernelsFor(set);
+	return true;
+}
+
+/***********************************************************************************/
+const char* BatchMath::instructionSet() noexcept {
+	return kernels().name;
+}
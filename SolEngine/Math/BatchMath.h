@@ -0,0 +1,81 @@
+#pragma once
+
+#include "Graphics/Bounds.h"
+
+#include <immintrin.h>
+
+#include <cstdint>
+#include <vector>
+
+// Batch math kernels working directly on glm types (column-major glm::mat4, tightly packed glm::vec3).
+// Every batch function picks SSE2 or AVX2+FMA at runtime, the first call detects the CPU.
+// setInstructionSet overrides the choice, including a plain scalar path, so tests can compare them.
+namespace BatchMath {
+	static_assert(sizeof(glm::mat4) == 16 * sizeof(float), "Kernels assume a tightly packed glm::mat4.");
+	static_assert(sizeof(glm::vec3) == 3 * sizeof(float), "Kernels assume a tightly packed glm::vec3.");
+
+	// cullSpheres reads the SoA streams in batches of this many lanes
+	constexpr std::size_t SpherePadding = 8;
+
+	// out[i] = a[i] * b[i]. out may alias a or b.
+	void multiply(const glm::mat4* a, const glm::mat4* b, glm::mat4* out, const std::size_t count);
+	// out[i] = a * b[i]. out may alias b.
+	void multiply(const glm::mat4& a, const glm::mat4* b, glm::mat4* out, const std::size_t count);
+	// out[i] = (m * vec4(points[i], 1)).xyz. No perspective divide.
+	void transformPoints(const glm::mat4& m, const glm::vec3* points, glm::vec3* out, const std::size_t count);
+	// Box enclosing each (non-empty) box under its affine matrix (Arvo's method).
+	void transformAABBs(const glm::mat4* matrices, const AABB* boxes, AABB* out, const std::size_t count);
+	// Appends the index of every sphere on the inner side of all planes to visible (a point p is inside
+	// when dot(plane.xyz, p) + plane.w >= 0). The streams must be readable (and padded with spheres
+	// that fail, e.g. radius = lowest float) up to count rounded up to SpherePadding.
+	void cullSpheres(const glm::vec4* planes, const std::size_t planeCount, 
+		const float* x, const float* y, const float* z, const float* radius, const std::size_t count, 
+		std::vector<std::uint32_t>& visible);
+
+	enum class InstructionSet { Scalar, SSE2, AVX2 };
+
+	// Scalar and SSE2 always, AVX2 when the CPU has both AVX2 and FMA
+	bool supports(const InstructionSet set) noexcept;
+	// Switches every batch function to the given kernels. Returns false, keeping the current ones, when
+	// the CPU lacks the set. Not synchronized with batch calls running on other threads.
+	bool setInstructionSet(const InstructionSet set) noexcept;
+	// "AVX2", "SSE2" or "Scalar"
+	const char* instructionSet() noexcept;
+
+	/***********************************************************************************/
+	// Single product for callers that can't batch, using whatever the compiler targets. out must not alias a or b.
+	inline void multiply(const glm::mat4& a, const glm::mat4& b, glm::mat4& out) noexcept {
+#ifdef __AVX__
+		// Two result columns at once: a's columns broadcast into both halves
+		const auto a0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(&a[0][0]));
+		const auto a1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(&a[1][0]));
+		const auto a2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(&a[2][0]));
+		const auto a3 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(&a[3][0]));
+
+		for (int column = 0; column < 4; column += 2) {
+			const auto b01 = _mm256_loadu_ps(&b[column][0]);
+
+			auto result = _mm256_mul_ps(a0, _mm256_permute_ps(b01, 0x00));
+			result = _mm256_add_ps(result, _mm256_mul_ps(a1, _mm256_permute_ps(b01, 0x55)));
+			result = _mm256_add_ps(result, _mm256_mul_ps(a2, _mm256_permute_ps(b01, 0xAA)));
+			result = _mm256_add_ps(result, _mm256_mul_ps(a3, _mm256_permute_ps(b01, 0xFF)));
+
+			_mm256_storeu_ps(&out[column][0], result);
+		}
+#else
+		const auto a0 = _mm_loadu_ps(&a[0][0]);
+		const auto a1 = _mm_loadu_ps(&a[1][0]);
+		const auto a2 = _mm_loadu_ps(&a[2][0]);
+		const auto a3 = _mm_loadu_ps(&a[3][0]);
+
+		for (int column = 0; column < 4; ++column) {
+			auto result = _mm_mul_ps(a0, _mm_set1_ps(b[column][0]));
+			result = _mm_add_ps(result, _mm_mul_ps(a1, _mm_set1_ps(b[column][1])));
+			result = _mm_add_ps(result, _mm_mul_ps(a2, _mm_set1_ps(b[column][2])));
+			result = _mm_add_ps(result, _mm_mul_ps(a3, _mm_set1_ps(b[column][3])));
+
+			_mm_storeu_ps(&out[column][0], result);
+		}
+#endif
+	}
+}
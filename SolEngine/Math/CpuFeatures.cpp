@@ -0,0 +1,69 @@
+#include "CpuFeatures.h"
+
+#include <cstdint>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#include <immintrin.h>
+#else
+#include <cpuid.h>
+#endif
+
+namespace {
+	/***********************************************************************************/
+	void cpuid(const int leaf, const int subleaf, std::uint32_t regs[4]) noexcept {
+#ifdef _MSC_VER
+		int info[4];
+		__cpuidex(info, leaf, subleaf);
+		for (int i = 0; i < 4; ++i) {
+			regs[i] = static_cast<std::uint32_t>(info[i]);
+		}
+#else
+		if (!__get_cpuid_count(static_cast<unsigned>(leaf), static_cast<unsigned>(subleaf), &regs[0], &regs[1], &regs[2], &regs[3])) {
+			regs[0] = regs[1] = regs[2] = regs[3] = 0;
+		}
+#endif
+	}
+
+	/***********************************************************************************/
+	std::uint64_t xgetbv() noexcept {
+#ifdef _MSC_VER
+		return _xgetbv(0);
+#else
+		std::uint32_t low, high;
+		__asm__ volatile("xgetbv" : "=a"(low), "=d"(high) : "c"(0));
+		return (static_cast<std::uint64_t>(high) << 32) | low;
+#endif
+	}
+
+	/***********************************************************************************/
+	CpuFeatures detect() noexcept {
+		CpuFeatures features;
+
+		std::uint32_t regs[4];
+		cpuid(0, 0, regs);
+		const auto maxLeaf = regs[0];
+
+		cpuid(1, 0, regs);
+		const auto ecx = regs[2];
+		features.sse41 = (ecx & (1u << 19)) != 0;
+
+		// XMM + YMM state enabled by the OS
+		const auto osSavesYmm = (ecx & (1u << 27)) != 0 && (xgetbv() & 0x6) == 0x6;
+		features.avx = osSavesYmm && (ecx & (1u << 28)) != 0;
+		features.fma = features.avx && (ecx & (1u << 12)) != 0;
+
+		if (maxLeaf >= 7) {
+			cpuid(7, 0, regs);
+			features.avx2 = features.avx && (regs[1] & (1u << 5)) != 0;
+		}
+
+		return features;
+	}
+}
+
+/***********************************************************************************/
+const CpuFeatures& cpuFeatures() noexcept {
+	static const auto features = detect();
+	return features;
+}
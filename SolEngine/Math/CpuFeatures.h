@@ -0,0 +1,12 @@
+#pragma once
+
+// Instruction sets the CPU and OS support, detected once with cpuid.
+// AVX only counts when the OS saves the YMM registers (OSXSAVE + XCR0).
+struct CpuFeatures {
+	bool sse41 = false;
+	bool avx = false;
+	bool avx2 = false;
+	bool fma = false;
+};
+
+const CpuFeatures& cpuFeatures() noexcept;
@@ -0,0 +1,477 @@
+#include "Bvh.h"
+
+#include <glm/geometric.hpp>
+
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <utility>
+
+namespace {
+	constexpr std::uint32_t BinCount = 12;
+	constexpr std::uint32_t MaxLeafSize = 4;
+	// Relative cost of a traversal step vs an object test
+	constexpr float TraversalCost = 1.0f;
+	constexpr float IntersectionCost = 1.0f;
+	// Rebuild once refitting made the tree this much more expensive than right after its build
+	constexpr float RebuildRatio = 1.5f;
+	// Fixed-size traversal stack. Nodes deeper than MaxDepth stay leaves, so it can't overflow.
+	constexpr std::size_t StackSize = 64;
+	constexpr std::uint32_t MaxDepth = StackSize - 2;
+
+	/***********************************************************************************/
+	inline float surfaceArea(const glm::vec3& min, const glm::vec3& max) noexcept {
+		const auto e = glm::max(max - min, glm::vec3(0.0f));
+		return 2.0f * (e.x * e.y + e.y * e.z + e.z * e.x);
+	}
+
+	/***********************************************************************************/
+	inline bool overlaps(const glm::vec3& minA, const glm::vec3& maxA, const glm::vec3& minB, const glm::vec3& maxB) noexcept {
+		return minA.x <= maxB.x && maxA.x >= minB.x && 
+			minA.y <= maxB.y && maxA.y >= minB.y && 
+			minA.z <= maxB.z && maxA.z >= minB.z;
+	}
+
+	/***********************************************************************************/
+	inline bool overlaps(const glm::vec3& min, const glm::vec3& max, const BoundingSphere& sphere) noexcept {
+		const auto d = glm::clamp(sphere.center, min, max) - sphere.center;
+		return glm::dot(d, d) <= sphere.radius * sphere.radius;
+	}
+
+	/***********************************************************************************/
+	// Entry distance along the ray (slab test), or +inf on a miss
+	inline float intersectRay(const glm::vec3& min, const glm::vec3& max, const glm::vec3& origin, const glm::vec3& inverseDirection, const float maxDistance) noexcept {
+		const auto t0 = (min - origin) * inverseDirection;
+		const auto t1 = (max - origin) * inverseDirection;
+
+		const auto tNear = glm::min(t0, t1);
+		const auto tFar = glm::max(t0, t1);
+
+		const auto entry = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0f));
+		const auto exit = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, maxDistance));
+
+		return entry <= exit ? entry : std::numeric_limits<float>::infinity();
+	}
+
+	/***********************************************************************************/
+	// 0 = outside, 1 = intersecting, 2 = inside. Planes already known to contain the box are skipped via mask.
+	inline int classify(const Frustum& frustum, const glm::vec3& min, const glm::vec3& max, std::uint32_t& mask) noexcept {
+		const auto center = (min + max) * 0.5f;
+		const auto extents = (max - min) * 0.5f;
+
+		for (std::uint32_t p = 0; p < 6; ++p) {
+			if (!(mask & (1u << p))) {
+				continue;
+			}
+
+			const auto& plane = frustum.planes[p];
+			const auto normal = glm::vec3(plane);
+			const auto distance = glm::dot(normal, center) + plane.w;
+			const auto radius = glm::dot(glm::abs(normal), extents);
+
+			if (distance < -radius) {
+				return 0;
+			}
+			if (distance >= radius) {
+				mask &= ~(1u << p);
+			}
+		}
+
+		return mask == 0 ? 2 : 1;
+	}
+}
+
+/***********************************************************************************/
+void Bvh::build(const AABB* bounds, const std::size_t count) {
+	m_nodes.clear();
+	m_bounds.resize(count);
+	m_objectIndices.resize(count);
+
+	if (count == 0) {
+		m_subtreeFirst.clear();
+		m_subtreeCount.clear();
+		m_sahCost = m_builtSahCost = 0.0f;
+		return;
+	}
+
+	// Partitioning a contiguous copy is much cheaper than gathering through indices at every level
+	std::vector<BuildItem> items(count);
+	for (std::size_t i = 0; i < count; ++i) {
+		items[i] = { bounds[i], bounds[i].center(), static_cast<std::uint32_t>(i) };
+	}
+
+	m_nodes.reserve(2 * count);
+	m_nodes.resize(1);
+	m_nodes[0].leftOrFirst = 0;
+	m_nodes[0].count = static_cast<std::uint32_t>(count);
+
+	subdivide(items);
+
+	for (std::size_t i = 0; i < count; ++i) {
+		m_objectIndices[i] = items[i].object;
+		m_bounds[i] = items[i].bounds;
+	}
+
+	// Subtree ranges: leaves know theirs, a parent spans its two children (children come after parents)
+	m_subtreeFirst.assign(m_nodes.size(), 0);
+	m_subtreeCount.assign(m_nodes.size(), 0);
+	for (auto i = m_nodes.size(); i-- > 0;) {
+		const auto& node = m_nodes[i];
+		if (node.isLeaf()) {
+			m_subtreeFirst[i] = node.leftOrFirst;
+			m_subtreeCount[i] = node.count;
+		}
+		else {
+			m_subtreeFirst[i] = m_subtreeFirst[node.leftOrFirst];
+			m_subtreeCount[i] = m_subtreeCount[node.leftOrFirst] + m_subtreeCount[node.leftOrFirst + 1];
+		}
+	}
+
+	m_sahCost = m_builtSahCost = computeSahCost();
+}
+
+/***********************************************************************************/
+void Bvh::update(const AABB* bounds, const std::size_t count) {
+	if (count != m_bounds.size() || count == 0) {
+		build(bounds, count);
+		return;
+	}
+
+	for (std::size_t i = 0; i < count; ++i) {
+		m_bounds[i] = bounds[m_objectIndices[i]];
+	}
+	m_sahCost = refit();
+
+	if (m_sahCost > m_builtSahCost * RebuildRatio) {
+		build(bounds, count);
+	}
+}
+
+/***********************************************************************************/
+void Bvh::subdivide(std::vector<BuildItem>& items) {
+	// Node + depth
+	std::vector<std::pair<std::uint32_t, std::uint32_t>> pending { { 0, 0 } };
+
+	while (!pending.empty()) {
+		const auto [nodeIndex, depth] = pending.back();
+		pending.pop_back();
+
+		const auto first = m_nodes[nodeIndex].leftOrFirst;
+		const auto count = m_nodes[nodeIndex].count;
+
+		AABB nodeBounds, centroidBounds;
+		for (auto i = first; i < first + count; ++i) {
+			nodeBounds.expand(items[i].bounds.min);
+			nodeBounds.expand(items[i].bounds.max);
+			centroidBounds.expand(items[i].centroid);
+		}
+		m_nodes[nodeIndex].min = nodeBounds.min;
+		m_nodes[nodeIndex].max = nodeBounds.max;
+
+		if (count <= MaxLeafSize || depth >= MaxDepth) {
+			continue;
+		}
+
+		// Binned SAH: bucket the centroids along each axis and evaluate the BinCount - 1 split planes
+		auto bestCost = std::numeric_limits<float>::max();
+		auto bestAxis = -1;
+		std::uint32_t bestSplit = 0;
+
+		for (int axis = 0; axis < 3; ++axis) {
+			const auto axisMin = centroidBounds.min[axis];
+			const auto axisExtent = centroidBounds.max[axis] - axisMin;
+			if (axisExtent <= 0.0f) {
+				continue;
+			}
+
+			std::array<AABB, BinCount> bins;
+			std::array<std::uint32_t, BinCount> binCounts {};
+			const auto scale = BinCount / axisExtent;
+
+			for (auto i = first; i < first + count; ++i) {
+				const auto bin = std::min(BinCount - 1, static_cast<std::uint32_t>((items[i].centroid[axis] - axisMin) * scale));
+				++binCounts[bin];
+				bins[bin].expand(items[i].bounds.min);
+				bins[bin].expand(items[i].bounds.max);
+			}
+
+			// Sweep in from both ends so every split plane is evaluated in O(BinCount)
+			std::array<float, BinCount - 1> leftArea, rightArea;
+			std::array<std::uint32_t, BinCount - 1> leftCount, rightCount;
+			AABB leftBox, rightBox;
+			std::uint32_t leftSum = 0, rightSum = 0;
+			for (std::uint32_t i = 0; i < BinCount - 1; ++i) {
+				leftSum += binCounts[i];
+				leftCount[i] = leftSum;
+				if (binCounts[i] > 0) {
+					leftBox.expand(bins[i].min);
+					leftBox.expand(bins[i].max);
+				}
+				leftArea[i] = surfaceArea(leftBox.min, leftBox.max);
+
+				const auto j = BinCount - 1 - i;
+				rightSum += binCounts[j];
+				rightCount[j - 1] = rightSum;
+				if (binCounts[j] > 0) {
+					rightBox.expand(bins[j].min);
+					rightBox.expand(bins[j].max);
+				}
+				rightArea[j - 1] = surfaceArea(rightBox.min, rightBox.max);
+			}
+
+			for (std::uint32_t i = 0; i < BinCount - 1; ++i) {
+				if (leftCount[i] == 0 || rightCount[i] == 0) {
+					continue;
+				}
+
+				const auto cost = leftArea[i] * leftCount[i] + rightArea[i] * rightCount[i];
+				if (cost < bestCost) {
+					bestCost = cost;
+					bestAxis = axis;
+					bestSplit = i + 1;
+				}
+			}
+		}
+
+		// Splitting has to beat testing every object in this node
+		const auto parentArea = surfaceArea(nodeBounds.min, nodeBounds.max);
+		const auto leafCost = IntersectionCost * count;
+		const auto splitCost = parentArea > 0.0f ? TraversalCost + IntersectionCost * bestCost / parentArea : leafCost;
+		if (bestAxis < 0 || splitCost >= leafCost) {
+			continue;
+		}
+
+		const auto axisMin = centroidBounds.min[bestAxis];
+		const auto scale = BinCount / (centroidBounds.max[bestAxis] - axisMin);
+		const auto begin = items.begin() + first;
+		const auto middle = std::partition(begin, begin + count, [&](const BuildItem& item) {
+			return std::min(BinCount - 1, static_cast<std::uint32_t>((item.centroid[bestAxis] - axisMin) * scale)) < bestSplit;
+		});
+		const auto leftCount = static_cast<std::uint32_t>(std::distance(begin, middle));
+
+		const auto left = static_cast<std::uint32_t>(m_nodes.size());
+		m_nodes.resize(m_nodes.size() + 2);
+
+		m_nodes[left].leftOrFirst = first;
+		m_nodes[left].count = leftCount;
+		m_nodes[left + 1].leftOrFirst = first + leftCount;
+		m_nodes[left + 1].count = count - leftCount;
+
+		m_nodes[nodeIndex].leftOrFirst = left;
+		m_nodes[nodeIndex].count = 0;
+
+		pending.push_back({ left + 1, depth + 1 });
+		pending.push_back({ left, depth + 1 });
+	}
+}
+
+/***********************************************************************************/
+float Bvh::refit() {
+	// Children always come after their parent, so one backwards pass is bottom-up
+	for (auto i = m_nodes.size(); i-- > 0;) {
+		auto& node = m_nodes[i];
+		if (node.isLeaf()) {
+			AABB box;
+			for (auto j = node.leftOrFirst; j < node.leftOrFirst + node.count; ++j) {
+				box.expand(m_bounds[j].min);
+				box.expand(m_bounds[j].max);
+			}
+			node.min = box.min;
+			node.max = box.max;
+		}
+		else {
+			const auto& left = m_nodes[node.leftOrFirst];
+			const auto& right = m_nodes[node.leftOrFirst + 1];
+			node.min = glm::min(left.min, right.min);
+			node.max = glm::max(left.max, right.max);
+		}
+	}
+
+	return computeSahCost();
+}
+
+/***********************************************************************************/
+float Bvh::computeSahCost() const {
+	const auto rootArea = surfaceArea(m_nodes[0].min, m_nodes[0].max);
+	if (rootArea <= 0.0f) {
+		return 0.0f;
+	}
+
+	auto cost = 0.0f;
+	for (const auto& node : m_nodes) {
+		const auto area = surfaceArea(node.min, node.max) / rootArea;
+		cost += node.isLeaf() ? area * IntersectionCost * node.count : area * TraversalCost;
+	}
+
+	return cost;
+}
+
+/***********************************************************************************/
+void Bvh::cullFrustum(const Frustum& frustum, std::vector<std::uint32_t>& visible) const {
+	visible.clear();
+	if (m_nodes.empty()) {
+		return;
+	}
+
+	constexpr std::uint32_t AllPlanes = (1u << 6) - 1;
+
+	// Node + the planes it still straddles (planes a parent is fully inside are dropped for its children)
+	std::pair<std::uint32_t, std::uint32_t> stack[StackSize];
+	std::size_t stackSize = 0;
+	stack[stackSize++] = { 0, AllPlanes };
+
+	while (stackSize > 0) {
+		const auto [nodeIndex, parentMask] = stack[--stackSize];
+		const auto& node = m_nodes[nodeIndex];
+
+		auto mask = parentMask;
+		const auto result = classify(frustum, node.min, node.max, mask);
+		if (result == 0) {
+			continue;
+		}
+
+		if (result == 2) {
+			const auto first = m_objectIndices.begin() + m_subtreeFirst[nodeIndex];
+			visible.insert(visible.end(), first, first + m_subtreeCount[nodeIndex]);
+			continue;
+		}
+
+		if (node.isLeaf()) {
+			for (auto i = node.leftOrFirst; i < node.leftOrFirst + node.count; ++i) {
+				auto objectMask = mask;
+				if (classify(frustum, m_bounds[i].min, m_bounds[i].max, objectMask) != 0) {
+					visible.push_back(m_objectIndices[i]);
+				}
+			}
+			continue;
+		}
+
+		stack[stackSize++] = { node.leftOrFirst + 1, mask };
+		stack[stackSize++] = { node.leftOrFirst, mask };
+	}
+}
+
+/***********************************************************************************/
+bool Bvh::raycast(const glm::vec3& origin, const glm::vec3& direction, const float maxDistance, std::uint32_t& object, float& distance) const {
+	const auto infinity = std::numeric_limits<float>::infinity();
+	const auto inverseDirection = 1.0f / direction;
+
+	distance = infinity;
+	if (m_nodes.empty() || intersectRay(m_nodes[0].min, m_nodes[0].max, origin, inverseDirection, maxDistance) == infinity) {
+		return false;
+	}
+
+	auto best = maxDistance;
+	auto hit = false;
+
+	// Node + its entry distance, so nodes behind the current best hit are skipped when popped
+	std::pair<std::uint32_t, float> stack[StackSize];
+	std::size_t stackSize = 0;
+	stack[stackSize++] = { 0, 0.0f };
+
+	while (stackSize > 0) {
+		const auto [nodeIndex, entry] = stack[--stackSize];
+		if (entry > best) {
+			continue;
+		}
+
+		const auto& node = m_nodes[nodeIndex];
+		if (node.isLeaf()) {
+			for (auto i = node.leftOrFirst; i < node.leftOrFirst + node.count; ++i) {
+				// Strictly closer, so a miss (+inf) never counts as a hit when maxDistance is infinite
+				const auto t = intersectRay(m_bounds[i].min, m_bounds[i].max, origin, inverseDirection, best);
+				if (t < best) {
+					best = t;
+					object = m_objectIndices[i];
+					hit = true;
+				}
+			}
+			continue;
+		}
+
+		// The nearer child goes on top so its hits can prune the farther one
+		auto nearNode = node.leftOrFirst;
+		auto farNode = nearNode + 1;
+		auto nearT = intersectRay(m_nodes[nearNode].min, m_nodes[nearNode].max, origin, inverseDirection, best);
+		auto farT = intersectRay(m_nodes[farNode].min, m_nodes[farNode].max, origin, inverseDirection, best);
+		if (farT < nearT) {
+			std::swap(nearT, farT);
+			std::swap(nearNode, farNode);
+		}
+
+		if (farT != infinity) {
+			stack[stackSize++] = { farNode, farT };
+		}
+		if (nearT != infinity) {
+			stack[stackSize++] = { nearNode, nearT };
+		}
+	}
+
+	if (hit) {
+		distance = best;
+	}
+
+	return hit;
+}
+
+/***********************************************************************************/
+void Bvh::queryAABB(const AABB& box, std::vector<std::uint32_t>& results) const {
+	results.clear();
+	if (m_nodes.empty()) {
+		return;
+	}
+
+	std::uint32_t stack[StackSize];
+	std::size_t stackSize = 0;
+	stack[stackSize++] = 0;
+
+	while (stackSize > 0) {
+		const auto& node = m_nodes[stack[--stackSize]];
+		if (!overlaps(node.min, node.max, box.min, box.max)) {
+			continue;
+		}
+
+		if (node.isLeaf()) {
+			for (auto i = node.leftOrFirst; i < node.leftOrFirst + node.count; ++i) {
+				if (overlaps(m_bounds[i].min, m_bounds[i].max, box.min, box.max)) {
+					results.push_back(m_objectIndices[i]);
+				}
+			}
+			continue;
+		}
+
+		stack[stackSize++] = node.leftOrFirst + 1;
+		stack[stackSize++] = node.leftOrFirst;
+	}
+}
+
+/***********************************************************************************/
+void Bvh::querySphere(const BoundingSphere& sphere, std::vector<std::uint32_t>& results) const {
+	results.clear();
+	if (m_nodes.empty()) {
+		return;
+	}
+
+	std::uint32_t stack[StackSize];
+	std::size_t stackSize = 0;
+	stack[stackSize++] = 0;
+
+	while (stackSize > 0) {
+		const auto& node = m_nodes[stack[--stackSize]];
+		if (!overlaps(node.min, node.max, sphere)) {
+			continue;
+		}
+
+		if (node.isLeaf()) {
+			for (auto i = node.leftOrFirst; i < node.leftOrFirst + node.count; ++i) {
+				if (overlaps(m_bounds[i].min, m_bounds[i].max, sphere)) {
+					results.push_back(m_objectIndices[i]);
+				}
+			}
+			continue;
+		}
+
+		stack[stackSize++] = node.leftOrFirst + 1;
+		stack[stackSize++] = node.leftOrFirst;
+	}
+}
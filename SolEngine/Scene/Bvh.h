@@ -0,0 +1,76 @@
+#pragma once
+
+#include "Graphics/Bounds.h"
+#include "Graphics/Frustum.h"
+
+#include <cstdint>
+#include <vector>
+
+// Bounding volume hierarchy over object AABBs (object i = the i-th box handed to build/update).
+// Built top-down with binned SAH. While objects move it is refit bottom-up, and rebuilt once
+// refitting has degraded its SAH cost too far. Nodes are 32 bytes and siblings are stored
+// next to each other, so a traversal step fetches both children together.
+class Bvh {
+
+public:
+	Bvh() = default;
+
+	// Builds from scratch
+	void build(const AABB* bounds, const std::size_t count);
+	// Refits to the new bounds (same objects), rebuilding when the tree got too loose.
+	// A different object count always rebuilds.
+	void update(const AABB* bounds, const std::size_t count);
+
+	// Objects whose box intersects the frustum. Subtrees fully inside are taken without further tests.
+	void cullFrustum(const Frustum& frustum, std::vector<std::uint32_t>& visible) const;
+	// Nearest object whose box the ray enters before maxDistance. direction needn't be normalized,
+	// distance is in units of its length. On a miss distance is +inf and object is left alone.
+	bool raycast(const glm::vec3& origin, const glm::vec3& direction, const float maxDistance, std::uint32_t& object, float& distance) const;
+	// Objects whose box overlaps the box / sphere
+	void queryAABB(const AABB& box, std::vector<std::uint32_t>& results) const;
+	void querySphere(const BoundingSphere& sphere, std::vector<std::uint32_t>& results) const;
+
+	auto nodeCount() const noexcept { return m_nodes.size(); }
+	auto objectCount() const noexcept { return m_objectIndices.size(); }
+	// Expected traversal cost relative to the root's surface area (lower is better)
+	auto sahCost() const noexcept { return m_sahCost; }
+
+private:
+	/***********************************************************************************/
+	struct alignas(32) Node {
+		glm::vec3 min;
+		// Interior: index of the left child, the right one follows. Leaf: first entry in m_objectIndices.
+		std::uint32_t leftOrFirst;
+		glm::vec3 max;
+		// Objects in the leaf, 0 for interior nodes
+		std::uint32_t count;
+
+		auto isLeaf() const noexcept { return count > 0; }
+	};
+	/***********************************************************************************/
+
+	static_assert(sizeof(Node) == 32, "Two sibling nodes should fit in a cache line.");
+
+	struct BuildItem {
+		AABB bounds;
+		glm::vec3 centroid;
+		std::uint32_t object;
+	};
+
+	// Splits nodes with binned SAH until splitting stops paying off. Items get reordered into leaf order.
+	void subdivide(std::vector<BuildItem>& items);
+	// Recomputes every node's box bottom-up from m_bounds and returns the new SAH cost.
+	float refit();
+	float computeSahCost() const;
+
+	std::vector<Node> m_nodes;
+	// Last bounds in m_objectIndices order, so leaves read theirs contiguously
+	std::vector<AABB> m_bounds;
+	std::vector<std::uint32_t> m_objectIndices;
+	// First/count into m_objectIndices of every node's subtree, for accepting whole subtrees
+	std::vector<std::uint32_t> m_subtreeFirst, m_subtreeCount;
+
+	float m_sahCost = 0.0f;
+	// SAH cost right after the last build
+	float m_builtSahCost = 0.0f;
+};
@@ -0,0 +1,267 @@
+#include "TransformHierarchy.h"
+
+#include "Logging/Log.h"
+#include "Math/BatchMath.h"
+
+#include <algorithm>
+
+namespace {
+	constexpr std::uint32_t InvalidIndex = ~0u;
+}
+
+/***********************************************************************************/
+TransformHierarchy::Handle TransformHierarchy::create(const glm::mat4& local, const Handle parent) {
+	Handle node;
+	if (m_freeHandles.empty()) {
+		node = static_cast<Handle>(m_indexOf.size());
+		m_indexOf.push_back(InvalidIndex);
+		m_parentOf.push_back(InvalidHandle);
+		m_alive.push_back(0);
+	}
+	else {
+		node = m_freeHandles.back();
+		m_freeHandles.pop_back();
+	}
+
+	// Appended out of order, rebuildOrder moves it below its parent
+	const auto index = static_cast<std::uint32_t>(m_handleOf.size());
+	m_indexOf[node] = index;
+	m_parentOf[node] = isAlive(parent) ? parent : InvalidHandle;
+	m_alive[node] = 1;
+
+	m_handleOf.push_back(node);
+	m_parent.push_back(NoParent);
+	m_subtreeEnd.push_back(index + 1);
+	m_root.push_back(index);
+	m_local.push_back(local);
+	m_world.push_back(local);
+	m_dirty.push_back(1);
+	m_rootQueued.push_back(0);
+
+	m_orderDirty = true;
+
+	return node;
+}
+
+/***********************************************************************************/
+void TransformHierarchy::destroy(const Handle node) {
+	if (!isAlive(node)) {
+		return;
+	}
+
+	m_alive[node] = 0;
+	m_orderDirty = true;
+}
+
+/***********************************************************************************/
+void TransformHierarchy::setParent(const Handle node, const Handle parent) {
+	if (!isAlive(node)) {
+		return;
+	}
+
+	const auto newParent = isAlive(parent) ? parent : InvalidHandle;
+
+	for (auto ancestor = newParent; ancestor != InvalidHandle; ancestor = m_parentOf[ancestor]) {
+		if (ancestor == node) {
+			LOG_ERROR("Reparenting would create a cycle in the transform hierarchy.");
+			return;
+		}
+	}
+
+	m_parentOf[node] = newParent;
+	m_dirty[m_indexOf[node]] = 1;
+	m_orderDirty = true;
+}
+
+/***********************************************************************************/
+void TransformHierarchy::setLocal(const Handle node, const glm::mat4& local) {
+	// Destroyed and released handles have no slot to write to
+	if (!isAlive(node)) {
+		return;
+	}
+
+	const auto index = m_indexOf[node];
+
+	m_local[index] = local;
+	markDirty(index);
+}
+
+/***********************************************************************************/
+bool TransformHierarchy::isAlive(const Handle node) const noexcept {
+	return node < m_alive.size() && m_alive[node];
+}
+
+/***********************************************************************************/
+void TransformHierarchy::update() {
+	if (m_orderDirty) {
+		rebuildOrder();
+	}
+
+	const auto rootCount = static_cast<int>(m_dirtyRoots.size());
+
+	// Subtrees can be very uneven, hand them out one at a time
+#pragma omp parallel for schedule(dynamic, 1) if(rootCount > 1)
+	for (int i = 0; i < rootCount; ++i) {
+		const auto root = m_dirtyRoots[i];
+		updateRange(root, m_subtreeEnd[root]);
+	}
+
+	for (const auto root : m_dirtyRoots) {
+		m_rootQueued[root] = 0;
+	}
+	m_dirtyRoots.clear();
+}
+
+/***********************************************************************************/
+void TransformHierarchy::updateRange(const std::uint32_t begin, const std::uint32_t end) {
+	for (auto i = begin; i < end;) {
+		if (!m_dirty[i]) {
+			++i;
+			continue;
+		}
+
+		// The whole subtree below a dirty node is stale. Parents come first, so one forward pass does it.
+		const auto subtreeEnd = m_subtreeEnd[i];
+		for (auto node = i; node < subtreeEnd; ++node) {
+			const auto parent = m_parent[node];
+			if (parent == NoParent) {
+				m_world[node] = m_local[node];
+			}
+			else {
+				BatchMath::multiply(m_world[parent], m_local[node], m_world[node]);
+			}
+			m_dirty[node] = 0;
+		}
+
+		i = subtreeEnd;
+	}
+}
+
+/***********************************************************************************/
+void TransformHierarchy::markDirty(const std::uint32_t index) {
+	m_dirty[index] = 1;
+
+	// rebuildOrder collects the dirty roots itself
+	if (m_orderDirty) {
+		return;
+	}
+
+	const auto root = m_root[index];
+	if (!m_rootQueued[root]) {
+		m_rootQueued[root] = 1;
+		m_dirtyRoots.push_back(root);
+	}
+}
+
+/***********************************************************************************/
+void TransformHierarchy::rebuildOrder() {
+	const auto count = static_cast<std::uint32_t>(m_handleOf.size());
+
+	// Children of every node (by old index) in CSR form
+	std::vector<std::uint32_t> childStart(count + 1, 0), children(count);
+	std::vector<std::uint32_t> roots;
+	for (std::uint32_t i = 0; i < count; ++i) {
+		const auto parent = m_parentOf[m_handleOf[i]];
+		if (parent == InvalidHandle) {
+			roots.push_back(i);
+		}
+		else {
+			++childStart[m_indexOf[parent] + 1];
+		}
+	}
+	for (std::uint32_t i = 0; i < count; ++i) {
+		childStart[i + 1] += childStart[i];
+	}
+	auto fill = childStart;
+	for (std::uint32_t i = 0; i < count; ++i) {
+		const auto parent = m_parentOf[m_handleOf[i]];
+		if (parent != InvalidHandle) {
+			children[fill[m_indexOf[parent]]++] = i;
+		}
+	}
+
+	// Depth-first, skipping destroyed nodes and with them their subtrees
+	std::vector<std::uint32_t> order, newParent;
+	order.reserve(count);
+	newParent.reserve(count);
+
+	std::vector<std::pair<std::uint32_t, std::uint32_t>> stack; // old index, new parent index
+	for (const auto root : roots) {
+		stack.emplace_back(root, NoParent);
+
+		while (!stack.empty()) {
+			const auto [node, parent] = stack.back();
+			stack.pop_back();
+
+			if (!m_alive[m_handleOf[node]]) {
+				continue;
+			}
+
+			const auto newIndex = static_cast<std::uint32_t>(order.size());
+			order.push_back(node);
+			newParent.push_back(parent);
+
+			// Reversed so children keep their creation order
+			for (auto child = childStart[node + 1]; child > childStart[node]; --child) {
+				stack.emplace_back(children[child - 1], newIndex);
+			}
+		}
+	}
+
+	// Everything not reached was destroyed, directly or through an ancestor
+	std::vector<std::uint8_t> reached(count, 0);
+	for (const auto node : order) {
+		reached[node] = 1;
+	}
+	for (std::uint32_t i = 0; i < count; ++i) {
+		if (!reached[i]) {
+			const auto handle = m_handleOf[i];
+			m_indexOf[handle] = InvalidIndex;
+			m_parentOf[handle] = InvalidHandle;
+			m_alive[handle] = 0;
+			m_freeHandles.push_back(handle);
+		}
+	}
+
+	const auto newCount = static_cast<std::uint32_t>(order.size());
+
+	std::vector<Handle> handleOf(newCount);
+	std::vector<glm::mat4> local(newCount), world(newCount);
+	std::vector<std::uint8_t> dirty(newCount);
+	for (std::uint32_t i = 0; i < newCount; ++i) {
+		handleOf[i] = m_handleOf[order[i]];
+		local[i] = m_local[order[i]];
+		world[i] = m_world[order[i]];
+		dirty[i] = m_dirty[order[i]];
+		m_indexOf[handleOf[i]] = i;
+	}
+
+	m_handleOf = std::move(handleOf);
+	m_local = std::move(local);
+	m_world = std::move(world);
+	m_dirty = std::move(dirty);
+	m_parent = std::move(newParent);
+
+	// Pre-order: a subtree ends where its last descendant's subtree ends
+	m_subtreeEnd.resize(newCount);
+	for (std::uint32_t i = 0; i < newCount; ++i) {
+		m_subtreeEnd[i] = i + 1;
+	}
+	for (auto i = newCount; i-- > 0;) {
+		if (m_parent[i] != NoParent) {
+			m_subtreeEnd[m_parent[i]] = std::max(m_subtreeEnd[m_parent[i]], m_subtreeEnd[i]);
+		}
+	}
+
+	m_root.resize(newCount);
+	m_rootQueued.assign(newCount, 0);
+	m_dirtyRoots.clear();
+	m_orderDirty = false;
+
+	for (std::uint32_t i = 0; i < newCount; ++i) {
+		m_root[i] = m_parent[i] == NoParent ? i : m_root[m_parent[i]];
+		if (m_dirty[i]) {
+			markDirty(i);
+		}
+	}
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/mat4x4.hpp>
+
+#include <cstdint>
+#include <vector>
+
+// Parent/child transforms stored as flat arrays in depth-first order: every parent precedes its
+// children and every subtree is one contiguous range. World matrices are only recomputed for
+// dirty nodes and the ranges below them, with independent top-level subtrees updated in parallel.
+// Handles stay valid across reordering; array indices don't.
+class TransformHierarchy {
+
+public:
+	using Handle = std::uint32_t;
+	static constexpr Handle InvalidHandle = ~0u;
+
+	TransformHierarchy() = default;
+
+	Handle create(const glm::mat4& local = glm::mat4(1.0f), const Handle parent = InvalidHandle);
+	// Destroys the node and everything below it. The descendants' handles are released by the next update().
+	void destroy(const Handle node);
+	// InvalidHandle makes the node a root. Rejected if the parent lives below the node.
+	// Like setLocal, ignored if the node was destroyed.
+	void setParent(const Handle node, const Handle parent);
+	void setLocal(const Handle node, const glm::mat4& local);
+
+	bool isAlive(const Handle node) const noexcept;
+	Handle parent(const Handle node) const noexcept { return m_parentOf[node]; }
+	const glm::mat4& local(const Handle node) const noexcept { return m_local[m_indexOf[node]]; }
+	// Up to date after update()
+	const glm::mat4& world(const Handle node) const noexcept { return m_world[m_indexOf[node]]; }
+
+	// Recomputes the world matrices of dirty nodes and their descendants.
+	void update();
+
+	auto size() const noexcept { return m_handleOf.size(); }
+
+private:
+	static constexpr std::uint32_t NoParent = ~0u;
+
+	// Re-sorts the arrays into depth-first order after nodes were added, removed or reparented.
+	void rebuildOrder();
+	// Recomputes the dirty parts of [begin, end), which must be whole subtrees.
+	void updateRange(const std::uint32_t begin, const std::uint32_t end);
+	void markDirty(const std::uint32_t index);
+
+	// Indexed by handle
+	std::vector<std::uint32_t> m_indexOf;
+	std::vector<Handle> m_parentOf;
+	std::vector<std::uint8_t> m_alive;
+	std::vector<Handle> m_freeHandles;
+
+	// Indexed by position in depth-first order
+	std::vector<Handle> m_handleOf;
+	std::vector<std::uint32_t> m_parent;
+	// One past the last descendant
+	std::vector<std::uint32_t> m_subtreeEnd;
+	// Top-level ancestor (the node itself for roots)
+	std::vector<std::uint32_t> m_root;
+	std::vector<glm::mat4> m_local, m_world;
+	std::vector<std::uint8_t> m_dirty;
+
+	// Top-level subtrees with at least one dirty node, each listed once
+	std::vector<std::uint32_t> m_dirtyRoots;
+	std::vector<std::uint8_t> m_rootQueued;
+
+	// Nodes were added, destroyed or reparented since the last rebuildOrder
+	bool m_orderDirty = false;
+};
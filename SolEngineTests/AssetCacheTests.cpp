@@ -0,0 +1,124 @@
+#include "Test.h"
+
+#include <Assets/AssetCache.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+
+namespace {
+	// One textured triangle with normals
+	constexpr auto Triangle =
+		"v 0 0 0\nv 1 0 0\nv 0 1 0\n"
+		"vt 0 0\nvt 1 0\nvt 0 1\n"
+		"vn 0 0 1\n"
+		"f 1/1/1 2/2/1 3/3/1\n";
+
+	/***********************************************************************************/
+	// Fresh directory under the system's temp directory, removed again when the test ends
+	struct TempDirectory {
+		explicit TempDirectory(const std::string& name) : path((std::filesystem::temp_directory_path() / name).generic_string()) {
+			std::filesystem::remove_all(path);
+			std::filesystem::create_directories(path);
+		}
+		~TempDirectory() {
+			std::error_code error;
+			std::filesystem::remove_all(path, error);
+		}
+
+		std::string write(const std::string& name, const std::string& contents) const {
+			const auto file = path + '/' + name;
+			std::ofstream(file, std::ios::binary) << contents;
+			return file;
+		}
+
+		const std::string path;
+	};
+}
+
+/***********************************************************************************/
+// Textures aren't decoded until upload, any bytes will do
+TEST(AssetCacheDedupsTextures) {
+	const TempDirectory directory("SolEngineAssetCacheTextures");
+	const auto a = directory.write("a.png", "first image");
+	const auto copy = directory.write("copy.png", "first image");
+	const auto b = directory.write("b.png", "second image");
+
+	AssetCache cache;
+	const auto texture = cache.loadTexture(a);
+	CHECK(texture != nullptr);
+	CHECK(cache.loadTexture(a) == texture);
+
+	// Backslashes are the same path, a copy of the file is the same content
+	auto alias = a;
+	alias[directory.path.size()] = '\\';
+	CHECK(cache.loadTexture(alias) == texture);
+	CHECK(cache.loadTexture(copy) == texture);
+	CHECK(cache.findTexture(copy) == texture);
+
+	const auto other = cache.loadTexture(b);
+	CHECK(other != texture);
+	CHECK(cache.textureCount() == 2);
+
+	// Once a.png changes, a fresh copy of its old contents is a different texture
+	directory.write("a.png", "edited image");
+	cache.forgetContents(a);
+	CHECK(cache.loadTexture(directory.write("later.png", "first image")) != texture);
+}
+
+/***********************************************************************************/
+// Meshes are the same when their geometry and their texture object are
+TEST(AssetCacheDedupsMeshes) {
+	const TempDirectory directory("SolEngineAssetCacheMeshes");
+	const auto model = directory.write("model.obj", Triangle);
+	const auto copy = directory.write("copy.obj", Triangle);
+	const auto texture = directory.write("a.png", "first image");
+	const auto textureCopy = directory.write("copy.png", "first image");
+	const auto otherTexture = directory.write("b.png", "second image");
+
+	AssetCache cache;
+	const auto mesh = cache.loadMesh(model, texture);
+	CHECK(mesh != nullptr && mesh->indices.size() == 3);
+	CHECK(cache.loadMesh(model, texture) == mesh);
+	CHECK(cache.loadMesh(copy, textureCopy) == mesh);
+
+	const auto retextured = cache.loadMesh(model, otherTexture);
+	CHECK(retextured != mesh);
+	CHECK(retextured->texture != mesh->texture);
+	CHECK(cache.meshCount() == 2);
+
+	const auto found = cache.findMeshes(model);
+	CHECK(found.size() == 2);
+	CHECK(std::find(found.begin(), found.end(), mesh) != found.end());
+	CHECK(std::find(found.begin(), found.end(), retextured) != found.end());
+}
+
+/***********************************************************************************/
+// The cache holds no strong references, assets go with their last handle
+TEST(AssetCacheReleasesWithLastHandle) {
+	const TempDirectory directory("SolEngineAssetCacheRelease");
+	const auto model = directory.write("model.obj", Triangle);
+	const auto texture = directory.write("a.png", "first image");
+
+	AssetCache cache;
+	auto mesh = cache.loadMesh(model, texture);
+	std::weak_ptr<Texture> weakTexture = mesh->texture;
+	CHECK(cache.meshCount() == 1 && cache.textureCount() == 1);
+
+	// The mesh keeps its texture alive
+	auto handle = cache.loadMesh(model, texture);
+	mesh.reset();
+	CHECK(cache.meshCount() == 1 && cache.textureCount() == 1);
+
+	handle.reset();
+	CHECK(cache.meshCount() == 0);
+	CHECK(cache.textureCount() == 0);
+	CHECK(weakTexture.expired());
+	CHECK(cache.findTexture(texture) == nullptr);
+	CHECK(cache.findMeshes(model).empty());
+
+	// And come back as new loads
+	mesh = cache.loadMesh(model, texture);
+	CHECK(mesh != nullptr);
+	CHECK(cache.meshCount() == 1 && cache.textureCount() == 1);
+}
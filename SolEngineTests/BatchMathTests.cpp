@@ -0,0 +1,227 @@
+#include "Test.h"
+
+#include <Graphics/Frustum.h>
+#include <Math/BatchMath.h>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <limits>
+#include <random>
+#include <string>
+
+namespace {
+	using BatchMath::InstructionSet;
+
+	// Around every SIMD width, so the kernels' tails are covered
+	constexpr std::size_t Counts[] { 0, 1, 2, 3, 4, 5, 7, 8, 9, 15, 17, 31, 33, 1000 };
+
+	/***********************************************************************************/
+	// Within float rounding of a sum of terms of the given magnitude (the same sum over absolute values), which
+	// allows for cancellation. Whole columns at a time: glm's vec4 component indexing trips GCC's alias analysis.
+	bool near(const glm::vec4& a, const glm::vec4& b, const glm::vec4& magnitude) {
+		return !glm::any(glm::greaterThan(glm::abs(a - b), (magnitude + 1.0f) * 1e-5f));
+	}
+
+	/***********************************************************************************/
+	bool near(const glm::vec3& a, const glm::vec3& b, const glm::vec3& magnitude) {
+		return near(glm::vec4(a, 0.0f), glm::vec4(b, 0.0f), glm::vec4(magnitude, 0.0f));
+	}
+
+	/***********************************************************************************/
+	glm::mat4 abs(const glm::mat4& m) {
+		return glm::mat4(glm::abs(m[0]), glm::abs(m[1]), glm::abs(m[2]), glm::abs(m[3]));
+	}
+
+	/***********************************************************************************/
+	bool nearProduct(const glm::mat4& result, const glm::mat4& a, const glm::mat4& b) {
+		const auto expected = a * b, magnitude = abs(a) * abs(b);
+		return near(result[0], expected[0], magnitude[0]) && near(result[1], expected[1], magnitude[1]) &&
+			near(result[2], expected[2], magnitude[2]) && near(result[3], expected[3], magnitude[3]);
+	}
+
+	/***********************************************************************************/
+	// Rotation, non-uniform scale and translation, like a scene's model matrices
+	glm::mat4 randomAffine(std::mt19937& random) {
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f), scale(0.1f, 10.0f);
+
+		auto m = glm::translate(glm::mat4(1.0f), glm::vec3(unit(random), unit(random), unit(random)) * 100.0f);
+		m = glm::rotate(m, unit(random) * 3.0f, glm::normalize(glm::vec3(unit(random), unit(random), unit(random)) + glm::vec3(0.0f, 0.0f, 1e-3f)));
+		return glm::scale(m, glm::vec3(scale(random), scale(random), scale(random)));
+	}
+
+	/***********************************************************************************/
+	// Every set the CPU runs, naming the ones that failed, then back to the detected one
+	template <typename Check>
+	void forEachInstructionSet(Check&& check) {
+		for (const auto set : { InstructionSet::Scalar, InstructionSet::SSE2, InstructionSet::AVX2 }) {
+			if (!BatchMath::setInstructionSet(set)) {
+				std::printf("  AVX2 not supported, skipped\n");
+				continue;
+			}
+
+			const auto failures = Test::state().failures;
+			check();
+			if (Test::state().failures != failures) {
+				std::printf("  ...with the %s kernels\n", BatchMath::instructionSet());
+			}
+		}
+
+		BatchMath::setInstructionSet(BatchMath::supports(InstructionSet::AVX2) ? InstructionSet::AVX2 : InstructionSet::SSE2);
+	}
+}
+
+/***********************************************************************************/
+TEST(BatchMathSelection) {
+	CHECK(BatchMath::supports(InstructionSet::Scalar) && BatchMath::supports(InstructionSet::SSE2));
+
+	CHECK(BatchMath::setInstructionSet(InstructionSet::Scalar));
+	CHECK(std::string(BatchMath::instructionSet()) == "Scalar");
+	CHECK(BatchMath::setInstructionSet(InstructionSet::SSE2));
+	CHECK(std::string(BatchMath::instructionSet()) == "SSE2");
+
+	// Unsupported sets leave the kernels alone
+	CHECK(BatchMath::setInstructionSet(InstructionSet::AVX2) == BatchMath::supports(InstructionSet::AVX2));
+	CHECK(std::string(BatchMath::instructionSet()) == (BatchMath::supports(InstructionSet::AVX2) ? "AVX2" : "SSE2"));
+}
+
+/***********************************************************************************/
+TEST(BatchMathMultiply) {
+	std::mt19937 random(37);
+
+	forEachInstructionSet([&]() {
+		for (const auto count : Counts) {
+			std::vector<glm::mat4> a(count), b(count), out(count);
+			std::generate(a.begin(), a.end(), [&]() { return randomAffine(random); });
+			std::generate(b.begin(), b.end(), [&]() { return randomAffine(random); });
+
+			BatchMath::multiply(a.data(), b.data(), out.data(), count);
+			for (std::size_t i = 0; i < count; ++i) {
+				CHECK(nearProduct(out[i], a[i], b[i]));
+			}
+
+			const auto shared = randomAffine(random);
+			BatchMath::multiply(shared, b.data(), out.data(), count);
+			for (std::size_t i = 0; i < count; ++i) {
+				CHECK(nearProduct(out[i], shared, b[i]));
+			}
+
+			// In place, through either operand
+			auto inPlace = a;
+			BatchMath::multiply(inPlace.data(), b.data(), inPlace.data(), count);
+			for (std::size_t i = 0; i < count; ++i) {
+				CHECK(nearProduct(inPlace[i], a[i], b[i]));
+			}
+
+			inPlace = b;
+			BatchMath::multiply(shared, inPlace.data(), inPlace.data(), count);
+			for (std::size_t i = 0; i < count; ++i) {
+				CHECK(nearProduct(inPlace[i], shared, b[i]));
+			}
+		}
+	});
+}
+
+/***********************************************************************************/
+TEST(BatchMathTransformPoints) {
+	std::mt19937 random(38);
+	std::uniform_real_distribution<float> position(-500.0f, 500.0f);
+
+	forEachInstructionSet([&]() {
+		for (const auto count : Counts) {
+			const auto m = randomAffine(random);
+
+			// One past the end is checked for stray writes, glm::vec3 stores are easy to get wrong by a lane
+			std::vector<glm::vec3> points(count), out(count + 1, glm::vec3(7.0f));
+			std::generate(points.begin(), points.end(), [&]() { return glm::vec3(position(random), position(random), position(random)); });
+
+			BatchMath::transformPoints(m, points.data(), out.data(), count);
+			for (std::size_t i = 0; i < count; ++i) {
+				CHECK(near(out[i], glm::vec3(m * glm::vec4(points[i], 1.0f)), glm::vec3(abs(m) * glm::vec4(glm::abs(points[i]), 1.0f))));
+			}
+			CHECK(out[count] == glm::vec3(7.0f));
+		}
+	});
+}
+
+/***********************************************************************************/
+TEST(BatchMathTransformAABBs) {
+	std::mt19937 random(39);
+	std::uniform_real_distribution<float> position(-50.0f, 50.0f), size(0.0f, 20.0f);
+
+	forEachInstructionSet([&]() {
+		for (const auto count : Counts) {
+			std::vector<glm::mat4> matrices(count);
+			std::generate(matrices.begin(), matrices.end(), [&]() { return randomAffine(random); });
+
+			std::vector<AABB> boxes(count), out(count);
+			for (auto& box : boxes) {
+				box.min = glm::vec3(position(random), position(random), position(random));
+				box.max = box.min + glm::vec3(size(random), size(random), size(random));
+			}
+
+			BatchMath::transformAABBs(matrices.data(), boxes.data(), out.data(), count);
+
+			// Under an affine matrix the tight box is the one around the eight transformed corners
+			for (std::size_t i = 0; i < count; ++i) {
+				AABB expected;
+				const auto magnitude = glm::vec3(abs(matrices[i]) * glm::vec4(glm::max(glm::abs(boxes[i].min), glm::abs(boxes[i].max)), 1.0f));
+				for (int corner = 0; corner < 8; ++corner) {
+					const glm::vec3 point((corner & 1) ? boxes[i].max.x : boxes[i].min.x, (corner & 2) ? boxes[i].max.y : boxes[i].min.y, (corner & 4) ? boxes[i].max.z : boxes[i].min.z);
+					expected.expand(glm::vec3(matrices[i] * glm::vec4(point, 1.0f)));
+				}
+
+				CHECK(near(out[i].min, expected.min, magnitude) && near(out[i].max, expected.max, magnitude));
+			}
+		}
+	});
+}
+
+/***********************************************************************************/
+TEST(BatchMathCullSpheres) {
+	std::mt19937 random(40);
+	std::uniform_real_distribution<float> position(-100.0f, 100.0f), radius(0.0f, 10.0f);
+
+	const Frustum frustum(glm::perspective(glm::radians(60.0f), 1.5f, 0.1f, 120.0f) * glm::lookAt(glm::vec3(-20.0f, 10.0f, 5.0f), glm::vec3(30.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f)));
+
+	forEachInstructionSet([&]() {
+		for (const auto count : Counts) {
+			// Padded as the header asks, with spheres that fail every plane
+			const auto padded = (count + BatchMath::SpherePadding - 1) / BatchMath::SpherePadding * BatchMath::SpherePadding;
+			std::vector<float> x(padded, 0.0f), y(padded, 0.0f), z(padded, 0.0f), r(padded, std::numeric_limits<float>::lowest());
+			for (std::size_t i = 0; i < count; ++i) {
+				x[i] = position(random);
+				y[i] = position(random);
+				z[i] = position(random);
+				r[i] = radius(random);
+			}
+
+			// Appends, so whatever is already there stays
+			std::vector<std::uint32_t> visible { 12345 };
+			BatchMath::cullSpheres(frustum.planes.data(), frustum.planes.size(), x.data(), y.data(), z.data(), r.data(), count, visible);
+			CHECK(!visible.empty() && visible.front() == 12345);
+			visible.erase(visible.begin());
+
+			std::size_t expectedCount = 0;
+			auto next = visible.cbegin();
+			for (std::uint32_t i = 0; i < count; ++i) {
+				const BoundingSphere sphere { glm::vec3(x[i], y[i], z[i]), r[i] };
+				const auto expected = frustum.intersects(sphere);
+				const auto reported = next != visible.cend() && *next == i;
+				next += reported ? 1 : 0;
+				expectedCount += expected ? 1 : 0;
+
+				// FMA can round a sphere touching a plane either way
+				if (reported != expected) {
+					CHECK(std::any_of(frustum.planes.cbegin(), frustum.planes.cend(), [&](const glm::vec4& plane) {
+						return std::abs(glm::dot(glm::vec3(plane), sphere.center) + plane.w + sphere.radius) < 1e-3f;
+					}));
+				}
+			}
+
+			// Ascending, each index once, none past count
+			CHECK(next == visible.cend());
+			CHECK(count < 1000 || expectedCount > 0);
+		}
+	});
+}
@@ -0,0 +1,173 @@
+#include "Test.h"
+
+#include <Scene/Bvh.h>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <limits>
+#include <random>
+
+namespace {
+	/***********************************************************************************/
+	std::vector<AABB> randomBoxes(std::mt19937& random, const std::size_t count) {
+		std::uniform_real_distribution<float> position(-50.0f, 50.0f), size(0.1f, 3.0f);
+
+		std::vector<AABB> boxes(count);
+		for (auto& box : boxes) {
+			box.min = glm::vec3(position(random), position(random), position(random));
+			box.max = box.min + glm::vec3(size(random), size(random), size(random));
+		}
+		return boxes;
+	}
+
+	/***********************************************************************************/
+	// Reference slab test, one axis at a time
+	float rayEntry(const AABB& box, const glm::vec3& origin, const glm::vec3& direction, const float maxDistance) {
+		auto entry = 0.0f, exit = maxDistance;
+		const float minimum[] { box.min.x, box.min.y, box.min.z }, maximum[] { box.max.x, box.max.y, box.max.z };
+		const float start[] { origin.x, origin.y, origin.z }, step[] { direction.x, direction.y, direction.z };
+
+		for (int axis = 0; axis < 3; ++axis) {
+			const auto t0 = (minimum[axis] - start[axis]) / step[axis];
+			const auto t1 = (maximum[axis] - start[axis]) / step[axis];
+			entry = std::max(entry, std::min(t0, t1));
+			exit = std::min(exit, std::max(t0, t1));
+		}
+
+		return entry <= exit ? entry : std::numeric_limits<float>::infinity();
+	}
+
+	/***********************************************************************************/
+	bool overlaps(const AABB& a, const AABB& b) {
+		return a.min.x <= b.max.x && a.max.x >= b.min.x &&
+			a.min.y <= b.max.y && a.max.y >= b.min.y &&
+			a.min.z <= b.max.z && a.max.z >= b.min.z;
+	}
+
+	/***********************************************************************************/
+	// Outside if the box's most positive corner is behind any plane
+	bool intersects(const Frustum& frustum, const AABB& box) {
+		for (const auto& plane : frustum.planes) {
+			const glm::vec3 corner(plane.x >= 0.0f ? box.max.x : box.min.x, plane.y >= 0.0f ? box.max.y : box.min.y, plane.z >= 0.0f ? box.max.z : box.min.z);
+			if (glm::dot(glm::vec3(plane), corner) + plane.w < 0.0f) {
+				return false;
+			}
+		}
+		return true;
+	}
+}
+
+/***********************************************************************************/
+TEST(BvhRaycastMatchesBruteForce) {
+	std::mt19937 random(3);
+	const auto boxes = randomBoxes(random, 3000);
+
+	Bvh bvh;
+	bvh.build(boxes.data(), boxes.size());
+
+	const auto infinity = std::numeric_limits<float>::infinity();
+
+	// Straight up from above everything: a miss even with an unbounded ray
+	std::uint32_t object = ~0u;
+	auto distance = 0.0f;
+	CHECK(!bvh.raycast(glm::vec3(0.0f, 0.0f, 100.0f), glm::vec3(0.0f, 0.0f, 1.0f), infinity, object, distance));
+	CHECK(distance == infinity);
+	CHECK(object == ~0u);
+
+	// Straight down onto a known box
+	const auto& target = boxes[1234];
+	const auto origin = glm::vec3(target.center().x, target.center().y, 100.0f);
+	CHECK(bvh.raycast(origin, glm::vec3(0.0f, 0.0f, -1.0f), infinity, object, distance));
+	CHECK(distance <= 100.0f - target.max.z + 1e-3f);
+	CHECK(Test::near(distance, rayEntry(boxes[object], origin, glm::vec3(0.0f, 0.0f, -1.0f), infinity), 1e-4f));
+
+	// Nothing is nearer than that hit, so a ray half as long misses
+	CHECK(!bvh.raycast(origin, glm::vec3(0.0f, 0.0f, -1.0f), distance * 0.5f, object, distance));
+	CHECK(distance == infinity);
+
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	std::size_t hits = 0;
+	for (int ray = 0; ray < 2000; ++ray) {
+		const glm::vec3 start(unit(random) * 60.0f, unit(random) * 60.0f, unit(random) * 60.0f);
+		const glm::vec3 direction(unit(random), unit(random), unit(random));
+		const auto maxDistance = ray % 2 == 0 ? infinity : 40.0f;
+
+		auto expected = infinity;
+		for (const auto& box : boxes) {
+			expected = std::min(expected, rayEntry(box, start, direction, maxDistance));
+		}
+
+		object = ~0u;
+		const auto hit = bvh.raycast(start, direction, maxDistance, object, distance);
+		CHECK(hit == (expected != infinity));
+		if (hit) {
+			++hits;
+			CHECK(Test::near(distance, expected, 1e-4f));
+			CHECK(Test::near(rayEntry(boxes[object], start, direction, maxDistance), expected, 1e-4f));
+		}
+		else {
+			CHECK(distance == infinity);
+		}
+	}
+
+	// Both outcomes are actually exercised
+	CHECK(hits > 100 && hits < 1900);
+}
+
+/***********************************************************************************/
+TEST(BvhQueriesMatchBruteForce) {
+	std::mt19937 random(5);
+	auto boxes = randomBoxes(random, 3000);
+
+	Bvh bvh;
+	bvh.build(boxes.data(), boxes.size());
+
+	std::uniform_real_distribution<float> position(-60.0f, 60.0f), size(0.0f, 20.0f);
+	std::vector<std::uint32_t> results, expected;
+
+	const auto check = [&]() {
+		for (int query = 0; query < 200; ++query) {
+			AABB box;
+			box.min = glm::vec3(position(random), position(random), position(random));
+			box.max = box.min + glm::vec3(size(random), size(random), size(random));
+
+			expected.clear();
+			for (std::uint32_t i = 0; i < boxes.size(); ++i) {
+				if (overlaps(boxes[i], box)) {
+					expected.push_back(i);
+				}
+			}
+
+			bvh.queryAABB(box, results);
+			std::sort(results.begin(), results.end());
+			CHECK(results == expected);
+		}
+
+		const Frustum frustum(glm::perspective(glm::radians(60.0f), 1.5f, 0.1f, 80.0f) * glm::lookAt(glm::vec3(-70.0f, 10.0f, 0.0f), glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, 1.0f)));
+		expected.clear();
+		for (std::uint32_t i = 0; i < boxes.size(); ++i) {
+			if (intersects(frustum, boxes[i])) {
+				expected.push_back(i);
+			}
+		}
+
+		bvh.cullFrustum(frustum, results);
+		std::sort(results.begin(), results.end());
+		CHECK(!expected.empty() && expected.size() < boxes.size());
+		CHECK(results == expected);
+	};
+
+	check();
+
+	// Same answers after the objects moved and the tree was refit (or rebuilt)
+	std::uniform_real_distribution<float> nudge(-2.0f, 2.0f);
+	for (auto& box : boxes) {
+		const glm::vec3 offset(nudge(random), nudge(random), nudge(random));
+		box.min += offset;
+		box.max += offset;
+	}
+	bvh.update(boxes.data(), boxes.size());
+
+	check();
+}
@@ -0,0 +1,181 @@
+#include "Test.h"
+
+#include <Graphics/FrustumCuller.h>
+#include <Graphics/Mesh.h>
+#include <Graphics/MeshOptimizer.h>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <iterator>
+#include <random>
+
+namespace {
+	/***********************************************************************************/
+	// Latitude/longitude sphere, reordered like Mesh::loadModel does before meshlets are built
+	MeshPtr createSphereMesh(const std::uint32_t segments, const std::uint32_t rings) {
+		std::vector<Vertex> vertices;
+		for (std::uint32_t ring = 0; ring <= rings; ++ring) {
+			const auto theta = glm::pi<float>() * ring / rings;
+			for (std::uint32_t segment = 0; segment <= segments; ++segment) {
+				const auto phi = glm::two_pi<float>() * segment / segments;
+				const glm::vec3 normal(std::sin(theta) * std::cos(phi), std::sin(theta) * std::sin(phi), std::cos(theta));
+				vertices.push_back({ normal, normal, glm::vec2(static_cast<float>(segment) / segments, static_cast<float>(ring) / rings) });
+			}
+		}
+
+		std::vector<std::uint32_t> indices;
+		for (std::uint32_t ring = 0; ring < rings; ++ring) {
+			for (std::uint32_t segment = 0; segment < segments; ++segment) {
+				const auto a = ring * (segments + 1) + segment, b = a + segments + 1;
+				indices.insert(indices.end(), { a, b, a + 1, a + 1, b, b + 1 });
+			}
+		}
+
+		MeshOptimizer::optimize(vertices, indices);
+
+		auto mesh = std::make_shared<Mesh>(vertices, indices, nullptr);
+		mesh->computeBounds();
+		mesh->buildMeshlets();
+		return mesh;
+	}
+}
+
+/***********************************************************************************/
+// One frame's CPU culling of 1M objects scattered through a 2 km cube, the camera looking across it.
+// The baseline is Frustum::intersects per object over an array of spheres, against FrustumCuller's SoA streams
+// with each instruction set BatchMath has.
+BENCHMARK(BenchmarkFrustumCulling1M) {
+	constexpr std::uint32_t ObjectCount = 1000000;
+
+	std::mt19937 random(27);
+	std::uniform_real_distribution<float> position(-1000.0f, 1000.0f), radius(0.5f, 5.0f);
+
+	std::vector<BoundingSphere> spheres(ObjectCount);
+	FrustumCuller culler;
+	culler.reserve(ObjectCount);
+	for (auto& sphere : spheres) {
+		sphere = { glm::vec3(position(random), position(random), position(random)), radius(random) };
+		culler.add(sphere);
+	}
+
+	const auto viewProjection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 1500.0f) *
+		glm::lookAt(glm::vec3(-800.0f, 0.0f, 100.0f), glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+	const Frustum frustum(viewProjection);
+
+	std::vector<std::uint32_t> scalarVisible, batchVisible;
+	scalarVisible.reserve(ObjectCount);
+
+	const auto scalar = Test::milliseconds([&]() {
+		scalarVisible.clear();
+		for (std::uint32_t i = 0; i < ObjectCount; ++i) {
+			if (frustum.intersects(spheres[i])) {
+				scalarVisible.push_back(i);
+			}
+		}
+	});
+	std::printf("  %-24s %10.3f ms\n", "Frustum::intersects loop", scalar);
+
+	// FrustumCuller with each of BatchMath's kernels, then back to the detected ones
+	for (const auto set : { BatchMath::InstructionSet::Scalar, BatchMath::InstructionSet::SSE2, BatchMath::InstructionSet::AVX2 }) {
+		if (!BatchMath::setInstructionSet(set)) {
+			continue;
+		}
+
+		const auto batch = Test::milliseconds([&]() { culler.cull(frustum, batchVisible); });
+
+		// Same planes and comparison, only FMA contraction can move a sphere touching a plane across it
+		std::vector<std::uint32_t> differences;
+		std::set_symmetric_difference(scalarVisible.cbegin(), scalarVisible.cend(), batchVisible.cbegin(), batchVisible.cend(), std::back_inserter(differences));
+		for (const auto index : differences) {
+			const auto& sphere = spheres[index];
+			CHECK(std::any_of(frustum.planes.cbegin(), frustum.planes.cend(), [&](const glm::vec4& plane) {
+				return std::abs(glm::dot(glm::vec3(plane), sphere.center) + plane.w + sphere.radius) < 1e-3f;
+			}));
+		}
+
+		std::printf("  FrustumCuller, %-9s %10.3f ms\n", BatchMath::instructionSet(), batch);
+	}
+	BatchMath::setInstructionSet(BatchMath::supports(BatchMath::InstructionSet::AVX2) ? BatchMath::InstructionSet::AVX2 : BatchMath::InstructionSet::SSE2);
+
+	CHECK(!scalarVisible.empty() && scalarVisible.size() < ObjectCount);
+	std::printf("  %zu of %u visible\n", scalarVisible.size(), ObjectCount);
+}
+
+/***********************************************************************************/
+// Triangles submitted with and without meshlet culling along a camera path through a field of dense
+// meshes, with the per-frame CPU cost of each. Mirrors RenderSystem's CPU path at LOD 0: objects are
+// frustum culled first, then each visible object either draws whole or draws its surviving meshlets.
+BENCHMARK(BenchmarkMeshletCulling) {
+	constexpr std::uint32_t ObjectCount = 2000, FrameCount = 120;
+
+	const auto mesh = createSphereMesh(96, 48);
+
+	std::mt19937 random(34);
+	std::uniform_real_distribution<float> position(-200.0f, 200.0f), scale(0.5f, 4.0f);
+
+	std::vector<glm::mat4> transforms(ObjectCount);
+	FrustumCuller culler;
+	for (auto& transform : transforms) {
+		transform = glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(position(random), position(random), scale(random))), glm::vec3(scale(random)));
+		culler.add(mesh->boundingSphere.transformed(transform));
+	}
+
+	// Circles the field at head height, looking a little inwards
+	std::vector<std::pair<glm::vec3, glm::mat4>> cameras;
+	for (std::uint32_t frame = 0; frame < FrameCount; ++frame) {
+		const auto angle = glm::two_pi<float>() * frame / FrameCount;
+		const auto eye = glm::vec3(std::cos(angle), std::sin(angle), 0.0f) * 120.0f + glm::vec3(0.0f, 0.0f, 2.0f);
+		const auto target = glm::vec3(std::cos(angle + 1.8f), std::sin(angle + 1.8f), 0.0f) * 120.0f + glm::vec3(0.0f, 0.0f, 2.0f);
+		cameras.emplace_back(eye, glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 400.0f) * glm::lookAt(eye, target, glm::vec3(0.0f, 0.0f, 1.0f)));
+	}
+
+	std::vector<std::uint32_t> visible;
+	std::size_t wholeTriangles = 0, meshletTriangles = 0, wholeDraws = 0, meshletDraws = 0;
+
+	const auto wholeMs = Test::milliseconds([&]() {
+		wholeTriangles = wholeDraws = 0;
+		for (const auto& camera : cameras) {
+			culler.cull(Frustum(camera.second), visible);
+			wholeDraws += visible.size();
+			wholeTriangles += visible.size() * mesh->lods[0].indexCount / 3;
+		}
+	});
+
+	const auto meshletMs = Test::milliseconds([&]() {
+		meshletTriangles = meshletDraws = 0;
+		for (const auto& camera : cameras) {
+			const Frustum frustum(camera.second);
+			culler.cull(frustum, visible);
+
+			for (const auto objectIndex : visible) {
+				const auto& transform = transforms[objectIndex];
+				const glm::mat3 rotation(transform);
+
+				// Neighbouring survivors merge into one draw, as in RenderSystem
+				auto mergeable = false;
+				for (const auto& meshlet : mesh->meshlets) {
+					const auto meshletSphere = meshlet.boundingSphere.transformed(transform);
+					const auto coneAxis = glm::normalize(rotation * meshlet.coneAxis);
+
+					if (!frustum.intersects(meshletSphere) || meshlet.isBackfacing(meshletSphere, coneAxis, camera.first)) {
+						mergeable = false;
+						continue;
+					}
+
+					meshletDraws += mergeable ? 0 : 1;
+					meshletTriangles += meshlet.indexCount / 3;
+					mergeable = true;
+				}
+			}
+		}
+	});
+
+	CHECK(mesh->meshlets.size() > 1);
+	CHECK(wholeTriangles > 0 && meshletTriangles < wholeTriangles);
+
+	std::printf("  %u triangles in %zu meshlets per mesh, %u objects, %u frames\n", mesh->lods[0].indexCount / 3, mesh->meshlets.size(), ObjectCount, FrameCount);
+	std::printf("  %-8s %16s %16s %16s\n", "", "triangles/frame", "draws/frame", "CPU ms/frame");
+	std::printf("  %-8s %16zu %16zu %16.4f\n", "whole", wholeTriangles / FrameCount, wholeDraws / FrameCount, wholeMs / FrameCount);
+	std::printf("  %-8s %16zu %16zu %16.4f\n", "meshlet", meshletTriangles / FrameCount, meshletDraws / FrameCount, meshletMs / FrameCount);
+}
@@ -0,0 +1,311 @@
+#include "Test.h"
+#include "TestDevice.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cstring>
+#include <random>
+
+namespace {
+	// Largest minUniformBufferOffsetAlignment the spec allows, so valid everywhere
+	constexpr VkDeviceSize UniformStride = 256;
+	constexpr std::uint32_t TargetSize = 256;
+
+	/***********************************************************************************/
+	VkPipeline createPipeline(const VkDevice device, const VkShaderModule vertexShader, const VkShaderModule fragmentShader, const VkPipelineLayout layout, const VkRenderPass renderPass) {
+		VkPipelineShaderStageCreateInfo stages[2] {};
+		stages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		stages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+		stages[0].module = vertexShader;
+		stages[0].pName = "main";
+		stages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		stages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+		stages[1].module = fragmentShader;
+		stages[1].pName = "main";
+
+		VkPipelineVertexInputStateCreateInfo vertexInput {};
+		vertexInput.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+
+		VkPipelineInputAssemblyStateCreateInfo inputAssembly {};
+		inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+		inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+		const VkViewport viewport { 0.0f, 0.0f, static_cast<float>(TargetSize), static_cast<float>(TargetSize), 0.0f, 1.0f };
+		const VkRect2D scissor { { 0, 0 }, { TargetSize, TargetSize } };
+		VkPipelineViewportStateCreateInfo viewportState {};
+		viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+		viewportState.viewportCount = 1;
+		viewportState.pViewports = &viewport;
+		viewportState.scissorCount = 1;
+		viewportState.pScissors = &scissor;
+
+		VkPipelineRasterizationStateCreateInfo rasterizer {};
+		rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+		rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+		rasterizer.cullMode = VK_CULL_MODE_NONE;
+		rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+		rasterizer.lineWidth = 1.0f;
+
+		VkPipelineMultisampleStateCreateInfo multisampling {};
+		multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+		multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+		VkPipelineColorBlendAttachmentState blendAttachment {};
+		blendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+		VkPipelineColorBlendStateCreateInfo colorBlending {};
+		colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+		colorBlending.attachmentCount = 1;
+		colorBlending.pAttachments = &blendAttachment;
+
+		VkGraphicsPipelineCreateInfo pipelineInfo {};
+		pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+		pipelineInfo.stageCount = 2;
+		pipelineInfo.pStages = stages;
+		pipelineInfo.pVertexInputState = &vertexInput;
+		pipelineInfo.pInputAssemblyState = &inputAssembly;
+		pipelineInfo.pViewportState = &viewportState;
+		pipelineInfo.pRasterizationState = &rasterizer;
+		pipelineInfo.pMultisampleState = &multisampling;
+		pipelineInfo.pColorBlendState = &colorBlending;
+		pipelineInfo.layout = layout;
+		pipelineInfo.renderPass = renderPass;
+
+		auto pipeline = VkPipeline(VK_NULL_HANDLE);
+		vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline);
+		return pipeline;
+	}
+}
+
+/***********************************************************************************/
+// Per-draw model matrices through vkCmdPushConstants (what basic.vert used to do) against one dynamic
+// uniform buffer offset per draw, at 1k/10k/100k single-triangle draws. Record is CPU time to write the
+// matrices (UBO only) and record the command buffer, total adds submitting and waiting for the GPU.
+BENCHMARK(BenchmarkPushConstantsVsDynamicUniforms) {
+	TestDevice testDevice;
+	if (!testDevice.valid()) {
+		SKIP("no Vulkan device");
+	}
+	const auto device = testDevice.device();
+
+	const auto pushShader = testDevice.createShaderModule("../SolEngineTests/Shaders/draw_push.spv");
+	const auto uniformShader = testDevice.createShaderModule("../SolEngineTests/Shaders/draw_ubo.spv");
+	const auto fragmentShader = testDevice.createShaderModule("../SolEngineTests/Shaders/flat.spv");
+	if (!pushShader || !uniformShader || !fragmentShader) {
+		SKIP("run from SolEngine/ to find ../SolEngineTests/Shaders");
+	}
+
+	const auto target = testDevice.createImage(TargetSize, TargetSize, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT);
+
+	VkAttachmentDescription colorAttachment {};
+	colorAttachment.format = VK_FORMAT_R8G8B8A8_UNORM;
+	colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+	colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+	colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+	colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	colorAttachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+	const VkAttachmentReference colorReference { 0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+	VkSubpassDescription subpass {};
+	subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+	subpass.colorAttachmentCount = 1;
+	subpass.pColorAttachments = &colorReference;
+
+	VkRenderPassCreateInfo renderPassInfo {};
+	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+	renderPassInfo.attachmentCount = 1;
+	renderPassInfo.pAttachments = &colorAttachment;
+	renderPassInfo.subpassCount = 1;
+	renderPassInfo.pSubpasses = &subpass;
+
+	auto renderPass = VkRenderPass(VK_NULL_HANDLE);
+	vkCreateRenderPass(device, &renderPassInfo, nullptr, &renderPass);
+
+	VkFramebufferCreateInfo framebufferInfo {};
+	framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+	framebufferInfo.renderPass = renderPass;
+	framebufferInfo.attachmentCount = 1;
+	framebufferInfo.pAttachments = &target.view;
+	framebufferInfo.width = TargetSize;
+	framebufferInfo.height = TargetSize;
+	framebufferInfo.layers = 1;
+
+	auto framebuffer = VkFramebuffer(VK_NULL_HANDLE);
+	vkCreateFramebuffer(device, &framebufferInfo, nullptr, &framebuffer);
+
+	// Push constant path: one mat4 for the vertex stage
+	const VkPushConstantRange pushRange { VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(glm::mat4) };
+	VkPipelineLayoutCreateInfo pushLayoutInfo {};
+	pushLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pushLayoutInfo.pushConstantRangeCount = 1;
+	pushLayoutInfo.pPushConstantRanges = &pushRange;
+
+	auto pushLayout = VkPipelineLayout(VK_NULL_HANDLE);
+	vkCreatePipelineLayout(device, &pushLayoutInfo, nullptr, &pushLayout);
+
+	// Dynamic uniform path: one set, rebound with a new offset per draw
+	const VkDescriptorSetLayoutBinding uniformBinding { 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1, VK_SHADER_STAGE_VERTEX_BIT, nullptr };
+	VkDescriptorSetLayoutCreateInfo setLayoutInfo {};
+	setLayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	setLayoutInfo.bindingCount = 1;
+	setLayoutInfo.pBindings = &uniformBinding;
+
+	auto setLayout = VkDescriptorSetLayout(VK_NULL_HANDLE);
+	vkCreateDescriptorSetLayout(device, &setLayoutInfo, nullptr, &setLayout);
+
+	VkPipelineLayoutCreateInfo uniformLayoutInfo {};
+	uniformLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	uniformLayoutInfo.setLayoutCount = 1;
+	uniformLayoutInfo.pSetLayouts = &setLayout;
+
+	auto uniformLayout = VkPipelineLayout(VK_NULL_HANDLE);
+	vkCreatePipelineLayout(device, &uniformLayoutInfo, nullptr, &uniformLayout);
+
+	const VkDescriptorPoolSize poolSize { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1 };
+	VkDescriptorPoolCreateInfo poolInfo {};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.maxSets = 1;
+	poolInfo.poolSizeCount = 1;
+	poolInfo.pPoolSizes = &poolSize;
+
+	auto descriptorPool = VkDescriptorPool(VK_NULL_HANDLE);
+	vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool);
+
+	VkDescriptorSetAllocateInfo allocInfo {};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = descriptorPool;
+	allocInfo.descriptorSetCount = 1;
+	allocInfo.pSetLayouts = &setLayout;
+
+	auto descriptorSet = VkDescriptorSet(VK_NULL_HANDLE);
+	vkAllocateDescriptorSets(device, &allocInfo, &descriptorSet);
+
+	constexpr std::uint32_t MaxDraws = 100000;
+	const auto uniformBuffer = testDevice.createBuffer(UniformStride * MaxDraws, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
+
+	const VkDescriptorBufferInfo bufferInfo { uniformBuffer.buffer, 0, sizeof(glm::mat4) };
+	VkWriteDescriptorSet write {};
+	write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write.dstSet = descriptorSet;
+	write.dstBinding = 0;
+	write.descriptorCount = 1;
+	write.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+	write.pBufferInfo = &bufferInfo;
+	vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+
+	const auto pushPipeline = createPipeline(device, pushShader, fragmentShader, pushLayout, renderPass);
+	const auto uniformPipeline = createPipeline(device, uniformShader, fragmentShader, uniformLayout, renderPass);
+
+	// Small triangles scattered over the target
+	std::mt19937 random(17);
+	std::uniform_real_distribution<float> position(-1.0f, 0.95f);
+	std::vector<glm::mat4> models(MaxDraws);
+	for (auto& model : models) {
+		model = glm::translate(glm::mat4(1.0f), glm::vec3(position(random), position(random), 0.0f));
+	}
+
+	const auto beginPass = [&](const VkCommandBuffer commandBuffer, const VkPipeline pipeline) {
+		const VkClearValue clearColor { { { 0.0f, 0.0f, 0.0f, 1.0f } } };
+		VkRenderPassBeginInfo beginInfo {};
+		beginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+		beginInfo.renderPass = renderPass;
+		beginInfo.framebuffer = framebuffer;
+		beginInfo.renderArea = { { 0, 0 }, { TargetSize, TargetSize } };
+		beginInfo.clearValueCount = 1;
+		beginInfo.pClearValues = &clearColor;
+
+		vkCmdBeginRenderPass(commandBuffer, &beginInfo, VK_SUBPASS_CONTENTS_INLINE);
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+	};
+
+	// Both paths have to draw the same picture, or the timings compare different work
+	const auto pushImage = testDevice.createBuffer(TargetSize * TargetSize * 4, VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+	const auto uniformImage = testDevice.createBuffer(TargetSize * TargetSize * 4, VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+	const auto readBack = [&](const VkCommandBuffer commandBuffer, const TestDevice::Buffer& destination) {
+		VkImageMemoryBarrier barrier {};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+		barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = target.image;
+		barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+		VkBufferImageCopy region {};
+		region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+		region.imageExtent = { TargetSize, TargetSize, 1 };
+		vkCmdCopyImageToBuffer(commandBuffer, target.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, destination.buffer, 1, &region);
+	};
+
+	const auto recordPush = [&](const VkCommandBuffer commandBuffer, const std::uint32_t drawCount) {
+		beginPass(commandBuffer, pushPipeline);
+		for (std::uint32_t i = 0; i < drawCount; ++i) {
+			vkCmdPushConstants(commandBuffer, pushLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(glm::mat4), &models[i]);
+			vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+		}
+		vkCmdEndRenderPass(commandBuffer);
+	};
+
+	const auto recordUniform = [&](const VkCommandBuffer commandBuffer, const std::uint32_t drawCount) {
+		// The matrices have to reach the buffer every frame, like the push constants do
+		auto* uniforms = static_cast<char*>(uniformBuffer.data);
+		for (std::uint32_t i = 0; i < drawCount; ++i) {
+			std::memcpy(uniforms + i * UniformStride, &models[i], sizeof(glm::mat4));
+		}
+
+		beginPass(commandBuffer, uniformPipeline);
+		for (std::uint32_t i = 0; i < drawCount; ++i) {
+			const auto offset = static_cast<std::uint32_t>(i * UniformStride);
+			vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, uniformLayout, 0, 1, &descriptorSet, 1, &offset);
+			vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+		}
+		vkCmdEndRenderPass(commandBuffer);
+	};
+
+	std::printf("  %8s %18s %18s %18s %18s\n", "draws", "push record ms", "push total ms", "ubo record ms", "ubo total ms");
+	for (const std::uint32_t drawCount : { 1000u, 10000u, 100000u }) {
+		auto pushRecord = std::numeric_limits<double>::max(), uniformRecord = std::numeric_limits<double>::max();
+
+		const auto pushTotal = Test::milliseconds([&]() {
+			testDevice.run([&](const VkCommandBuffer commandBuffer) {
+				pushRecord = std::min(pushRecord, Test::milliseconds([&]() { recordPush(commandBuffer, drawCount); }, 1));
+			});
+		});
+		const auto uniformTotal = Test::milliseconds([&]() {
+			testDevice.run([&](const VkCommandBuffer commandBuffer) {
+				uniformRecord = std::min(uniformRecord, Test::milliseconds([&]() { recordUniform(commandBuffer, drawCount); }, 1));
+			});
+		});
+
+		testDevice.run([&](const VkCommandBuffer commandBuffer) {
+			recordPush(commandBuffer, drawCount);
+			readBack(commandBuffer, pushImage);
+		});
+		testDevice.run([&](const VkCommandBuffer commandBuffer) {
+			recordUniform(commandBuffer, drawCount);
+			readBack(commandBuffer, uniformImage);
+		});
+
+		const auto* pixels = static_cast<const std::uint32_t*>(pushImage.data);
+		CHECK(std::count(pixels, pixels + TargetSize * TargetSize, 0xFFFFFFFFu) > 0);
+		CHECK(std::memcmp(pushImage.data, uniformImage.data, TargetSize * TargetSize * 4) == 0);
+
+		std::printf("  %8u %18.3f %18.3f %18.3f %18.3f\n", drawCount, pushRecord, pushTotal, uniformRecord, uniformTotal);
+	}
+
+	vkDestroyPipeline(device, pushPipeline, nullptr);
+	vkDestroyPipeline(device, uniformPipeline, nullptr);
+	vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+	vkDestroyPipelineLayout(device, uniformLayout, nullptr);
+	vkDestroyDescriptorSetLayout(device, setLayout, nullptr);
+	vkDestroyPipelineLayout(device, pushLayout, nullptr);
+	vkDestroyFramebuffer(device, framebuffer, nullptr);
+	vkDestroyRenderPass(device, renderPass, nullptr);
+	vkDestroyShaderModule(device, pushShader, nullptr);
+	vkDestroyShaderModule(device, uniformShader, nullptr);
+	vkDestroyShaderModule(device, fragmentShader, nullptr);
+}
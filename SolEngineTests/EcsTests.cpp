@@ -0,0 +1,148 @@
+#include "Test.h"
+
+#include <ECS/World.h>
+
+#include <algorithm>
+
+namespace {
+	// Test-only components, so the engine's own types keep their ids
+	struct Position {
+		float x, y, z;
+	};
+
+	struct Velocity {
+		float x, y, z;
+	};
+
+	struct Tag {
+		std::uint32_t value;
+	};
+}
+
+/***********************************************************************************/
+TEST(EcsCreateDestroy) {
+	World world;
+
+	const auto a = world.create(Position { 1.0f, 2.0f, 3.0f });
+	const auto b = world.create(Position { 4.0f, 5.0f, 6.0f }, Velocity { 1.0f, 0.0f, 0.0f });
+	CHECK(world.size() == 2);
+	CHECK(world.isAlive(a) && world.isAlive(b));
+	CHECK(world.count<Position>() == 2);
+	CHECK(world.count<Position, Velocity>() == 1);
+	CHECK(world.get<Velocity>(a) == nullptr);
+	CHECK(world.get<Position>(b)->x == 4.0f);
+
+	world.destroy(a);
+	CHECK(!world.isAlive(a));
+	CHECK(world.get<Position>(a) == nullptr);
+	CHECK(world.size() == 1);
+	CHECK(world.count<Position>() == 1);
+	// Destroying twice is harmless
+	world.destroy(a);
+	CHECK(world.size() == 1);
+
+	// The index is recycled with a new generation, so the stale handle stays dead
+	const auto c = world.create(Position { 7.0f, 8.0f, 9.0f });
+	CHECK(c.index == a.index);
+	CHECK(c.generation != a.generation);
+	CHECK(!world.isAlive(a));
+	CHECK(world.get<Position>(c)->z == 9.0f);
+	CHECK(world.get<Position>(b)->z == 6.0f);
+}
+
+/***********************************************************************************/
+TEST(EcsForEachChunk) {
+	World world;
+
+	// Enough to span several chunks, with holes punched in the middle
+	constexpr std::uint32_t Count = 5000;
+	std::vector<Entity> entities;
+	for (std::uint32_t i = 0; i < Count; ++i) {
+		entities.push_back(world.create(Tag { i }));
+	}
+	for (std::uint32_t i = 0; i < Count; i += 3) {
+		world.destroy(entities[i]);
+	}
+
+	std::vector<std::uint32_t> seen(Count, 0);
+	std::size_t chunks = 0, visited = 0;
+	world.forEachChunk<Tag>([&](const std::size_t count, const Entity* chunkEntities, const Tag* tags) {
+		++chunks;
+		visited += count;
+		for (std::size_t i = 0; i < count; ++i) {
+			// Every row's entity resolves back to the same component
+			CHECK(world.get<Tag>(chunkEntities[i]) == &tags[i]);
+			++seen[tags[i].value];
+		}
+	});
+
+	CHECK(chunks > 1);
+	CHECK(visited == world.count<Tag>());
+	for (std::uint32_t i = 0; i < Count; ++i) {
+		CHECK(seen[i] == (i % 3 == 0 ? 0u : 1u));
+	}
+
+	// A query for a component nobody has visits nothing
+	std::size_t empty = 0;
+	world.forEachChunk<Velocity>([&](const std::size_t count, const Entity*, const Velocity*) {
+		empty += count;
+	});
+	CHECK(empty == 0);
+}
+
+/***********************************************************************************/
+TEST(EcsArchetypeMoves) {
+	World world;
+
+	std::vector<Entity> entities;
+	for (std::uint32_t i = 0; i < 8; ++i) {
+		entities.push_back(world.create(Position { static_cast<float>(i), 0.0f, 0.0f }, Tag { i }));
+	}
+
+	// Moving a row from the middle fills the hole with the source archetype's last row
+	const auto moved = entities[2];
+	const auto version = world.version();
+	world.add(moved, Velocity { 1.0f, 2.0f, 3.0f });
+	CHECK(world.version() != version);
+	CHECK(world.has<Velocity>(moved));
+	CHECK(world.get<Position>(moved)->x == 2.0f);
+	CHECK(world.get<Tag>(moved)->value == 2);
+	CHECK(world.get<Velocity>(moved)->y == 2.0f);
+	CHECK(world.count<Position, Tag>() == 8);
+	CHECK(world.count<Position, Tag, Velocity>() == 1);
+
+	// Adding a component the entity already has overwrites it in place
+	world.add(moved, Velocity { 4.0f, 5.0f, 6.0f });
+	CHECK(world.get<Velocity>(moved)->x == 4.0f);
+	CHECK(world.count<Velocity>() == 1);
+
+	// Removal carries over what's left
+	world.remove<Tag>(moved);
+	CHECK(!world.has<Tag>(moved));
+	CHECK(world.get<Position>(moved)->x == 2.0f);
+	CHECK(world.get<Velocity>(moved)->z == 6.0f);
+	// Removing a missing component is a no-op
+	world.remove<Tag>(moved);
+	CHECK(world.isAlive(moved));
+
+	// The entities that stayed behind still find their own components
+	for (std::uint32_t i = 0; i < entities.size(); ++i) {
+		if (entities[i] != moved) {
+			CHECK(world.get<Tag>(entities[i])->value == i);
+			CHECK(world.get<Position>(entities[i])->x == static_cast<float>(i));
+		}
+	}
+
+	// Back to the original archetype
+	world.add(moved, Tag { 2 });
+	world.remove<Velocity>(moved);
+	CHECK(world.count<Position, Tag>() == 8);
+	CHECK(world.count<Velocity>() == 0);
+	CHECK(world.get<Tag>(moved)->value == 2);
+
+	// Dead handles are ignored
+	world.destroy(entities[5]);
+	world.add(entities[5], Velocity {});
+	CHECK(world.count<Velocity>() == 0);
+	CHECK(!world.has<Position>(entities[5]));
+}
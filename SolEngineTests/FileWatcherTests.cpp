@@ -0,0 +1,46 @@
+#include "Test.h"
+
+#include <Assets/FileWatcher.h>
+
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+/***********************************************************************************/
+// A file written in several steps is reported once, and only after it has been quiet for SettleTime
+TEST(FileWatcherReportsSettledChangeOnce) {
+	const auto directory = (std::filesystem::temp_directory_path() / "SolEngineFileWatcher").generic_string();
+	std::filesystem::remove_all(directory);
+	std::filesystem::create_directories(directory);
+	const auto path = directory + "/shader.comp";
+
+	FileWatcher watcher;
+	watcher.start({ directory });
+	// Let the watcher thread add its watches (or take its first scan) before anything changes
+	std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+	const auto written = FileWatcher::Clock::now();
+	std::ofstream(path, std::ios::binary) << "first half";
+	std::ofstream(path, std::ios::binary | std::ios::app) << ", second half";
+	CHECK(watcher.changes().empty());
+
+	// Polling only notices the change on its next scan
+	const auto deadline = written + FileWatcher::SettleTime + 2 * FileWatcher::PollInterval + std::chrono::seconds(1);
+	std::vector<std::string> changes;
+	while (changes.empty() && FileWatcher::Clock::now() < deadline) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		changes = watcher.changes();
+	}
+
+	CHECK(FileWatcher::Clock::now() - written >= FileWatcher::SettleTime);
+	CHECK(changes.size() == 1);
+	CHECK(!changes.empty() && changes.front() == path);
+
+	// Nothing is reported twice
+	std::this_thread::sleep_for(FileWatcher::SettleTime + FileWatcher::PollInterval);
+	CHECK(watcher.changes().empty());
+
+	watcher.stop();
+	std::error_code error;
+	std::filesystem::remove_all(directory, error);
+}
@@ -0,0 +1,750 @@
+#include "Test.h"
+#include "TestDevice.h"
+
+#include <Graphics/Mesh.h>
+#include <Graphics/PipelineCache.h>
+#include <Graphics/ShaderReflection.h>
+#include <Graphics/Vertex.h>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <deque>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+	// RenderSystem's cluster grid, must match light_cull.comp and basic.frag
+	constexpr std::uint32_t ClusterTilesX = 16, ClusterTilesY = 9, ClusterSlices = 24;
+	constexpr std::uint32_t ClusterCount = ClusterTilesX * ClusterTilesY * ClusterSlices;
+	constexpr std::uint32_t MaxLightsPerCluster = 128;
+	constexpr std::uint32_t MaxLights = 10000;
+
+	constexpr std::uint32_t Width = 1280, Height = 720;
+	constexpr VkFormat ColorFormat = VK_FORMAT_R8G8B8A8_UNORM, DepthFormat = VK_FORMAT_D32_SFLOAT;
+	constexpr float FieldOfView = glm::radians(45.0f), NearPlane = 0.1f, FarPlane = 50.0f;
+	// Layers of spheres one behind the other, each covering the whole view
+	constexpr std::uint32_t Layers = 8, Columns = 16, Rows = 9, ObjectCount = Layers * Columns * Rows;
+
+	/***********************************************************************************/
+	// Latitude/longitude sphere, counter-clockwise seen from outside
+	Mesh createSphereMesh(const std::uint32_t segments, const std::uint32_t rings) {
+		std::vector<Vertex> vertices;
+		for (std::uint32_t ring = 0; ring <= rings; ++ring) {
+			const auto theta = glm::pi<float>() * ring / rings;
+			for (std::uint32_t segment = 0; segment <= segments; ++segment) {
+				const auto phi = glm::two_pi<float>() * segment / segments;
+				const glm::vec3 normal(std::sin(theta) * std::cos(phi), std::sin(theta) * std::sin(phi), std::cos(theta));
+				vertices.push_back({ normal, normal, glm::vec2(static_cast<float>(segment) / segments, static_cast<float>(ring) / rings) });
+			}
+		}
+
+		std::vector<std::uint32_t> indices;
+		for (std::uint32_t ring = 0; ring < rings; ++ring) {
+			for (std::uint32_t segment = 0; segment < segments; ++segment) {
+				const auto a = ring * (segments + 1) + segment, b = a + segments + 1;
+				indices.insert(indices.end(), { a, b, a + 1, a + 1, b, b + 1 });
+			}
+		}
+
+		Mesh mesh(vertices, indices, nullptr);
+		mesh.computeBounds();
+		mesh.quantize();
+		return mesh;
+	}
+
+	/***********************************************************************************/
+	// What the render graph makes of the forward pass: color and depth, plus the single sample image the
+	// color is resolved into at the end of the subpass with MSAA. loadDepth keeps the pre-pass's depth.
+	VkRenderPass createForwardPass(const VkDevice device, const VkSampleCountFlagBits samples, const bool loadDepth) {
+		std::array<VkAttachmentDescription, 3> attachments {};
+		attachments[0].format = ColorFormat;
+		attachments[0].samples = samples;
+		attachments[0].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+		attachments[0].storeOp = samples == VK_SAMPLE_COUNT_1_BIT ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		attachments[0].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+		attachments[0].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		attachments[0].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		attachments[0].finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+		attachments[1] = attachments[0];
+		attachments[1].format = DepthFormat;
+		attachments[1].loadOp = loadDepth ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR;
+		attachments[1].storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		attachments[1].initialLayout = loadDepth ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED;
+		attachments[1].finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+		attachments[2] = attachments[0];
+		attachments[2].samples = VK_SAMPLE_COUNT_1_BIT;
+		attachments[2].loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+		attachments[2].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+
+		const VkAttachmentReference colorReference { 0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+		const VkAttachmentReference depthReference { 1, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL };
+		const VkAttachmentReference resolveReference { 2, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+
+		VkSubpassDescription subpass {};
+		subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+		subpass.colorAttachmentCount = 1;
+		subpass.pColorAttachments = &colorReference;
+		subpass.pResolveAttachments = samples == VK_SAMPLE_COUNT_1_BIT ? nullptr : &resolveReference;
+		subpass.pDepthStencilAttachment = &depthReference;
+
+		VkRenderPassCreateInfo renderPassInfo {};
+		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+		renderPassInfo.attachmentCount = samples == VK_SAMPLE_COUNT_1_BIT ? 2 : 3;
+		renderPassInfo.pAttachments = attachments.data();
+		renderPassInfo.subpassCount = 1;
+		renderPassInfo.pSubpasses = &subpass;
+
+		VkRenderPass renderPass = VK_NULL_HANDLE;
+		vkCreateRenderPass(device, &renderPassInfo, nullptr, &renderPass);
+		return renderPass;
+	}
+
+	/***********************************************************************************/
+	// The depth pre-pass: depth alone, kept for the forward pass
+	VkRenderPass createDepthPass(const VkDevice device, const VkSampleCountFlagBits samples) {
+		VkAttachmentDescription attachment {};
+		attachment.format = DepthFormat;
+		attachment.samples = samples;
+		attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+		attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+		attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+		attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		attachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+		const VkAttachmentReference depthReference { 0, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL };
+		VkSubpassDescription subpass {};
+		subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+		subpass.pDepthStencilAttachment = &depthReference;
+
+		VkRenderPassCreateInfo renderPassInfo {};
+		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+		renderPassInfo.attachmentCount = 1;
+		renderPassInfo.pAttachments = &attachment;
+		renderPassInfo.subpassCount = 1;
+		renderPassInfo.pSubpasses = &subpass;
+
+		VkRenderPass renderPass = VK_NULL_HANDLE;
+		vkCreateRenderPass(device, &renderPassInfo, nullptr, &renderPass);
+		return renderPass;
+	}
+
+	/***********************************************************************************/
+	// The shipped SPIR-V of the description's variant, like RenderSystem::createGraphicsPipeline at a fixed size
+	VkPipeline createPipeline(const TestDevice& device, const VkPipelineLayout layout, const VkRenderPass renderPass, const VkSampleCountFlagBits samples,
+		const PipelineDescription& description) {
+		const auto vertex = device.createShaderModule(description.depthOnly ? "Data/Shaders/vert_depth.spv" : description.shader.precompiledVertex());
+		const auto fragment = description.depthOnly ? VK_NULL_HANDLE : device.createShaderModule(description.shader.precompiledFragment());
+
+		const ShaderVariantConstants constants { description.shader.lit, description.shader.ambient };
+		const std::array<VkSpecializationMapEntry, 2> specializationEntries {{
+			{ 0, offsetof(ShaderVariantConstants, lit), sizeof(constants.lit) },
+			{ 1, offsetof(ShaderVariantConstants, ambient), sizeof(constants.ambient) }
+		}};
+		const VkSpecializationInfo specializationInfo { 2, specializationEntries.data(), sizeof(constants), &constants };
+
+		std::array<VkPipelineShaderStageCreateInfo, 2> stages {};
+		stages[0].sType = stages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		stages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+		stages[0].module = vertex;
+		stages[0].pName = "main";
+		stages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+		stages[1].module = fragment;
+		stages[1].pName = "main";
+		stages[1].pSpecializationInfo = &specializationInfo;
+
+		constexpr auto bindingDescription = VertexLayout<GpuVertex>::getBindingDescription();
+		constexpr auto attributeDescriptions = VertexLayout<GpuVertex>::getAttributeDescriptions();
+		VkPipelineVertexInputStateCreateInfo vertexInput {};
+		vertexInput.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+		vertexInput.vertexBindingDescriptionCount = 1;
+		vertexInput.pVertexBindingDescriptions = &bindingDescription;
+		vertexInput.vertexAttributeDescriptionCount = description.depthOnly ? 1 : static_cast<std::uint32_t>(attributeDescriptions.size());
+		vertexInput.pVertexAttributeDescriptions = attributeDescriptions.data();
+
+		VkPipelineInputAssemblyStateCreateInfo inputAssembly {};
+		inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+		inputAssembly.topology = description.topology;
+
+		const VkViewport viewport { 0.0f, 0.0f, static_cast<float>(Width), static_cast<float>(Height), 0.0f, 1.0f };
+		const VkRect2D scissor { { 0, 0 }, { Width, Height } };
+		VkPipelineViewportStateCreateInfo viewportState {};
+		viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+		viewportState.viewportCount = 1;
+		viewportState.pViewports = &viewport;
+		viewportState.scissorCount = 1;
+		viewportState.pScissors = &scissor;
+
+		VkPipelineRasterizationStateCreateInfo rasterizer {};
+		rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+		rasterizer.polygonMode = description.polygonMode;
+		rasterizer.cullMode = description.cullMode;
+		rasterizer.frontFace = description.frontFace;
+		rasterizer.lineWidth = 1.0f;
+
+		VkPipelineMultisampleStateCreateInfo multisampling {};
+		multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+		multisampling.rasterizationSamples = samples;
+
+		VkPipelineDepthStencilStateCreateInfo depthStencil {};
+		depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+		depthStencil.depthTestEnable = description.depthTest;
+		depthStencil.depthWriteEnable = description.depthWrite;
+		depthStencil.depthCompareOp = description.depthCompare;
+		depthStencil.maxDepthBounds = 1.0f;
+
+		VkPipelineColorBlendAttachmentState colorBlendAttachment {};
+		colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+
+		VkPipelineColorBlendStateCreateInfo colorBlending {};
+		colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+		colorBlending.attachmentCount = description.depthOnly ? 0 : 1;
+		colorBlending.pAttachments = &colorBlendAttachment;
+
+		VkGraphicsPipelineCreateInfo pipelineInfo {};
+		pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+		pipelineInfo.stageCount = description.depthOnly ? 1 : 2;
+		pipelineInfo.pStages = stages.data();
+		pipelineInfo.pVertexInputState = &vertexInput;
+		pipelineInfo.pInputAssemblyState = &inputAssembly;
+		pipelineInfo.pViewportState = &viewportState;
+		pipelineInfo.pRasterizationState = &rasterizer;
+		pipelineInfo.pMultisampleState = &multisampling;
+		pipelineInfo.pDepthStencilState = &depthStencil;
+		pipelineInfo.pColorBlendState = &colorBlending;
+		pipelineInfo.layout = layout;
+		pipelineInfo.renderPass = renderPass;
+
+		VkPipeline pipeline = VK_NULL_HANDLE;
+		if (vertex == VK_NULL_HANDLE || (fragment == VK_NULL_HANDLE && !description.depthOnly) ||
+			vkCreateGraphicsPipelines(device.device(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS) {
+			pipeline = VK_NULL_HANDLE;
+		}
+
+		vkDestroyShaderModule(device.device(), vertex, nullptr);
+		vkDestroyShaderModule(device.device(), fragment, nullptr);
+		return pipeline;
+	}
+
+	/***********************************************************************************/
+	// The frame RenderSystem's F9/F10/F11 benchmarks time, rendered offscreen with the shipped shaders:
+	// light_cull.comp, then the optional depth pre-pass and the lit, untextured forward pass over
+	// layers of spheres drawn far to near, the worst order for overdraw.
+	class Scene {
+
+	public:
+		/***********************************************************************************/
+		// Attachments, passes and pipelines for one sample count
+		struct Target {
+			VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+			TestDevice::Image color, depth, resolved; // Without MSAA color is the result and resolved is unused
+			VkRenderPass forwardPass = VK_NULL_HANDLE, forwardLoadPass = VK_NULL_HANDLE, depthPass = VK_NULL_HANDLE;
+			VkFramebuffer framebuffer = VK_NULL_HANDLE, depthFramebuffer = VK_NULL_HANDLE;
+			// Depth-tested as usual, and the pre-pass pair: positions only, then EQUAL without depth writes
+			VkPipeline forward = VK_NULL_HANDLE, forwardEqual = VK_NULL_HANDLE, depthOnly = VK_NULL_HANDLE;
+
+			bool valid() const noexcept { return forward != VK_NULL_HANDLE && forwardEqual != VK_NULL_HANDLE && depthOnly != VK_NULL_HANDLE; }
+			const TestDevice::Image& result() const noexcept { return samples == VK_SAMPLE_COUNT_1_BIT ? color : resolved; }
+		};
+		/***********************************************************************************/
+
+		explicit Scene(TestDevice& device);
+		~Scene();
+		Scene(const Scene&) = delete;
+		Scene& operator=(const Scene&) = delete;
+
+		bool valid() const noexcept { return m_layout != VK_NULL_HANDLE && m_lightCull.pipeline != VK_NULL_HANDLE; }
+
+		// Sample counts both color and depth attachments support
+		VkSampleCountFlags supportedSampleCounts() const;
+		// Created on first use, nullptr if its pipelines can't be
+		const Target* target(const VkSampleCountFlagBits samples);
+
+		// The first count of the lights, all of them inside the view
+		void setLightCount(const std::uint32_t count) { static_cast<UniformBufferObject*>(m_uniforms.data)->clusterCount.w = count; }
+
+		// Fastest frame of a few, submitted and waited for, in milliseconds
+		double frameMilliseconds(const Target& target, const bool depthPrepass);
+		double lightCullMilliseconds();
+		// One frame, read back
+		std::vector<std::uint32_t> render(const Target& target, const bool depthPrepass);
+
+	private:
+		void recordLightCull(const VkCommandBuffer commandBuffer) const;
+		void recordFrame(const VkCommandBuffer commandBuffer, const Target& target, const bool depthPrepass) const;
+		void recordDraws(const VkCommandBuffer commandBuffer, const VkPipeline pipeline) const;
+
+		TestDevice& m_device;
+		LayoutCache m_layoutCache;
+		VkPipelineLayout m_layout = VK_NULL_HANDLE;
+		VkDescriptorPool m_descriptorPool = VK_NULL_HANDLE;
+		VkDescriptorSet m_descriptorSet = VK_NULL_HANDLE;
+		TestDevice::ComputePipeline m_lightCull;
+
+		TestDevice::Buffer m_vertices, m_indices, m_objects, m_uniforms, m_lights, m_clusterCounts, m_clusterIndices, m_lightCullStats;
+		std::uint32_t m_indexCount = 0;
+		VkIndexType m_indexType = VK_INDEX_TYPE_UINT16;
+
+		// Handed out by pointer, a deque doesn't move them
+		std::deque<Target> m_targets;
+	};
+
+	/***********************************************************************************/
+	Scene::Scene(TestDevice& device) : m_device(device) {
+		const auto vkDevice = device.device();
+		m_layoutCache.init(vkDevice);
+
+		PipelineDescription description;
+		description.shader.textured = false;
+		description.shader.lit = true;
+		const auto vert = TestDevice::readFile(description.shader.precompiledVertex()), frag = TestDevice::readFile(description.shader.precompiledFragment());
+		m_lightCull = device.createComputePipeline("Data/Shaders/light_cull.spv");
+		if (vert.empty() || frag.empty() || m_lightCull.pipeline == VK_NULL_HANDLE) {
+			return;
+		}
+
+		// One layout for every pass, vert_depth.spv uses a subset of it
+		std::vector<VkDescriptorSetLayout> setLayouts;
+		auto reflection = ShaderReflection::reflect(vert);
+		reflection.merge(ShaderReflection::reflect(frag));
+		m_layout = m_layoutCache.pipelineLayout(reflection, &setLayouts);
+
+		const VkDescriptorPoolSize poolSizes[] { { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1 }, { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 4 } };
+		VkDescriptorPoolCreateInfo poolInfo {};
+		poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		poolInfo.maxSets = 1;
+		poolInfo.poolSizeCount = static_cast<std::uint32_t>(std::size(poolSizes));
+		poolInfo.pPoolSizes = poolSizes;
+		vkCreateDescriptorPool(vkDevice, &poolInfo, nullptr, &m_descriptorPool);
+
+		VkDescriptorSetAllocateInfo allocInfo {};
+		allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		allocInfo.descriptorPool = m_descriptorPool;
+		allocInfo.descriptorSetCount = 1;
+		allocInfo.pSetLayouts = &setLayouts.front();
+		vkAllocateDescriptorSets(vkDevice, &allocInfo, &m_descriptorSet);
+
+		// Geometry
+		const auto mesh = createSphereMesh(24, 12);
+		m_vertices = device.createBuffer(sizeof(GpuVertex) * mesh.gpuVertices.size(), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+		std::memcpy(m_vertices.data, mesh.gpuVertices.data(), sizeof(GpuVertex) * mesh.gpuVertices.size());
+
+		m_indexType = mesh.indexType();
+		m_indexCount = static_cast<std::uint32_t>(mesh.indices.size());
+		m_indices = device.createBuffer(mesh.indexSize() * mesh.indices.size(), VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+		for (std::uint32_t i = 0; i < m_indexCount; ++i) {
+			if (m_indexType == VK_INDEX_TYPE_UINT16) {
+				static_cast<std::uint16_t*>(m_indices.data)[i] = static_cast<std::uint16_t>(mesh.indices[i]);
+			}
+			else {
+				static_cast<std::uint32_t*>(m_indices.data)[i] = mesh.indices[i];
+			}
+		}
+
+		// The camera sits at the origin looking down -z, so view space is world space. Each layer's spheres
+		// overlap a little and fill the view at their distance, the farthest layer comes first.
+		const auto tanHalfFov = std::tan(FieldOfView * 0.5f);
+		const auto aspect = Width / static_cast<float>(Height);
+
+		m_objects = device.createBuffer(sizeof(ObjectData) * ObjectCount, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+		auto* objects = static_cast<ObjectData*>(m_objects.data);
+		for (std::uint32_t layer = 0; layer < Layers; ++layer) {
+			const auto distance = 6.0f + 4.0f * (Layers - 1 - layer);
+			const auto halfHeight = distance * tanHalfFov, halfWidth = halfHeight * aspect;
+			const auto radius = 1.1f * halfWidth / Columns;
+
+			for (std::uint32_t row = 0; row < Rows; ++row) {
+				for (std::uint32_t column = 0; column < Columns; ++column) {
+					const glm::vec3 center(halfWidth * ((2 * column + 1) / static_cast<float>(Columns) - 1.0f),
+						halfHeight * ((2 * row + 1) / static_cast<float>(Rows) - 1.0f), -distance);
+
+					auto& object = objects[(layer * Rows + row) * Columns + column];
+					object.model = glm::scale(glm::translate(glm::mat4(1.0f), center), glm::vec3(radius));
+					object.boundingSphere = glm::vec4(mesh.boundingSphere.center, mesh.boundingSphere.radius);
+					object.positionScale = glm::vec4(mesh.positionScale, 0.0f);
+					object.positionOffset = glm::vec4(mesh.positionOffset, 0.0f);
+				}
+			}
+		}
+
+		// Set up like RenderSystem::updateUniformBuffer
+		m_uniforms = device.createBuffer(sizeof(UniformBufferObject), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
+		auto& ubo = *static_cast<UniformBufferObject*>(m_uniforms.data);
+		ubo.view = glm::mat4(1.0f);
+		ubo.proj = glm::perspective(FieldOfView, aspect, NearPlane, FarPlane);
+		ubo.proj[1][1] *= -1;
+		ubo.previousViewProjection = ubo.proj;
+		const auto sliceScale = ClusterSlices / std::log(FarPlane / NearPlane);
+		ubo.clusterCount = glm::uvec4(ClusterTilesX, ClusterTilesY, ClusterSlices, 0);
+		ubo.clusterScale = glm::vec4(ClusterTilesX / static_cast<float>(Width), ClusterTilesY / static_cast<float>(Height), sliceScale, -std::log(NearPlane) * sliceScale);
+
+		// Lights scattered through the layers, in view space like RenderSystem::updateLightBuffer writes them
+		std::mt19937 random(50);
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f), depth(6.0f, 6.0f + 4.0f * Layers), lightRadius(1.0f, 3.0f), channel(0.0f, 0.5f);
+		m_lights = device.createBuffer(sizeof(LightData) * MaxLights, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+		auto* lights = static_cast<LightData*>(m_lights.data);
+		for (std::uint32_t i = 0; i < MaxLights; ++i) {
+			const auto distance = depth(random);
+			const glm::vec3 position(unit(random) * distance * tanHalfFov * aspect, unit(random) * distance * tanHalfFov, -distance);
+			lights[i] = { glm::vec4(position, lightRadius(random)), glm::vec4(channel(random), channel(random), channel(random), 0.0f) };
+		}
+
+		m_clusterCounts = device.createBuffer(sizeof(std::uint32_t) * ClusterCount, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+		m_clusterIndices = device.createBuffer(sizeof(std::uint32_t) * ClusterCount * MaxLightsPerCluster, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+		// Overflow stats only add up here, nothing reads them
+		m_lightCullStats = device.createBuffer(sizeof(std::uint32_t) * 2, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+
+		device.bind(m_lightCull, 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, m_uniforms);
+		device.bind(m_lightCull, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, m_lights);
+		device.bind(m_lightCull, 2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, m_clusterCounts);
+		device.bind(m_lightCull, 3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, m_clusterIndices);
+		device.bind(m_lightCull, 4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, m_lightCullStats);
+
+		// RenderSystem::createDescriptorSet's bindings, minus the textures
+		const std::array<std::pair<VkDescriptorType, const TestDevice::Buffer*>, 6> bindings {{
+			{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, &m_uniforms },
+			{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, nullptr },
+			{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, &m_objects },
+			{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, &m_lights },
+			{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, &m_clusterCounts },
+			{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, &m_clusterIndices }
+		}};
+		std::array<VkDescriptorBufferInfo, 6> bufferInfos {};
+		std::vector<VkWriteDescriptorSet> writes;
+		for (std::uint32_t binding = 0; binding < bindings.size(); ++binding) {
+			if (bindings[binding].second == nullptr) {
+				continue;
+			}
+			bufferInfos[binding] = { bindings[binding].second->buffer, 0, VK_WHOLE_SIZE };
+
+			VkWriteDescriptorSet write {};
+			write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			write.dstSet = m_descriptorSet;
+			write.dstBinding = binding;
+			write.descriptorCount = 1;
+			write.descriptorType = bindings[binding].first;
+			write.pBufferInfo = &bufferInfos[binding];
+			writes.push_back(write);
+		}
+		vkUpdateDescriptorSets(vkDevice, static_cast<std::uint32_t>(writes.size()), writes.data(), 0, nullptr);
+	}
+
+	/***********************************************************************************/
+	Scene::~Scene() {
+		const auto device = m_device.device();
+		for (const auto& target : m_targets) {
+			for (const auto pipeline : { target.forward, target.forwardEqual, target.depthOnly }) {
+				vkDestroyPipeline(device, pipeline, nullptr);
+			}
+			vkDestroyFramebuffer(device, target.framebuffer, nullptr);
+			vkDestroyFramebuffer(device, target.depthFramebuffer, nullptr);
+			for (const auto renderPass : { target.forwardPass, target.forwardLoadPass, target.depthPass }) {
+				vkDestroyRenderPass(device, renderPass, nullptr);
+			}
+		}
+
+		vkDestroyDescriptorPool(device, m_descriptorPool, nullptr);
+		m_layoutCache.shutdown();
+	}
+
+	/***********************************************************************************/
+	VkSampleCountFlags Scene::supportedSampleCounts() const {
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(m_device.physicalDevice(), &properties);
+		return properties.limits.framebufferColorSampleCounts & properties.limits.framebufferDepthSampleCounts;
+	}
+
+	/***********************************************************************************/
+	const Scene::Target* Scene::target(const VkSampleCountFlagBits samples) {
+		for (const auto& target : m_targets) {
+			if (target.samples == samples) {
+				return target.valid() ? &target : nullptr;
+			}
+		}
+
+		const auto device = m_device.device();
+		Target target;
+		target.samples = samples;
+
+		const auto multisampled = samples != VK_SAMPLE_COUNT_1_BIT;
+		target.color = m_device.createImage(Width, Height, ColorFormat, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+			(multisampled ? VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT : VK_IMAGE_USAGE_TRANSFER_SRC_BIT), samples);
+		target.depth = m_device.createImage(Width, Height, DepthFormat, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, samples);
+		if (multisampled) {
+			target.resolved = m_device.createImage(Width, Height, ColorFormat, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT);
+		}
+
+		target.forwardPass = createForwardPass(device, samples, false);
+		target.forwardLoadPass = createForwardPass(device, samples, true);
+		target.depthPass = createDepthPass(device, samples);
+
+		// The forward passes only differ in load ops and layouts, so they share a framebuffer and pipelines
+		const std::array<VkImageView, 3> attachments { target.color.view, target.depth.view, target.resolved.view };
+		VkFramebufferCreateInfo framebufferInfo {};
+		framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+		framebufferInfo.renderPass = target.forwardPass;
+		framebufferInfo.attachmentCount = multisampled ? 3 : 2;
+		framebufferInfo.pAttachments = attachments.data();
+		framebufferInfo.width = Width;
+		framebufferInfo.height = Height;
+		framebufferInfo.layers = 1;
+		vkCreateFramebuffer(device, &framebufferInfo, nullptr, &target.framebuffer);
+
+		framebufferInfo.renderPass = target.depthPass;
+		framebufferInfo.attachmentCount = 1;
+		framebufferInfo.pAttachments = &target.depth.view;
+		vkCreateFramebuffer(device, &framebufferInfo, nullptr, &target.depthFramebuffer);
+
+		// RenderSystem::passDescription's variants of the lit, untextured description
+		PipelineDescription description;
+		description.shader.textured = false;
+		description.shader.lit = true;
+		target.forward = createPipeline(m_device, m_layout, target.forwardPass, samples, description);
+
+		auto equal = description;
+		equal.depthCompare = VK_COMPARE_OP_EQUAL;
+		equal.depthWrite = VK_FALSE;
+		target.forwardEqual = createPipeline(m_device, m_layout, target.forwardPass, samples, equal);
+
+		auto depthOnly = description;
+		depthOnly.shader = ShaderVariant();
+		depthOnly.depthOnly = true;
+		target.depthOnly = createPipeline(m_device, m_layout, target.depthPass, samples, depthOnly);
+
+		m_targets.push_back(target);
+		return target.valid() ? &m_targets.back() : nullptr;
+	}
+
+	/***********************************************************************************/
+	double Scene::frameMilliseconds(const Target& target, const bool depthPrepass) {
+		return Test::milliseconds([&]() {
+			m_device.run([&](const VkCommandBuffer commandBuffer) {
+				recordLightCull(commandBuffer);
+				recordFrame(commandBuffer, target, depthPrepass);
+			});
+		});
+	}
+
+	/***********************************************************************************/
+	double Scene::lightCullMilliseconds() {
+		return Test::milliseconds([&]() {
+			m_device.run([&](const VkCommandBuffer commandBuffer) {
+				recordLightCull(commandBuffer);
+			});
+		});
+	}
+
+	/***********************************************************************************/
+	std::vector<std::uint32_t> Scene::render(const Target& target, const bool depthPrepass) {
+		const auto readBack = m_device.createBuffer(Width * Height * 4, VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+
+		m_device.run([&](const VkCommandBuffer commandBuffer) {
+			recordLightCull(commandBuffer);
+			recordFrame(commandBuffer, target, depthPrepass);
+
+			TestDevice::transition(commandBuffer, target.result(), VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+				VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+			VkBufferImageCopy region {};
+			region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+			region.imageExtent = { Width, Height, 1 };
+			vkCmdCopyImageToBuffer(commandBuffer, target.result().image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, readBack.buffer, 1, &region);
+		});
+
+		const auto* pixels = static_cast<const std::uint32_t*>(readBack.data);
+		return { pixels, pixels + Width * Height };
+	}
+
+	/***********************************************************************************/
+	void Scene::recordLightCull(const VkCommandBuffer commandBuffer) const {
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_lightCull.pipeline);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_lightCull.layout, 0, 1, &m_lightCull.descriptorSet, 0, nullptr);
+		vkCmdDispatch(commandBuffer, (ClusterCount + 63) / 64, 1, 1); // local_size_x = 64
+
+		// Cluster lists have to land before the forward pass shades with them
+		VkMemoryBarrier barrier {};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+	}
+
+	/***********************************************************************************/
+	void Scene::recordFrame(const VkCommandBuffer commandBuffer, const Target& target, const bool depthPrepass) const {
+		std::array<VkClearValue, 2> clearValues {};
+		clearValues[0].color = { { 0.0f, 0.0f, 0.0f, 1.0f } };
+		clearValues[1].depthStencil = { 1.0f, 0 };
+
+		VkRenderPassBeginInfo beginInfo {};
+		beginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+		beginInfo.renderArea = { { 0, 0 }, { Width, Height } };
+
+		if (depthPrepass) {
+			beginInfo.renderPass = target.depthPass;
+			beginInfo.framebuffer = target.depthFramebuffer;
+			beginInfo.clearValueCount = 1;
+			beginInfo.pClearValues = &clearValues[1];
+			vkCmdBeginRenderPass(commandBuffer, &beginInfo, VK_SUBPASS_CONTENTS_INLINE);
+			recordDraws(commandBuffer, target.depthOnly);
+			vkCmdEndRenderPass(commandBuffer);
+
+			// The forward pass tests against the finished depth
+			VkImageMemoryBarrier barrier {};
+			barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+			barrier.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+			barrier.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT;
+			barrier.oldLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+			barrier.newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+			barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.image = target.depth.image;
+			barrier.subresourceRange = { VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, 0, 1 };
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT, VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+		}
+
+		beginInfo.renderPass = depthPrepass ? target.forwardLoadPass : target.forwardPass;
+		beginInfo.framebuffer = target.framebuffer;
+		beginInfo.clearValueCount = static_cast<std::uint32_t>(clearValues.size());
+		beginInfo.pClearValues = clearValues.data();
+		vkCmdBeginRenderPass(commandBuffer, &beginInfo, VK_SUBPASS_CONTENTS_INLINE);
+		recordDraws(commandBuffer, depthPrepass ? target.forwardEqual : target.forward);
+		vkCmdEndRenderPass(commandBuffer);
+	}
+
+	/***********************************************************************************/
+	// One instanced draw, instances are rasterized in order
+	void Scene::recordDraws(const VkCommandBuffer commandBuffer, const VkPipeline pipeline) const {
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_layout, 0, 1, &m_descriptorSet, 0, nullptr);
+
+		const DrawPushConstants pushConstants { 0 };
+		vkCmdPushConstants(commandBuffer, m_layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(pushConstants), &pushConstants);
+
+		const VkDeviceSize offset = 0;
+		vkCmdBindVertexBuffers(commandBuffer, 0, 1, &m_vertices.buffer, &offset);
+		vkCmdBindIndexBuffer(commandBuffer, m_indices.buffer, 0, m_indexType);
+		vkCmdDrawIndexed(commandBuffer, m_indexCount, ObjectCount, 0, 0, 0);
+	}
+
+	/***********************************************************************************/
+	// Sum of the color channels, for comparing how lit two frames are
+	std::uint64_t brightness(const std::vector<std::uint32_t>& pixels) {
+		std::uint64_t sum = 0;
+		for (const auto pixel : pixels) {
+			sum += (pixel & 0xFF) + ((pixel >> 8) & 0xFF) + ((pixel >> 16) & 0xFF);
+		}
+		return sum;
+	}
+}
+
+/***********************************************************************************/
+// RenderSystem::benchmarkMsaa (F9) outside the engine: the frame at every sample count color and depth
+// attachments support, resolved in the forward subpass, 1000 point lights.
+BENCHMARK(BenchmarkMsaa) {
+	TestDevice device;
+	if (!device.valid()) {
+		SKIP("no Vulkan device");
+	}
+	Scene scene(device);
+	if (!scene.valid()) {
+		SKIP("run from SolEngine/ to find Data/Shaders");
+	}
+	scene.setLightCount(1000);
+
+	const auto* single = scene.target(VK_SAMPLE_COUNT_1_BIT);
+	CHECK(single != nullptr);
+	if (single == nullptr) {
+		return;
+	}
+	const auto singleBrightness = brightness(scene.render(*single, false));
+	CHECK(singleBrightness > 0);
+
+	std::printf("  %8s %12s\n", "samples", "frame ms");
+	for (const auto samples : { VK_SAMPLE_COUNT_1_BIT, VK_SAMPLE_COUNT_2_BIT, VK_SAMPLE_COUNT_4_BIT, VK_SAMPLE_COUNT_8_BIT }) {
+		if ((scene.supportedSampleCounts() & samples) == 0) {
+			continue;
+		}
+		const auto* target = scene.target(samples);
+		CHECK(target != nullptr);
+		if (target == nullptr) {
+			continue;
+		}
+
+		// Only edges differ after the resolve, the picture as a whole is the same
+		const auto resolvedBrightness = brightness(scene.render(*target, false));
+		CHECK(resolvedBrightness > singleBrightness * 0.95 && resolvedBrightness < singleBrightness * 1.05);
+
+		std::printf("  %7ux %12.3f\n", static_cast<std::uint32_t>(samples), scene.frameMilliseconds(*target, false));
+	}
+}
+
+/***********************************************************************************/
+// RenderSystem::benchmarkDepthPrepass (F10) outside the engine: the frame with the pre-pass off and on.
+// Layers are drawn far to near under 1000 point lights, so without the pre-pass nearly every layer is shaded.
+BENCHMARK(BenchmarkDepthPrepass) {
+	TestDevice device;
+	if (!device.valid()) {
+		SKIP("no Vulkan device");
+	}
+	Scene scene(device);
+	if (!scene.valid()) {
+		SKIP("run from SolEngine/ to find Data/Shaders");
+	}
+	scene.setLightCount(1000);
+
+	const auto* target = scene.target(VK_SAMPLE_COUNT_1_BIT);
+	CHECK(target != nullptr);
+	if (target == nullptr) {
+		return;
+	}
+
+	// Invariant positions and EQUAL leave exactly the fragments LESS would have kept
+	const auto withoutPrepass = scene.render(*target, false);
+	CHECK(brightness(withoutPrepass) > 0);
+	CHECK(scene.render(*target, true) == withoutPrepass);
+
+	std::printf("  %u layers of %u spheres, drawn far to near\n", Layers, Columns * Rows);
+	std::printf("  %-10s %12s\n", "pre-pass", "frame ms");
+	std::printf("  %-10s %12.3f\n", "off", scene.frameMilliseconds(*target, false));
+	std::printf("  %-10s %12.3f\n", "on", scene.frameMilliseconds(*target, true));
+}
+
+/***********************************************************************************/
+// RenderSystem::benchmarkLights (F11) outside the engine: light_cull.comp and the whole frame with more
+// and more point lights, the same counts the in-engine benchmark steps through.
+BENCHMARK(BenchmarkPointLights) {
+	TestDevice device;
+	if (!device.valid()) {
+		SKIP("no Vulkan device");
+	}
+	Scene scene(device);
+	if (!scene.valid()) {
+		SKIP("run from SolEngine/ to find Data/Shaders");
+	}
+
+	const auto* target = scene.target(VK_SAMPLE_COUNT_1_BIT);
+	CHECK(target != nullptr);
+	if (target == nullptr) {
+		return;
+	}
+
+	std::printf("  %8s %16s %12s\n", "lights", "light cull ms", "frame ms");
+	std::uint64_t previousBrightness = 0;
+	for (const auto count : { 0u, 1000u, 2500u, 5000u, MaxLights }) {
+		scene.setLightCount(count);
+
+		// Lights only ever add, and clusters keep their first MaxLightsPerCluster
+		const auto litBrightness = brightness(scene.render(*target, false));
+		CHECK(litBrightness >= previousBrightness);
+		previousBrightness = litBrightness;
+
+		std::printf("  %8u %16.3f %12.3f\n", count, scene.lightCullMilliseconds(), scene.frameMilliseconds(*target, false));
+	}
+}
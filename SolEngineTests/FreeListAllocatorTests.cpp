@@ -0,0 +1,80 @@
+#include "Test.h"
+
+#include <Graphics/FreeListAllocator.h>
+
+/***********************************************************************************/
+// What an aligned allocation skips stays free, and first fit hands it out next
+TEST(FreeListAlignmentPaddingIsReused) {
+	FreeListAllocator allocator(256);
+
+	CHECK(allocator.allocate(10) == 0);
+	CHECK(allocator.allocate(16, 64) == 64);
+	CHECK(allocator.used() == 26);
+
+	// [10, 64) is the padding, exactly 54 bytes
+	CHECK(allocator.allocate(54) == 10);
+	CHECK(allocator.allocate(1) == 80);
+	CHECK(allocator.used() == 81);
+}
+
+/***********************************************************************************/
+// Freeing the middle range last merges it with both free neighbours into one range
+TEST(FreeListCoalescesBothNeighbours) {
+	FreeListAllocator allocator(300);
+
+	const auto a = allocator.allocate(100);
+	const auto b = allocator.allocate(100);
+	const auto c = allocator.allocate(100);
+	CHECK(a == 0 && b == 100 && c == 200);
+
+	allocator.free(a);
+	allocator.free(c);
+	// Two 100 byte holes, nothing bigger
+	CHECK(allocator.allocate(101) == FreeListAllocator::InvalidOffset);
+
+	allocator.free(b);
+	CHECK(allocator.used() == 0);
+	CHECK(allocator.allocate(300) == 0);
+	CHECK(allocator.used() == 300);
+}
+
+/***********************************************************************************/
+TEST(FreeListExhaustion) {
+	FreeListAllocator allocator(100);
+
+	CHECK(allocator.allocate(0) == FreeListAllocator::InvalidOffset);
+	CHECK(allocator.allocate(101) == FreeListAllocator::InvalidOffset);
+	CHECK(allocator.allocate(90) == 0);
+
+	// 10 bytes are left, but aligning to 16 leaves only 4 of them
+	CHECK(allocator.allocate(10, 16) == FreeListAllocator::InvalidOffset);
+	CHECK(allocator.allocate(10) == 90);
+	CHECK(allocator.allocate(1) == FreeListAllocator::InvalidOffset);
+	CHECK(allocator.used() == 100);
+
+	// An empty allocator has nothing to give
+	FreeListAllocator empty;
+	CHECK(empty.allocate(1) == FreeListAllocator::InvalidOffset);
+}
+
+/***********************************************************************************/
+// Offsets that weren't returned by allocate, or were already freed, are ignored
+TEST(FreeListIgnoresUnknownOffsets) {
+	FreeListAllocator allocator(64);
+
+	CHECK(allocator.allocate(16) == 0);
+	CHECK(allocator.allocate(16) == 16);
+
+	allocator.free(8);
+	allocator.free(1000);
+	allocator.free(FreeListAllocator::InvalidOffset);
+	CHECK(allocator.used() == 32);
+	CHECK(allocator.allocate(16) == 32);
+
+	allocator.free(0);
+	allocator.free(0);
+	CHECK(allocator.used() == 32);
+	CHECK(allocator.allocate(16) == 0);
+	CHECK(allocator.allocate(16) == 48);
+	CHECK(allocator.allocate(1) == FreeListAllocator::InvalidOffset);
+}
@@ -0,0 +1,260 @@
+#include "Test.h"
+#include "TestDevice.h"
+
+#include <Graphics/FrustumCuller.h>
+#include <Graphics/Meshlet.h>
+#include <Graphics/Vertex.h>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <random>
+
+namespace {
+	/***********************************************************************************/
+	// Spheres this close to a plane may land on either side depending on rounding (as in validateGpuCulling)
+	bool borderline(const Frustum& frustum, const BoundingSphere& sphere) {
+		for (const auto& plane : frustum.planes) {
+			const auto distance = glm::dot(glm::vec3(plane), sphere.center) + plane.w + sphere.radius;
+			if (std::abs(distance) <= 1e-4f * (1.0f + std::abs(plane.w) + glm::length(sphere.center) + sphere.radius)) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	/***********************************************************************************/
+	// Sampled only when depthSize != 0, which these tests never set
+	void prepareUnusedHiZ(const VkCommandBuffer commandBuffer, const TestDevice::Image& hiZ) {
+		TestDevice::transition(commandBuffer, hiZ, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+			0, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+	}
+}
+
+/***********************************************************************************/
+// cull.comp against the CPU culler, object by object, on whatever Vulkan implementation is installed
+TEST(GpuCullingMatchesCpu) {
+	TestDevice device;
+	if (!device.valid()) {
+		SKIP("no Vulkan device");
+	}
+
+	auto cull = device.createComputePipeline("Data/Shaders/cull.spv");
+	if (cull.pipeline == VK_NULL_HANDLE) {
+		SKIP("run from SolEngine/ to find Data/Shaders/cull.spv");
+	}
+
+	// Not a multiple of the workgroup size or of the mask's 32 bits
+	constexpr std::uint32_t ObjectCount = 20000 + 37;
+
+	const auto objectBuffer = device.createBuffer(sizeof(ObjectData) * ObjectCount, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+	const auto drawBuffer = device.createBuffer(sizeof(VkDrawIndexedIndirectCommand) * ObjectCount, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+	const auto statsBuffer = device.createBuffer(sizeof(std::uint32_t) * (1 + (ObjectCount + 31) / 32), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+	const auto lodBuffer = device.createBuffer(sizeof(std::uint32_t) * ObjectCount, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+	const auto uniformBuffer = device.createBuffer(sizeof(UniformBufferObject), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
+	// Never sampled, depthSize = 0 turns occlusion culling off
+	const auto hiZ = device.createImage(1, 1, VK_FORMAT_R32_SFLOAT, VK_IMAGE_USAGE_SAMPLED_BIT);
+	const auto sampler = device.createSampler();
+
+	device.bind(cull, 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, objectBuffer);
+	device.bind(cull, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, drawBuffer);
+	device.bind(cull, 2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, statsBuffer);
+	device.bind(cull, 3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, lodBuffer);
+	device.bind(cull, 6, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, hiZ, sampler, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	device.bind(cull, 7, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, uniformBuffer);
+
+	// Randomly placed, rotated and non-uniformly scaled objects around a camera that sees some of them
+	std::mt19937 random(13);
+	std::uniform_real_distribution<float> position(-120.0f, 120.0f), unit(-1.0f, 1.0f), scale(0.2f, 3.0f), radius(0.1f, 4.0f);
+
+	auto* objects = static_cast<ObjectData*>(objectBuffer.data);
+	FrustumCuller culler;
+	for (std::uint32_t i = 0; i < ObjectCount; ++i) {
+		auto model = glm::translate(glm::mat4(1.0f), glm::vec3(position(random), position(random), position(random)));
+		model = glm::rotate(model, unit(random) * 3.0f, glm::normalize(glm::vec3(unit(random), unit(random), unit(random)) + glm::vec3(0.0f, 0.0f, 1e-3f)));
+		model = glm::scale(model, glm::vec3(scale(random), scale(random), scale(random)));
+
+		const BoundingSphere sphere { glm::vec3(unit(random), unit(random), unit(random)), radius(random) };
+
+		ObjectData object {};
+		object.model = model;
+		object.boundingSphere = glm::vec4(sphere.center, sphere.radius);
+		object.lodFirstIndex = glm::uvec4(i * 36);
+		object.lodIndexCount = glm::uvec4(36);
+		object.lodCount = 1;
+		object.vertexOffset = static_cast<std::int32_t>(i);
+		objects[i] = object;
+
+		culler.add(sphere.transformed(model));
+	}
+
+	const auto cameraPosition = glm::vec3(-10.0f, 20.0f, 5.0f);
+	const auto viewProjection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 150.0f) * glm::lookAt(cameraPosition, glm::vec3(30.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+	const Frustum frustum(viewProjection);
+
+	CullPushConstants pushConstants {};
+	std::copy(frustum.planes.begin(), frustum.planes.end(), pushConstants.frustumPlanes.begin());
+	pushConstants.cameraPosition = cameraPosition;
+	pushConstants.lodScale = 1.0f;
+	pushConstants.objectCount = ObjectCount;
+
+	device.run([&](const VkCommandBuffer commandBuffer) {
+		prepareUnusedHiZ(commandBuffer, hiZ);
+
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cull.pipeline);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cull.layout, 0, 1, &cull.descriptorSet, 0, nullptr);
+		vkCmdPushConstants(commandBuffer, cull.layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullPushConstants), &pushConstants);
+		vkCmdDispatch(commandBuffer, (ObjectCount + 63) / 64, 1, 1);
+	});
+
+	std::vector<std::uint32_t> expected;
+	culler.cull(frustum, expected);
+	CHECK(!expected.empty() && expected.size() < ObjectCount / 2);
+
+	const auto* stats = static_cast<const std::uint32_t*>(statsBuffer.data);
+	const auto* draws = static_cast<const VkDrawIndexedIndirectCommand*>(drawBuffer.data);
+	const auto* lods = static_cast<const std::uint32_t*>(lodBuffer.data);
+
+	auto cpuVisible = expected.cbegin();
+	std::size_t gpuVisibleCount = 0, borderlineCount = 0;
+	for (std::uint32_t i = 0; i < ObjectCount; ++i) {
+		const auto visibleOnGpu = (stats[1 + i / 32] & (1u << (i % 32))) != 0;
+		const auto visibleOnCpu = cpuVisible != expected.cend() && *cpuVisible == i;
+		if (visibleOnCpu) {
+			++cpuVisible;
+		}
+		gpuVisibleCount += visibleOnGpu ? 1 : 0;
+
+		if (visibleOnGpu != visibleOnCpu) {
+			CHECK(borderline(frustum, culler.sphere(i)));
+			++borderlineCount;
+		}
+
+		// Without occlusion or meshlets, drawn is exactly inside the frustum
+		CHECK(draws[i].instanceCount == (visibleOnGpu ? 1u : 0u));
+		CHECK(draws[i].firstInstance == i);
+		CHECK(draws[i].firstIndex == i * 36 && draws[i].indexCount == 36);
+		CHECK(draws[i].vertexOffset == static_cast<std::int32_t>(i));
+		CHECK(lods[i] == (visibleOnGpu ? 0u : ~0u));
+	}
+
+	// Bits past the last object stay clear
+	CHECK((stats[1 + (ObjectCount - 1) / 32] >> (ObjectCount % 32)) == 0);
+	CHECK(stats[0] == gpuVisibleCount);
+	CHECK(borderlineCount <= 2);
+}
+
+/***********************************************************************************/
+// cluster_cull.comp against Meshlet::isBackfacing and the CPU frustum test, meshlet by meshlet
+TEST(GpuMeshletCullingMatchesCpu) {
+	TestDevice device;
+	if (!device.valid()) {
+		SKIP("no Vulkan device");
+	}
+
+	auto clusterCull = device.createComputePipeline("Data/Shaders/cluster_cull.spv");
+	if (clusterCull.pipeline == VK_NULL_HANDLE) {
+		SKIP("run from SolEngine/ to find Data/Shaders/cluster_cull.spv");
+	}
+
+	constexpr std::uint32_t ObjectCount = 500, MeshletsPerObject = 20, MeshletCount = ObjectCount * MeshletsPerObject + 13;
+
+	const auto objectBuffer = device.createBuffer(sizeof(ObjectData) * ObjectCount, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+	const auto lodBuffer = device.createBuffer(sizeof(std::uint32_t) * ObjectCount, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+	const auto meshletBuffer = device.createBuffer(sizeof(MeshletData) * MeshletCount, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+	const auto drawBuffer = device.createBuffer(sizeof(VkDrawIndexedIndirectCommand) * MeshletCount, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+	const auto uniformBuffer = device.createBuffer(sizeof(UniformBufferObject), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
+	const auto hiZ = device.createImage(1, 1, VK_FORMAT_R32_SFLOAT, VK_IMAGE_USAGE_SAMPLED_BIT);
+	const auto sampler = device.createSampler();
+
+	device.bind(clusterCull, 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, objectBuffer);
+	device.bind(clusterCull, 3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, lodBuffer);
+	device.bind(clusterCull, 4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, meshletBuffer);
+	device.bind(clusterCull, 5, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, drawBuffer);
+	device.bind(clusterCull, 6, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, hiZ, sampler, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	device.bind(clusterCull, 7, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, uniformBuffer);
+
+	std::mt19937 random(34);
+	std::uniform_real_distribution<float> position(-60.0f, 60.0f), unit(-1.0f, 1.0f), scale(0.3f, 2.5f), radius(0.05f, 1.0f), cutoff(0.0f, 1.0f);
+
+	auto* objects = static_cast<ObjectData*>(objectBuffer.data);
+	auto* lods = static_cast<std::uint32_t*>(lodBuffer.data);
+	for (std::uint32_t i = 0; i < ObjectCount; ++i) {
+		auto model = glm::translate(glm::mat4(1.0f), glm::vec3(position(random), position(random), position(random)));
+		model = glm::rotate(model, unit(random) * 3.0f, glm::normalize(glm::vec3(unit(random), unit(random), unit(random)) + glm::vec3(0.0f, 0.0f, 1e-3f)));
+		model = glm::scale(model, glm::vec3(scale(random), scale(random), scale(random)));
+
+		objects[i] = ObjectData {};
+		objects[i].model = model;
+		// cull.comp's verdict: drawn at LOD 0, at a coarser LOD, or culled
+		const std::uint32_t lodChoices[] { 0, 0, 0, 1, ~0u };
+		lods[i] = lodChoices[random() % 5];
+	}
+
+	// Meshlets past ObjectCount * MeshletsPerObject belong to the last object
+	auto* meshletData = static_cast<MeshletData*>(meshletBuffer.data);
+	std::vector<Meshlet> meshlets(MeshletCount);
+	for (std::uint32_t i = 0; i < MeshletCount; ++i) {
+		auto& meshlet = meshlets[i];
+		meshlet.firstIndex = i * 372;
+		meshlet.indexCount = 372;
+		meshlet.boundingSphere = { glm::vec3(unit(random), unit(random), unit(random)) * 2.0f, radius(random) };
+		meshlet.coneAxis = glm::normalize(glm::vec3(unit(random), unit(random), unit(random)) + glm::vec3(0.0f, 0.0f, 1e-3f));
+		meshlet.coneCutoff = random() % 4 == 0 ? 1.0f : cutoff(random);
+
+		const auto objectIndex = std::min(i / MeshletsPerObject, ObjectCount - 1);
+		meshletData[i] = { glm::vec4(meshlet.boundingSphere.center, meshlet.boundingSphere.radius), glm::vec4(meshlet.coneAxis, meshlet.coneCutoff), objectIndex, meshlet.firstIndex, meshlet.indexCount, static_cast<std::int32_t>(objectIndex) };
+	}
+
+	const auto cameraPosition = glm::vec3(-10.0f, 20.0f, 5.0f);
+	const Frustum frustum(glm::perspective(glm::radians(70.0f), 16.0f / 9.0f, 0.1f, 100.0f) * glm::lookAt(cameraPosition, glm::vec3(20.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f)));
+
+	CullPushConstants pushConstants {};
+	std::copy(frustum.planes.begin(), frustum.planes.end(), pushConstants.frustumPlanes.begin());
+	pushConstants.cameraPosition = cameraPosition;
+	pushConstants.lodScale = 1.0f;
+	pushConstants.objectCount = ObjectCount;
+	pushConstants.meshletCount = MeshletCount;
+
+	device.run([&](const VkCommandBuffer commandBuffer) {
+		prepareUnusedHiZ(commandBuffer, hiZ);
+
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, clusterCull.pipeline);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, clusterCull.layout, 0, 1, &clusterCull.descriptorSet, 0, nullptr);
+		vkCmdPushConstants(commandBuffer, clusterCull.layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullPushConstants), &pushConstants);
+		vkCmdDispatch(commandBuffer, (MeshletCount + 63) / 64, 1, 1);
+	});
+
+	const auto* draws = static_cast<const VkDrawIndexedIndirectCommand*>(drawBuffer.data);
+	std::size_t visibleCount = 0, backfacingCount = 0, mismatchCount = 0;
+	for (std::uint32_t i = 0; i < MeshletCount; ++i) {
+		const auto objectIndex = meshletData[i].objectIndex;
+		const auto& model = objects[objectIndex].model;
+		const auto& meshlet = meshlets[i];
+
+		// As RenderSystem's CPU path tests meshlets
+		const auto meshletSphere = meshlet.boundingSphere.transformed(model);
+		const auto coneAxis = glm::normalize(glm::mat3(model) * meshlet.coneAxis);
+		const auto inFrustum = frustum.intersects(meshletSphere);
+		const auto backfacing = meshlet.isBackfacing(meshletSphere, coneAxis, cameraPosition);
+		const auto visibleOnCpu = lods[objectIndex] == 0 && inFrustum && !backfacing;
+
+		visibleCount += visibleOnCpu ? 1 : 0;
+		backfacingCount += lods[objectIndex] == 0 && inFrustum && backfacing ? 1 : 0;
+
+		if ((draws[i].instanceCount == 1) != visibleOnCpu) {
+			// Only rounding at a frustum plane or the cone's edge may disagree
+			const auto toCenter = meshletSphere.center - cameraPosition;
+			const auto coneMargin = glm::dot(toCenter, coneAxis) - meshlet.coneCutoff * glm::length(toCenter) - meshletSphere.radius;
+			CHECK(borderline(frustum, meshletSphere) || std::abs(coneMargin) <= 1e-4f * (1.0f + glm::length(toCenter)));
+			++mismatchCount;
+		}
+
+		CHECK(draws[i].instanceCount <= 1);
+		CHECK(draws[i].indexCount == meshlet.indexCount && draws[i].firstIndex == meshlet.firstIndex);
+		CHECK(draws[i].vertexOffset == static_cast<std::int32_t>(objectIndex) && draws[i].firstInstance == objectIndex);
+	}
+
+	// Both tests actually decide something in this scene
+	CHECK(visibleCount > 0 && backfacingCount > 0);
+	CHECK(mismatchCount <= 2);
+}
@@ -0,0 +1,114 @@
+#include "Test.h"
+#include "TestDevice.h"
+
+#include <Graphics/Vertex.h>
+
+#include <algorithm>
+#include <random>
+
+namespace {
+	/***********************************************************************************/
+	// What hiz_build.comp computes for one level: the farthest of the 2x2 source texels, clamped at the edges
+	std::vector<float> buildLevel(const std::vector<float>& source, const int width, const int height) {
+		const auto levelWidth = (width + 1) / 2, levelHeight = (height + 1) / 2;
+		const auto fetch = [&](const int x, const int y) { return source[std::min(y, height - 1) * width + std::min(x, width - 1)]; };
+
+		std::vector<float> level(levelWidth * levelHeight);
+		for (int y = 0; y < levelHeight; ++y) {
+			for (int x = 0; x < levelWidth; ++x) {
+				level[y * levelWidth + x] = std::max(std::max(fetch(2 * x, 2 * y), fetch(2 * x + 1, 2 * y)), std::max(fetch(2 * x, 2 * y + 1), fetch(2 * x + 1, 2 * y + 1)));
+			}
+		}
+		return level;
+	}
+}
+
+/***********************************************************************************/
+// Two levels of hiz_build.comp from an odd-sized depth image, the second reading the first in GENERAL
+// layout as RenderSystem's pyramid does. The multisampled variant only has to build.
+TEST(GpuHiZBuildMatchesCpu) {
+	TestDevice device;
+	if (!device.valid()) {
+		SKIP("no Vulkan device");
+	}
+
+	const auto level0 = device.createComputePipeline("Data/Shaders/hiz_build.spv");
+	const auto level1 = device.createComputePipeline("Data/Shaders/hiz_build.spv");
+	const auto multisampled = device.createComputePipeline("Data/Shaders/hiz_build_ms.spv");
+	if (level0.pipeline == VK_NULL_HANDLE || multisampled.pipeline == VK_NULL_HANDLE) {
+		SKIP("run from SolEngine/ to find Data/Shaders/hiz_build.spv");
+	}
+
+	// Odd on both axes, so every level has edge texels covering a single row or column
+	constexpr int Width = 37, Height = 23;
+	constexpr int Width0 = (Width + 1) / 2, Height0 = (Height + 1) / 2;
+	constexpr int Width1 = (Width0 + 1) / 2, Height1 = (Height0 + 1) / 2;
+
+	std::mt19937 random(49);
+	std::uniform_real_distribution<float> depthValue(0.0f, 1.0f);
+	std::vector<float> depth(Width * Height);
+	std::generate(depth.begin(), depth.end(), [&]() { return depthValue(random); });
+
+	const auto upload = device.createBuffer(depth.size() * sizeof(float), VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
+	std::copy(depth.begin(), depth.end(), static_cast<float*>(upload.data));
+	const auto readBack0 = device.createBuffer(Width0 * Height0 * sizeof(float), VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+	const auto readBack1 = device.createBuffer(Width1 * Height1 * sizeof(float), VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+
+	const auto source = device.createImage(Width, Height, VK_FORMAT_R32_SFLOAT, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT);
+	const auto pyramid0 = device.createImage(Width0, Height0, VK_FORMAT_R32_SFLOAT, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT);
+	const auto pyramid1 = device.createImage(Width1, Height1, VK_FORMAT_R32_SFLOAT, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT);
+	const auto sampler = device.createSampler();
+
+	device.bind(level0, 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, source, sampler, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	device.bind(level0, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, pyramid0, VK_NULL_HANDLE, VK_IMAGE_LAYOUT_GENERAL);
+	device.bind(level1, 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, pyramid0, sampler, VK_IMAGE_LAYOUT_GENERAL);
+	device.bind(level1, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, pyramid1, VK_NULL_HANDLE, VK_IMAGE_LAYOUT_GENERAL);
+
+	device.run([&](const VkCommandBuffer commandBuffer) {
+		TestDevice::transition(commandBuffer, source, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			0, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+		VkBufferImageCopy region {};
+		region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+		region.imageExtent = { Width, Height, 1 };
+		vkCmdCopyBufferToImage(commandBuffer, upload.buffer, source.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+		TestDevice::transition(commandBuffer, source, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+			VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+		for (const auto* level : { &pyramid0, &pyramid1 }) {
+			TestDevice::transition(commandBuffer, *level, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL,
+				0, VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+		}
+
+		HiZPushConstants pushConstants { { Width, Height }, { Width0, Height0 }, 1 };
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, level0.pipeline);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, level0.layout, 0, 1, &level0.descriptorSet, 0, nullptr);
+		vkCmdPushConstants(commandBuffer, level0.layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(HiZPushConstants), &pushConstants);
+		vkCmdDispatch(commandBuffer, (Width0 + 7) / 8, (Height0 + 7) / 8, 1); // local_size 8x8
+
+		TestDevice::transition(commandBuffer, pyramid0, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_GENERAL,
+			VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+
+		pushConstants = { { Width0, Height0 }, { Width1, Height1 }, 1 };
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, level1.pipeline);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, level1.layout, 0, 1, &level1.descriptorSet, 0, nullptr);
+		vkCmdPushConstants(commandBuffer, level1.layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(HiZPushConstants), &pushConstants);
+		vkCmdDispatch(commandBuffer, (Width1 + 7) / 8, (Height1 + 7) / 8, 1);
+
+		for (const auto* level : { &pyramid0, &pyramid1 }) {
+			TestDevice::transition(commandBuffer, *level, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+				VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+		}
+
+		region.imageExtent = { Width0, Height0, 1 };
+		vkCmdCopyImageToBuffer(commandBuffer, pyramid0.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, readBack0.buffer, 1, &region);
+		region.imageExtent = { Width1, Height1, 1 };
+		vkCmdCopyImageToBuffer(commandBuffer, pyramid1.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, readBack1.buffer, 1, &region);
+	});
+
+	// Maxima of exact values, so exactly equal
+	const auto expected0 = buildLevel(depth, Width, Height);
+	const auto expected1 = buildLevel(expected0, Width0, Height0);
+	CHECK(std::equal(expected0.begin(), expected0.end(), static_cast<const float*>(readBack0.data)));
+	CHECK(std::equal(expected1.begin(), expected1.end(), static_cast<const float*>(readBack1.data)));
+}
@@ -0,0 +1,90 @@
+#include "Test.h"
+#include "TestDevice.h"
+
+#include <Graphics/Vertex.h>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+	// Must match light_cull.comp
+	constexpr std::uint32_t MaxLightsPerCluster = 128;
+}
+
+/***********************************************************************************/
+// light_cull.comp under and over MaxLightsPerCluster: one light out of reach, the others covering
+// every cluster. Over the cap a cluster lists the first MaxLightsPerCluster and counts all of them.
+TEST(GpuLightCullCountsOverflow) {
+	TestDevice device;
+	if (!device.valid()) {
+		SKIP("no Vulkan device");
+	}
+
+	const auto pipeline = device.createComputePipeline("Data/Shaders/light_cull.spv");
+	if (pipeline.pipeline == VK_NULL_HANDLE) {
+		SKIP("run from SolEngine/ to find Data/Shaders/light_cull.spv");
+	}
+
+	// Small grid, one workgroup, set up like RenderSystem::updateUniformBuffer
+	constexpr std::uint32_t TilesX = 4, TilesY = 3, Slices = 5, ClusterCount = TilesX * TilesY * Slices;
+	constexpr float NearPlane = 0.1f, FarPlane = 100.0f;
+	constexpr std::uint32_t LightCount = 1 + MaxLightsPerCluster + 72;
+
+	const auto uniforms = device.createBuffer(sizeof(UniformBufferObject), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
+	const auto lights = device.createBuffer(sizeof(LightData) * LightCount, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+	const auto counts = device.createBuffer(sizeof(std::uint32_t) * ClusterCount, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+	const auto indices = device.createBuffer(sizeof(std::uint32_t) * ClusterCount * MaxLightsPerCluster, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+	const auto stats = device.createBuffer(sizeof(std::uint32_t) * 2, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+
+	auto& ubo = *static_cast<UniformBufferObject*>(uniforms.data);
+	ubo.view = glm::mat4(1.0f);
+	ubo.proj = glm::perspective(glm::radians(60.0f), 4.0f / 3.0f, NearPlane, FarPlane);
+	const auto sliceScale = Slices / std::log(FarPlane / NearPlane);
+	ubo.clusterScale = glm::vec4(TilesX / 640.0f, TilesY / 480.0f, sliceScale, -std::log(NearPlane) * sliceScale);
+
+	// Light 0 is far off to the side, the rest are in front of the camera and reach past the far plane
+	auto* lightData = static_cast<LightData*>(lights.data);
+	lightData[0] = { glm::vec4(1e4f, 0.0f, 0.0f, 1.0f), glm::vec4(1.0f) };
+	for (std::uint32_t i = 1; i < LightCount; ++i) {
+		lightData[i] = { glm::vec4(0.0f, 0.0f, -10.0f, 1e3f), glm::vec4(1.0f) };
+	}
+
+	device.bind(pipeline, 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, uniforms);
+	device.bind(pipeline, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, lights);
+	device.bind(pipeline, 2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, counts);
+	device.bind(pipeline, 3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, indices);
+	device.bind(pipeline, 4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, stats);
+
+	const auto* clusterCounts = static_cast<const std::uint32_t*>(counts.data);
+	const auto* clusterIndices = static_cast<const std::uint32_t*>(indices.data);
+	const auto* overflow = static_cast<const std::uint32_t*>(stats.data);
+
+	for (const auto lightCount : { MaxLightsPerCluster, LightCount }) {
+		ubo.clusterCount = glm::uvec4(TilesX, TilesY, Slices, lightCount);
+		std::memset(stats.data, 0, sizeof(std::uint32_t) * 2);
+
+		device.run([&](const VkCommandBuffer commandBuffer) {
+			vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline.pipeline);
+			vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline.layout, 0, 1, &pipeline.descriptorSet, 0, nullptr);
+			vkCmdDispatch(commandBuffer, 1, 1, 1); // local_size_x = 64
+		});
+
+		// Every cluster touches all but light 0, listed in light order up to the cap
+		const auto touching = lightCount - 1;
+		auto listed = true;
+		for (std::uint32_t cluster = 0; cluster < ClusterCount; ++cluster) {
+			CHECK(clusterCounts[cluster] == touching);
+			for (std::uint32_t i = 0; i < std::min(touching, MaxLightsPerCluster); ++i) {
+				listed = listed && clusterIndices[cluster * MaxLightsPerCluster + i] == i + 1;
+			}
+		}
+		CHECK(listed);
+
+		const auto overflowing = touching > MaxLightsPerCluster;
+		CHECK(overflow[0] == (overflowing ? ClusterCount : 0));
+		CHECK(overflow[1] == (overflowing ? touching : 0));
+	}
+}
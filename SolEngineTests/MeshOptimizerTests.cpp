@@ -0,0 +1,108 @@
+#include "Test.h"
+
+#include <Graphics/MeshOptimizer.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <random>
+#include <tuple>
+
+namespace {
+	using Triangle = std::array<glm::vec3, 3>;
+
+	/***********************************************************************************/
+	// Size x Size quads on a bumpy height field, triangle order shuffled so the cache sees no locality
+	void shuffledGrid(const std::uint32_t size, std::vector<Vertex>& vertices, std::vector<std::uint32_t>& indices) {
+		for (std::uint32_t y = 0; y <= size; ++y) {
+			for (std::uint32_t x = 0; x <= size; ++x) {
+				const glm::vec3 position(x, y, std::sin(x * 0.5f) * std::cos(y * 0.5f));
+				vertices.emplace_back(position, glm::vec3(0.0f, 0.0f, 1.0f), glm::vec2(x, y) / static_cast<float>(size));
+			}
+		}
+
+		std::vector<std::array<std::uint32_t, 3>> triangles;
+		for (std::uint32_t y = 0; y < size; ++y) {
+			for (std::uint32_t x = 0; x < size; ++x) {
+				const auto i = y * (size + 1) + x;
+				triangles.push_back({ i, i + 1, i + size + 1 });
+				triangles.push_back({ i + 1, i + size + 2, i + size + 1 });
+			}
+		}
+
+		std::mt19937 random(1234);
+		std::shuffle(triangles.begin(), triangles.end(), random);
+		for (const auto& triangle : triangles) {
+			indices.insert(indices.end(), triangle.begin(), triangle.end());
+		}
+	}
+
+	/***********************************************************************************/
+	// Triangles by vertex position, each rotated to start at its smallest corner (winding kept) and
+	// the list sorted. Equal for any triangle order, rotation or vertex order of the same surface.
+	std::vector<Triangle> triangleSet(const std::vector<Vertex>& vertices, const std::vector<std::uint32_t>& indices) {
+		const auto less = [](const glm::vec3& a, const glm::vec3& b) {
+			return std::tie(a.x, a.y, a.z) < std::tie(b.x, b.y, b.z);
+		};
+
+		std::vector<Triangle> triangles;
+		for (std::size_t i = 0; i < indices.size(); i += 3) {
+			Triangle triangle { vertices[indices[i]].pos, vertices[indices[i + 1]].pos, vertices[indices[i + 2]].pos };
+			std::rotate(triangle.begin(), std::min_element(triangle.begin(), triangle.end(), less), triangle.end());
+			triangles.push_back(triangle);
+		}
+
+		std::sort(triangles.begin(), triangles.end(), [&](const Triangle& a, const Triangle& b) {
+			return std::lexicographical_compare(a.begin(), a.end(), b.begin(), b.end(), less);
+		});
+		return triangles;
+	}
+}
+
+/***********************************************************************************/
+TEST(MeshOptimizerLowersAcmr) {
+	std::vector<Vertex> vertices;
+	std::vector<std::uint32_t> indices;
+	shuffledGrid(32, vertices, indices);
+
+	const auto before = MeshOptimizer::analyzeVertexCache(indices, vertices.size());
+	MeshOptimizer::optimizeVertexCache(indices, vertices.size());
+	const auto after = MeshOptimizer::analyzeVertexCache(indices, vertices.size());
+
+	// A shuffled grid misses on nearly every vertex, an optimized one gets well below 1
+	CHECK(after.acmr < before.acmr);
+	CHECK(after.acmr < 1.0f);
+	CHECK(after.atvr < before.atvr);
+}
+
+/***********************************************************************************/
+// Every pass only reorders: the same triangles with the same winding come out of each of them
+TEST(MeshOptimizerKeepsTriangles) {
+	std::vector<Vertex> vertices;
+	std::vector<std::uint32_t> indices;
+	shuffledGrid(32, vertices, indices);
+
+	// One vertex nothing references, which optimizeVertexFetch should drop
+	vertices.emplace_back(glm::vec3(-1.0f), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec2(0.0f));
+	const auto vertexCount = vertices.size();
+	const auto original = triangleSet(vertices, indices);
+
+	MeshOptimizer::optimizeVertexCache(indices, vertices.size());
+	CHECK(indices.size() == original.size() * 3);
+	CHECK(triangleSet(vertices, indices) == original);
+
+	MeshOptimizer::optimizeOverdraw(indices, vertices);
+	CHECK(indices.size() == original.size() * 3);
+	CHECK(triangleSet(vertices, indices) == original);
+
+	MeshOptimizer::optimizeVertexFetch(vertices, indices);
+	CHECK(vertices.size() == vertexCount - 1);
+	CHECK(triangleSet(vertices, indices) == original);
+
+	// Fetch order follows first use in the index list
+	std::uint32_t next = 0;
+	for (const auto index : indices) {
+		CHECK(index <= next);
+		next = std::max(next, index + 1);
+	}
+}
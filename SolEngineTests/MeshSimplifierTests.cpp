@@ -0,0 +1,183 @@
+#include "Test.h"
+
+#include <Graphics/Mesh.h>
+#include <Graphics/MeshSimplifier.h>
+
+#include <algorithm>
+#include <map>
+#include <set>
+
+namespace {
+	// Mesh.cpp's limit on LOD error, relative to the bounding sphere radius
+	constexpr float MaxLodError = 0.05f;
+
+	/***********************************************************************************/
+	// Unit icosahedron with every triangle split into four, subdivisions times. Closed and seamless,
+	// so nothing is locked and the simplifier can take it down as far as the error allows.
+	void icosphere(const int subdivisions, std::vector<Vertex>& vertices, std::vector<std::uint32_t>& indices) {
+		const auto t = (1.0f + std::sqrt(5.0f)) / 2.0f;
+		const glm::vec3 corners[] {
+			{ -1, t, 0 }, { 1, t, 0 }, { -1, -t, 0 }, { 1, -t, 0 },
+			{ 0, -1, t }, { 0, 1, t }, { 0, -1, -t }, { 0, 1, -t },
+			{ t, 0, -1 }, { t, 0, 1 }, { -t, 0, -1 }, { -t, 0, 1 }
+		};
+
+		vertices.clear();
+		for (const auto& corner : corners) {
+			const auto p = glm::normalize(corner);
+			vertices.emplace_back(p, p, glm::vec2(0.0f));
+		}
+		indices = {
+			0, 11, 5, 0, 5, 1, 0, 1, 7, 0, 7, 10, 0, 10, 11,
+			1, 5, 9, 5, 11, 4, 11, 10, 2, 10, 7, 6, 7, 1, 8,
+			3, 9, 4, 3, 4, 2, 3, 2, 6, 3, 6, 8, 3, 8, 9,
+			4, 9, 5, 2, 4, 11, 6, 2, 10, 8, 6, 7, 9, 8, 1
+		};
+
+		for (int level = 0; level < subdivisions; ++level) {
+			std::map<std::pair<std::uint32_t, std::uint32_t>, std::uint32_t> midpoints;
+			const auto midpoint = [&](const std::uint32_t a, const std::uint32_t b) {
+				const auto key = std::minmax(a, b);
+				const auto it = midpoints.find(key);
+				if (it != midpoints.end()) {
+					return it->second;
+				}
+
+				const auto p = glm::normalize(vertices[a].pos + vertices[b].pos);
+				vertices.emplace_back(p, p, glm::vec2(0.0f));
+				return midpoints[key] = static_cast<std::uint32_t>(vertices.size() - 1);
+			};
+
+			std::vector<std::uint32_t> subdivided;
+			for (std::size_t i = 0; i < indices.size(); i += 3) {
+				const auto a = indices[i], b = indices[i + 1], c = indices[i + 2];
+				const auto ab = midpoint(a, b), bc = midpoint(b, c), ca = midpoint(c, a);
+				subdivided.insert(subdivided.end(), { a, ab, ca, b, bc, ab, c, ca, bc, ab, bc, ca });
+			}
+			indices = std::move(subdivided);
+		}
+	}
+
+	/***********************************************************************************/
+	// Closest point of triangle abc to p (Ericson, Real-Time Collision Detection 5.1.5)
+	glm::vec3 closestPoint(const glm::vec3& p, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c) {
+		const auto ab = b - a, ac = c - a, ap = p - a;
+		const auto d1 = glm::dot(ab, ap), d2 = glm::dot(ac, ap);
+		if (d1 <= 0.0f && d2 <= 0.0f) {
+			return a;
+		}
+
+		const auto bp = p - b;
+		const auto d3 = glm::dot(ab, bp), d4 = glm::dot(ac, bp);
+		if (d3 >= 0.0f && d4 <= d3) {
+			return b;
+		}
+
+		const auto vc = d1 * d4 - d3 * d2;
+		if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) {
+			return a + ab * (d1 / (d1 - d3));
+		}
+
+		const auto cp = p - c;
+		const auto d5 = glm::dot(ab, cp), d6 = glm::dot(ac, cp);
+		if (d6 >= 0.0f && d5 <= d6) {
+			return c;
+		}
+
+		const auto vb = d5 * d2 - d1 * d6;
+		if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) {
+			return a + ac * (d2 / (d2 - d6));
+		}
+
+		const auto va = d3 * d6 - d5 * d4;
+		if (va <= 0.0f && d4 - d3 >= 0.0f && d5 - d6 >= 0.0f) {
+			return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+		}
+
+		const auto denominator = 1.0f / (va + vb + vc);
+		return a + ab * (vb * denominator) + ac * (vc * denominator);
+	}
+
+	/***********************************************************************************/
+	// How far the triangles' surface dips below a unit sphere around the origin
+	float sphereDeviation(const std::vector<Vertex>& vertices, const std::uint32_t* indices, const std::size_t indexCount) {
+		auto deviation = 0.0f;
+		for (std::size_t i = 0; i < indexCount; i += 3) {
+			const auto closest = closestPoint(glm::vec3(0.0f), vertices[indices[i]].pos, vertices[indices[i + 1]].pos, vertices[indices[i + 2]].pos);
+			deviation = std::max(deviation, 1.0f - glm::length(closest));
+		}
+		return deviation;
+	}
+}
+
+/***********************************************************************************/
+// Every LOD is smaller than the one before, and stays within MaxLodError of the sphere it came from
+TEST(MeshLodChainOnSphere) {
+	std::vector<Vertex> vertices;
+	std::vector<std::uint32_t> indices;
+	icosphere(4, vertices, indices);
+
+	Mesh mesh(vertices, indices, nullptr);
+	mesh.computeBounds();
+	mesh.generateLods();
+
+	CHECK(mesh.lods.size() > 1);
+	CHECK(mesh.lods.size() <= Mesh::MaxLods);
+	CHECK(mesh.lods[0].firstIndex == 0 && mesh.lods[0].indexCount == indices.size() && mesh.lods[0].error == 0.0f);
+
+	const auto maxError = mesh.boundingSphere.radius * MaxLodError;
+	const auto baseDeviation = sphereDeviation(mesh.vertices, mesh.indices.data(), indices.size());
+
+	for (std::size_t i = 1; i < mesh.lods.size(); ++i) {
+		const auto& lod = mesh.lods[i];
+		CHECK(lod.indexCount % 3 == 0);
+		CHECK(lod.indexCount < mesh.lods[i - 1].indexCount);
+		CHECK(lod.error >= mesh.lods[i - 1].error);
+		CHECK(lod.error <= maxError);
+		CHECK(lod.firstIndex + lod.indexCount <= mesh.indices.size());
+
+		// Measured against the surface, not just the simplifier's estimate. The base mesh's own
+		// deviation from the sphere comes on top of what the simplification adds.
+		const auto deviation = sphereDeviation(mesh.vertices, mesh.indices.data() + lod.firstIndex, lod.indexCount);
+		CHECK(deviation - baseDeviation <= maxError);
+	}
+}
+
+/***********************************************************************************/
+// Interior vertices of a flat grid collapse for free, its border never moves
+TEST(MeshSimplifierKeepsBorders) {
+	constexpr std::uint32_t Size = 16;
+	std::vector<Vertex> vertices;
+	std::vector<std::uint32_t> indices;
+	for (std::uint32_t y = 0; y <= Size; ++y) {
+		for (std::uint32_t x = 0; x <= Size; ++x) {
+			vertices.emplace_back(glm::vec3(x, y, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec2(0.0f));
+		}
+	}
+	for (std::uint32_t y = 0; y < Size; ++y) {
+		for (std::uint32_t x = 0; x < Size; ++x) {
+			const auto i = y * (Size + 1) + x;
+			indices.insert(indices.end(), { i, i + 1, i + Size + 1, i + 1, i + Size + 2, i + Size + 1 });
+		}
+	}
+
+	auto error = -1.0f;
+	const auto simplified = MeshSimplifier::simplify(vertices, indices, 0, 1e-4f, error);
+
+	CHECK(simplified.size() % 3 == 0);
+	CHECK(simplified.size() < indices.size() / 2);
+	CHECK(error >= 0.0f && error <= 1e-4f);
+
+	const std::set<std::uint32_t> used(simplified.begin(), simplified.end());
+	for (std::uint32_t y = 0; y <= Size; ++y) {
+		for (std::uint32_t x = 0; x <= Size; ++x) {
+			if (x == 0 || y == 0 || x == Size || y == Size) {
+				CHECK(used.count(y * (Size + 1) + x) == 1);
+			}
+		}
+	}
+
+	// No error allowed at all still leaves a flat grid free to simplify, a tight target stops it
+	const auto target = MeshSimplifier::simplify(vertices, indices, indices.size() - 30, 0.0f, error);
+	CHECK(target.size() <= indices.size() - 30 && target.size() >= indices.size() - 36);
+}
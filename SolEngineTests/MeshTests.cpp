@@ -0,0 +1,94 @@
+#include "Test.h"
+
+#include <Graphics/Mesh.h>
+
+#include <glm/gtc/packing.hpp>
+
+#include <algorithm>
+#include <random>
+
+namespace {
+	/***********************************************************************************/
+	// Same as basic.vert
+	glm::vec3 octDecode(const glm::vec2& e) {
+		glm::vec3 n(e, 1.0f - std::abs(e.x) - std::abs(e.y));
+		if (n.z < 0.0f) {
+			const glm::vec2 signs(n.x >= 0.0f ? 1.0f : -1.0f, n.y >= 0.0f ? 1.0f : -1.0f);
+			const auto folded = (1.0f - glm::abs(glm::vec2(n.y, n.x))) * signs;
+			n.x = folded.x;
+			n.y = folded.y;
+		}
+		return glm::normalize(n);
+	}
+}
+
+/***********************************************************************************/
+// What basic.vert decodes from PackedVertex is within one quantization step of the source vertex
+TEST(MeshQuantizationRoundTrip) {
+#ifdef SOL_FULL_PRECISION_VERTICES
+	SKIP("Vertices are uploaded unquantized");
+#else
+	std::mt19937 random(42);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+	// Off-center, unevenly sized box, normals over both hemispheres and the axes, texture coordinates that wrap
+	std::vector<Vertex> vertices;
+	const glm::vec3 axes[] { { 1, 0, 0 }, { 0, 1, 0 }, { 0, 0, 1 }, { -1, 0, 0 }, { 0, -1, 0 }, { 0, 0, -1 } };
+	for (const auto& axis : axes) {
+		vertices.emplace_back(axis * 10.0f, axis, glm::vec2(0.0f, 1.0f));
+	}
+	for (int i = 0; i < 1000; ++i) {
+		const glm::vec3 position(100.0f + unit(random) * 50.0f, unit(random) * 0.5f, -20.0f + unit(random) * 5.0f);
+		glm::vec3 normal;
+		do {
+			normal = glm::vec3(unit(random), unit(random), unit(random));
+		} while (glm::length(normal) < 0.1f);
+
+		vertices.emplace_back(position, glm::normalize(normal), glm::vec2(unit(random), unit(random)) * 3.0f + 1.0f);
+	}
+
+	Mesh mesh(vertices, { 0, 1, 2 }, nullptr);
+	mesh.computeBounds();
+	mesh.quantize();
+	CHECK(mesh.gpuVertices.size() == vertices.size());
+
+	// Rounding to the nearest SNORM step is off by at most half a step of the AABB's half extent
+	const auto positionTolerance = mesh.positionScale * (0.5f / 32767.0f) + glm::vec3(1e-5f);
+	auto maxNormalError = 0.0f;
+
+	for (std::size_t i = 0; i < vertices.size(); ++i) {
+		const auto& source = vertices[i];
+		const auto& packed = mesh.gpuVertices[i];
+
+		const glm::vec3 snorm(glm::unpackSnorm1x16(packed.position[0]), glm::unpackSnorm1x16(packed.position[1]), glm::unpackSnorm1x16(packed.position[2]));
+		const auto position = snorm * mesh.positionScale + mesh.positionOffset;
+		CHECK(glm::all(glm::lessThanEqual(glm::abs(position - source.pos), positionTolerance)));
+
+		const auto normal = octDecode(glm::vec2(glm::unpackSnorm1x16(packed.normal[0]), glm::unpackSnorm1x16(packed.normal[1])));
+		maxNormalError = std::max(maxNormalError, glm::length(normal - source.normal));
+
+		// Half floats keep 11 significant bits
+		const glm::vec2 texCoord(glm::unpackHalf1x16(packed.texCoord[0]), glm::unpackHalf1x16(packed.texCoord[1]));
+		CHECK(glm::all(glm::lessThanEqual(glm::abs(texCoord - source.texCoord), glm::abs(source.texCoord) * (1.0f / 2048.0f))));
+	}
+
+	// 16 bit octahedral normals are good to well under a hundredth of a degree
+	CHECK(maxNormalError < 1e-4f);
+#endif
+}
+
+/***********************************************************************************/
+// 16 bit indices reach vertex 65535, so they cover exactly 65536 vertices
+TEST(MeshIndexTypeBoundary) {
+	const std::vector<Vertex> vertices(65536, Vertex(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec2(0.0f)));
+
+	Mesh mesh(vertices, { 0, 65534, 65535 }, nullptr);
+	CHECK(mesh.indexType() == VK_INDEX_TYPE_UINT16);
+	CHECK(mesh.indexSize() == sizeof(std::uint16_t));
+	CHECK(static_cast<std::uint16_t>(mesh.indices.back()) == mesh.indices.back());
+
+	mesh.vertices.push_back(vertices.back());
+	mesh.indices.back() = 65536;
+	CHECK(mesh.indexType() == VK_INDEX_TYPE_UINT32);
+	CHECK(mesh.indexSize() == sizeof(std::uint32_t));
+}
@@ -0,0 +1,293 @@
+#include "Test.h"
+#include "TestDevice.h"
+
+#include <Graphics/PipelineCache.h>
+#include <Graphics/ShaderReflection.h>
+#include <Graphics/Vertex.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <vector>
+
+namespace {
+	/***********************************************************************************/
+	// Color + depth for the forward pass, depth alone for the pre-pass. Never begun, pipelines only need them to exist.
+	VkRenderPass createRenderPass(const VkDevice device, const bool depthOnly) {
+		std::array<VkAttachmentDescription, 2> attachments {};
+		attachments[0].format = VK_FORMAT_D32_SFLOAT;
+		attachments[0].samples = VK_SAMPLE_COUNT_1_BIT;
+		attachments[0].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+		attachments[0].storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		attachments[0].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+		attachments[0].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		attachments[0].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		attachments[0].finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+		attachments[1] = attachments[0];
+		attachments[1].format = VK_FORMAT_B8G8R8A8_UNORM;
+		attachments[1].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+		attachments[1].finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+		const VkAttachmentReference depthReference { 0, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL };
+		const VkAttachmentReference colorReference { 1, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+
+		VkSubpassDescription subpass {};
+		subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+		subpass.colorAttachmentCount = depthOnly ? 0 : 1;
+		subpass.pColorAttachments = &colorReference;
+		subpass.pDepthStencilAttachment = &depthReference;
+
+		VkRenderPassCreateInfo renderPassInfo {};
+		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+		renderPassInfo.attachmentCount = depthOnly ? 1 : 2;
+		renderPassInfo.pAttachments = attachments.data();
+		renderPassInfo.subpassCount = 1;
+		renderPassInfo.pSubpasses = &subpass;
+
+		VkRenderPass renderPass = VK_NULL_HANDLE;
+		vkCreateRenderPass(device, &renderPassInfo, nullptr, &renderPass);
+		return renderPass;
+	}
+
+	/***********************************************************************************/
+	// The shipped SPIR-V of the description's variant with the description's fixed-function state,
+	// like RenderSystem::createGraphicsPipeline minus the runtime compiler
+	VkPipeline createPipeline(const TestDevice& device, const VkPipelineLayout layout, const VkRenderPass renderPass, const VkRenderPass depthRenderPass,
+		const PipelineDescription& description, const VkPipelineCache pipelineCache) {
+		const auto vertex = device.createShaderModule(description.depthOnly ? "Data/Shaders/vert_depth.spv" : description.shader.precompiledVertex());
+		const auto fragment = description.depthOnly ? VK_NULL_HANDLE : device.createShaderModule(description.shader.precompiledFragment());
+
+		const ShaderVariantConstants constants { description.shader.lit, description.shader.ambient };
+		const std::array<VkSpecializationMapEntry, 2> specializationEntries {{
+			{ 0, offsetof(ShaderVariantConstants, lit), sizeof(constants.lit) },
+			{ 1, offsetof(ShaderVariantConstants, ambient), sizeof(constants.ambient) }
+		}};
+		const VkSpecializationInfo specializationInfo { 2, specializationEntries.data(), sizeof(constants), &constants };
+
+		std::array<VkPipelineShaderStageCreateInfo, 2> stages {};
+		stages[0].sType = stages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		stages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+		stages[0].module = vertex;
+		stages[0].pName = "main";
+		stages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+		stages[1].module = fragment;
+		stages[1].pName = "main";
+		stages[1].pSpecializationInfo = &specializationInfo;
+
+		constexpr auto bindingDescription = VertexLayout<GpuVertex>::getBindingDescription();
+		constexpr auto attributeDescriptions = VertexLayout<GpuVertex>::getAttributeDescriptions();
+		VkPipelineVertexInputStateCreateInfo vertexInput {};
+		vertexInput.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+		vertexInput.vertexBindingDescriptionCount = 1;
+		vertexInput.pVertexBindingDescriptions = &bindingDescription;
+		vertexInput.vertexAttributeDescriptionCount = description.depthOnly ? 1 : static_cast<std::uint32_t>(attributeDescriptions.size());
+		vertexInput.pVertexAttributeDescriptions = attributeDescriptions.data();
+
+		VkPipelineInputAssemblyStateCreateInfo inputAssembly {};
+		inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+		inputAssembly.topology = description.topology;
+
+		VkPipelineViewportStateCreateInfo viewportState {};
+		viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+		viewportState.viewportCount = 1;
+		viewportState.scissorCount = 1;
+
+		const std::array<VkDynamicState, 2> dynamicStates { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+		VkPipelineDynamicStateCreateInfo dynamicState {};
+		dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+		dynamicState.dynamicStateCount = static_cast<std::uint32_t>(dynamicStates.size());
+		dynamicState.pDynamicStates = dynamicStates.data();
+
+		VkPipelineRasterizationStateCreateInfo rasterizer {};
+		rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+		rasterizer.polygonMode = description.polygonMode;
+		rasterizer.cullMode = description.cullMode;
+		rasterizer.frontFace = description.frontFace;
+		rasterizer.lineWidth = 1.0f;
+
+		VkPipelineMultisampleStateCreateInfo multisampling {};
+		multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+		multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+		VkPipelineDepthStencilStateCreateInfo depthStencil {};
+		depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+		depthStencil.depthTestEnable = description.depthTest;
+		depthStencil.depthWriteEnable = description.depthWrite;
+		depthStencil.depthCompareOp = description.depthCompare;
+		depthStencil.maxDepthBounds = 1.0f;
+
+		VkPipelineColorBlendAttachmentState colorBlendAttachment {};
+		colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+		colorBlendAttachment.blendEnable = description.blend;
+		colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+		colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+		colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+
+		VkPipelineColorBlendStateCreateInfo colorBlending {};
+		colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+		colorBlending.attachmentCount = description.depthOnly ? 0 : 1;
+		colorBlending.pAttachments = &colorBlendAttachment;
+
+		VkGraphicsPipelineCreateInfo pipelineInfo {};
+		pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+		pipelineInfo.stageCount = description.depthOnly ? 1 : 2;
+		pipelineInfo.pStages = stages.data();
+		pipelineInfo.pVertexInputState = &vertexInput;
+		pipelineInfo.pInputAssemblyState = &inputAssembly;
+		pipelineInfo.pViewportState = &viewportState;
+		pipelineInfo.pRasterizationState = &rasterizer;
+		pipelineInfo.pMultisampleState = &multisampling;
+		pipelineInfo.pDepthStencilState = &depthStencil;
+		pipelineInfo.pColorBlendState = &colorBlending;
+		pipelineInfo.pDynamicState = &dynamicState;
+		pipelineInfo.layout = layout;
+		pipelineInfo.renderPass = description.depthOnly ? depthRenderPass : renderPass;
+
+		VkPipeline pipeline = VK_NULL_HANDLE;
+		if (vertex == VK_NULL_HANDLE || (fragment == VK_NULL_HANDLE && !description.depthOnly) ||
+			vkCreateGraphicsPipelines(device.device(), pipelineCache, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS) {
+			pipeline = VK_NULL_HANDLE;
+		}
+
+		vkDestroyShaderModule(device.device(), vertex, nullptr);
+		vkDestroyShaderModule(device.device(), fragment, nullptr);
+		return pipeline;
+	}
+}
+
+/***********************************************************************************/
+// Every field takes part in both, so no two different pipelines share a cache entry
+TEST(PipelineDescriptionHashAndEquality) {
+	const PipelineDescription base;
+	CHECK(base == PipelineDescription());
+	CHECK(base.hash() == PipelineDescription().hash());
+	CHECK(PipelineDescription::Hasher()(base) == static_cast<std::size_t>(base.hash()));
+
+	const std::function<void(PipelineDescription&)> changes[] {
+		[](PipelineDescription& d) { d.shader.textured = false; },
+		[](PipelineDescription& d) { d.shader.lit = !d.shader.lit; },
+		[](PipelineDescription& d) { d.shader.ambient += 0.1f; },
+		[](PipelineDescription& d) { d.topology = VK_PRIMITIVE_TOPOLOGY_LINE_LIST; },
+		[](PipelineDescription& d) { d.polygonMode = VK_POLYGON_MODE_LINE; },
+		[](PipelineDescription& d) { d.cullMode = VK_CULL_MODE_NONE; },
+		[](PipelineDescription& d) { d.frontFace = VK_FRONT_FACE_CLOCKWISE; },
+		[](PipelineDescription& d) { d.depthTest = VK_FALSE; },
+		[](PipelineDescription& d) { d.depthWrite = VK_FALSE; },
+		[](PipelineDescription& d) { d.depthCompare = VK_COMPARE_OP_EQUAL; },
+		[](PipelineDescription& d) { d.blend = VK_TRUE; },
+		[](PipelineDescription& d) { d.depthOnly = true; }
+	};
+
+	std::vector<std::uint64_t> hashes { base.hash() };
+	for (const auto& change : changes) {
+		auto description = base;
+		change(description);
+		CHECK(description != base);
+		CHECK(!(description == base));
+		hashes.push_back(description.hash());
+	}
+
+	std::sort(hashes.begin(), hashes.end());
+	CHECK(std::adjacent_find(hashes.begin(), hashes.end()) == hashes.end());
+}
+
+/***********************************************************************************/
+// Real pipelines from the shipped SPIR-V: get() never blocks, wait() does, each description is created
+// once, failures stick until clear(), and shutdown saves a cache init will accept on the next run
+TEST(PipelineCacheCreatesOnWorkers) {
+	TestDevice device;
+	if (!device.valid()) {
+		SKIP("no Vulkan device");
+	}
+
+	const auto vert = TestDevice::readFile("Data/Shaders/vert.spv"), frag = TestDevice::readFile("Data/Shaders/frag.spv");
+	if (vert.empty() || frag.empty()) {
+		SKIP("run from SolEngine/ to find Data/Shaders");
+	}
+
+	LayoutCache layoutCache;
+	layoutCache.init(device.device());
+	auto reflection = ShaderReflection::reflect(vert);
+	reflection.merge(ShaderReflection::reflect(frag));
+	const auto layout = layoutCache.pipelineLayout(reflection);
+	const auto renderPass = createRenderPass(device.device(), false);
+	const auto depthRenderPass = createRenderPass(device.device(), true);
+	CHECK(layout != VK_NULL_HANDLE && renderPass != VK_NULL_HANDLE && depthRenderPass != VK_NULL_HANDLE);
+
+	const auto directory = (std::filesystem::temp_directory_path() / "SolEnginePipelineCache").generic_string();
+	std::filesystem::remove_all(directory);
+	const auto path = directory + "/pipelines.bin";
+
+	// Blending stands in for a pipeline the driver rejects
+	std::atomic<int> creations { 0 };
+	PipelineCache cache(path);
+	cache.init(device.device(), device.physicalDevice(), [&](const PipelineDescription& description, const VkPipelineCache pipelineCache) {
+		++creations;
+		return description.blend ? VK_NULL_HANDLE : createPipeline(device, layout, renderPass, depthRenderPass, description, pipelineCache);
+	});
+
+	PipelineDescription forward;
+	PipelineDescription depthOnly;
+	depthOnly.depthOnly = true;
+	PipelineDescription untextured;
+	untextured.shader.textured = false;
+	untextured.shader.lit = true;
+	PipelineDescription broken;
+	broken.blend = VK_TRUE;
+
+	// Asking starts the creation, waiting finishes it
+	cache.get(forward);
+	const auto pipeline = cache.wait(forward);
+	CHECK(pipeline != VK_NULL_HANDLE);
+	CHECK(cache.get(forward) == pipeline);
+	CHECK(cache.wait(forward) == pipeline);
+	CHECK(!cache.failed(forward));
+
+	for (const auto& description : { depthOnly, untextured }) {
+		const auto other = cache.wait(description);
+		CHECK(other != VK_NULL_HANDLE && other != pipeline);
+	}
+
+	CHECK(cache.wait(broken) == VK_NULL_HANDLE);
+	CHECK(cache.failed(broken));
+	CHECK(cache.get(broken) == VK_NULL_HANDLE);
+	CHECK(cache.pipelineCount() == 4);
+	CHECK(creations == 4);
+
+	// Everything is created again after a clear, failures get another chance
+	cache.clear();
+	CHECK(cache.pipelineCount() == 0);
+	CHECK(!cache.failed(broken));
+	CHECK(cache.wait(forward) != VK_NULL_HANDLE);
+	CHECK(cache.wait(broken) == VK_NULL_HANDLE);
+	CHECK(creations == 6);
+
+	cache.shutdown();
+	CHECK(cache.pipelineCount() == 0);
+
+	// Saved with this device's header, which is what init checks before seeding the next cache from it
+	std::ifstream file(path, std::ios::binary);
+	const std::vector<char> data { std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>() };
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(device.physicalDevice(), &properties);
+	CHECK(data.size() >= 16 + VK_UUID_SIZE);
+	if (data.size() >= 16 + VK_UUID_SIZE) {
+		std::uint32_t header[4];
+		std::memcpy(header, data.data(), sizeof(header));
+		CHECK(header[1] == VK_PIPELINE_CACHE_HEADER_VERSION_ONE);
+		CHECK(header[2] == properties.vendorID && header[3] == properties.deviceID);
+		CHECK(std::memcmp(data.data() + 16, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0);
+	}
+
+	vkDestroyRenderPass(device.device(), renderPass, nullptr);
+	vkDestroyRenderPass(device.device(), depthRenderPass, nullptr);
+	layoutCache.shutdown();
+
+	std::error_code error;
+	std::filesystem::remove_all(directory, error);
+}
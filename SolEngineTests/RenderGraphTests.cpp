@@ -0,0 +1,268 @@
+#include "Test.h"
+#include "TestDevice.h"
+
+#include <Graphics/RenderGraph.h>
+
+#include <algorithm>
+
+namespace {
+	constexpr VkExtent2D Extent { 64, 64 };
+	constexpr RenderGraph::ImageDescription ColorImage { VK_FORMAT_R8G8B8A8_UNORM };
+	constexpr RenderGraph::ImageDescription DepthImage { VK_FORMAT_D32_SFLOAT };
+
+	/***********************************************************************************/
+	const RenderGraph::Barrier* findBarrier(const RenderGraph::BarrierBatch& batch, const RenderGraph::Resource resource) {
+		const auto barrier = std::find_if(batch.barriers.begin(), batch.barriers.end(), [resource](const auto& barrier) { return barrier.resource == resource; });
+		return barrier != batch.barriers.end() ? &*barrier : nullptr;
+	}
+}
+
+/***********************************************************************************/
+// A pass whose output nothing reads goes, and so does the pass that only feeds it. Their images are never created.
+TEST(RenderGraphCullsUnreadPasses) {
+	TestDevice device;
+	if (!device.valid()) {
+		SKIP("no Vulkan device");
+	}
+
+	RenderGraph graph;
+	graph.init(device.device(), device.allocator());
+
+	const auto result = graph.importBuffer("result", device.createBuffer(256, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT).buffer, RenderGraph::Usage::HostRead);
+	auto unread = RenderGraph::InvalidResource, feed = RenderGraph::InvalidResource;
+
+	graph.addPass("feedsUnread", VK_PIPELINE_BIND_POINT_COMPUTE, [&](RenderGraph::PassBuilder& builder) {
+		feed = builder.createImage("feed", ColorImage);
+		builder.write(feed, RenderGraph::Usage::StorageWriteCompute);
+	}, [](VkCommandBuffer) {});
+	graph.addPass("unread", VK_PIPELINE_BIND_POINT_COMPUTE, [&](RenderGraph::PassBuilder& builder) {
+		builder.read(feed, RenderGraph::Usage::StorageReadCompute);
+		unread = builder.createImage("unread", ColorImage);
+		builder.write(unread, RenderGraph::Usage::StorageWriteCompute);
+	}, [](VkCommandBuffer) {});
+	graph.addPass("used", VK_PIPELINE_BIND_POINT_COMPUTE, [&](RenderGraph::PassBuilder& builder) {
+		builder.write(result, RenderGraph::Usage::StorageWriteCompute);
+	}, [](VkCommandBuffer) {});
+	graph.addPass("sideEffects", VK_PIPELINE_BIND_POINT_COMPUTE, [&](RenderGraph::PassBuilder& builder) {
+		builder.sideEffects();
+	}, [](VkCommandBuffer) {});
+	graph.compile(Extent);
+
+	CHECK(graph.culled("unread"));
+	CHECK(graph.culled("feedsUnread"));
+	CHECK(!graph.culled("used"));
+	CHECK(!graph.culled("sideEffects"));
+	CHECK(graph.image(unread) == VK_NULL_HANDLE && graph.imageUsage(unread) == 0);
+	CHECK(graph.image(feed) == VK_NULL_HANDLE && graph.imageUsage(feed) == 0);
+	CHECK(graph.memoryStats().allocated == 0);
+
+	graph.reset();
+}
+
+/***********************************************************************************/
+// Attachments are stored when a later pass or the outside world reads them, and discarded otherwise
+TEST(RenderGraphStoresOnlyWhatIsReadLater) {
+	TestDevice device;
+	if (!device.valid()) {
+		SKIP("no Vulkan device");
+	}
+
+	RenderGraph graph;
+	graph.init(device.device(), device.allocator());
+
+	const auto swapchain = graph.importImage("swapchain", VK_FORMAT_B8G8R8A8_UNORM, RenderGraph::Usage::Present);
+	const auto result = graph.importBuffer("result", device.createBuffer(256, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT).buffer, RenderGraph::Usage::HostRead);
+	auto color = RenderGraph::InvalidResource, depth = RenderGraph::InvalidResource;
+
+	graph.addPass("scene", VK_PIPELINE_BIND_POINT_GRAPHICS, [&](RenderGraph::PassBuilder& builder) {
+		color = builder.createImage("color", ColorImage);
+		depth = builder.createImage("depth", DepthImage);
+		builder.colorAttachment(color);
+		builder.colorAttachment(swapchain);
+		builder.depthAttachment(depth);
+	}, [](VkCommandBuffer) {});
+	graph.addPass("post", VK_PIPELINE_BIND_POINT_COMPUTE, [&](RenderGraph::PassBuilder& builder) {
+		builder.read(color, RenderGraph::Usage::SampledCompute);
+		builder.write(result, RenderGraph::Usage::StorageWriteCompute);
+	}, [](VkCommandBuffer) {});
+	graph.compile(Extent);
+
+	CHECK(graph.renderPass("scene") != VK_NULL_HANDLE);
+	CHECK(graph.storeOp("scene", color) == VK_ATTACHMENT_STORE_OP_STORE);
+	CHECK(graph.storeOp("scene", swapchain) == VK_ATTACHMENT_STORE_OP_STORE);
+	CHECK(graph.storeOp("scene", depth) == VK_ATTACHMENT_STORE_OP_DONT_CARE);
+
+	graph.reset();
+}
+
+/***********************************************************************************/
+// Two transients of the same size whose lifetimes don't overlap share one memory slot, the second one's
+// first use waits for the first one's last
+TEST(RenderGraphAliasesDisjointTransients) {
+	TestDevice device;
+	if (!device.valid()) {
+		SKIP("no Vulkan device");
+	}
+
+	RenderGraph graph;
+	graph.init(device.device(), device.allocator());
+
+	const auto result = graph.importBuffer("result", device.createBuffer(256, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT).buffer, RenderGraph::Usage::HostRead);
+	auto first = RenderGraph::InvalidResource, second = RenderGraph::InvalidResource;
+
+	graph.addPass("writeFirst", VK_PIPELINE_BIND_POINT_COMPUTE, [&](RenderGraph::PassBuilder& builder) {
+		first = builder.createImage("first", ColorImage);
+		builder.write(first, RenderGraph::Usage::StorageWriteCompute);
+	}, [](VkCommandBuffer) {});
+	graph.addPass("readFirst", VK_PIPELINE_BIND_POINT_COMPUTE, [&](RenderGraph::PassBuilder& builder) {
+		builder.read(first, RenderGraph::Usage::StorageReadCompute);
+		builder.write(result, RenderGraph::Usage::StorageWriteCompute);
+	}, [](VkCommandBuffer) {});
+	graph.addPass("writeSecond", VK_PIPELINE_BIND_POINT_COMPUTE, [&](RenderGraph::PassBuilder& builder) {
+		second = builder.createImage("second", ColorImage);
+		builder.write(second, RenderGraph::Usage::StorageWriteCompute);
+	}, [](VkCommandBuffer) {});
+	graph.addPass("readSecond", VK_PIPELINE_BIND_POINT_COMPUTE, [&](RenderGraph::PassBuilder& builder) {
+		builder.read(second, RenderGraph::Usage::StorageReadCompute);
+		builder.write(result, RenderGraph::Usage::StorageWriteCompute);
+	}, [](VkCommandBuffer) {});
+	graph.compile(Extent);
+
+	const auto stats = graph.memoryStats();
+	CHECK(graph.image(first) != VK_NULL_HANDLE && graph.image(second) != VK_NULL_HANDLE && graph.image(first) != graph.image(second));
+	CHECK(stats.unaliased > 0);
+	CHECK(stats.allocated * 2 == stats.unaliased);
+
+	const auto batch = graph.barriers("writeSecond");
+	const auto barrier = batch ? findBarrier(*batch, second) : nullptr;
+	CHECK(barrier != nullptr);
+	if (barrier) {
+		CHECK((batch->srcStages & VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT) != 0);
+		CHECK(barrier->oldLayout == VK_IMAGE_LAYOUT_UNDEFINED);
+		CHECK(barrier->newLayout == VK_IMAGE_LAYOUT_GENERAL);
+	}
+
+	graph.reset();
+}
+
+/***********************************************************************************/
+// Depth written by a graphics pass and sampled by a compute pass, as the Hi-Z build does
+TEST(RenderGraphDepthWriteThenComputeReadBarrier) {
+	TestDevice device;
+	if (!device.valid()) {
+		SKIP("no Vulkan device");
+	}
+
+	RenderGraph graph;
+	graph.init(device.device(), device.allocator());
+
+	const auto result = graph.importBuffer("result", device.createBuffer(256, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT).buffer, RenderGraph::Usage::HostRead);
+	auto depth = RenderGraph::InvalidResource;
+
+	graph.addPass("depth", VK_PIPELINE_BIND_POINT_GRAPHICS, [&](RenderGraph::PassBuilder& builder) {
+		depth = builder.createImage("depth", DepthImage);
+		builder.depthAttachment(depth);
+	}, [](VkCommandBuffer) {});
+	graph.addPass("reduce", VK_PIPELINE_BIND_POINT_COMPUTE, [&](RenderGraph::PassBuilder& builder) {
+		builder.read(depth, RenderGraph::Usage::SampledCompute);
+		builder.write(result, RenderGraph::Usage::StorageWriteCompute);
+	}, [](VkCommandBuffer) {});
+	graph.compile(Extent);
+
+	CHECK(graph.storeOp("depth", depth) == VK_ATTACHMENT_STORE_OP_STORE);
+
+	const auto batch = graph.barriers("reduce");
+	const auto barrier = batch ? findBarrier(*batch, depth) : nullptr;
+	CHECK(barrier != nullptr);
+	if (barrier) {
+		CHECK((batch->srcStages & VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT) != 0);
+		CHECK((batch->dstStages & VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT) != 0);
+		CHECK((barrier->srcAccess & VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT) != 0);
+		CHECK(barrier->dstAccess == VK_ACCESS_SHADER_READ_BIT);
+		CHECK(barrier->oldLayout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
+		CHECK(barrier->newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	}
+
+	graph.reset();
+}
+
+/***********************************************************************************/
+// Only attachments of a single pass that are never loaded get VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT
+TEST(RenderGraphMakesSinglePassAttachmentsLazy) {
+	TestDevice device;
+	if (!device.valid()) {
+		SKIP("no Vulkan device");
+	}
+
+	RenderGraph graph;
+	graph.init(device.device(), device.allocator());
+
+	const auto swapchain = graph.importImage("swapchain", VK_FORMAT_B8G8R8A8_UNORM, RenderGraph::Usage::Present);
+	auto scratch = RenderGraph::InvalidResource, loaded = RenderGraph::InvalidResource, depth = RenderGraph::InvalidResource;
+
+	graph.addPass("prepass", VK_PIPELINE_BIND_POINT_GRAPHICS, [&](RenderGraph::PassBuilder& builder) {
+		depth = builder.createImage("depth", DepthImage);
+		builder.depthAttachment(depth);
+	}, [](VkCommandBuffer) {});
+	graph.addPass("scene", VK_PIPELINE_BIND_POINT_GRAPHICS, [&](RenderGraph::PassBuilder& builder) {
+		scratch = builder.createImage("scratch", ColorImage);
+		loaded = builder.createImage("loaded", ColorImage);
+		builder.colorAttachment(swapchain);
+		builder.colorAttachment(scratch, VK_ATTACHMENT_LOAD_OP_DONT_CARE);
+		builder.colorAttachment(loaded, VK_ATTACHMENT_LOAD_OP_LOAD);
+		builder.depthReadAttachment(depth);
+	}, [](VkCommandBuffer) {});
+	graph.compile(Extent);
+
+	CHECK((graph.imageUsage(scratch) & VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT) != 0);
+	CHECK(graph.storeOp("scene", scratch) == VK_ATTACHMENT_STORE_OP_DONT_CARE);
+	CHECK(graph.imageUsage(loaded) != 0 && (graph.imageUsage(loaded) & VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT) == 0);
+	CHECK(graph.imageUsage(depth) != 0 && (graph.imageUsage(depth) & VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT) == 0);
+
+	const auto stats = graph.memoryStats();
+	CHECK(stats.allocated == stats.unaliased);
+	CHECK(stats.lazy <= stats.allocated && stats.committed <= stats.lazy);
+
+	graph.reset();
+}
+
+/***********************************************************************************/
+// A lazy attachment and a backed image of the same size with disjoint lifetimes would share memory if
+// both were backed. Lazily allocated memory can't hold the backed one, so they get a slot each.
+TEST(RenderGraphKeepsLazyTransientsApart) {
+	TestDevice device;
+	if (!device.valid()) {
+		SKIP("no Vulkan device");
+	}
+
+	RenderGraph graph;
+	graph.init(device.device(), device.allocator());
+
+	const auto swapchain = graph.importImage("swapchain", VK_FORMAT_B8G8R8A8_UNORM, RenderGraph::Usage::Present);
+	const auto result = graph.importBuffer("result", device.createBuffer(256, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT).buffer, RenderGraph::Usage::HostRead);
+	auto scratch = RenderGraph::InvalidResource, storage = RenderGraph::InvalidResource;
+
+	graph.addPass("scene", VK_PIPELINE_BIND_POINT_GRAPHICS, [&](RenderGraph::PassBuilder& builder) {
+		scratch = builder.createImage("scratch", ColorImage);
+		builder.colorAttachment(swapchain);
+		builder.colorAttachment(scratch);
+	}, [](VkCommandBuffer) {});
+	graph.addPass("writeStorage", VK_PIPELINE_BIND_POINT_COMPUTE, [&](RenderGraph::PassBuilder& builder) {
+		storage = builder.createImage("storage", ColorImage);
+		builder.write(storage, RenderGraph::Usage::StorageWriteCompute);
+	}, [](VkCommandBuffer) {});
+	graph.addPass("readStorage", VK_PIPELINE_BIND_POINT_COMPUTE, [&](RenderGraph::PassBuilder& builder) {
+		builder.read(storage, RenderGraph::Usage::StorageReadCompute);
+		builder.write(result, RenderGraph::Usage::StorageWriteCompute);
+	}, [](VkCommandBuffer) {});
+	graph.compile(Extent);
+
+	CHECK((graph.imageUsage(scratch) & VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT) != 0);
+	CHECK((graph.imageUsage(storage) & VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT) == 0);
+
+	const auto stats = graph.memoryStats();
+	CHECK(stats.unaliased > 0);
+	CHECK(stats.allocated == stats.unaliased);
+
+	graph.reset();
+}
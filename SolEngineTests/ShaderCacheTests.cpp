@@ -0,0 +1,52 @@
+#include "Test.h"
+
+#include <Graphics/ShaderCache.h>
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+
+/***********************************************************************************/
+TEST(ShaderCacheVariantKey) {
+	const std::string source = "#version 450\nvoid main() {}\n";
+	const auto key = ShaderCache::variantKey(source, { "A", "B=1" });
+
+	// Define order doesn't matter, define boundaries and values do
+	CHECK(ShaderCache::variantKey(source, { "B=1", "A" }) == key);
+	CHECK(ShaderCache::variantKey(source, { "A", "B=2" }) != key);
+	CHECK(ShaderCache::variantKey(source, { "AB" }) != ShaderCache::variantKey(source, { "A", "B" }));
+	CHECK(ShaderCache::variantKey(source, {}) != ShaderCache::variantKey(source, { "" }));
+
+	// Any edit to the source is a new binary
+	CHECK(ShaderCache::variantKey(source + ' ', { "A", "B=1" }) != key);
+}
+
+/***********************************************************************************/
+// A warm cache only reads the binary named by the key, whichever order the defines come in
+TEST(ShaderCacheReadsCachedBinary) {
+	const auto directory = (std::filesystem::temp_directory_path() / "SolEngineShaderCache").generic_string();
+	std::filesystem::remove_all(directory);
+	std::filesystem::create_directories(directory);
+
+	const std::string source = "#version 450\nvoid main() {}\n";
+	const auto sourcePath = directory + "/test.comp";
+	std::ofstream(sourcePath, std::ios::binary) << source;
+
+	char name[17];
+	std::snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(ShaderCache::variantKey(source, { "A", "B" })));
+	const std::string binary = "not really SPIR-V";
+	std::ofstream(directory + "/test.comp." + name + ".spv", std::ios::binary) << binary << std::string(4 - binary.size() % 4, '\0');
+
+	ShaderCache cache(directory);
+	const auto code = cache.get(sourcePath, { "B", "A" });
+	CHECK(code.size() == 20);
+	CHECK(std::string(code.data(), binary.size()) == binary);
+
+	// Other defines miss the cache and need the compiler
+	if (!ShaderCache::canCompile()) {
+		CHECK(cache.get(sourcePath, { "A" }).empty());
+	}
+
+	std::error_code error;
+	std::filesystem::remove_all(directory, error);
+}
@@ -0,0 +1,141 @@
+#include "Test.h"
+#include "TestDevice.h"
+
+#include <Graphics/ShaderReflection.h>
+
+#include <cstring>
+#include <random>
+
+namespace {
+	/***********************************************************************************/
+	bool declares(const ShaderReflection& reflection, const std::uint32_t binding, const VkDescriptorType type) {
+		const auto* declared = reflection.findBinding(0, binding);
+		return declared && declared->type == type;
+	}
+}
+
+/***********************************************************************************/
+// The precompiled modules are what the engine falls back on, so they must match what it binds
+TEST(ShaderReflectionShippedModules) {
+	const auto vert = TestDevice::readFile("Data/Shaders/vert.spv"), frag = TestDevice::readFile("Data/Shaders/frag.spv");
+	if (vert.empty() || frag.empty()) {
+		SKIP("run from SolEngine/ to find Data/Shaders");
+	}
+
+	auto graphics = ShaderReflection::reflect(vert);
+	CHECK(graphics.stages == VK_SHADER_STAGE_VERTEX_BIT);
+	const auto fragment = ShaderReflection::reflect(frag);
+	CHECK(fragment.stages == VK_SHADER_STAGE_FRAGMENT_BIT);
+	graphics.merge(fragment);
+
+	CHECK(declares(graphics, 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER));
+	CHECK(declares(graphics, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER));
+	// One element per texture slot, see MaxTextures in RenderSystem.cpp
+	const auto* textures = graphics.findBinding(0, 1);
+	CHECK(textures && textures->count == 64);
+	for (std::uint32_t binding = 2; binding <= 5; ++binding) {
+		CHECK(declares(graphics, binding, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER));
+	}
+	CHECK(graphics.setCount() == 1);
+
+	// Position, normal, uv as the vertex layout provides them
+	CHECK(graphics.inputs.size() == 3);
+	for (std::uint32_t i = 0; i < graphics.inputs.size(); ++i) {
+		CHECK(graphics.inputs[i].location == i);
+		CHECK(graphics.inputs[i].type == ShaderReflection::NumericType::Float);
+	}
+}
+
+/***********************************************************************************/
+// The other #define combinations' fallbacks fit the default variant's layout
+TEST(ShaderReflectionShippedVariants) {
+	const auto fullPrecision = TestDevice::readFile("Data/Shaders/vert_full_precision.spv"), untextured = TestDevice::readFile("Data/Shaders/frag_untextured.spv");
+	if (fullPrecision.empty() || untextured.empty()) {
+		SKIP("run from SolEngine/ to find Data/Shaders");
+	}
+
+	const auto vertex = ShaderReflection::reflect(fullPrecision);
+	CHECK(vertex.stages == VK_SHADER_STAGE_VERTEX_BIT);
+	CHECK(declares(vertex, 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER) && declares(vertex, 2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER));
+	CHECK(vertex.inputs.size() == 3);
+	CHECK(vertex.pushConstants.size == sizeof(std::uint32_t));
+
+	// Everything but the texture
+	const auto fragment = ShaderReflection::reflect(untextured);
+	CHECK(fragment.stages == VK_SHADER_STAGE_FRAGMENT_BIT);
+	CHECK(declares(fragment, 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER));
+	CHECK(fragment.findBinding(0, 1) == nullptr);
+	for (std::uint32_t binding = 3; binding <= 5; ++binding) {
+		CHECK(declares(fragment, binding, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER));
+	}
+}
+
+/***********************************************************************************/
+// The depth pre-pass binds only the position attribute, which is all vert_depth.spv may read
+TEST(ShaderReflectionShippedDepthOnly) {
+	const auto code = TestDevice::readFile("Data/Shaders/vert_depth.spv");
+	if (code.empty()) {
+		SKIP("run from SolEngine/ to find Data/Shaders");
+	}
+
+	const auto vertex = ShaderReflection::reflect(code);
+	CHECK(vertex.stages == VK_SHADER_STAGE_VERTEX_BIT);
+	CHECK(vertex.inputs.size() == 1 && vertex.inputs.front().location == 0);
+	CHECK(declares(vertex, 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER) && declares(vertex, 2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER));
+	CHECK(vertex.pushConstants.size == sizeof(std::uint32_t));
+}
+
+/***********************************************************************************/
+// Truncated or corrupted modules come back empty (or at worst wrong), never read out of bounds
+TEST(ShaderReflectionMalformedModules) {
+	CHECK(ShaderReflection::reflect({}).stages == 0);
+	CHECK(ShaderReflection::reflect(std::vector<char>(3, 0)).stages == 0);
+	CHECK(ShaderReflection::reflect(std::vector<char>(64, 0)).stages == 0);
+
+	auto code = TestDevice::readFile("Data/Shaders/vert.spv");
+	if (code.empty()) {
+		SKIP("run from SolEngine/ to find Data/Shaders");
+	}
+	const auto wordCount = code.size() / 4;
+
+	std::vector<std::uint32_t> words(wordCount);
+	std::memcpy(words.data(), code.data(), wordCount * 4);
+
+	const auto toCode = [](const std::vector<std::uint32_t>& module) {
+		std::vector<char> bytes(module.size() * 4);
+		std::memcpy(bytes.data(), module.data(), bytes.size());
+		return bytes;
+	};
+
+	// Every truncation point
+	for (std::size_t size = 0; size < code.size(); size += 4) {
+		ShaderReflection::reflect(std::vector<char>(code.begin(), code.begin() + size));
+	}
+
+	// Every instruction claiming fewer operands than it has, so its fields run into the next one
+	for (std::size_t i = 5; i < wordCount; i += words[i] >> 16) {
+		const auto count = words[i] >> 16;
+		if (count == 0) {
+			break;
+		}
+		for (std::uint32_t shorter = 1; shorter < count; ++shorter) {
+			auto corrupted = words;
+			corrupted[i] = (shorter << 16) | (words[i] & 0xFFFF);
+			ShaderReflection::reflect(toCode(corrupted));
+		}
+	}
+
+	// Random words overwritten, ids and member indices included
+	std::mt19937 random(11);
+	for (int round = 0; round < 2000; ++round) {
+		auto corrupted = words;
+		for (int change = 0; change < 4; ++change) {
+			const auto index = 5 + random() % (wordCount - 5);
+			corrupted[index] = random() % 4 == 0 ? random() : corrupted[index] ^ (1u << (random() % 32));
+		}
+		ShaderReflection::reflect(toCode(corrupted));
+	}
+
+	// Getting here without crashing is the test, the untouched module still reflects
+	CHECK(ShaderReflection::reflect(code).stages == VK_SHADER_STAGE_VERTEX_BIT);
+}
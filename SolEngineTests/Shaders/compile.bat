@@ -0,0 +1,8 @@
+REM https://vulkan.lunarg.com/doc/view/1.0.61.1/windows/spirv_toolchain.html
+
+REM Benchmark-only shaders, loaded from ../SolEngineTests/Shaders with SolEngine/ as the working directory
+C:/VulkanSDK/1.0.65.0/Bin/glslangValidator.exe -V draw_push.vert -o draw_push.spv
+C:/VulkanSDK/1.0.65.0/Bin/glslangValidator.exe -V draw_ubo.vert -o draw_ubo.spv
+C:/VulkanSDK/1.0.65.0/Bin/glslangValidator.exe -V flat.frag -o flat.spv
+
+pause
\ No newline at end of file
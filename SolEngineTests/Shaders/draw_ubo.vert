@@ -0,0 +1,17 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+// Per-draw model matrix from a dynamic uniform buffer offset, see DrawBenchmarks.cpp
+layout(binding = 0) uniform Object {
+    mat4 model;
+} object;
+
+out gl_PerVertex {
+    vec4 gl_Position;
+};
+
+void main() {
+    // A small triangle from the vertex index, no vertex buffer
+    const vec2 corner = vec2(float(gl_VertexIndex & 1), float(gl_VertexIndex >> 1)) * 0.05;
+    gl_Position = object.model * vec4(corner, 0.5, 1.0);
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <vector>
+
+// Just enough of a test framework for the engine's unit tests. TEST(name) defines a case and registers it
+// with the runner in main.cpp, CHECK records a failure and carries on so one run reports everything.
+// BENCHMARK(name) cases print timings and only run when the command line names them.
+
+namespace Test {
+	/***********************************************************************************/
+	struct Case {
+		const char* name;
+		void (*run)();
+		bool benchmark;
+	};
+	/***********************************************************************************/
+
+	inline std::vector<Case>& cases() {
+		static std::vector<Case> registered;
+		return registered;
+	}
+
+	/***********************************************************************************/
+	struct State {
+		std::size_t failures = 0;
+		bool skipped = false;
+	};
+
+	inline State& state() {
+		static State current;
+		return current;
+	}
+
+	/***********************************************************************************/
+	struct Registrar {
+		Registrar(const char* name, void (*run)(), const bool benchmark) {
+			cases().push_back({ name, run, benchmark });
+		}
+	};
+
+	/***********************************************************************************/
+	inline void fail(const char* file, const int line, const char* expression) {
+		std::printf("  %s(%d): CHECK(%s) failed\n", file, line, expression);
+		++state().failures;
+	}
+
+	/***********************************************************************************/
+	inline void skip(const char* reason) {
+		std::printf("  skipped: %s\n", reason);
+		state().skipped = true;
+	}
+
+	/***********************************************************************************/
+	// Fastest of a few runs of work, in milliseconds. The minimum is the least disturbed by the rest of the machine.
+	template <typename Work>
+	double milliseconds(Work&& work, const int runs = 5) {
+		auto fastest = std::numeric_limits<double>::max();
+		for (int run = 0; run < runs; ++run) {
+			const auto start = std::chrono::steady_clock::now();
+			work();
+			fastest = std::min(fastest, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+		}
+		return fastest;
+	}
+
+	/***********************************************************************************/
+	// Relative tolerance for values that grow large, absolute near zero
+	inline bool near(const float a, const float b, const float tolerance) {
+		return std::abs(a - b) <= tolerance * std::fmax(1.0f, std::fmax(std::abs(a), std::abs(b)));
+	}
+}
+
+#define TEST(name) \
+	static void name(); \
+	static const Test::Registrar name##Registrar { #name, name, false }; \
+	static void name()
+
+#define BENCHMARK(name) \
+	static void name(); \
+	static const Test::Registrar name##Registrar { #name, name, true }; \
+	static void name()
+
+// Variadic so template argument lists don't need extra parentheses
+#define CHECK(...) \
+	do { if (!(__VA_ARGS__)) { Test::fail(__FILE__, __LINE__, #__VA_ARGS__); } } while (false)
+
+#define CHECK_NEAR(a, b, tolerance) \
+	do { if (!Test::near((a), (b), (tolerance))) { Test::fail(__FILE__, __LINE__, #a " ~= " #b); } } while (false)
+
+// Ends the current test without failing, e.g. when the machine lacks the hardware it needs
+#define SKIP(reason) \
+	do { Test::skip(reason); return; } while (false)
@@ -0,0 +1,379 @@
+#define VMA_IMPLEMENTATION
+#include "TestDevice.h"
+
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+/***********************************************************************************/
+TestDevice::TestDevice() {
+	VkApplicationInfo appInfo {};
+	appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+	appInfo.pApplicationName = "SolEngineTests";
+	appInfo.apiVersion = VK_API_VERSION_1_0;
+
+	VkInstanceCreateInfo instanceInfo {};
+	instanceInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+	instanceInfo.pApplicationInfo = &appInfo;
+
+	if (vkCreateInstance(&instanceInfo, nullptr, &m_instance) != VK_SUCCESS) {
+		m_instance = VK_NULL_HANDLE;
+		return;
+	}
+
+	// Any device with a compute queue
+	std::uint32_t deviceCount = 0;
+	vkEnumeratePhysicalDevices(m_instance, &deviceCount, nullptr);
+	std::vector<VkPhysicalDevice> devices(deviceCount);
+	vkEnumeratePhysicalDevices(m_instance, &deviceCount, devices.data());
+
+	for (const auto device : devices) {
+		std::uint32_t familyCount = 0;
+		vkGetPhysicalDeviceQueueFamilyProperties(device, &familyCount, nullptr);
+		std::vector<VkQueueFamilyProperties> families(familyCount);
+		vkGetPhysicalDeviceQueueFamilyProperties(device, &familyCount, families.data());
+
+		for (std::uint32_t i = 0; i < familyCount && m_physicalDevice == VK_NULL_HANDLE; ++i) {
+			if (families[i].queueFlags & VK_QUEUE_COMPUTE_BIT) {
+				m_physicalDevice = device;
+				m_queueFamily = i;
+			}
+		}
+	}
+
+	if (m_physicalDevice == VK_NULL_HANDLE) {
+		return;
+	}
+
+	const auto priority = 1.0f;
+	VkDeviceQueueCreateInfo queueInfo {};
+	queueInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+	queueInfo.queueFamilyIndex = m_queueFamily;
+	queueInfo.queueCount = 1;
+	queueInfo.pQueuePriorities = &priority;
+
+	VkDeviceCreateInfo deviceInfo {};
+	deviceInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+	deviceInfo.queueCreateInfoCount = 1;
+	deviceInfo.pQueueCreateInfos = &queueInfo;
+
+	if (vkCreateDevice(m_physicalDevice, &deviceInfo, nullptr, &m_device) != VK_SUCCESS) {
+		m_device = VK_NULL_HANDLE;
+		return;
+	}
+	vkGetDeviceQueue(m_device, m_queueFamily, 0, &m_queue);
+
+	VkCommandPoolCreateInfo poolInfo {};
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.queueFamilyIndex = m_queueFamily;
+	vkCreateCommandPool(m_device, &poolInfo, nullptr, &m_commandPool);
+
+	const VkDescriptorPoolSize poolSizes[] {
+		{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 64 },
+		{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 256 },
+		{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 64 },
+		{ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 64 }
+	};
+
+	VkDescriptorPoolCreateInfo descriptorPoolInfo {};
+	descriptorPoolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	descriptorPoolInfo.maxSets = 64;
+	descriptorPoolInfo.poolSizeCount = static_cast<std::uint32_t>(std::size(poolSizes));
+	descriptorPoolInfo.pPoolSizes = poolSizes;
+	vkCreateDescriptorPool(m_device, &descriptorPoolInfo, nullptr, &m_descriptorPool);
+
+	VmaAllocatorCreateInfo allocatorInfo {};
+	allocatorInfo.physicalDevice = m_physicalDevice;
+	allocatorInfo.device = m_device;
+	vmaCreateAllocator(&allocatorInfo, &m_allocator);
+
+	m_layoutCache.init(m_device);
+}
+
+/***********************************************************************************/
+TestDevice::~TestDevice() {
+	if (m_device != VK_NULL_HANDLE) {
+		vkDeviceWaitIdle(m_device);
+
+		for (const auto pipeline : m_pipelines) {
+			vkDestroyPipeline(m_device, pipeline, nullptr);
+		}
+		for (const auto sampler : m_samplers) {
+			vkDestroySampler(m_device, sampler, nullptr);
+		}
+		for (const auto& image : m_images) {
+			vkDestroyImageView(m_device, image.view, nullptr);
+			vkDestroyImage(m_device, image.image, nullptr);
+			vkFreeMemory(m_device, image.memory, nullptr);
+		}
+		for (const auto& buffer : m_buffers) {
+			vkDestroyBuffer(m_device, buffer.buffer, nullptr);
+			vkFreeMemory(m_device, buffer.memory, nullptr);
+		}
+
+		m_layoutCache.shutdown();
+		vmaDestroyAllocator(m_allocator);
+		vkDestroyDescriptorPool(m_device, m_descriptorPool, nullptr);
+		vkDestroyCommandPool(m_device, m_commandPool, nullptr);
+		vkDestroyDevice(m_device, nullptr);
+	}
+
+	if (m_instance != VK_NULL_HANDLE) {
+		vkDestroyInstance(m_instance, nullptr);
+	}
+}
+
+/***********************************************************************************/
+std::vector<char> TestDevice::readFile(const char* path) {
+	std::ifstream file(path, std::ios::ate | std::ios::binary);
+	if (!file.is_open()) {
+		return {};
+	}
+
+	std::vector<char> code(static_cast<std::size_t>(file.tellg()));
+	file.seekg(0);
+	file.read(code.data(), code.size());
+	return code;
+}
+
+/***********************************************************************************/
+TestDevice::Buffer TestDevice::createBuffer(const VkDeviceSize size, const VkBufferUsageFlags usage) {
+	VkBufferCreateInfo bufferInfo {};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = size;
+	bufferInfo.usage = usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	Buffer buffer;
+	vkCreateBuffer(m_device, &bufferInfo, nullptr, &buffer.buffer);
+
+	VkMemoryRequirements requirements;
+	vkGetBufferMemoryRequirements(m_device, buffer.buffer, &requirements);
+	buffer.memory = allocate(requirements, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+	vkBindBufferMemory(m_device, buffer.buffer, buffer.memory, 0);
+
+	vkMapMemory(m_device, buffer.memory, 0, VK_WHOLE_SIZE, 0, &buffer.data);
+	std::memset(buffer.data, 0, static_cast<std::size_t>(size));
+
+	m_buffers.push_back(buffer);
+	return buffer;
+}
+
+/***********************************************************************************/
+TestDevice::Image TestDevice::createImage(const std::uint32_t width, const std::uint32_t height, const VkFormat format, const VkImageUsageFlags usage,
+	const VkSampleCountFlagBits samples) {
+	VkImageCreateInfo imageInfo {};
+	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageInfo.format = format;
+	imageInfo.extent = { width, height, 1 };
+	imageInfo.mipLevels = 1;
+	imageInfo.arrayLayers = 1;
+	imageInfo.samples = samples;
+	imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageInfo.usage = usage;
+	imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+	Image image;
+	vkCreateImage(m_device, &imageInfo, nullptr, &image.image);
+
+	VkMemoryRequirements requirements;
+	vkGetImageMemoryRequirements(m_device, image.image, &requirements);
+	image.memory = allocate(requirements, 0);
+	vkBindImageMemory(m_device, image.image, image.memory, 0);
+
+	VkImageViewCreateInfo viewInfo {};
+	viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	viewInfo.image = image.image;
+	viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	viewInfo.format = format;
+	const auto depth = format == VK_FORMAT_D16_UNORM || format == VK_FORMAT_D32_SFLOAT;
+	viewInfo.subresourceRange = { static_cast<VkImageAspectFlags>(depth ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT), 0, 1, 0, 1 };
+	vkCreateImageView(m_device, &viewInfo, nullptr, &image.view);
+
+	m_images.push_back(image);
+	return image;
+}
+
+/***********************************************************************************/
+void TestDevice::transition(const VkCommandBuffer commandBuffer, const Image& image, const VkImageLayout oldLayout, const VkImageLayout newLayout,
+	const VkAccessFlags srcAccess, const VkAccessFlags dstAccess, const VkPipelineStageFlags srcStage, const VkPipelineStageFlags dstStage) {
+	VkImageMemoryBarrier barrier {};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.srcAccessMask = srcAccess;
+	barrier.dstAccessMask = dstAccess;
+	barrier.oldLayout = oldLayout;
+	barrier.newLayout = newLayout;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = image.image;
+	barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+	vkCmdPipelineBarrier(commandBuffer, srcStage, dstStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
+
+/***********************************************************************************/
+VkSampler TestDevice::createSampler() {
+	VkSamplerCreateInfo samplerInfo {};
+	samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerInfo.magFilter = VK_FILTER_NEAREST;
+	samplerInfo.minFilter = VK_FILTER_NEAREST;
+	samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+
+	auto sampler = VkSampler(VK_NULL_HANDLE);
+	vkCreateSampler(m_device, &samplerInfo, nullptr, &sampler);
+
+	m_samplers.push_back(sampler);
+	return sampler;
+}
+
+/***********************************************************************************/
+VkShaderModule TestDevice::createShaderModule(const char* path) const {
+	const auto code = readFile(path);
+	if (code.empty() || code.size() % sizeof(std::uint32_t) != 0) {
+		return VK_NULL_HANDLE;
+	}
+
+	VkShaderModuleCreateInfo moduleInfo {};
+	moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	moduleInfo.codeSize = code.size();
+	moduleInfo.pCode = reinterpret_cast<const std::uint32_t*>(code.data());
+
+	auto shaderModule = VkShaderModule(VK_NULL_HANDLE);
+	if (vkCreateShaderModule(m_device, &moduleInfo, nullptr, &shaderModule) != VK_SUCCESS) {
+		return VK_NULL_HANDLE;
+	}
+	return shaderModule;
+}
+
+/***********************************************************************************/
+TestDevice::ComputePipeline TestDevice::createComputePipeline(const char* path) {
+	const auto reflection = ShaderReflection::reflect(readFile(path));
+	if (reflection.stages != VK_SHADER_STAGE_COMPUTE_BIT) {
+		return {};
+	}
+
+	const auto shaderModule = createShaderModule(path);
+	if (shaderModule == VK_NULL_HANDLE) {
+		return {};
+	}
+
+	ComputePipeline pipeline;
+	std::vector<VkDescriptorSetLayout> setLayouts;
+	pipeline.layout = m_layoutCache.pipelineLayout(reflection, &setLayouts);
+
+	VkComputePipelineCreateInfo pipelineInfo {};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	pipelineInfo.stage.module = shaderModule;
+	pipelineInfo.stage.pName = "main";
+	pipelineInfo.layout = pipeline.layout;
+
+	const auto result = vkCreateComputePipelines(m_device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline.pipeline);
+	vkDestroyShaderModule(m_device, shaderModule, nullptr);
+	if (result != VK_SUCCESS) {
+		return {};
+	}
+	m_pipelines.push_back(pipeline.pipeline);
+
+	if (!setLayouts.empty()) {
+		VkDescriptorSetAllocateInfo allocInfo {};
+		allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		allocInfo.descriptorPool = m_descriptorPool;
+		allocInfo.descriptorSetCount = 1;
+		allocInfo.pSetLayouts = &setLayouts.front();
+		vkAllocateDescriptorSets(m_device, &allocInfo, &pipeline.descriptorSet);
+	}
+
+	return pipeline;
+}
+
+/***********************************************************************************/
+void TestDevice::bind(const ComputePipeline& pipeline, const std::uint32_t binding, const VkDescriptorType type, const Buffer& buffer) const {
+	const VkDescriptorBufferInfo bufferInfo { buffer.buffer, 0, VK_WHOLE_SIZE };
+
+	VkWriteDescriptorSet write {};
+	write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write.dstSet = pipeline.descriptorSet;
+	write.dstBinding = binding;
+	write.descriptorCount = 1;
+	write.descriptorType = type;
+	write.pBufferInfo = &bufferInfo;
+
+	vkUpdateDescriptorSets(m_device, 1, &write, 0, nullptr);
+}
+
+/***********************************************************************************/
+void TestDevice::bind(const ComputePipeline& pipeline, const std::uint32_t binding, const VkDescriptorType type, const Image& image, const VkSampler sampler, const VkImageLayout layout) const {
+	const VkDescriptorImageInfo imageInfo { sampler, image.view, layout };
+
+	VkWriteDescriptorSet write {};
+	write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write.dstSet = pipeline.descriptorSet;
+	write.dstBinding = binding;
+	write.descriptorCount = 1;
+	write.descriptorType = type;
+	write.pImageInfo = &imageInfo;
+
+	vkUpdateDescriptorSets(m_device, 1, &write, 0, nullptr);
+}
+
+/***********************************************************************************/
+VkCommandBuffer TestDevice::beginCommands() {
+	VkCommandBufferAllocateInfo allocInfo {};
+	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocInfo.commandPool = m_commandPool;
+	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocInfo.commandBufferCount = 1;
+
+	auto commandBuffer = VkCommandBuffer(VK_NULL_HANDLE);
+	vkAllocateCommandBuffers(m_device, &allocInfo, &commandBuffer);
+
+	VkCommandBufferBeginInfo beginInfo {};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	vkBeginCommandBuffer(commandBuffer, &beginInfo);
+
+	return commandBuffer;
+}
+
+/***********************************************************************************/
+void TestDevice::submitCommands(const VkCommandBuffer commandBuffer) {
+	vkEndCommandBuffer(commandBuffer);
+
+	VkSubmitInfo submitInfo {};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &commandBuffer;
+
+	vkQueueSubmit(m_queue, 1, &submitInfo, VK_NULL_HANDLE);
+	vkQueueWaitIdle(m_queue);
+
+	vkFreeCommandBuffers(m_device, m_commandPool, 1, &commandBuffer);
+}
+
+/***********************************************************************************/
+VkDeviceMemory TestDevice::allocate(const VkMemoryRequirements& requirements, const VkMemoryPropertyFlags properties) {
+	VkPhysicalDeviceMemoryProperties memoryProperties;
+	vkGetPhysicalDeviceMemoryProperties(m_physicalDevice, &memoryProperties);
+
+	VkMemoryAllocateInfo allocInfo {};
+	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocInfo.allocationSize = requirements.size;
+	for (std::uint32_t i = 0; i < memoryProperties.memoryTypeCount; ++i) {
+		if ((requirements.memoryTypeBits & (1u << i)) && (memoryProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+			allocInfo.memoryTypeIndex = i;
+			break;
+		}
+	}
+
+	auto memory = VkDeviceMemory(VK_NULL_HANDLE);
+	vkAllocateMemory(m_device, &allocInfo, nullptr, &memory);
+	return memory;
+}
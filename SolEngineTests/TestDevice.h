@@ -0,0 +1,99 @@
+#pragma once
+
+#include <Graphics/LayoutCache.h>
+
+#include <vk_mem_alloc.h>
+
+#include <cstdint>
+#include <vector>
+
+// Headless Vulkan device for tests that run the engine's compute shaders. Needs no window or surface, so any
+// implementation will do (a CPU one like lavapipe or SwiftShader on machines without a GPU). Tests SKIP
+// when valid() is false. Everything created through it is destroyed with it.
+class TestDevice {
+
+public:
+	/***********************************************************************************/
+	// Host visible and coherent, mapped for its whole life
+	struct Buffer {
+		VkBuffer buffer = VK_NULL_HANDLE;
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+		void* data = nullptr;
+	};
+	/***********************************************************************************/
+	struct Image {
+		VkImage image = VK_NULL_HANDLE;
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+		VkImageView view = VK_NULL_HANDLE;
+	};
+	/***********************************************************************************/
+	// Laid out from the module's reflection, with one descriptor set allocated for it
+	struct ComputePipeline {
+		VkPipeline pipeline = VK_NULL_HANDLE;
+		VkPipelineLayout layout = VK_NULL_HANDLE;
+		VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+	};
+	/***********************************************************************************/
+
+	TestDevice();
+	~TestDevice();
+	TestDevice(const TestDevice&) = delete;
+	TestDevice& operator=(const TestDevice&) = delete;
+
+	bool valid() const noexcept { return m_device != VK_NULL_HANDLE; }
+	auto device() const noexcept { return m_device; }
+	auto physicalDevice() const noexcept { return m_physicalDevice; }
+	// For engine code that allocates through VMA, like the render graph
+	auto allocator() const noexcept { return m_allocator; }
+
+	// Relative to SolEngine/, the tests' working directory, e.g. "Data/Shaders/cull.spv". Empty if it isn't there.
+	static std::vector<char> readFile(const char* path);
+
+	// Zeroed
+	Buffer createBuffer(const VkDeviceSize size, const VkBufferUsageFlags usage);
+	// Single level, in VK_IMAGE_LAYOUT_UNDEFINED. Depth formats get a depth view.
+	Image createImage(const std::uint32_t width, const std::uint32_t height, const VkFormat format, const VkImageUsageFlags usage,
+		const VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT);
+	// Nearest filtering, clamped
+	VkSampler createSampler();
+	// VK_NULL_HANDLE if the file can't be read or isn't SPIR-V. Destroyed by the caller.
+	VkShaderModule createShaderModule(const char* path) const;
+	// Invalid pipeline if the shader can't be read or doesn't reflect as a compute shader
+	ComputePipeline createComputePipeline(const char* path);
+
+	// Set 0 of the pipeline
+	void bind(const ComputePipeline& pipeline, const std::uint32_t binding, const VkDescriptorType type, const Buffer& buffer) const;
+	void bind(const ComputePipeline& pipeline, const std::uint32_t binding, const VkDescriptorType type, const Image& image, const VkSampler sampler, const VkImageLayout layout) const;
+
+	// Whole-image layout transition of a single level color image
+	static void transition(const VkCommandBuffer commandBuffer, const Image& image, const VkImageLayout oldLayout, const VkImageLayout newLayout,
+		const VkAccessFlags srcAccess, const VkAccessFlags dstAccess, const VkPipelineStageFlags srcStage, const VkPipelineStageFlags dstStage);
+
+	// Records with record, submits and waits for the queue to finish
+	template <typename Record>
+	void run(Record&& record) {
+		const auto commandBuffer = beginCommands();
+		record(commandBuffer);
+		submitCommands(commandBuffer);
+	}
+
+private:
+	VkCommandBuffer beginCommands();
+	void submitCommands(const VkCommandBuffer commandBuffer);
+	VkDeviceMemory allocate(const VkMemoryRequirements& requirements, const VkMemoryPropertyFlags properties);
+
+	VkInstance m_instance = VK_NULL_HANDLE;
+	VkPhysicalDevice m_physicalDevice = VK_NULL_HANDLE;
+	VkDevice m_device = VK_NULL_HANDLE;
+	VkQueue m_queue = VK_NULL_HANDLE;
+	std::uint32_t m_queueFamily = 0;
+	VkCommandPool m_commandPool = VK_NULL_HANDLE;
+	VkDescriptorPool m_descriptorPool = VK_NULL_HANDLE;
+	VmaAllocator m_allocator = VK_NULL_HANDLE;
+	LayoutCache m_layoutCache;
+
+	std::vector<Buffer> m_buffers;
+	std::vector<Image> m_images;
+	std::vector<VkSampler> m_samplers;
+	std::vector<VkPipeline> m_pipelines;
+};
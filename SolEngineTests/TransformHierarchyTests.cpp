@@ -0,0 +1,166 @@
+#include "Test.h"
+
+#include <Scene/TransformHierarchy.h>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <random>
+
+namespace {
+	/***********************************************************************************/
+	// Whole columns at a time: glm's vec4 component indexing trips GCC's alias analysis
+	bool equal(const glm::mat4& a, const glm::mat4& b) {
+		for (int column = 0; column < 4; ++column) {
+			const auto scale = glm::max(glm::vec4(1.0f), glm::max(glm::abs(a[column]), glm::abs(b[column])));
+			if (glm::any(glm::greaterThan(glm::abs(a[column] - b[column]), scale * 1e-4f))) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	/***********************************************************************************/
+	// World matrix by walking up the parents, the way the hierarchy is defined
+	glm::mat4 bruteForceWorld(const TransformHierarchy& hierarchy, TransformHierarchy::Handle node) {
+		auto world = hierarchy.local(node);
+		for (auto parent = hierarchy.parent(node); parent != TransformHierarchy::InvalidHandle; parent = hierarchy.parent(parent)) {
+			world = hierarchy.local(parent) * world;
+		}
+		return world;
+	}
+}
+
+/***********************************************************************************/
+TEST(TransformHierarchyMatchesBruteForce) {
+	TransformHierarchy hierarchy;
+
+	std::mt19937 random(7);
+	std::uniform_real_distribution<float> offset(-1.0f, 1.0f);
+	const auto randomLocal = [&]() {
+		return glm::rotate(glm::translate(glm::mat4(1.0f), glm::vec3(offset(random), offset(random), offset(random))), offset(random), glm::vec3(0.0f, 0.0f, 1.0f));
+	};
+
+	// Random forest, every node's parent created before it
+	std::vector<TransformHierarchy::Handle> nodes;
+	for (int i = 0; i < 2000; ++i) {
+		const auto parent = nodes.empty() || random() % 8 == 0 ? TransformHierarchy::InvalidHandle : nodes[random() % nodes.size()];
+		nodes.push_back(hierarchy.create(randomLocal(), parent));
+	}
+	hierarchy.update();
+
+	for (const auto node : nodes) {
+		CHECK(equal(hierarchy.world(node), bruteForceWorld(hierarchy, node)));
+	}
+
+	// Dirty a few nodes and reparent a few subtrees
+	for (int i = 0; i < 50; ++i) {
+		hierarchy.setLocal(nodes[random() % nodes.size()], randomLocal());
+		hierarchy.setParent(nodes[random() % nodes.size()], nodes[random() % nodes.size()]);
+	}
+	hierarchy.update();
+
+	for (const auto node : nodes) {
+		CHECK(equal(hierarchy.world(node), bruteForceWorld(hierarchy, node)));
+	}
+}
+
+/***********************************************************************************/
+TEST(TransformHierarchyDeadHandles) {
+	TransformHierarchy hierarchy;
+
+	const auto root = hierarchy.create(glm::translate(glm::mat4(1.0f), glm::vec3(1.0f, 0.0f, 0.0f)));
+	const auto child = hierarchy.create(glm::mat4(1.0f), root);
+	const auto other = hierarchy.create();
+	hierarchy.update();
+
+	hierarchy.destroy(root);
+	// The child goes with its parent, but only once update() has run
+	CHECK(!hierarchy.isAlive(root));
+	CHECK(hierarchy.isAlive(child));
+
+	// Writes through the destroyed handle are dropped
+	hierarchy.setLocal(root, glm::mat4(2.0f));
+	hierarchy.setParent(root, other);
+	hierarchy.update();
+
+	CHECK(!hierarchy.isAlive(child));
+	CHECK(hierarchy.size() == 1);
+
+	// Released handles are ignored too, and never become anyone's parent
+	hierarchy.setLocal(child, glm::mat4(2.0f));
+	hierarchy.setParent(child, other);
+	hierarchy.setParent(other, child);
+	hierarchy.update();
+
+	CHECK(hierarchy.isAlive(other));
+	CHECK(hierarchy.parent(other) == TransformHierarchy::InvalidHandle);
+	CHECK(equal(hierarchy.world(other), glm::mat4(1.0f)));
+
+	// Handles are recycled for new nodes
+	const auto recycled = hierarchy.create(glm::mat4(1.0f), other);
+	CHECK(recycled == root || recycled == child);
+	hierarchy.update();
+	CHECK(hierarchy.size() == 2);
+	CHECK(hierarchy.parent(recycled) == other);
+}
+
+/***********************************************************************************/
+// Frame cost of setLocal on a random 1% / 100% of 100k nodes plus update(), against a scene with nothing
+// to do. 1000 top-level subtrees of 100 nodes, each node parented to a random earlier one of its subtree.
+BENCHMARK(BenchmarkTransformHierarchy100k) {
+	constexpr std::uint32_t TreeCount = 1000, TreeSize = 100, NodeCount = TreeCount * TreeSize;
+
+	std::mt19937 random(36);
+	std::uniform_real_distribution<float> offset(-2.0f, 2.0f), angle(-3.0f, 3.0f);
+	const auto randomLocal = [&]() {
+		return glm::rotate(glm::translate(glm::mat4(1.0f), glm::vec3(offset(random), offset(random), offset(random))), angle(random), glm::vec3(0.0f, 0.0f, 1.0f));
+	};
+
+	TransformHierarchy hierarchy;
+	std::vector<TransformHierarchy::Handle> nodes;
+	nodes.reserve(NodeCount);
+	for (std::uint32_t tree = 0; tree < TreeCount; ++tree) {
+		const auto root = static_cast<std::uint32_t>(nodes.size());
+		nodes.push_back(hierarchy.create(randomLocal()));
+		for (std::uint32_t i = 1; i < TreeSize; ++i) {
+			nodes.push_back(hierarchy.create(randomLocal(), nodes[root + random() % i]));
+		}
+	}
+	hierarchy.update();
+
+	// Matrices are generated up front so only the hierarchy is timed
+	std::vector<glm::mat4> locals(NodeCount);
+	for (auto& local : locals) {
+		local = randomLocal();
+	}
+
+	const auto clean = Test::milliseconds([&]() { hierarchy.update(); });
+
+	std::vector<std::uint32_t> dirtyNodes(NodeCount / 100);
+	for (auto& node : dirtyNodes) {
+		node = random() % NodeCount;
+	}
+	const auto onePercent = Test::milliseconds([&]() {
+		for (const auto node : dirtyNodes) {
+			hierarchy.setLocal(nodes[node], locals[node]);
+		}
+		hierarchy.update();
+	});
+
+	const auto all = Test::milliseconds([&]() {
+		for (std::uint32_t node = 0; node < NodeCount; ++node) {
+			hierarchy.setLocal(nodes[node], locals[node]);
+		}
+		hierarchy.update();
+	});
+
+	// Everything was rewritten, spot check the result
+	for (std::uint32_t node = 0; node < NodeCount; node += 997) {
+		CHECK(equal(hierarchy.world(nodes[node]), bruteForceWorld(hierarchy, nodes[node])));
+	}
+
+	std::printf("  %u nodes in %u subtrees\n", NodeCount, TreeCount);
+	std::printf("  %-12s %10.3f ms\n", "0% dirty", clean);
+	std::printf("  %-12s %10.3f ms\n", "1% dirty", onePercent);
+	std::printf("  %-12s %10.3f ms\n", "100% dirty", all);
+}
@@ -0,0 +1,43 @@
+#include "Test.h"
+
+#include <spdlog/spdlog.h>
+
+#include <cstring>
+
+// Runs every registered test, or only those whose name contains the first argument. Benchmarks
+// only run when named that way. Returns non-zero if anything failed so it can gate a build.
+int main(int argc, char** argv) {
+	const auto console = spdlog::stdout_color_mt("console");
+
+	const char* filter = argc > 1 ? argv[1] : nullptr;
+
+	std::size_t run = 0, failed = 0, skipped = 0;
+	for (const auto& testCase : Test::cases()) {
+		if (filter ? !std::strstr(testCase.name, filter) : testCase.benchmark) {
+			continue;
+		}
+
+		std::printf("[ RUN  ] %s\n", testCase.name);
+
+		auto& state = Test::state();
+		state = {};
+		testCase.run();
+		++run;
+
+		if (state.failures > 0) {
+			std::printf("[ FAIL ] %s (%zu checks)\n", testCase.name, state.failures);
+			++failed;
+		}
+		else if (state.skipped) {
+			std::printf("[ SKIP ] %s\n", testCase.name);
+			++skipped;
+		}
+		else {
+			std::printf("[  OK  ] %s\n", testCase.name);
+		}
+	}
+
+	std::printf("%zu tests, %zu failed, %zu skipped\n", run, failed, skipped);
+
+	return failed > 0 ? 1 : 0;
+}